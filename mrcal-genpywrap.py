@@ -72,6 +72,26 @@ bool validate_lensmodel_un_project(// out; valid if we returned true
 
     return true;
 }
+
+// The strided C kernels use stride <= 0 to mean "contiguous". So I can pass
+// numpy strides directly only if they're positive. Dimensions of length 1 are
+// never stepped through, so their strides don't matter
+static
+bool validate_positive_strides(const char* what,
+                               int Ndims,
+                               const npy_intp* dims,
+                               const npy_intp* strides)
+{
+    for(int i=0; i<Ndims; i++)
+        if(dims[i] > 1 && strides[i] <= 0)
+        {
+            PyErr_Format(PyExc_RuntimeError,
+                         "'%s' must have positive strides. Dimension %d has stride %d",
+                         what, i, (int)strides[i]);
+            return false;
+        }
+    return true;
+}
 ''')
 
 
@@ -210,6 +230,77 @@ _project_withgrad() in mrcal-genpywrap.py. Please keep them in sync
 '''},
 )
 
+m.function( "_project_cahvore",
+            """Internal batched CAHVORE point-projection routine
+
+This is the internals for mrcal.project() when projecting with a CAHVORE model
+without gradients. As a user, please call mrcal.project(), and see the docs for
+that function. The differences:
+
+- _project() evaluates one point per broadcasted slice. Here each slice is a
+  whole set of points: the leading dimension of the points array. The per-model
+  setup happens once per slice, and the projection loop runs in C
+
+- The points may have any strides: the C kernel reads the x,y,z values directly
+  from the numpy array, without making a contiguous copy
+
+- To make the broadcasting work, the argument order in this function is
+  different. numpysane_pywrap broadcasts the leading arguments, so this function
+  takes the lensmodel (the one argument that does not broadcast) last
+
+""",
+
+            args_input       = ('points', 'intrinsics'),
+            prototype_input  = (('N',3), ('Nintrinsics',)),
+            prototype_output = ('N',2),
+
+            extra_args = (("const char*", "lensmodel", "NULL", "s"),),
+
+            Ccode_cookie_struct = '''
+              mrcal_lensmodel_t lensmodel;
+            ''',
+
+            Ccode_validate = r'''
+              if( !validate_lensmodel_un_project(&cookie->lensmodel,
+                                      lensmodel, dims_slice__intrinsics[0], true) )
+                  return false;
+              if( cookie->lensmodel.type != MRCAL_LENSMODEL_CAHVORE )
+              {
+                  PyErr_Format(PyExc_RuntimeError,
+                               "_project_cahvore() works only with LENSMODEL_CAHVORE. Got '%s'",
+                               lensmodel);
+                  return false;
+              }
+              return
+                  validate_positive_strides("points", 2, dims_slice__points, strides_slice__points) &&
+                  validate_positive_strides("output", 2, dims_slice__output, strides_slice__output) &&
+                  CHECK_CONTIGUOUS_AND_SETERROR__intrinsics();
+''',
+
+            Ccode_slice_eval = \
+                {np.float64:
+                 r'''
+                 const int N = dims_slice__points[0];
+                 const double* p = (const double*)data_slice__points;
+                 double*       q = (double*)data_slice__output;
+
+                 return
+                     _mrcal_project_internal_cahvore_soa(
+                                &q[0], strides_slice__output[0],
+                                (double*)&((char*)q)[strides_slice__output[1]],
+                                strides_slice__output[0],
+
+                                &p[0], strides_slice__points[0],
+                                (const double*)&((const char*)p)[  strides_slice__points[1]],
+                                strides_slice__points[0],
+                                (const double*)&((const char*)p)[2*strides_slice__points[1]],
+                                strides_slice__points[0],
+                                N,
+                                (const double*)data_slice__intrinsics,
+                                cookie->lensmodel.LENSMODEL_CAHVORE__config.linearity);
+'''},
+)
+
 m.function( "_project_withgrad",
             """Internal point-projection routine
 
@@ -250,9 +341,15 @@ _project_withgrad() in mrcal-genpywrap.py. Please keep them in sync
             ''',
 
             Ccode_validate = r'''
+              // The points and the outputs may have any strides: the
+              // projection kernel reads and writes them directly
               if( !( validate_lensmodel_un_project(&cookie->lensmodel,
                                         lensmodel, dims_slice__intrinsics[0], true) &&
-                     CHECK_CONTIGUOUS_AND_SETERROR_ALL()))
+                     validate_positive_strides("points",  1, dims_slice__points,  strides_slice__points ) &&
+                     validate_positive_strides("output0", 1, dims_slice__output0, strides_slice__output0) &&
+                     validate_positive_strides("output1", 2, dims_slice__output1, strides_slice__output1) &&
+                     validate_positive_strides("output2", 2, dims_slice__output2, strides_slice__output2) &&
+                     CHECK_CONTIGUOUS_AND_SETERROR__intrinsics()))
                   return false;
 
               mrcal_lensmodel_metadata_t meta = mrcal_lensmodel_metadata(&cookie->lensmodel);
@@ -271,17 +368,29 @@ _project_withgrad() in mrcal-genpywrap.py. Please keep them in sync
                 {np.float64:
                  r'''
                  const int N = 1;
-
+                 const double* p = (const double*)data_slice__points;
+                 double*       q = (double*)data_slice__output0;
                  return
-                     _mrcal_project_internal((mrcal_point2_t*)data_slice__output0,
-                                             (mrcal_point3_t*)data_slice__output1,
-                                             (double*)  data_slice__output2,
-                                             (const mrcal_point3_t*)data_slice__points,
-                                             N,
-                                             &cookie->lensmodel,
-                                             // core, distortions concatenated
-                                             (const double*)data_slice__intrinsics,
-                                             cookie->Nintrinsics, &cookie->precomputed);
+                     _mrcal_project_internal_soa(&q[0], 0,
+                                                 (double*)&((char*)q)[strides_slice__output0[0]], 0,
+                                                 (double*)data_slice__output1,
+                                                 0,
+                                                 strides_slice__output1[0],
+                                                 strides_slice__output1[1],
+                                                 (double*)data_slice__output2,
+                                                 0,
+                                                 strides_slice__output2[0],
+                                                 strides_slice__output2[1],
+                                                 0, cookie->Nintrinsics,
+
+                                                 &p[0], 0,
+                                                 (const double*)&((const char*)p)[  strides_slice__points[0]], 0,
+                                                 (const double*)&((const char*)p)[2*strides_slice__points[0]], 0,
+                                                 N,
+                                                 &cookie->lensmodel,
+                                                 // core, distortions concatenated
+                                                 (const double*)data_slice__intrinsics,
+                                                 cookie->Nintrinsics, &cookie->precomputed);
 '''},
 )
 
@@ -473,98 +582,6 @@ for what in ('pinhole', 'stereographic', 'lonlat', 'latlon'):
                 **unproject_withgrad_simple_kwargs,
                 **simple_kwargs_base )
 
-m.function( "_A_Jt_J_At",
-            """Computes matmult(A,Jt,J,At) for a sparse J
-
-This is used in the internals of projection_uncertainty().
-
-A has shape (2,Nstate)
-
-J has shape (Nmeasurements,Nstate). J is large and sparse
-
-We use the Nleading_rows_J leading rows of J. This integer is passed-in as an
-argument.
-
-matmult(A, Jt, J, At) has shape (2,2)
-
-The input matrices are large, but the result is very small. I can't see a way to
-do this efficiently in pure Python, so I'm writing this.
-
-J is sparse, stored by row. This is the scipy.sparse.csr_matrix representation,
-and is also how CHOLMOD stores Jt (CHOLMOD stores by column, so the same data
-looks like Jt to CHOLMOD). The sparse J is given here as the p,i,x arrays from
-CHOLMOD, equivalent to the indptr,indices,data members of
-scipy.sparse.csr_matrix respectively.
- """,
-
-            args_input       = ('A', 'Jp', 'Ji', 'Jx'),
-            prototype_input  = (('Nx','Nstate'), ('Np',), ('Nix',), ('Nix',)),
-            prototype_output = ('Nx','Nx'),
-
-            extra_args = (("int", "Nleading_rows_J", "-1", "i"),),
-
-            Ccode_validate = r'''
-            if(*Nleading_rows_J <= 0)
-            {
-                PyErr_Format(PyExc_RuntimeError,
-                             "Nleading_rows_J must be passed, and must be > 0");
-                return false;
-            }
-            return CHECK_CONTIGUOUS_AND_SETERROR_ALL();''',
-
-            Ccode_slice_eval = \
-                { (np.float64, np.int32, np.int32, np.float64, np.float64):
-                 r'''
-
-                 // I'm computing A Jt J At = sum(outer(ja,ja)) where ja is each
-                 // row of matmult(J,At). Rows of matmult(J,At) are
-                 // matmult(jt,At) where jt are rows of J. So the logic is:
-                 //
-                 //   For each row jt of J:
-                 //     jta = matmult(jt,At); // jta has shape (Nx,)
-                 //     accumulate( outer(jta,jta) )
-
-
-                 int32_t Nx     = dims_slice__A[0];
-                 int32_t Nstate = dims_slice__A[1];
-
-                 const double*   A = (const double* )data_slice__A;
-                 const int32_t* Jp = (const int32_t*)data_slice__Jp;
-                 const int32_t* Ji = (const int32_t*)data_slice__Ji;
-                 const double*  Jx = (const double* )data_slice__Jx;
-                 double* out       = (      double* )data_slice__output;
-
-                 for(int i=0; i<Nx*Nx; i++)
-                     out[i] = 0.0;
-
-                 for(int irow=0; irow<*Nleading_rows_J; irow++)
-                 {
-                     double jta[Nx];
-                     for(int i=0; i<Nx; i++)
-                         jta[i] = 0.0;
-
-                     for(int32_t i = Jp[irow]; i < Jp[irow+1]; i++)
-                     {
-                         int32_t icol = Ji[i];
-                         double x     = Jx[i];
-
-                         for(int j=0; j<Nx; j++)
-                             jta[j] += A[icol + j*Nstate] * x;
-                     }
-                     for(int i=0; i<Nx; i++)
-                     {
-                         out[i*Nx + i] += jta[i]*jta[i];
-                         for(int j=i+1; j<Nx; j++)
-                         {
-                             out[i*Nx + j] += jta[i]*jta[j];
-                             out[j*Nx + i] += jta[i]*jta[j];
-                         }
-                     }
-                 }
-                 return true;
-'''},
-)
-
 
 apply_homography_body = \
 r'''
@@ -37,6 +37,118 @@
 // and on any theory of liability, whether in contract, strict liability,
 // or tort (including negligence or otherwise) arising in any way out of
 
+// The fixed-intrinsics path: we want q and maybe dq/dp, but no intrinsics
+// gradients. This is what we do when projecting with a known model, such as
+// when reprojecting images or computing stereo maps. Ndistortions is always a
+// compile-time constant here (the function is always inlined into a switch()),
+// so the terms that the model doesn't have are compiled away. The polynomials
+// are evaluated with Horner's rule, and the powers of r^2 are shared between
+// the radial, tangential and thin-prism terms
+static inline __attribute__((always_inline))
+void project_opencv_fixed_intrinsics( // outputs
+                                     mrcal_point2_t* q,
+                                     mrcal_point3_t* dq_dp, // may be NULL
+
+                                     // inputs
+                                     const mrcal_point3_t* p,
+                                     int N,
+                                     const double* intrinsics,
+                                     const int Ndistortions)
+{
+    const double fx = intrinsics[0];
+    const double fy = intrinsics[1];
+    const double cx = intrinsics[2];
+    const double cy = intrinsics[3];
+    const double* k = &intrinsics[4];
+
+    for( int i = 0; i < N; i++ )
+    {
+        double z_recip = 1./p[i].z;
+        double x = p[i].x * z_recip;
+        double y = p[i].y * z_recip;
+
+        if(Ndistortions == 0)
+        {
+            q[i].x = x*fx + cx;
+            q[i].y = y*fy + cy;
+            if( dq_dp )
+            {
+                dq_dp[i*2 + 0] = (mrcal_point3_t){.x = fx*z_recip, .y = 0,          .z = -fx*x*z_recip};
+                dq_dp[i*2 + 1] = (mrcal_point3_t){.x = 0,          .y = fy*z_recip, .z = -fy*y*z_recip};
+            }
+            continue;
+        }
+
+        double r2 = x*x + y*y;
+
+        // radial: R = cdist/denom
+        //   cdist = 1 + k0 r2 + k1 r4 + k4 r6
+        //   denom = 1 + k5 r2 + k6 r4 + k7 r6
+        double cdist, dcdist_dr2;
+        if(Ndistortions >= 5)
+        {
+            cdist     = 1. + r2*(k[0] + r2*(k[1] + r2*k[4]));
+            dcdist_dr2 =       k[0] + r2*(2.*k[1] + r2*3.*k[4]);
+        }
+        else
+        {
+            cdist      = 1. + r2*(k[0] + r2*k[1]);
+            dcdist_dr2 =       k[0] + r2*2.*k[1];
+        }
+
+        double R, dR_dr2;
+        if(Ndistortions >= 8)
+        {
+            double denom_recip = 1./(1. + r2*(k[5] + r2*(k[6] + r2*k[7])));
+            double ddenom_dr2  =            k[5] + r2*(2.*k[6] + r2*3.*k[7]);
+            R      = cdist*denom_recip;
+            dR_dr2 = (dcdist_dr2 - R*ddenom_dr2) * denom_recip;
+        }
+        else
+        {
+            R      = cdist;
+            dR_dr2 = dcdist_dr2;
+        }
+
+        // tangential: k2,k3
+        double a1 = 2.*x*y;
+        double xd = x*R + k[2]*a1 + k[3]*(r2 + 2.*x*x);
+        double yd = y*R + k[2]*(r2 + 2.*y*y) + k[3]*a1;
+
+        // thin prism: sx = s0 r2 + s1 r4, sy = s2 r2 + s3 r4
+        double dsx_dr2 = 0., dsy_dr2 = 0.;
+        if(Ndistortions >= 12)
+        {
+            xd += r2*(k[8]  + r2*k[9]);
+            yd += r2*(k[10] + r2*k[11]);
+            dsx_dr2 = k[8]  + 2.*r2*k[9];
+            dsy_dr2 = k[10] + 2.*r2*k[11];
+        }
+
+        q[i].x = xd*fx + cx;
+        q[i].y = yd*fy + cy;
+
+        if( dq_dp )
+        {
+            // d(xd,yd)/d(x,y). dr2/dx = 2x, dr2/dy = 2y
+            double dxd_dx = R + 2.*x*(x*dR_dr2 + dsx_dr2) + 2.*y*k[2] + 6.*x*k[3];
+            double dxd_dy =     2.*y*(x*dR_dr2 + dsx_dr2) + 2.*x*k[2] + 2.*y*k[3];
+            double dyd_dx =     2.*x*(y*dR_dr2 + dsy_dr2) + 2.*x*k[2] + 2.*y*k[3];
+            double dyd_dy = R + 2.*y*(y*dR_dr2 + dsy_dr2) + 6.*y*k[2] + 2.*x*k[3];
+
+            // d(x,y)/dp = [1/z 0 -x/z; 0 1/z -y/z]
+            dq_dp[i*2 + 0] = (mrcal_point3_t)
+                {.x =  fx*dxd_dx*z_recip,
+                 .y =  fx*dxd_dy*z_recip,
+                 .z = -fx*(dxd_dx*x + dxd_dy*y)*z_recip};
+            dq_dp[i*2 + 1] = (mrcal_point3_t)
+                {.x =  fy*dyd_dx*z_recip,
+                 .y =  fy*dyd_dy*z_recip,
+                 .z = -fy*(dyd_dx*x + dyd_dy*y)*z_recip};
+        }
+    }
+}
+
 // NOT A PART OF THE EXTERNAL API. This is exported for the mrcal python wrapper
 // only
 void _mrcal_project_internal_opencv( // outputs
@@ -50,6 +162,25 @@ void _mrcal_project_internal_opencv( // outputs
                                     const double* intrinsics,
                                     int Nintrinsics)
 {
+    if( !dq_dintrinsics_nocore )
+    {
+        switch(Nintrinsics-4)
+        {
+#define CASE_FIXED_INTRINSICS(Ndistortions)                             \
+        case Ndistortions:                                              \
+            project_opencv_fixed_intrinsics(q, dq_dp, p, N, intrinsics, Ndistortions); \
+            return;
+
+            CASE_FIXED_INTRINSICS(0)
+            CASE_FIXED_INTRINSICS(4)
+            CASE_FIXED_INTRINSICS(5)
+            CASE_FIXED_INTRINSICS(8)
+            CASE_FIXED_INTRINSICS(12)
+#undef CASE_FIXED_INTRINSICS
+        default: ;
+        }
+    }
+
     const double fx = intrinsics[0];
     const double fy = intrinsics[1];
     const double cx = intrinsics[2];
@@ -603,194 +603,2215 @@ CHOLMOD_factorization_solve_xt_JtJ_bt(CHOLMOD_factorization* self, PyObject* arg
     return result;
 }
 
+// Selected inversion of a simplicial CHOLMOD factor, using the Takahashi
+// equations. The factor L describes P JtJ Pt = L D Lt (if !is_ll: the unit
+// diagonal of L is not stored; D is stored in its place) or P JtJ Pt = L Lt (if
+// is_ll). Z = inv(P JtJ Pt) is computed in the sparsity pattern of L: Zx is
+// indexed like Lx. The row indices in each column of L needn't be sorted, but
+// the diagonal must be the first entry. Processing column j needs the columns
+// k > j of Z, so I go backwards:
+//
+//   Z[i,j] = -sum(l[k,j] Z[i,k]) for i,k in struct(L[:,j]) below the diagonal
+//   Z[j,j] = 1/d[j] - sum(l[k,j] Z[k,j])
+//
+// where l = L and d = D, or l[k,j] = L[k,j]/L[j,j] and d[j] = L[j,j]^2 if
+// is_ll. struct(L[:,j]) is a clique in the pattern of L+Lt, so every Z[i,k] we
+// need was already computed. Uses 2n doubles and n ints of workspace
+static bool
+selected_inverse_simplicial(// out
+                            double*       Zx,
+                            // in
+                            const int*    Lp,
+                            const int*    Li,
+                            const double* Lx,
+                            const int*    Lnz,
+                            int           n,
+                            bool          is_ll)
+{
+    double* l    = malloc(n*sizeof(double));
+    double* z    = malloc(n*sizeof(double));
+    int*    mark = malloc(n*sizeof(int));
+    if(l == NULL || z == NULL || mark == NULL)
+    {
+        free(l);
+        free(z);
+        free(mark);
+        return false;
+    }
+    for(int i=0; i<n; i++)
+        mark[i] = -1;
+
+    for(int j=n-1; j>=0; j--)
+    {
+        const int p0 = Lp[j];
+        const int p1 = Lp[j] + Lnz[j];
+
+        const double Ljj = Lx[p0];
+        const double dj  = is_ll ? Ljj*Ljj : Ljj;
+        const double s   = is_ll ? 1.0/Ljj : 1.0;
+
+        // Scatter the below-diagonal part of column j of l
+        for(int p=p0+1; p<p1; p++)
+        {
+            const int i = Li[p];
+            l   [i] = Lx[p] * s;
+            z   [i] = 0.0;
+            mark[i] = j;
+        }
+
+        // z[i] = sum(l[k,j] Z[i,k]) for all i,k in struct(L[:,j]). I only
+        // store the lower triangle of Z, so each off-diagonal Z[i,k] is used
+        // twice: for z[i] and for z[k]
+        for(int p=p0+1; p<p1; p++)
+        {
+            const int    k   = Li[p];
+            const double lkj = l[k];
+
+            z[k] += lkj * Zx[Lp[k]];
+            for(int q=Lp[k]+1; q<Lp[k]+Lnz[k]; q++)
+            {
+                const int i = Li[q];
+                if(mark[i] != j)
+                    continue;
+                z[i] += lkj  * Zx[q];
+                z[k] += l[i] * Zx[q];
+            }
+        }
+
+        double Zjj = 1.0/dj;
+        for(int p=p0+1; p<p1; p++)
+        {
+            const int i = Li[p];
+            Zx[p] = -z[i];
+            Zjj  += l[i] * z[i];
+        }
+        Zx[p0] = Zjj;
+    }
+
+    free(l);
+    free(z);
+    free(mark);
+    return true;
+}
+
+static PyObject*
+CHOLMOD_factorization_Var_dF(CHOLMOD_factorization* self, PyObject* args, PyObject* kwargs)
+{
+    // error by default
+    PyObject*      result = NULL;
+    PyArrayObject* Py_out = NULL;
+    PyArrayObject* dF     = NULL;
+    PyArrayObject* icol   = NULL;
+    PyArrayObject* Jp     = NULL;
+    PyArrayObject* Ji     = NULL;
+    PyArrayObject* Jx     = NULL;
+    double*        B      = NULL;
+    double*        jta    = NULL;
+    cholmod_dense* X      = NULL;
+    cholmod_dense* Y      = NULL;
+    cholmod_dense* E      = NULL;
+
+    char* keywords[] = {"dF", "icol",
+                        "Jp", "Ji", "Jx", "Nleading_rows_J",
+                        NULL};
+    PyObject* Py_dF   = NULL;
+    PyObject* Py_icol = NULL;
+    PyObject* Py_Jp   = Py_None;
+    PyObject* Py_Ji   = Py_None;
+    PyObject* Py_Jx   = Py_None;
+    int Nleading_rows_J = -1;
+
+    if(!(self->inited_common && self->factorization))
+    {
+        BARF("No factorization has been computed");
+        goto done;
+    }
+
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     "OO|OOOi", keywords,
+                                     &Py_dF, &Py_icol,
+                                     &Py_Jp, &Py_Ji, &Py_Jx, &Nleading_rows_J))
+        goto done;
+
+    const int Nstate = (int)self->factorization->n;
+
+    dF = (PyArrayObject*)PyArray_FROMANY(Py_dF, NPY_DOUBLE, 2, 0,
+                                         NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(dF == NULL)
+        goto done;
+    icol = (PyArrayObject*)PyArray_FROMANY(Py_icol, NPY_INT32, 1, 1,
+                                           NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(icol == NULL)
+        goto done;
+
+    const int ndim  = PyArray_NDIM(dF);
+    const int Ncols = (int)PyArray_DIMS(dF)[ndim-1];
+    const int Nf    = (int)PyArray_DIMS(dF)[ndim-2];
+    if(Ncols != (int)PyArray_DIMS(icol)[0])
+    {
+        BARF("dF must have shape (..., Nf, Ncols) and icol must have shape (Ncols,). Got Ncols=%d and %d",
+             Ncols, (int)PyArray_DIMS(icol)[0]);
+        goto done;
+    }
+    const int32_t* icol_data = (const int32_t*)PyArray_DATA(icol);
+    for(int i=0; i<Ncols; i++)
+        if(icol_data[i] < 0 || icol_data[i] >= Nstate)
+        {
+            BARF("icol must contain state indices in [0,%d). icol[%d] = %d",
+                 Nstate, i, icol_data[i]);
+            goto done;
+        }
+
+    const bool have_J = Py_Jp != Py_None || Py_Ji != Py_None || Py_Jx != Py_None;
+    if(have_J)
+    {
+        if(Py_Jp == Py_None || Py_Ji == Py_None || Py_Jx == Py_None)
+        {
+            BARF("Jp, Ji, Jx must be given together, or not at all");
+            goto done;
+        }
+        if(Nleading_rows_J <= 0)
+        {
+            BARF("J is given, so Nleading_rows_J must be given too, and must be > 0");
+            goto done;
+        }
+        Jp = (PyArrayObject*)PyArray_FROMANY(Py_Jp, NPY_INT32, 1, 1,
+                                             NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+        if(Jp == NULL) goto done;
+        Ji = (PyArrayObject*)PyArray_FROMANY(Py_Ji, NPY_INT32, 1, 1,
+                                             NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+        if(Ji == NULL) goto done;
+        Jx = (PyArrayObject*)PyArray_FROMANY(Py_Jx, NPY_DOUBLE, 1, 1,
+                                             NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+        if(Jx == NULL) goto done;
+        if(PyArray_DIMS(Jp)[0] <= Nleading_rows_J)
+        {
+            BARF("J has %d rows, but Nleading_rows_J = %d",
+                 (int)PyArray_DIMS(Jp)[0] - 1, Nleading_rows_J);
+            goto done;
+        }
+        if(PyArray_DIMS(Ji)[0] != PyArray_DIMS(Jx)[0])
+        {
+            BARF("Ji and Jx must have the same length");
+            goto done;
+        }
+    }
+
+    {
+        npy_intp dims_out[ndim];
+        for(int i=0; i<ndim-1; i++)
+            dims_out[i] = PyArray_DIMS(dF)[i];
+        dims_out[ndim-1] = Nf;
+        Py_out = (PyArrayObject*)PyArray_ZEROS(ndim, dims_out, NPY_DOUBLE, 0);
+        if(Py_out == NULL)
+        {
+            BARF("Couldn't allocate the output");
+            goto done;
+        }
+    }
+
+    const int Nblocks = (Nf == 0 || Ncols == 0) ? 0 :
+        (int)(PyArray_SIZE(dF) / ((npy_intp)Nf*Ncols));
+    if(Nblocks == 0)
+    {
+        // Nothing to do; the output is all 0
+        Py_INCREF(Py_out);
+        result = (PyObject*)Py_out;
+        goto done;
+    }
+
+    // I solve for several blocks at a time: one CHOLMOD call for many
+    // right-hand-sides. But I limit the block size to keep the dense solution
+    // small
+    const int Nrhs_max = 256;
+    int Nblocks_chunk = Nrhs_max / Nf;
+    if(Nblocks_chunk < 1)       Nblocks_chunk = 1;
+    if(Nblocks_chunk > Nblocks) Nblocks_chunk = Nblocks;
+
+    // The right-hand-side. Each column is dF/dp*t for one F: the gradient in
+    // respect to the packed state, as given. No scaling is applied here. Only
+    // the icol rows are ever written, so the rest stays 0
+    B = calloc((size_t)Nstate * Nblocks_chunk * Nf, sizeof(double));
+    if(have_J)
+        jta = malloc((size_t)Nblocks_chunk * Nf * sizeof(double));
+    if(B == NULL || (have_J && jta == NULL))
+    {
+        BARF("Couldn't allocate the work arrays");
+        goto done;
+    }
+
+    const double* dF_data  = (const double*)PyArray_DATA(dF);
+    double*       out_data = (double*)PyArray_DATA(Py_out);
+
+    for(int iblock0 = 0; iblock0 < Nblocks; iblock0 += Nblocks_chunk)
+    {
+        const int Nblocks_here = (iblock0 + Nblocks_chunk <= Nblocks) ?
+            Nblocks_chunk : Nblocks - iblock0;
+        const int Nrhs = Nblocks_here * Nf;
+
+        for(int irhs=0; irhs<Nrhs; irhs++)
+        {
+            const double* dF_row = &dF_data[(size_t)(iblock0*Nf + irhs) * Ncols];
+            double*       b_col  = &B[(size_t)irhs * Nstate];
+            for(int i=0; i<Ncols; i++)
+                b_col[icol_data[i]] = dF_row[i];
+        }
+
+        cholmod_dense b = {
+            .nrow  = Nstate,
+            .ncol  = Nrhs,
+            .nzmax = (size_t)Nrhs * Nstate,
+            .d     = Nstate,
+            .x     = B,
+            .xtype = CHOLMOD_REAL,
+            .dtype = CHOLMOD_DOUBLE };
+
+        // X is allocated by the first call, and reused after that
+        if(!cholmod_solve2( CHOLMOD_A, self->factorization,
+                            &b, NULL,
+                            &X, NULL, &Y, &E,
+                            &self->common))
+        {
+            BARF("cholmod_solve2() failed");
+            goto done;
+        }
+        const double* x = (const double*)X->x;
+
+        if(!have_J)
+        {
+            // No regularization: Var(F) = dF/dp* inv(J*tJ*) dF/dp*t. I only need
+            // the icol rows of the solution
+            for(int iblock=0; iblock<Nblocks_here; iblock++)
+            {
+                const double* dF_block  = &dF_data [(size_t)(iblock0+iblock)*Nf*Ncols];
+                double*       out_block = &out_data[(size_t)(iblock0+iblock)*Nf*Nf];
+                for(int i=0; i<Nf; i++)
+                    for(int j=i; j<Nf; j++)
+                    {
+                        const double* x_col = &x[(size_t)(iblock*Nf + j) * Nstate];
+                        double s = 0.0;
+                        for(int k=0; k<Ncols; k++)
+                            s += dF_block[i*Ncols + k] * x_col[icol_data[k]];
+                        out_block[i*Nf + j] = s;
+                        out_block[j*Nf + i] = s;
+                    }
+            }
+        }
+        else
+        {
+            // Regularization: Var(F) = sum(outer(ja,ja)) where ja are the rows
+            // of J*[observations] inv(J*tJ*) dF/dp*t
+            const int32_t* Jp_data = (const int32_t*)PyArray_DATA(Jp);
+            const int32_t* Ji_data = (const int32_t*)PyArray_DATA(Ji);
+            const double*  Jx_data = (const double* )PyArray_DATA(Jx);
+
+            for(int irow=0; irow<Nleading_rows_J; irow++)
+            {
+                if(Jp_data[irow] == Jp_data[irow+1])
+                    continue;
+
+                for(int irhs=0; irhs<Nrhs; irhs++)
+                {
+                    const double* x_col = &x[(size_t)irhs * Nstate];
+                    double s = 0.0;
+                    for(int32_t i = Jp_data[irow]; i < Jp_data[irow+1]; i++)
+                        s += Jx_data[i] * x_col[Ji_data[i]];
+                    jta[irhs] = s;
+                }
+
+                for(int iblock=0; iblock<Nblocks_here; iblock++)
+                {
+                    const double* ja        = &jta[iblock*Nf];
+                    double*       out_block = &out_data[(size_t)(iblock0+iblock)*Nf*Nf];
+                    for(int i=0; i<Nf; i++)
+                        for(int j=i; j<Nf; j++)
+                            out_block[i*Nf + j] += ja[i]*ja[j];
+                }
+            }
+
+            for(int iblock=0; iblock<Nblocks_here; iblock++)
+            {
+                double* out_block = &out_data[(size_t)(iblock0+iblock)*Nf*Nf];
+                for(int i=0; i<Nf; i++)
+                    for(int j=i+1; j<Nf; j++)
+                        out_block[j*Nf + i] = out_block[i*Nf + j];
+            }
+        }
+    }
+
+    Py_INCREF(Py_out);
+    result = (PyObject*)Py_out;
+
+ done:
+    if(self->inited_common)
+    {
+        cholmod_free_dense(&X, &self->common);
+        cholmod_free_dense(&Y, &self->common);
+        cholmod_free_dense(&E, &self->common);
+    }
+    free(B);
+    free(jta);
+    Py_XDECREF(Py_out);
+    Py_XDECREF(dF);
+    Py_XDECREF(icol);
+    Py_XDECREF(Jp);
+    Py_XDECREF(Ji);
+    Py_XDECREF(Jx);
+
+    return result;
+}
+
+static PyObject*
+CHOLMOD_factorization_inv_JtJ_blocks(CHOLMOD_factorization* self, PyObject* args, PyObject* kwargs)
+{
+    // error by default
+    PyObject*      result   = NULL;
+    PyObject*      Py_out   = NULL;
+    PyArrayObject* blocks   = NULL;
+    double*        Zx       = NULL;
+    int*           Pinv     = NULL;
+    double*        w        = NULL;
+    int*           wmark    = NULL;
+    double*        B        = NULL;
+    cholmod_dense* X        = NULL;
+    cholmod_dense* Y        = NULL;
+    cholmod_dense* E        = NULL;
+
+    char* keywords[] = {"blocks",
+                        NULL};
+    PyObject* Py_blocks = NULL;
+
+    if(!(self->inited_common && self->factorization))
+    {
+        BARF("No factorization has been computed");
+        goto done;
+    }
+
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     "O", keywords,
+                                     &Py_blocks))
+        goto done;
+
+    const cholmod_factor* L = self->factorization;
+    const int Nstate = (int)L->n;
+
+    if(L->is_super || L->itype != CHOLMOD_INT || L->xtype != CHOLMOD_REAL)
+    {
+        BARF("inv_JtJ_blocks() requires a simplicial, real, int-indexed factorization");
+        goto done;
+    }
+
+    blocks = (PyArrayObject*)PyArray_FROMANY(Py_blocks, NPY_INT32, 1, 2,
+                                             NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(blocks == NULL)
+        goto done;
+    const bool single_block = PyArray_NDIM(blocks) == 1;
+    if(PyArray_DIMS(blocks)[PyArray_NDIM(blocks)-1] != 2)
+    {
+        BARF("blocks must have shape (2,) or (Nblocks,2)");
+        goto done;
+    }
+    const int Nblocks = single_block ? 1 : (int)PyArray_DIMS(blocks)[0];
+    const int32_t* blocks_data = (const int32_t*)PyArray_DATA(blocks);
+    for(int iblock=0; iblock<Nblocks; iblock++)
+    {
+        const int32_t istate0 = blocks_data[2*iblock + 0];
+        const int32_t N       = blocks_data[2*iblock + 1];
+        if(istate0 < 0 || N <= 0 || istate0 > Nstate - N)
+        {
+            BARF("Each block must be (istate0, Nstate_block) with istate0 >= 0, Nstate_block > 0 and istate0+Nstate_block <= %d. Block %d is (%d,%d)",
+                 Nstate, iblock, istate0, N);
+            goto done;
+        }
+    }
+
+    const int*    Lp   = (const int*   )L->p;
+    const int*    Li   = (const int*   )L->i;
+    const int*    Lnz  = (const int*   )L->nz;
+    const double* Lx   = (const double*)L->x;
+    const int*    Perm = (const int*   )L->Perm;
+
+    // The selected inverse lives in the same sparsity pattern as the factor
+    Zx    = malloc(L->nzmax * sizeof(double));
+    Pinv  = malloc(Nstate   * sizeof(int));
+    w     = malloc(Nstate   * sizeof(double));
+    wmark = malloc(Nstate   * sizeof(int));
+    if(Zx == NULL || Pinv == NULL || w == NULL || wmark == NULL)
+    {
+        BARF("Couldn't allocate the work arrays");
+        goto done;
+    }
+    if(!selected_inverse_simplicial(Zx, Lp, Li, Lx, Lnz, Nstate, L->is_ll))
+    {
+        BARF("Couldn't compute the selected inverse");
+        goto done;
+    }
+
+    // The factorization is of P JtJ Pt, so inv(JtJ)[Perm[a],Perm[b]] = Z[a,b]
+    for(int i=0; i<Nstate; i++)
+    {
+        Pinv[i]  = Perm == NULL ? i : -1;
+        wmark[i] = -1;
+    }
+    if(Perm != NULL)
+        for(int i=0; i<Nstate; i++)
+            Pinv[Perm[i]] = i;
+
+    Py_out = PyTuple_New(Nblocks);
+    if(Py_out == NULL)
+        goto done;
+
+    int istamp = 0;
+    for(int iblock=0; iblock<Nblocks; iblock++)
+    {
+        const int istate0 = blocks_data[2*iblock + 0];
+        const int N       = blocks_data[2*iblock + 1];
+
+        PyArrayObject* Py_block =
+            (PyArrayObject*)PyArray_SimpleNew(2, ((npy_intp[]){N,N}), NPY_DOUBLE);
+        if(Py_block == NULL)
+        {
+            BARF("Couldn't allocate the output");
+            goto done;
+        }
+        PyTuple_SET_ITEM(Py_out, iblock, (PyObject*)Py_block);
+        double* out = (double*)PyArray_DATA(Py_block);
+
+        // Z[a,b] for a<b is stored in column a, so I scatter each column into
+        // w, and read off the entries I need
+        bool have_missing = false;
+        for(int a=0; a<N; a++)
+        {
+            const int pa = Pinv[istate0 + a];
+            istamp++;
+            for(int p=Lp[pa]; p<Lp[pa]+Lnz[pa]; p++)
+            {
+                w    [Li[p]] = Zx[p];
+                wmark[Li[p]] = istamp;
+            }
+            for(int b=0; b<N; b++)
+            {
+                const int pb = Pinv[istate0 + b];
+                if(pb < pa)
+                    continue;
+                if(wmark[pb] == istamp)
+                {
+                    out[a*N + b] = w[pb];
+                    out[b*N + a] = w[pb];
+                }
+                else
+                {
+                    // Not in the pattern of the factor. I'll solve for these
+                    // below
+                    out[a*N + b] = NAN;
+                    out[b*N + a] = NAN;
+                    have_missing = true;
+                }
+            }
+        }
+        if(!have_missing)
+            continue;
+
+        // Some of the requested entries aren't in the sparsity pattern of the
+        // factor, so selected inversion doesn't give them to me. This happens
+        // for blocks spanning weakly-coupled parts of the state. I fall back to
+        // solving for the columns of the block explicitly, a few at a time
+        const int Nrhs_max = 64;
+        const int Nrhs_chunk = N < Nrhs_max ? N : Nrhs_max;
+        if(B == NULL)
+        {
+            B = calloc((size_t)Nstate * Nrhs_max, sizeof(double));
+            if(B == NULL)
+            {
+                BARF("Couldn't allocate the work arrays");
+                goto done;
+            }
+        }
+        for(int b0=0; b0<N; b0 += Nrhs_chunk)
+        {
+            const int Nrhs = (b0 + Nrhs_chunk <= N) ? Nrhs_chunk : N - b0;
+
+            for(int irhs=0; irhs<Nrhs; irhs++)
+                B[(size_t)irhs*Nstate + istate0 + b0 + irhs] = 1.0;
+
+            cholmod_dense bdense = {
+                .nrow  = Nstate,
+                .ncol  = Nrhs,
+                .nzmax = (size_t)Nrhs * Nstate,
+                .d     = Nstate,
+                .x     = B,
+                .xtype = CHOLMOD_REAL,
+                .dtype = CHOLMOD_DOUBLE };
+            const bool solved =
+                cholmod_solve2( CHOLMOD_A, self->factorization,
+                                &bdense, NULL,
+                                &X, NULL, &Y, &E,
+                                &self->common);
+            for(int irhs=0; irhs<Nrhs; irhs++)
+                B[(size_t)irhs*Nstate + istate0 + b0 + irhs] = 0.0;
+            if(!solved)
+            {
+                BARF("cholmod_solve2() failed");
+                goto done;
+            }
+
+            const double* x = (const double*)X->x;
+            for(int irhs=0; irhs<Nrhs; irhs++)
+            {
+                const int b = b0 + irhs;
+                for(int a=0; a<N; a++)
+                    if(isnan(out[a*N + b]))
+                    {
+                        out[a*N + b] = x[(size_t)irhs*Nstate + istate0 + a];
+                        out[b*N + a] = out[a*N + b];
+                    }
+            }
+        }
+    }
+
+    if(single_block)
+    {
+        result = PyTuple_GET_ITEM(Py_out, 0);
+        Py_INCREF(result);
+    }
+    else
+    {
+        Py_INCREF(Py_out);
+        result = Py_out;
+    }
+
+ done:
+    if(self->inited_common)
+    {
+        cholmod_free_dense(&X, &self->common);
+        cholmod_free_dense(&Y, &self->common);
+        cholmod_free_dense(&E, &self->common);
+    }
+    free(Zx);
+    free(Pinv);
+    free(w);
+    free(wmark);
+    free(B);
+    Py_XDECREF(Py_out);
+    Py_XDECREF(blocks);
+
+    return result;
+}
+
 static const char CHOLMOD_factorization_docstring[] =
 #include "CHOLMOD_factorization.docstring.h"
     ;
 static const char CHOLMOD_factorization_solve_xt_JtJ_bt_docstring[] =
 #include "CHOLMOD_factorization_solve_xt_JtJ_bt.docstring.h"
     ;
+static const char CHOLMOD_factorization_Var_dF_docstring[] =
+#include "CHOLMOD_factorization_Var_dF.docstring.h"
+    ;
+static const char CHOLMOD_factorization_inv_JtJ_blocks_docstring[] =
+#include "CHOLMOD_factorization_inv_JtJ_blocks.docstring.h"
+    ;
+
+static PyMethodDef CHOLMOD_factorization_methods[] =
+    {
+        PYMETHODDEF_ENTRY(CHOLMOD_factorization_, solve_xt_JtJ_bt, METH_VARARGS | METH_KEYWORDS),
+        PYMETHODDEF_ENTRY(CHOLMOD_factorization_, Var_dF,          METH_VARARGS | METH_KEYWORDS),
+        PYMETHODDEF_ENTRY(CHOLMOD_factorization_, inv_JtJ_blocks,  METH_VARARGS | METH_KEYWORDS),
+        {}
+    };
+
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-braces"
+// PyObject_HEAD_INIT throws
+//   warning: missing braces around initializer []
+// This isn't mine to fix, so I'm ignoring it
+static PyTypeObject CHOLMOD_factorization_type =
+{
+     PyObject_HEAD_INIT(NULL)
+    .tp_name      = "mrcal.CHOLMOD_factorization",
+    .tp_basicsize = sizeof(CHOLMOD_factorization),
+    .tp_new       = PyType_GenericNew,
+    .tp_init      = (initproc)CHOLMOD_factorization_init,
+    .tp_dealloc   = (destructor)CHOLMOD_factorization_dealloc,
+    .tp_methods   = CHOLMOD_factorization_methods,
+    .tp_str       = (reprfunc)CHOLMOD_factorization_str,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = CHOLMOD_factorization_docstring,
+};
+#pragma GCC diagnostic pop
+
+
+// For the C code. Create a new Python CHOLMOD_factorization object from a C
+// cholmod_sparse structure
+static PyObject*
+CHOLMOD_factorization_from_cholmod_sparse(cholmod_sparse* Jt)
+{
+    PyObject* self = PyObject_CallObject((PyObject*)&CHOLMOD_factorization_type, NULL);
+    if(NULL == self)
+        return NULL;
+
+    if(!_CHOLMOD_factorization_init_from_cholmod_sparse((CHOLMOD_factorization*)self, Jt))
+    {
+        Py_DECREF(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+
+
+static bool parse_lensmodel_from_arg(// output
+                                     mrcal_lensmodel_t* lensmodel,
+                                     // input
+                                     PyObject* lensmodel_string)
+{
+    const char* lensmodel_cstring = PyString_AsString(lensmodel_string);
+    if( lensmodel_cstring == NULL)
+    {
+        BARF("The lens model must be given as a string");
+        return false;
+    }
+
+    mrcal_lensmodel_from_name(lensmodel, lensmodel_cstring);
+    if( !mrcal_lensmodel_type_is_valid(lensmodel->type) )
+    {
+        if(lensmodel->type == MRCAL_LENSMODEL_INVALID_BADCONFIG)
+        {
+            BARF("Couldn't parse the configuration of the given lens model '%s'",
+                         lensmodel_cstring);
+            return false;
+        }
+        BARF("Invalid lens model was passed in: '%s'. Must be one of " VALID_LENSMODELS_FORMAT,
+                     lensmodel_cstring
+                     VALID_LENSMODELS_ARGLIST);
+        return false;
+    }
+    return true;
+}
+
+
+// A Python wrapper around mrcal_projector_t
+typedef struct {
+    PyObject_HEAD
+
+    // NULL if not initialized
+    mrcal_projector_t* projector;
+} projector;
+
+static int
+projector_init(projector* self, PyObject* args, PyObject* kwargs)
+{
+    // Any existing projector goes away. If this function fails, we lose the
+    // existing projector, which is fine
+    mrcal_projector_free(&self->projector);
+
+    // error by default
+    int result = -1;
+
+    char* keywords[] = {"lensmodel", "intrinsics", NULL};
+    PyObject*      lensmodel_string = NULL;
+    PyObject*      Py_intrinsics    = NULL;
+    PyArrayObject* intrinsics       = NULL;
+
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     STRING_OBJECT "O", keywords,
+                                     &lensmodel_string, &Py_intrinsics))
+        goto done;
+
+    mrcal_lensmodel_t lensmodel;
+    if(!parse_lensmodel_from_arg(&lensmodel, lensmodel_string))
+        goto done;
+
+    intrinsics = (PyArrayObject*)PyArray_FROMANY(Py_intrinsics, NPY_DOUBLE,
+                                                 1, 1,
+                                                 NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(intrinsics == NULL)
+        goto done;
+
+    int Nintrinsics = mrcal_lensmodel_num_params(&lensmodel);
+    if( PyArray_DIMS(intrinsics)[0] != Nintrinsics )
+    {
+        BARF("intrinsics must have shape (%d,) for this lens model. Got (%d,)",
+             Nintrinsics, (int)PyArray_DIMS(intrinsics)[0]);
+        goto done;
+    }
+
+    self->projector = mrcal_projector_new(&lensmodel,
+                                          (const double*)PyArray_DATA(intrinsics));
+    if(self->projector == NULL)
+    {
+        BARF("mrcal_projector_new() failed");
+        goto done;
+    }
+
+    result = 0;
+
+ done:
+    Py_XDECREF(intrinsics);
+    return result;
+}
+
+static void projector_dealloc(projector* self)
+{
+    mrcal_projector_free(&self->projector);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject* projector_str(projector* self)
+{
+    if(self->projector == NULL)
+        return PyString_FromString("Uninitialized projector");
+
+    char lensmodel_string[1024];
+    if(!mrcal_lensmodel_name(lensmodel_string, sizeof(lensmodel_string),
+                             mrcal_projector_lensmodel(self->projector)))
+        return PyString_FromString("Projector with an unprintable lens model");
+    return PyString_FromFormat("Projector for lens model '%s'",
+                               lensmodel_string);
+}
+
+// Validates the input array of (...,Ninput) points, and allocates the
+// (...,Noutput) output array. Returns the new output array, or NULL on error
+static PyArrayObject*
+projector_validate_and_allocate_output(// out
+                                       int* N,
+                                       // in
+                                       PyObject* Py_input, const char* name,
+                                       int Ninput, int Noutput)
+{
+    if( Py_input == NULL || !PyArray_Check((PyArrayObject*)Py_input) )
+    {
+        BARF("%s must be a numpy array", name);
+        return NULL;
+    }
+
+    PyArrayObject* input = (PyArrayObject*)Py_input;
+    int ndim = PyArray_NDIM(input);
+    if( ndim < 1 || PyArray_DIMS(input)[ndim-1] != Ninput)
+    {
+        BARF("%s must have shape (..., %d)", name, Ninput);
+        return NULL;
+    }
+    if( PyArray_TYPE(input) != NPY_FLOAT64 )
+    {
+        BARF("%s must have dtype=float", name);
+        return NULL;
+    }
+    if( !PyArray_IS_C_CONTIGUOUS(input) )
+    {
+        BARF("%s must live in contiguous memory", name);
+        return NULL;
+    }
+
+    npy_intp dims[ndim];
+    memcpy(dims, PyArray_DIMS(input), ndim*sizeof(dims[0]));
+    dims[ndim-1] = Noutput;
+
+    PyArrayObject* output = (PyArrayObject*)PyArray_SimpleNew(ndim, dims, NPY_DOUBLE);
+    if(output == NULL)
+    {
+        BARF("Couldn't allocate the output");
+        return NULL;
+    }
+
+    *N = (int)(PyArray_SIZE(input) / Ninput);
+    return output;
+}
+
+static PyObject*
+projector_project(projector* self, PyObject* args, PyObject* kwargs)
+{
+    char* keywords[] = {"v", NULL};
+    PyObject* Py_v = NULL;
+
+    if(self->projector == NULL)
+    {
+        BARF("The projector has not been initialized");
+        return NULL;
+    }
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     "O", keywords, &Py_v))
+        return NULL;
+
+    int N;
+    PyArrayObject* q = projector_validate_and_allocate_output(&N, Py_v, "v", 3, 2);
+    if(q == NULL)
+        return NULL;
+
+    if(!mrcal_projector_project((mrcal_point2_t*)PyArray_DATA(q),
+                                NULL, NULL,
+                                (const mrcal_point3_t*)PyArray_DATA((PyArrayObject*)Py_v),
+                                N,
+                                self->projector))
+    {
+        BARF("mrcal_projector_project() failed");
+        Py_DECREF(q);
+        return NULL;
+    }
+    return (PyObject*)q;
+}
+
+static PyObject*
+projector_unproject(projector* self, PyObject* args, PyObject* kwargs)
+{
+    char* keywords[] = {"q", NULL};
+    PyObject* Py_q = NULL;
+
+    if(self->projector == NULL)
+    {
+        BARF("The projector has not been initialized");
+        return NULL;
+    }
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     "O", keywords, &Py_q))
+        return NULL;
+
+    int N;
+    PyArrayObject* v = projector_validate_and_allocate_output(&N, Py_q, "q", 2, 3);
+    if(v == NULL)
+        return NULL;
+
+    if(!mrcal_projector_unproject((mrcal_point3_t*)PyArray_DATA(v),
+                                  (const mrcal_point2_t*)PyArray_DATA((PyArrayObject*)Py_q),
+                                  N,
+                                  self->projector))
+    {
+        BARF("mrcal_projector_unproject() failed");
+        Py_DECREF(v);
+        return NULL;
+    }
+    return (PyObject*)v;
+}
+
+static const char projector_docstring[] =
+#include "projector.docstring.h"
+    ;
+static const char projector_project_docstring[] =
+#include "projector_project.docstring.h"
+    ;
+static const char projector_unproject_docstring[] =
+#include "projector_unproject.docstring.h"
+    ;
+
+static PyMethodDef projector_methods[] =
+    {
+        PYMETHODDEF_ENTRY(projector_, project,   METH_VARARGS | METH_KEYWORDS),
+        PYMETHODDEF_ENTRY(projector_, unproject, METH_VARARGS | METH_KEYWORDS),
+        {}
+    };
+
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-braces"
+// PyObject_HEAD_INIT throws
+//   warning: missing braces around initializer []
+// This isn't mine to fix, so I'm ignoring it
+static PyTypeObject projector_type =
+{
+     PyObject_HEAD_INIT(NULL)
+    .tp_name      = "mrcal.projector",
+    .tp_basicsize = sizeof(projector),
+    .tp_new       = PyType_GenericNew,
+    .tp_init      = (initproc)projector_init,
+    .tp_dealloc   = (destructor)projector_dealloc,
+    .tp_methods   = projector_methods,
+    .tp_str       = (reprfunc)projector_str,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = projector_docstring,
+};
+#pragma GCC diagnostic pop
+
+static PyObject* lensmodel_metadata_and_config(PyObject* NPY_UNUSED(self),
+                                               PyObject* args)
+{
+    PyObject* result = NULL;
+    SET_SIGINT();
+
+    PyObject* lensmodel_string = NULL;
+    if(!PyArg_ParseTuple( args, STRING_OBJECT, &lensmodel_string ))
+        goto done;
+    mrcal_lensmodel_t lensmodel;
+    if(!parse_lensmodel_from_arg(&lensmodel, lensmodel_string))
+        goto done;
+
+    mrcal_lensmodel_metadata_t meta = mrcal_lensmodel_metadata(&lensmodel);
+
+#define MRCAL_ITEM_BUILDVALUE_DEF(  name, type, pybuildvaluecode, PRIcode,SCNcode, bitfield, cookie) " s "pybuildvaluecode
+#define MRCAL_ITEM_BUILDVALUE_VALUE(name, type, pybuildvaluecode, PRIcode,SCNcode, bitfield, cookie) , #name, cookie name
+
+    if(lensmodel.type == MRCAL_LENSMODEL_CAHVORE )
+        result = Py_BuildValue("{"
+                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_DEF, )
+                               MRCAL_LENSMODEL_CAHVORE_CONFIG_LIST(MRCAL_ITEM_BUILDVALUE_DEF, )
+                               "}"
+                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_VALUE, meta.)
+                               MRCAL_LENSMODEL_CAHVORE_CONFIG_LIST(MRCAL_ITEM_BUILDVALUE_VALUE, lensmodel.LENSMODEL_CAHVORE__config.));
+    else if(lensmodel.type == MRCAL_LENSMODEL_SPLINED_STEREOGRAPHIC )
+        result = Py_BuildValue("{"
+                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_DEF, )
+                               MRCAL_LENSMODEL_SPLINED_STEREOGRAPHIC_CONFIG_LIST(MRCAL_ITEM_BUILDVALUE_DEF, )
+                               "}"
+                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_VALUE, meta.)
+                               MRCAL_LENSMODEL_SPLINED_STEREOGRAPHIC_CONFIG_LIST(MRCAL_ITEM_BUILDVALUE_VALUE, lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.));
+    else
+        result = Py_BuildValue("{"
+                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_DEF, )
+                               "}"
+                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_VALUE, meta.));
+
+    Py_INCREF(result);
+
+ done:
+    RESET_SIGINT();
+    return result;
+}
+
+static PyObject* knots_for_splined_models(PyObject* NPY_UNUSED(self),
+                                          PyObject* args)
+{
+    PyObject*      result = NULL;
+    PyArrayObject* py_ux  = NULL;
+    PyArrayObject* py_uy  = NULL;
+    SET_SIGINT();
+
+    PyObject* lensmodel_string = NULL;
+    if(!PyArg_ParseTuple( args, STRING_OBJECT, &lensmodel_string ))
+        goto done;
+    mrcal_lensmodel_t lensmodel;
+    if(!parse_lensmodel_from_arg(&lensmodel, lensmodel_string))
+        goto done;
+
+    if(lensmodel.type != MRCAL_LENSMODEL_SPLINED_STEREOGRAPHIC)
+    {
+        BARF( "This function works only with the MRCAL_LENSMODEL_SPLINED_STEREOGRAPHIC model. %S passed in",
+              lensmodel_string);
+        goto done;
+    }
+
+    {
+        double ux[lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Nx];
+        double uy[lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Ny];
+        if(!mrcal_knots_for_splined_models(ux,uy, &lensmodel))
+        {
+            BARF( "mrcal_knots_for_splined_models() failed");
+            goto done;
+        }
+
+
+        npy_intp dims[1];
+
+        dims[0] = lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Nx;
+        py_ux = (PyArrayObject*)PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+        if(py_ux == NULL)
+        {
+            BARF("Couldn't allocate ux");
+            goto done;
+        }
+
+        dims[0] = lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Ny;
+        py_uy = (PyArrayObject*)PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+        if(py_uy == NULL)
+        {
+            BARF("Couldn't allocate uy");
+            goto done;
+        }
+
+        memcpy(PyArray_DATA(py_ux), ux, lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Nx*sizeof(double));
+        memcpy(PyArray_DATA(py_uy), uy, lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Ny*sizeof(double));
+    }
+
+    result = Py_BuildValue("OO", py_ux, py_uy);
+
+ done:
+    Py_XDECREF(py_ux);
+    Py_XDECREF(py_uy);
+    RESET_SIGINT();
+    return result;
+}
+
+// Converts the given Python object to a C-contiguous float64 numpy array with
+// the given dimensions. Returns a new reference, or NULL on error
+static PyArrayObject* double_array_from_arg(PyObject* obj, const char* name,
+                                            int ndims, const npy_intp* dims)
+{
+    PyArrayObject* array =
+        (PyArrayObject*)PyArray_FROMANY(obj, NPY_DOUBLE, ndims, ndims,
+                                        NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(array == NULL)
+        return NULL;
+
+    for(int i=0; i<ndims; i++)
+        if(PyArray_DIMS(array)[i] != dims[i])
+        {
+            BARF("'%s' has an unexpected shape. Dimension %d should be %d, but got %d",
+                 name, i, (int)dims[i], (int)PyArray_DIMS(array)[i]);
+            Py_DECREF(array);
+            return NULL;
+        }
+    return array;
+}
+
+static PyObject* _rectification_maps(PyObject* NPY_UNUSED(self),
+                                     PyObject* args,
+                                     PyObject* kwargs)
+{
+    PyObject*      result        = NULL;
+    PyArrayObject* intrinsics[2] = {};
+    PyArrayObject* R_cam_rect[2] = {};
+    PyArrayObject* fxycxy        = NULL;
+    PyArrayObject* maps[2]       = {};
+    SET_SIGINT();
+
+    char* keywords[] = {"lensmodel0", "intrinsics0", "R_cam0_rect",
+                        "lensmodel1", "intrinsics1", "R_cam1_rect",
+                        "lensmodel_rectified", "fxycxy_rectified",
+                        "imagersize_rectified",
+                        NULL};
+    PyObject* lensmodel_string[2]          = {};
+    PyObject* Py_intrinsics[2]             = {};
+    PyObject* Py_R_cam_rect[2]             = {};
+    PyObject* lensmodel_rectified_string   = NULL;
+    PyObject* Py_fxycxy                    = NULL;
+    unsigned int imagersize_rectified[2];
+
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     STRING_OBJECT "OO" STRING_OBJECT "OO" STRING_OBJECT "O(II)",
+                                     keywords,
+                                     &lensmodel_string[0], &Py_intrinsics[0], &Py_R_cam_rect[0],
+                                     &lensmodel_string[1], &Py_intrinsics[1], &Py_R_cam_rect[1],
+                                     &lensmodel_rectified_string, &Py_fxycxy,
+                                     &imagersize_rectified[0], &imagersize_rectified[1]))
+        goto done;
+
+    mrcal_lensmodel_t lensmodel[2], lensmodel_rectified;
+    for(int i=0; i<2; i++)
+    {
+        if(!parse_lensmodel_from_arg(&lensmodel[i], lensmodel_string[i]))
+            goto done;
+
+        intrinsics[i] = double_array_from_arg(Py_intrinsics[i], "intrinsics", 1,
+                                              (npy_intp[]){mrcal_lensmodel_num_params(&lensmodel[i])});
+        if(intrinsics[i] == NULL)
+            goto done;
+        R_cam_rect[i] = double_array_from_arg(Py_R_cam_rect[i], "R_cam_rect", 2,
+                                              (npy_intp[]){3,3});
+        if(R_cam_rect[i] == NULL)
+            goto done;
+    }
+    if(!parse_lensmodel_from_arg(&lensmodel_rectified, lensmodel_rectified_string))
+        goto done;
+    fxycxy = double_array_from_arg(Py_fxycxy, "fxycxy_rectified", 1, (npy_intp[]){4});
+    if(fxycxy == NULL)
+        goto done;
+
+    for(int i=0; i<2; i++)
+    {
+        maps[i] = (PyArrayObject*)PyArray_SimpleNew(3,
+                                                    ((npy_intp[]){imagersize_rectified[1],
+                                                                  imagersize_rectified[0],
+                                                                  2}),
+                                                    NPY_FLOAT32);
+        if(maps[i] == NULL)
+        {
+            BARF("Couldn't allocate the rectification map");
+            goto done;
+        }
+    }
+
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS;
+    ok = mrcal_rectification_maps((float*)PyArray_DATA(maps[0]),
+                                  (float*)PyArray_DATA(maps[1]),
+                                  &lensmodel[0],
+                                  (const double*)PyArray_DATA(intrinsics[0]),
+                                  (const double*)PyArray_DATA(R_cam_rect[0]),
+                                  &lensmodel[1],
+                                  (const double*)PyArray_DATA(intrinsics[1]),
+                                  (const double*)PyArray_DATA(R_cam_rect[1]),
+                                  lensmodel_rectified.type,
+                                  (const double*)PyArray_DATA(fxycxy),
+                                  imagersize_rectified,
+                                  0);
+    Py_END_ALLOW_THREADS;
+    if(!ok)
+    {
+        BARF("mrcal_rectification_maps() failed");
+        goto done;
+    }
+
+    result = Py_BuildValue("OO", maps[0], maps[1]);
+
+ done:
+    for(int i=0; i<2; i++)
+    {
+        Py_XDECREF(intrinsics[i]);
+        Py_XDECREF(R_cam_rect[i]);
+        Py_XDECREF(maps[i]);
+    }
+    Py_XDECREF(fxycxy);
+    RESET_SIGINT();
+    return result;
+}
+
+static PyObject* _stereo_range_lut(PyObject* NPY_UNUSED(self),
+                                   PyObject* args,
+                                   PyObject* kwargs)
+{
+    PyObject*      result = NULL;
+    PyArrayObject* fxycxy = NULL;
+    PyArrayObject* lut    = NULL;
+    SET_SIGINT();
+
+    char* keywords[] = {"lensmodel_rectified", "fxycxy_rectified",
+                        "imagersize_rectified",
+                        "baseline", "disparity_scale", "Ndisparities",
+                        NULL};
+    PyObject*    lensmodel_rectified_string = NULL;
+    PyObject*    Py_fxycxy                  = NULL;
+    unsigned int imagersize_rectified[2];
+    double       baseline, disparity_scale;
+    int          Ndisparities;
+
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     STRING_OBJECT "O(II)ddi",
+                                     keywords,
+                                     &lensmodel_rectified_string, &Py_fxycxy,
+                                     &imagersize_rectified[0], &imagersize_rectified[1],
+                                     &baseline, &disparity_scale, &Ndisparities))
+        goto done;
+
+    mrcal_lensmodel_t lensmodel_rectified;
+    if(!parse_lensmodel_from_arg(&lensmodel_rectified, lensmodel_rectified_string))
+        goto done;
+    fxycxy = double_array_from_arg(Py_fxycxy, "fxycxy_rectified", 1, (npy_intp[]){4});
+    if(fxycxy == NULL)
+        goto done;
+    if(Ndisparities <= 0)
+    {
+        BARF("Ndisparities must be > 0");
+        goto done;
+    }
+
+    if(lensmodel_rectified.type == MRCAL_LENSMODEL_LATLON)
+        lut = (PyArrayObject*)PyArray_SimpleNew(2,
+                                                ((npy_intp[]){Ndisparities,
+                                                              imagersize_rectified[0]}),
+                                                NPY_FLOAT32);
+    else
+        lut = (PyArrayObject*)PyArray_SimpleNew(1,
+                                                ((npy_intp[]){Ndisparities}),
+                                                NPY_FLOAT32);
+    if(lut == NULL)
+    {
+        BARF("Couldn't allocate the range LUT");
+        goto done;
+    }
+
+    if(!mrcal_stereo_range_lut((float*)PyArray_DATA(lut),
+                               Ndisparities,
+                               lensmodel_rectified.type,
+                               (const double*)PyArray_DATA(fxycxy),
+                               imagersize_rectified,
+                               baseline, disparity_scale))
+    {
+        BARF("mrcal_stereo_range_lut() failed");
+        goto done;
+    }
+
+    result = (PyObject*)lut;
+    Py_INCREF(result);
+
+ done:
+    Py_XDECREF(fxycxy);
+    Py_XDECREF(lut);
+    RESET_SIGINT();
+    return result;
+}
+
+static PyObject* _stereo_range_from_lut(PyObject* NPY_UNUSED(self),
+                                        PyObject* args,
+                                        PyObject* kwargs)
+{
+    PyObject*      result    = NULL;
+    PyArrayObject* disparity = NULL;
+    PyArrayObject* lut       = NULL;
+    PyArrayObject* fxycxy    = NULL;
+    PyArrayObject* range     = NULL;
+    SET_SIGINT();
+
+    char* keywords[] = {"disparity", "lut",
+                        "lensmodel_rectified", "fxycxy_rectified",
+                        NULL};
+    PyObject* Py_disparity               = NULL;
+    PyObject* Py_lut                     = NULL;
+    PyObject* lensmodel_rectified_string = NULL;
+    PyObject* Py_fxycxy                  = NULL;
+
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     "OO" STRING_OBJECT "O",
+                                     keywords,
+                                     &Py_disparity, &Py_lut,
+                                     &lensmodel_rectified_string, &Py_fxycxy))
+        goto done;
+
+    mrcal_lensmodel_t lensmodel_rectified;
+    if(!parse_lensmodel_from_arg(&lensmodel_rectified, lensmodel_rectified_string))
+        goto done;
+    fxycxy = double_array_from_arg(Py_fxycxy, "fxycxy_rectified", 1, (npy_intp[]){4});
+    if(fxycxy == NULL)
+        goto done;
+
+    disparity = (PyArrayObject*)PyArray_FROMANY(Py_disparity, NPY_INT16, 2, 2,
+                                                NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(disparity == NULL)
+        goto done;
+    const npy_intp* dims = PyArray_DIMS(disparity);
+    const unsigned int imagersize_rectified[2] = {(unsigned int)dims[1],
+                                                  (unsigned int)dims[0]};
+
+    const int ndims_lut = lensmodel_rectified.type == MRCAL_LENSMODEL_LATLON ? 2 : 1;
+    lut = (PyArrayObject*)PyArray_FROMANY(Py_lut, NPY_FLOAT32, ndims_lut, ndims_lut,
+                                          NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(lut == NULL)
+        goto done;
+    if(ndims_lut == 2 && PyArray_DIMS(lut)[1] != dims[1])
+    {
+        BARF("The LENSMODEL_LATLON 'lut' must have shape (Ndisparities,Naz=%d). Got Naz=%d",
+             (int)dims[1], (int)PyArray_DIMS(lut)[1]);
+        goto done;
+    }
+
+    range = (PyArrayObject*)PyArray_SimpleNew(2, dims, NPY_FLOAT32);
+    if(range == NULL)
+    {
+        BARF("Couldn't allocate the range image");
+        goto done;
+    }
+
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS;
+    ok = mrcal_stereo_range_from_lut((float*)PyArray_DATA(range),
+                                     (const int16_t*)PyArray_DATA(disparity),
+                                     (const float*)PyArray_DATA(lut),
+                                     (int)PyArray_DIMS(lut)[0],
+                                     lensmodel_rectified.type,
+                                     (const double*)PyArray_DATA(fxycxy),
+                                     imagersize_rectified,
+                                     0);
+    Py_END_ALLOW_THREADS;
+    if(!ok)
+    {
+        BARF("mrcal_stereo_range_from_lut() failed");
+        goto done;
+    }
+
+    result = (PyObject*)range;
+    Py_INCREF(result);
+
+ done:
+    Py_XDECREF(disparity);
+    Py_XDECREF(lut);
+    Py_XDECREF(fxycxy);
+    Py_XDECREF(range);
+    RESET_SIGINT();
+    return result;
+}
+
+static PyObject* _stereo_point_cloud(PyObject* NPY_UNUSED(self),
+                                     PyObject* args,
+                                     PyObject* kwargs)
+{
+    PyObject*      result       = NULL;
+    PyArrayObject* disparity    = NULL;
+    PyArrayObject* lut          = NULL;
+    PyArrayObject* fxycxy       = NULL;
+    PyArrayObject* image        = NULL;
+    PyArrayObject* Rt_out_rect0 = NULL;
+    PyArrayObject* points       = NULL;
+    PyArrayObject* colors       = NULL;
+    PyObject*      points_valid = NULL;
+    PyObject*      colors_valid = NULL;
+    SET_SIGINT();
+
+    char* keywords[] = {"disparity", "lut",
+                        "lensmodel_rectified", "fxycxy_rectified",
+                        "image", "Rt_out_rect0", "out",
+                        NULL};
+    PyObject* Py_disparity               = NULL;
+    PyObject* Py_lut                     = NULL;
+    PyObject* lensmodel_rectified_string = NULL;
+    PyObject* Py_fxycxy                  = NULL;
+    PyObject* Py_image                   = NULL;
+    PyObject* Py_Rt_out_rect0            = NULL;
+    PyObject* Py_out                     = NULL;
+
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     "OO" STRING_OBJECT "O|OOO",
+                                     keywords,
+                                     &Py_disparity, &Py_lut,
+                                     &lensmodel_rectified_string, &Py_fxycxy,
+                                     &Py_image, &Py_Rt_out_rect0, &Py_out))
+        goto done;
+
+    mrcal_lensmodel_t lensmodel_rectified;
+    if(!parse_lensmodel_from_arg(&lensmodel_rectified, lensmodel_rectified_string))
+        goto done;
+    fxycxy = double_array_from_arg(Py_fxycxy, "fxycxy_rectified", 1, (npy_intp[]){4});
+    if(fxycxy == NULL)
+        goto done;
+
+    disparity = (PyArrayObject*)PyArray_FROMANY(Py_disparity, NPY_INT16, 2, 2,
+                                                NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(disparity == NULL)
+        goto done;
+    const npy_intp* dims = PyArray_DIMS(disparity);
+    const npy_intp  Npixels = dims[0]*dims[1];
+    const unsigned int imagersize_rectified[2] = {(unsigned int)dims[1],
+                                                  (unsigned int)dims[0]};
+
+    const int ndims_lut = lensmodel_rectified.type == MRCAL_LENSMODEL_LATLON ? 2 : 1;
+    lut = (PyArrayObject*)PyArray_FROMANY(Py_lut, NPY_FLOAT32, ndims_lut, ndims_lut,
+                                          NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(lut == NULL)
+        goto done;
+    if(ndims_lut == 2 && PyArray_DIMS(lut)[1] != dims[1])
+    {
+        BARF("The LENSMODEL_LATLON 'lut' must have shape (Ndisparities,Naz=%d). Got Naz=%d",
+             (int)dims[1], (int)PyArray_DIMS(lut)[1]);
+        goto done;
+    }
+
+    int Ncolor_channels = 0;
+    if(Py_image != NULL && Py_image != Py_None)
+    {
+        image = (PyArrayObject*)PyArray_FROMANY(Py_image, NPY_UINT8, 2, 3,
+                                                NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+        if(image == NULL)
+            goto done;
+        Ncolor_channels = PyArray_NDIM(image) == 3 ? (int)PyArray_DIMS(image)[2] : 1;
+        if(PyArray_DIMS(image)[0] != dims[0] ||
+           PyArray_DIMS(image)[1] != dims[1] ||
+           !(Ncolor_channels == 1 || Ncolor_channels == 3))
+        {
+            BARF("'image' must have shape (%d,%d) or (%d,%d,3)",
+                 (int)dims[0], (int)dims[1], (int)dims[0], (int)dims[1]);
+            goto done;
+        }
+
+        colors = (PyArrayObject*)PyArray_SimpleNew(2,
+                                                   ((npy_intp[]){Npixels, Ncolor_channels}),
+                                                   NPY_UINT8);
+        if(colors == NULL)
+        {
+            BARF("Couldn't allocate the colors array");
+            goto done;
+        }
+    }
+
+    if(Py_Rt_out_rect0 != NULL && Py_Rt_out_rect0 != Py_None)
+    {
+        Rt_out_rect0 = double_array_from_arg(Py_Rt_out_rect0, "Rt_out_rect0", 2,
+                                             (npy_intp[]){4,3});
+        if(Rt_out_rect0 == NULL)
+            goto done;
+    }
+
+    if(Py_out == NULL || Py_out == Py_None)
+    {
+        points = (PyArrayObject*)PyArray_SimpleNew(2, ((npy_intp[]){Npixels, 3}),
+                                                   NPY_FLOAT32);
+        if(points == NULL)
+        {
+            BARF("Couldn't allocate the points array");
+            goto done;
+        }
+    }
+    else
+    {
+        if(!PyArray_Check(Py_out) ||
+           PyArray_TYPE((PyArrayObject*)Py_out) != NPY_FLOAT32 ||
+           PyArray_NDIM((PyArrayObject*)Py_out) != 2 ||
+           PyArray_DIMS((PyArrayObject*)Py_out)[0] < Npixels ||
+           PyArray_DIMS((PyArrayObject*)Py_out)[1] != 3 ||
+           !PyArray_IS_C_CONTIGUOUS((PyArrayObject*)Py_out))
+        {
+            BARF("'out' must be a C-contiguous float32 array of shape (N,3) with N >= Nel*Naz = %d",
+                 (int)Npixels);
+            goto done;
+        }
+        points = (PyArrayObject*)Py_out;
+        Py_INCREF(points);
+    }
+
+    int Npoints;
+    Py_BEGIN_ALLOW_THREADS;
+    Npoints = mrcal_stereo_point_cloud((float*)PyArray_DATA(points),
+                                       colors == NULL ? NULL : (uint8_t*)PyArray_DATA(colors),
+                                       (const int16_t*)PyArray_DATA(disparity),
+                                       (const float*)PyArray_DATA(lut),
+                                       (int)PyArray_DIMS(lut)[0],
+                                       image == NULL ? NULL : (const uint8_t*)PyArray_DATA(image),
+                                       Ncolor_channels,
+                                       Rt_out_rect0 == NULL ? NULL : (const double*)PyArray_DATA(Rt_out_rect0),
+                                       lensmodel_rectified.type,
+                                       (const double*)PyArray_DATA(fxycxy),
+                                       imagersize_rectified,
+                                       0);
+    Py_END_ALLOW_THREADS;
+    if(Npoints < 0)
+    {
+        BARF("mrcal_stereo_point_cloud() failed");
+        goto done;
+    }
+
+    // I return views into the first Npoints rows
+    points_valid = PySequence_GetSlice((PyObject*)points, 0, Npoints);
+    if(points_valid == NULL)
+        goto done;
+    if(colors != NULL)
+    {
+        colors_valid = PySequence_GetSlice((PyObject*)colors, 0, Npoints);
+        if(colors_valid == NULL)
+            goto done;
+    }
+    else
+    {
+        colors_valid = Py_None;
+        Py_INCREF(colors_valid);
+    }
+
+    result = Py_BuildValue("OO", points_valid, colors_valid);
+
+ done:
+    Py_XDECREF(disparity);
+    Py_XDECREF(lut);
+    Py_XDECREF(fxycxy);
+    Py_XDECREF(image);
+    Py_XDECREF(Rt_out_rect0);
+    Py_XDECREF(points);
+    Py_XDECREF(colors);
+    Py_XDECREF(points_valid);
+    Py_XDECREF(colors_valid);
+    RESET_SIGINT();
+    return result;
+}
+
+static PyObject* _stereo_sgm(PyObject* NPY_UNUSED(self),
+                             PyObject* args,
+                             PyObject* kwargs)
+{
+    PyObject*      result    = NULL;
+    PyArrayObject* images[2] = {};
+    PyArrayObject* disparity = NULL;
+    SET_SIGINT();
+
+#define SGM_PARAMETER_KEYWORD(name, default) #name,
+#define SGM_PARAMETER_FORMAT( name, default) "i"
+#define SGM_PARAMETER_ADDRESS(name, default) &parameters.name,
+#define SGM_PARAMETER_DEFAULT(name, default) .name = default,
+    char* keywords[] = {"image0", "image1",
+                        MRCAL_STEREO_SGM_PARAMETERS_LIST(SGM_PARAMETER_KEYWORD)
+                        NULL};
+    PyObject* Py_images[2] = {};
+    mrcal_stereo_sgm_parameters_t parameters =
+        { MRCAL_STEREO_SGM_PARAMETERS_LIST(SGM_PARAMETER_DEFAULT) };
+
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     "OO|$" MRCAL_STEREO_SGM_PARAMETERS_LIST(SGM_PARAMETER_FORMAT),
+                                     keywords,
+                                     &Py_images[0], &Py_images[1],
+                                     MRCAL_STEREO_SGM_PARAMETERS_LIST(SGM_PARAMETER_ADDRESS)
+                                     NULL))
+        goto done;
+#undef SGM_PARAMETER_KEYWORD
+#undef SGM_PARAMETER_FORMAT
+#undef SGM_PARAMETER_ADDRESS
+#undef SGM_PARAMETER_DEFAULT
+
+    for(int i=0; i<2; i++)
+    {
+        images[i] = (PyArrayObject*)PyArray_FROMANY(Py_images[i], NPY_UINT8, 2, 2,
+                                                    NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+        if(images[i] == NULL)
+            goto done;
+    }
+    const npy_intp* dims = PyArray_DIMS(images[0]);
+    if(PyArray_DIMS(images[1])[0] != dims[0] ||
+       PyArray_DIMS(images[1])[1] != dims[1])
+    {
+        BARF("The two images must have the same dimensions. Got (%d,%d) and (%d,%d)",
+             (int)dims[0], (int)dims[1],
+             (int)PyArray_DIMS(images[1])[0], (int)PyArray_DIMS(images[1])[1]);
+        goto done;
+    }
+
+    disparity = (PyArrayObject*)PyArray_SimpleNew(2, dims, NPY_INT16);
+    if(disparity == NULL)
+    {
+        BARF("Couldn't allocate the disparity image");
+        goto done;
+    }
+
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS;
+    ok = mrcal_stereo_sgm((int16_t*)PyArray_DATA(disparity),
+                          (const uint8_t*)PyArray_DATA(images[0]),
+                          (const uint8_t*)PyArray_DATA(images[1]),
+                          (int)dims[1], (int)dims[0],
+                          &parameters,
+                          0);
+    Py_END_ALLOW_THREADS;
+    if(!ok)
+    {
+        BARF("mrcal_stereo_sgm() failed");
+        goto done;
+    }
+
+    result = (PyObject*)disparity;
+    Py_INCREF(result);
+
+ done:
+    Py_XDECREF(images[0]);
+    Py_XDECREF(images[1]);
+    Py_XDECREF(disparity);
+    RESET_SIGINT();
+    return result;
+}
+
+static PyObject* _triangulate_with_uncertainty(PyObject* NPY_UNUSED(self),
+                                               PyObject* args,
+                                               PyObject* kwargs)
+{
+    PyObject*      result            = NULL;
+    PyArrayObject* q                 = NULL;
+    PyArrayObject* intrinsics[2]     = {};
+    PyArrayObject* rt_cam_ref[2]     = {};
+    PyArrayObject* Var_q             = NULL;
+    PyArrayObject* rt_ref_frame      = NULL;
+    PyArrayObject* p                 = NULL;
+    PyArrayObject* Var_p_observation = NULL;
+    PyArrayObject* dp_dstate         = NULL;
+    SET_SIGINT();
+
+    char* keywords[] = {"q", "method",
+                        "lensmodel0", "intrinsics0", "rt_0ref",
+                        "lensmodel1", "intrinsics1", "rt_1ref",
+                        "Var_q",
+                        "Nstate",
+                        "istate_intrinsics0", "istate_intrinsics1",
+                        "icol0_intrinsics",   "Nintrinsics_state",
+                        "istate_extrinsics0", "istate_extrinsics1",
+                        "stabilize",
+                        "rt_ref_frame", "istate_frames",
+                        NULL};
+    PyObject*   Py_q                = NULL;
+    const char* method_string       = NULL;
+    PyObject*   lensmodel_string[2] = {};
+    PyObject*   Py_intrinsics[2]    = {};
+    PyObject*   Py_rt_cam_ref[2]    = {};
+    PyObject*   Py_Var_q            = Py_None;
+    PyObject*   Py_rt_ref_frame     = Py_None;
+    int Nstate             = -1;
+    int istate_intrinsics0 = -1, istate_intrinsics1 = -1;
+    int icol0_intrinsics   = 0,  Nintrinsics_state  = 0;
+    int istate_extrinsics0 = -1, istate_extrinsics1 = -1;
+    int stabilize          = 0;
+    int istate_frames      = -1;
+
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     "Os" STRING_OBJECT "OO" STRING_OBJECT "OO|$Oiiiiiiipoi",
+                                     keywords,
+                                     &Py_q, &method_string,
+                                     &lensmodel_string[0], &Py_intrinsics[0], &Py_rt_cam_ref[0],
+                                     &lensmodel_string[1], &Py_intrinsics[1], &Py_rt_cam_ref[1],
+                                     &Py_Var_q,
+                                     &Nstate,
+                                     &istate_intrinsics0, &istate_intrinsics1,
+                                     &icol0_intrinsics,   &Nintrinsics_state,
+                                     &istate_extrinsics0, &istate_extrinsics1,
+                                     &stabilize,
+                                     &Py_rt_ref_frame, &istate_frames))
+        goto done;
+
+    mrcal_triangulation_function_t* triangulate = NULL;
+#define CHECK_METHOD(name)                                      \
+    if(0 == strcmp(method_string, #name))                       \
+        triangulate = &mrcal_triangulate_ ## name;
+    MRCAL_TRIANGULATION_METHOD_LIST(CHECK_METHOD);
+#undef CHECK_METHOD
+    if(triangulate == NULL)
+    {
+        BARF("Unknown triangulation method '%s'", method_string);
+        goto done;
+    }
+
+    q = (PyArrayObject*)PyArray_FROMANY(Py_q, NPY_DOUBLE, 3, 3,
+                                        NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(q == NULL)
+        goto done;
+    const int N = (int)PyArray_DIMS(q)[0];
+    if(PyArray_DIMS(q)[1] != 2 || PyArray_DIMS(q)[2] != 2)
+    {
+        BARF("'q' must have shape (N,2,2)");
+        goto done;
+    }
+
+    mrcal_lensmodel_t lensmodel[2];
+    for(int i=0; i<2; i++)
+    {
+        if(!parse_lensmodel_from_arg(&lensmodel[i], lensmodel_string[i]))
+            goto done;
+
+        intrinsics[i] = double_array_from_arg(Py_intrinsics[i], "intrinsics", 1,
+                                              (npy_intp[]){mrcal_lensmodel_num_params(&lensmodel[i])});
+        if(intrinsics[i] == NULL)
+            goto done;
+        rt_cam_ref[i] = double_array_from_arg(Py_rt_cam_ref[i], "rt_cam_ref", 1,
+                                              (npy_intp[]){6});
+        if(rt_cam_ref[i] == NULL)
+            goto done;
+    }
+
+    int Nframes = 0;
+    if(Py_rt_ref_frame != Py_None)
+    {
+        rt_ref_frame = (PyArrayObject*)PyArray_FROMANY(Py_rt_ref_frame, NPY_DOUBLE, 2, 2,
+                                                       NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+        if(rt_ref_frame == NULL)
+            goto done;
+        if(PyArray_DIMS(rt_ref_frame)[1] != 6)
+        {
+            BARF("'rt_ref_frame' must have shape (Nframes,6)");
+            goto done;
+        }
+        Nframes = (int)PyArray_DIMS(rt_ref_frame)[0];
+    }
+
+    // The C code writes dp_dstate at these indices without checking them, so
+    // I make sure they're in bounds here
+    if(Nstate < 0 &&
+       (istate_intrinsics0 >= 0 || istate_intrinsics1 >= 0 ||
+        istate_extrinsics0 >= 0 || istate_extrinsics1 >= 0 ||
+        istate_frames      >= 0))
+    {
+        BARF("State indices were given, so Nstate must be given too");
+        goto done;
+    }
+    if(icol0_intrinsics < 0 || Nintrinsics_state < 0)
+    {
+        BARF("Invalid optimized-intrinsics columns: icol0_intrinsics=%d, Nintrinsics_state=%d",
+             icol0_intrinsics, Nintrinsics_state);
+        goto done;
+    }
+    for(int i=0; i<2; i++)
+    {
+        if(icol0_intrinsics + Nintrinsics_state > mrcal_lensmodel_num_params(&lensmodel[i]))
+        {
+            BARF("Invalid optimized-intrinsics columns: icol0_intrinsics=%d, Nintrinsics_state=%d, but camera %d has only %d intrinsics",
+                 icol0_intrinsics, Nintrinsics_state,
+                 i, mrcal_lensmodel_num_params(&lensmodel[i]));
+            goto done;
+        }
+    }
+    {
+        const int istate_intrinsics[2] = {istate_intrinsics0, istate_intrinsics1};
+        const int istate_extrinsics[2] = {istate_extrinsics0, istate_extrinsics1};
+        for(int i=0; i<2; i++)
+        {
+            if(istate_intrinsics[i] >= 0 &&
+               istate_intrinsics[i] + Nintrinsics_state > Nstate)
+            {
+                BARF("istate_intrinsics%d=%d with Nintrinsics_state=%d is out of bounds: Nstate=%d",
+                     i, istate_intrinsics[i], Nintrinsics_state, Nstate);
+                goto done;
+            }
+            if(istate_extrinsics[i] >= 0 &&
+               istate_extrinsics[i] + 6 > Nstate)
+            {
+                BARF("istate_extrinsics%d=%d is out of bounds: Nstate=%d",
+                     i, istate_extrinsics[i], Nstate);
+                goto done;
+            }
+        }
+    }
+    if(rt_ref_frame != NULL &&
+       (istate_frames < 0 || istate_frames + 6*Nframes > Nstate))
+    {
+        BARF("istate_frames=%d with Nframes=%d is out of bounds: Nstate=%d",
+             istate_frames, Nframes, Nstate);
+        goto done;
+    }
 
-static PyMethodDef CHOLMOD_factorization_methods[] =
+    p = (PyArrayObject*)PyArray_SimpleNew(2, ((npy_intp[]){N,3}), NPY_DOUBLE);
+    if(p == NULL)
     {
-        PYMETHODDEF_ENTRY(CHOLMOD_factorization_, solve_xt_JtJ_bt, METH_VARARGS | METH_KEYWORDS),
-        {}
-    };
+        BARF("Couldn't allocate the output");
+        goto done;
+    }
+    if(Py_Var_q != Py_None)
+    {
+        Var_q = double_array_from_arg(Py_Var_q, "Var_q", 2, (npy_intp[]){4,4});
+        if(Var_q == NULL)
+            goto done;
+        Var_p_observation = (PyArrayObject*)PyArray_SimpleNew(3, ((npy_intp[]){N,3,3}), NPY_DOUBLE);
+        if(Var_p_observation == NULL)
+        {
+            BARF("Couldn't allocate the output");
+            goto done;
+        }
+    }
+    if(Nstate >= 0)
+    {
+        dp_dstate = (PyArrayObject*)PyArray_ZEROS(3, ((npy_intp[]){N,3,Nstate}), NPY_DOUBLE, 0);
+        if(dp_dstate == NULL)
+        {
+            BARF("Couldn't allocate the output");
+            goto done;
+        }
+    }
 
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS;
+    ok = mrcal_triangulate_with_uncertainty((mrcal_point3_t*)PyArray_DATA(p),
+                                            Var_p_observation == NULL ? NULL : (double*)PyArray_DATA(Var_p_observation),
+                                            dp_dstate         == NULL ? NULL : (double*)PyArray_DATA(dp_dstate),
+                                            (const mrcal_point2_t*)PyArray_DATA(q),
+                                            N,
+                                            triangulate,
+                                            &lensmodel[0],
+                                            (const double*)PyArray_DATA(intrinsics[0]),
+                                            (const double*)PyArray_DATA(rt_cam_ref[0]),
+                                            &lensmodel[1],
+                                            (const double*)PyArray_DATA(intrinsics[1]),
+                                            (const double*)PyArray_DATA(rt_cam_ref[1]),
+                                            Var_q == NULL ? NULL : (const double*)PyArray_DATA(Var_q),
+                                            Nstate,
+                                            istate_intrinsics0, istate_intrinsics1,
+                                            icol0_intrinsics,   Nintrinsics_state,
+                                            istate_extrinsics0, istate_extrinsics1,
+                                            stabilize,
+                                            rt_ref_frame == NULL ? NULL : (const double*)PyArray_DATA(rt_ref_frame),
+                                            Nframes, istate_frames,
+                                            0);
+    Py_END_ALLOW_THREADS;
+    if(!ok)
+    {
+        BARF("mrcal_triangulate_with_uncertainty() failed");
+        goto done;
+    }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wmissing-braces"
-// PyObject_HEAD_INIT throws
-//   warning: missing braces around initializer []
-// This isn't mine to fix, so I'm ignoring it
-static PyTypeObject CHOLMOD_factorization_type =
-{
-     PyObject_HEAD_INIT(NULL)
-    .tp_name      = "mrcal.CHOLMOD_factorization",
-    .tp_basicsize = sizeof(CHOLMOD_factorization),
-    .tp_new       = PyType_GenericNew,
-    .tp_init      = (initproc)CHOLMOD_factorization_init,
-    .tp_dealloc   = (destructor)CHOLMOD_factorization_dealloc,
-    .tp_methods   = CHOLMOD_factorization_methods,
-    .tp_str       = (reprfunc)CHOLMOD_factorization_str,
-    .tp_flags     = Py_TPFLAGS_DEFAULT,
-    .tp_doc       = CHOLMOD_factorization_docstring,
-};
-#pragma GCC diagnostic pop
+    result = Py_BuildValue("OOO",
+                           p,
+                           Var_p_observation == NULL ? Py_None : (PyObject*)Var_p_observation,
+                           dp_dstate         == NULL ? Py_None : (PyObject*)dp_dstate);
 
+ done:
+    Py_XDECREF(q);
+    for(int i=0; i<2; i++)
+    {
+        Py_XDECREF(intrinsics[i]);
+        Py_XDECREF(rt_cam_ref[i]);
+    }
+    Py_XDECREF(Var_q);
+    Py_XDECREF(rt_ref_frame);
+    Py_XDECREF(p);
+    Py_XDECREF(Var_p_observation);
+    Py_XDECREF(dp_dstate);
+    RESET_SIGINT();
+    return result;
+}
 
-// For the C code. Create a new Python CHOLMOD_factorization object from a C
-// cholmod_sparse structure
-static PyObject*
-CHOLMOD_factorization_from_cholmod_sparse(cholmod_sparse* Jt)
+static PyObject* _projection_uncertainty_grid(PyObject* NPY_UNUSED(self),
+                                              PyObject* args,
+                                              PyObject* kwargs)
 {
-    PyObject* self = PyObject_CallObject((PyObject*)&CHOLMOD_factorization_type, NULL);
-    if(NULL == self)
-        return NULL;
+    PyObject*      result     = NULL;
+    PyArrayObject* intrinsics = NULL;
+    PyArrayObject* rt_cam_ref = NULL;
+    PyArrayObject* Var_basis  = NULL;
+    PyArrayObject* stdev      = NULL;
+    SET_SIGINT();
 
-    if(!_CHOLMOD_factorization_init_from_cholmod_sparse((CHOLMOD_factorization*)self, Jt))
-    {
-        Py_DECREF(self);
-        return NULL;
-    }
+    char* keywords[] = {"lensmodel", "intrinsics", "imagersize",
+                        "gridn_width", "gridn_height",
+                        "distance",
+                        "Var_basis",
+                        "atinfinity",
+                        "rt_cam_ref",
+                        "icol0_intrinsics", "Nintrinsics_state",
+                        "rms",
+                        NULL};
+    PyObject*    lensmodel_string = NULL;
+    PyObject*    Py_intrinsics    = NULL;
+    unsigned int imagersize[2];
+    int          gridn_width      = -1, gridn_height = -1;
+    double       distance         = 0.0;
+    PyObject*    Py_Var_basis     = NULL;
+    int          atinfinity       = 0;
+    PyObject*    Py_rt_cam_ref    = Py_None;
+    int          icol0_intrinsics = 0, Nintrinsics_state = 0;
+    int          rms              = 0;
 
-    return self;
-}
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     STRING_OBJECT "O(II)iidO|$pOiip",
+                                     keywords,
+                                     &lensmodel_string, &Py_intrinsics,
+                                     &imagersize[0], &imagersize[1],
+                                     &gridn_width, &gridn_height,
+                                     &distance,
+                                     &Py_Var_basis,
+                                     &atinfinity,
+                                     &Py_rt_cam_ref,
+                                     &icol0_intrinsics, &Nintrinsics_state,
+                                     &rms))
+        goto done;
 
+    mrcal_lensmodel_t lensmodel;
+    if(!parse_lensmodel_from_arg(&lensmodel, lensmodel_string))
+        goto done;
 
+    intrinsics = double_array_from_arg(Py_intrinsics, "intrinsics", 1,
+                                       (npy_intp[]){mrcal_lensmodel_num_params(&lensmodel)});
+    if(intrinsics == NULL)
+        goto done;
+    const int Nbasis = Nintrinsics_state + 12;
+    Var_basis = double_array_from_arg(Py_Var_basis, "Var_basis", 2,
+                                      (npy_intp[]){Nbasis,Nbasis});
+    if(Var_basis == NULL)
+        goto done;
+    if(Py_rt_cam_ref != Py_None)
+    {
+        rt_cam_ref = double_array_from_arg(Py_rt_cam_ref, "rt_cam_ref", 1,
+                                           (npy_intp[]){6});
+        if(rt_cam_ref == NULL)
+            goto done;
+    }
+    if(gridn_width <= 0 || gridn_height <= 0)
+    {
+        BARF("The grid must be non-empty. Got gridn_width=%d, gridn_height=%d",
+             gridn_width, gridn_height);
+        goto done;
+    }
 
-static bool parse_lensmodel_from_arg(// output
-                                     mrcal_lensmodel_t* lensmodel,
-                                     // input
-                                     PyObject* lensmodel_string)
-{
-    const char* lensmodel_cstring = PyString_AsString(lensmodel_string);
-    if( lensmodel_cstring == NULL)
+    stdev = (PyArrayObject*)PyArray_SimpleNew(2, ((npy_intp[]){gridn_height,gridn_width}), NPY_DOUBLE);
+    if(stdev == NULL)
     {
-        BARF("The lens model must be given as a string");
-        return false;
+        BARF("Couldn't allocate the output");
+        goto done;
     }
 
-    mrcal_lensmodel_from_name(lensmodel, lensmodel_cstring);
-    if( !mrcal_lensmodel_type_is_valid(lensmodel->type) )
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS;
+    ok = mrcal_projection_uncertainty_grid((double*)PyArray_DATA(stdev),
+                                           gridn_width, gridn_height,
+                                           &lensmodel,
+                                           (const double*)PyArray_DATA(intrinsics),
+                                           imagersize,
+                                           distance,
+                                           atinfinity,
+                                           rt_cam_ref == NULL ? NULL : (const double*)PyArray_DATA(rt_cam_ref),
+                                           (const double*)PyArray_DATA(Var_basis),
+                                           icol0_intrinsics, Nintrinsics_state,
+                                           rms,
+                                           0);
+    Py_END_ALLOW_THREADS;
+    if(!ok)
     {
-        if(lensmodel->type == MRCAL_LENSMODEL_INVALID_BADCONFIG)
-        {
-            BARF("Couldn't parse the configuration of the given lens model '%s'",
-                         lensmodel_cstring);
-            return false;
-        }
-        BARF("Invalid lens model was passed in: '%s'. Must be one of " VALID_LENSMODELS_FORMAT,
-                     lensmodel_cstring
-                     VALID_LENSMODELS_ARGLIST);
-        return false;
+        BARF("mrcal_projection_uncertainty_grid() failed");
+        goto done;
     }
-    return true;
+
+    Py_INCREF(stdev);
+    result = (PyObject*)stdev;
+
+ done:
+    Py_XDECREF(intrinsics);
+    Py_XDECREF(rt_cam_ref);
+    Py_XDECREF(Var_basis);
+    Py_XDECREF(stdev);
+    RESET_SIGINT();
+    return result;
 }
 
-static PyObject* lensmodel_metadata_and_config(PyObject* NPY_UNUSED(self),
-                                               PyObject* args)
+static PyObject* _image_transformation_map(PyObject* NPY_UNUSED(self),
+                                           PyObject* args,
+                                           PyObject* kwargs)
 {
-    PyObject* result = NULL;
+    PyObject*      result          = NULL;
+    PyArrayObject* intrinsics_from = NULL;
+    PyArrayObject* intrinsics_to   = NULL;
+    PyArrayObject* M               = NULL;
+    PyArrayObject* mapxy           = NULL;
     SET_SIGINT();
 
-    PyObject* lensmodel_string = NULL;
-    if(!PyArg_ParseTuple( args, STRING_OBJECT, &lensmodel_string ))
+    char* keywords[] = {"lensmodel_from", "intrinsics_from",
+                        "lensmodel_to",   "intrinsics_to",
+                        "M", "imagersize_to",
+                        NULL};
+    PyObject* lensmodel_from_string = NULL;
+    PyObject* Py_intrinsics_from    = NULL;
+    PyObject* lensmodel_to_string   = NULL;
+    PyObject* Py_intrinsics_to      = NULL;
+    PyObject* Py_M                  = NULL;
+    unsigned int imagersize_to[2];
+
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     STRING_OBJECT "O" STRING_OBJECT "OO(II)",
+                                     keywords,
+                                     &lensmodel_from_string, &Py_intrinsics_from,
+                                     &lensmodel_to_string,   &Py_intrinsics_to,
+                                     &Py_M,
+                                     &imagersize_to[0], &imagersize_to[1]))
         goto done;
-    mrcal_lensmodel_t lensmodel;
-    if(!parse_lensmodel_from_arg(&lensmodel, lensmodel_string))
+
+    mrcal_lensmodel_t lensmodel_from, lensmodel_to;
+    if(!parse_lensmodel_from_arg(&lensmodel_from, lensmodel_from_string) ||
+       !parse_lensmodel_from_arg(&lensmodel_to,   lensmodel_to_string))
         goto done;
 
-    mrcal_lensmodel_metadata_t meta = mrcal_lensmodel_metadata(&lensmodel);
+    intrinsics_from = double_array_from_arg(Py_intrinsics_from, "intrinsics_from", 1,
+                                            (npy_intp[]){mrcal_lensmodel_num_params(&lensmodel_from)});
+    if(intrinsics_from == NULL)
+        goto done;
+    intrinsics_to = double_array_from_arg(Py_intrinsics_to, "intrinsics_to", 1,
+                                          (npy_intp[]){mrcal_lensmodel_num_params(&lensmodel_to)});
+    if(intrinsics_to == NULL)
+        goto done;
+    M = double_array_from_arg(Py_M, "M", 2, (npy_intp[]){3,3});
+    if(M == NULL)
+        goto done;
 
-#define MRCAL_ITEM_BUILDVALUE_DEF(  name, type, pybuildvaluecode, PRIcode,SCNcode, bitfield, cookie) " s "pybuildvaluecode
-#define MRCAL_ITEM_BUILDVALUE_VALUE(name, type, pybuildvaluecode, PRIcode,SCNcode, bitfield, cookie) , #name, cookie name
+    mapxy = (PyArrayObject*)PyArray_SimpleNew(3,
+                                              ((npy_intp[]){imagersize_to[1],
+                                                            imagersize_to[0],
+                                                            2}),
+                                              NPY_FLOAT32);
+    if(mapxy == NULL)
+    {
+        BARF("Couldn't allocate the transformation map");
+        goto done;
+    }
 
-    if(lensmodel.type == MRCAL_LENSMODEL_CAHVORE )
-        result = Py_BuildValue("{"
-                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_DEF, )
-                               MRCAL_LENSMODEL_CAHVORE_CONFIG_LIST(MRCAL_ITEM_BUILDVALUE_DEF, )
-                               "}"
-                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_VALUE, meta.)
-                               MRCAL_LENSMODEL_CAHVORE_CONFIG_LIST(MRCAL_ITEM_BUILDVALUE_VALUE, lensmodel.LENSMODEL_CAHVORE__config.));
-    else if(lensmodel.type == MRCAL_LENSMODEL_SPLINED_STEREOGRAPHIC )
-        result = Py_BuildValue("{"
-                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_DEF, )
-                               MRCAL_LENSMODEL_SPLINED_STEREOGRAPHIC_CONFIG_LIST(MRCAL_ITEM_BUILDVALUE_DEF, )
-                               "}"
-                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_VALUE, meta.)
-                               MRCAL_LENSMODEL_SPLINED_STEREOGRAPHIC_CONFIG_LIST(MRCAL_ITEM_BUILDVALUE_VALUE, lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.));
-    else
-        result = Py_BuildValue("{"
-                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_DEF, )
-                               "}"
-                               MRCAL_LENSMODEL_META_LIST(MRCAL_ITEM_BUILDVALUE_VALUE, meta.));
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS;
+    ok = mrcal_image_transformation_map((float*)PyArray_DATA(mapxy),
+                                        &lensmodel_from,
+                                        (const double*)PyArray_DATA(intrinsics_from),
+                                        &lensmodel_to,
+                                        (const double*)PyArray_DATA(intrinsics_to),
+                                        (const double*)PyArray_DATA(M),
+                                        imagersize_to,
+                                        0);
+    Py_END_ALLOW_THREADS;
+    if(!ok)
+    {
+        BARF("mrcal_image_transformation_map() failed");
+        goto done;
+    }
 
+    result = (PyObject*)mapxy;
     Py_INCREF(result);
 
  done:
+    Py_XDECREF(intrinsics_from);
+    Py_XDECREF(intrinsics_to);
+    Py_XDECREF(M);
+    Py_XDECREF(mapxy);
     RESET_SIGINT();
     return result;
 }
 
-static PyObject* knots_for_splined_models(PyObject* NPY_UNUSED(self),
-                                          PyObject* args)
+static PyObject* _transformation_map_fixedpoint(PyObject* NPY_UNUSED(self),
+                                                PyObject* args,
+                                                PyObject* kwargs)
 {
-    PyObject*      result = NULL;
-    PyArrayObject* py_ux  = NULL;
-    PyArrayObject* py_uy  = NULL;
+    PyObject*      result       = NULL;
+    PyArrayObject* mapxy        = NULL;
+    PyArrayObject* map_xy       = NULL;
+    PyArrayObject* map_fraction = NULL;
     SET_SIGINT();
 
-    PyObject* lensmodel_string = NULL;
-    if(!PyArg_ParseTuple( args, STRING_OBJECT, &lensmodel_string ))
+    char* keywords[] = {"mapxy", NULL};
+    PyObject* Py_mapxy = NULL;
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     "O", keywords,
+                                     &Py_mapxy))
         goto done;
-    mrcal_lensmodel_t lensmodel;
-    if(!parse_lensmodel_from_arg(&lensmodel, lensmodel_string))
+
+    mapxy = (PyArrayObject*)PyArray_FROMANY(Py_mapxy, NPY_FLOAT32, 3, 3,
+                                            NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(mapxy == NULL)
         goto done;
+    if(PyArray_DIMS(mapxy)[2] != 2)
+    {
+        BARF("'mapxy' must have shape (Nheight,Nwidth,2). Got a last dimension of %d",
+             (int)PyArray_DIMS(mapxy)[2]);
+        goto done;
+    }
 
-    if(lensmodel.type != MRCAL_LENSMODEL_SPLINED_STEREOGRAPHIC)
+    const npy_intp* dims = PyArray_DIMS(mapxy);
+    map_xy       = (PyArrayObject*)PyArray_SimpleNew(3, ((npy_intp[]){dims[0], dims[1], 2}), NPY_INT16);
+    map_fraction = (PyArrayObject*)PyArray_SimpleNew(2, ((npy_intp[]){dims[0], dims[1]   }), NPY_UINT16);
+    if(map_xy == NULL || map_fraction == NULL)
     {
-        BARF( "This function works only with the MRCAL_LENSMODEL_SPLINED_STEREOGRAPHIC model. %S passed in",
-              lensmodel_string);
+        BARF("Couldn't allocate the fixed-point map");
         goto done;
     }
 
+    Py_BEGIN_ALLOW_THREADS;
+    mrcal_remap_map_fixedpoint((int16_t*)PyArray_DATA(map_xy),
+                               (uint16_t*)PyArray_DATA(map_fraction),
+                               (const float*)PyArray_DATA(mapxy),
+                               (int)(dims[0]*dims[1]));
+    Py_END_ALLOW_THREADS;
+
+    result = Py_BuildValue("OO", map_xy, map_fraction);
+
+ done:
+    Py_XDECREF(mapxy);
+    Py_XDECREF(map_xy);
+    Py_XDECREF(map_fraction);
+    RESET_SIGINT();
+    return result;
+}
+
+static PyObject* _remap(PyObject* NPY_UNUSED(self),
+                        PyObject* args,
+                        PyObject* kwargs)
+{
+    PyObject*      result       = NULL;
+    PyArrayObject* image        = NULL;
+    PyArrayObject* map_xy       = NULL;
+    PyArrayObject* map_fraction = NULL;
+    PyArrayObject* out          = NULL;
+    SET_SIGINT();
+
+    char* keywords[] = {"image", "map_xy", "map_fraction",
+                        "out", "border_value",
+                        NULL};
+    PyObject* Py_image        = NULL;
+    PyObject* Py_map_xy       = NULL;
+    PyObject* Py_map_fraction = NULL;
+    PyObject* Py_out          = NULL;
+    double    border_value    = 0.0;
+    if( !PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     "OOO|Od", keywords,
+                                     &Py_image, &Py_map_xy, &Py_map_fraction,
+                                     &Py_out, &border_value))
+        goto done;
+
+    if(!PyArray_Check(Py_image))
     {
-        double ux[lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Nx];
-        double uy[lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Ny];
-        if(!mrcal_knots_for_splined_models(ux,uy, &lensmodel))
-        {
-            BARF( "mrcal_knots_for_splined_models() failed");
-            goto done;
-        }
+        BARF("'image' must be a numpy array");
+        goto done;
+    }
 
+    mrcal_remap_pixel_type_t pixel_type;
+    switch(PyArray_TYPE((PyArrayObject*)Py_image))
+    {
+    case NPY_UINT8:   pixel_type = MRCAL_REMAP_PIXEL_UINT8;  break;
+    case NPY_UINT16:  pixel_type = MRCAL_REMAP_PIXEL_UINT16; break;
+    case NPY_FLOAT32: pixel_type = MRCAL_REMAP_PIXEL_FLOAT;  break;
+    default:
+        BARF("'image' must contain uint8, uint16 or float32 data");
+        goto done;
+    }
+    const int npy_type = PyArray_TYPE((PyArrayObject*)Py_image);
 
-        npy_intp dims[1];
+    image = (PyArrayObject*)PyArray_FROMANY(Py_image, npy_type, 2, 3,
+                                            NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(image == NULL)
+        goto done;
+    const int Nchannels = PyArray_NDIM(image) == 3 ? (int)PyArray_DIMS(image)[2] : 1;
+    if(Nchannels < 1 || Nchannels > 4)
+    {
+        BARF("'image' must have 1-4 channels. Got %d", Nchannels);
+        goto done;
+    }
 
-        dims[0] = lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Nx;
-        py_ux = (PyArrayObject*)PyArray_SimpleNew(1, dims, NPY_DOUBLE);
-        if(py_ux == NULL)
+    map_xy = (PyArrayObject*)PyArray_FROMANY(Py_map_xy, NPY_INT16, 3, 3,
+                                             NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(map_xy == NULL)
+        goto done;
+    const npy_intp* dims = PyArray_DIMS(map_xy);
+    if(dims[2] != 2)
+    {
+        BARF("'map_xy' must have shape (Nheight,Nwidth,2). Got a last dimension of %d",
+             (int)dims[2]);
+        goto done;
+    }
+    map_fraction = (PyArrayObject*)PyArray_FROMANY(Py_map_fraction, NPY_UINT16, 2, 2,
+                                                   NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+    if(map_fraction == NULL)
+        goto done;
+    if(PyArray_DIMS(map_fraction)[0] != dims[0] ||
+       PyArray_DIMS(map_fraction)[1] != dims[1])
+    {
+        BARF("'map_fraction' must have shape (Nheight,Nwidth) = (%d,%d). Got (%d,%d)",
+             (int)dims[0], (int)dims[1],
+             (int)PyArray_DIMS(map_fraction)[0], (int)PyArray_DIMS(map_fraction)[1]);
+        goto done;
+    }
+
+    const npy_intp dims_out[] = {dims[0], dims[1], Nchannels};
+    const int      ndims_out  = PyArray_NDIM(image);
+    if(Py_out == NULL || Py_out == Py_None)
+    {
+        out = (PyArrayObject*)PyArray_SimpleNew(ndims_out, dims_out, npy_type);
+        if(out == NULL)
         {
-            BARF("Couldn't allocate ux");
+            BARF("Couldn't allocate the output image");
             goto done;
         }
-
-        dims[0] = lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Ny;
-        py_uy = (PyArrayObject*)PyArray_SimpleNew(1, dims, NPY_DOUBLE);
-        if(py_uy == NULL)
+    }
+    else
+    {
+        if(!PyArray_Check(Py_out) ||
+           PyArray_TYPE((PyArrayObject*)Py_out) != npy_type ||
+           PyArray_NDIM((PyArrayObject*)Py_out) != ndims_out ||
+           !PyArray_IS_C_CONTIGUOUS((PyArrayObject*)Py_out))
         {
-            BARF("Couldn't allocate uy");
+            BARF("'out' must be a C-contiguous numpy array with the same dtype and number of dimensions as 'image'");
             goto done;
         }
+        for(int i=0; i<ndims_out; i++)
+            if(PyArray_DIMS((PyArrayObject*)Py_out)[i] != dims_out[i])
+            {
+                BARF("'out' has an unexpected shape. Dimension %d should be %d, but got %d",
+                     i, (int)dims_out[i], (int)PyArray_DIMS((PyArrayObject*)Py_out)[i]);
+                goto done;
+            }
+        out = (PyArrayObject*)Py_out;
+        Py_INCREF(out);
+    }
 
-        memcpy(PyArray_DATA(py_ux), ux, lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Nx*sizeof(double));
-        memcpy(PyArray_DATA(py_uy), uy, lensmodel.LENSMODEL_SPLINED_STEREOGRAPHIC__config.Ny*sizeof(double));
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS;
+    ok = mrcal_remap(PyArray_DATA(out),
+                     (int)dims[1], (int)dims[0], 0,
+                     PyArray_DATA(image),
+                     (int)PyArray_DIMS(image)[1], (int)PyArray_DIMS(image)[0], 0,
+                     pixel_type, Nchannels,
+                     (const int16_t*)PyArray_DATA(map_xy),
+                     (const uint16_t*)PyArray_DATA(map_fraction),
+                     border_value,
+                     0);
+    Py_END_ALLOW_THREADS;
+    if(!ok)
+    {
+        BARF("mrcal_remap() failed");
+        goto done;
     }
 
-    result = Py_BuildValue("OO", py_ux, py_uy);
+    result = (PyObject*)out;
+    Py_INCREF(result);
 
  done:
-    Py_XDECREF(py_ux);
-    Py_XDECREF(py_uy);
+    Py_XDECREF(image);
+    Py_XDECREF(map_xy);
+    Py_XDECREF(map_fraction);
+    Py_XDECREF(out);
     RESET_SIGINT();
     return result;
 }
@@ -2622,6 +4643,36 @@ static const char supported_lensmodels_docstring[] =
 static const char knots_for_splined_models_docstring[] =
 #include "knots_for_splined_models.docstring.h"
     ;
+static const char _rectification_maps_docstring[] =
+#include "_rectification_maps.docstring.h"
+    ;
+static const char _stereo_range_lut_docstring[] =
+#include "_stereo_range_lut.docstring.h"
+    ;
+static const char _stereo_range_from_lut_docstring[] =
+#include "_stereo_range_from_lut.docstring.h"
+    ;
+static const char _stereo_point_cloud_docstring[] =
+#include "_stereo_point_cloud.docstring.h"
+    ;
+static const char _stereo_sgm_docstring[] =
+#include "_stereo_sgm.docstring.h"
+    ;
+static const char _triangulate_with_uncertainty_docstring[] =
+#include "_triangulate_with_uncertainty.docstring.h"
+    ;
+static const char _projection_uncertainty_grid_docstring[] =
+#include "_projection_uncertainty_grid.docstring.h"
+    ;
+static const char _image_transformation_map_docstring[] =
+#include "_image_transformation_map.docstring.h"
+    ;
+static const char _transformation_map_fixedpoint_docstring[] =
+#include "_transformation_map_fixedpoint.docstring.h"
+    ;
+static const char _remap_docstring[] =
+#include "_remap.docstring.h"
+    ;
 static PyMethodDef methods[] =
     { PYMETHODDEF_ENTRY(,optimize,                         METH_VARARGS | METH_KEYWORDS),
       PYMETHODDEF_ENTRY(,optimizer_callback,               METH_VARARGS | METH_KEYWORDS),
@@ -2653,6 +4704,17 @@ static PyMethodDef methods[] =
       PYMETHODDEF_ENTRY(,lensmodel_num_params,         METH_VARARGS),
       PYMETHODDEF_ENTRY(,supported_lensmodels,         METH_NOARGS),
       PYMETHODDEF_ENTRY(,knots_for_splined_models,     METH_VARARGS),
+
+      PYMETHODDEF_ENTRY(,_rectification_maps,          METH_VARARGS | METH_KEYWORDS),
+      PYMETHODDEF_ENTRY(,_stereo_range_lut,            METH_VARARGS | METH_KEYWORDS),
+      PYMETHODDEF_ENTRY(,_stereo_range_from_lut,       METH_VARARGS | METH_KEYWORDS),
+      PYMETHODDEF_ENTRY(,_stereo_point_cloud,          METH_VARARGS | METH_KEYWORDS),
+      PYMETHODDEF_ENTRY(,_stereo_sgm,                  METH_VARARGS | METH_KEYWORDS),
+      PYMETHODDEF_ENTRY(,_triangulate_with_uncertainty,METH_VARARGS | METH_KEYWORDS),
+      PYMETHODDEF_ENTRY(,_projection_uncertainty_grid, METH_VARARGS | METH_KEYWORDS),
+      PYMETHODDEF_ENTRY(,_image_transformation_map,    METH_VARARGS | METH_KEYWORDS),
+      PYMETHODDEF_ENTRY(,_transformation_map_fixedpoint,METH_VARARGS | METH_KEYWORDS),
+      PYMETHODDEF_ENTRY(,_remap,                       METH_VARARGS | METH_KEYWORDS),
       {}
     };
 
@@ -2662,6 +4724,9 @@ static void _init_mrcal_common(PyObject* module)
     Py_INCREF(&CHOLMOD_factorization_type);
     PyModule_AddObject(module, "CHOLMOD_factorization", (PyObject *)&CHOLMOD_factorization_type);
 
+    Py_INCREF(&projector_type);
+    PyModule_AddObject(module, "projector", (PyObject *)&projector_type);
+
 }
 
 
@@ -2682,6 +4747,8 @@ PyMODINIT_FUNC init_mrcal(void)
 {
     if (PyType_Ready(&CHOLMOD_factorization_type) < 0)
         return;
+    if (PyType_Ready(&projector_type) < 0)
+        return;
 
     PyObject* module =
         Py_InitModule3("_mrcal", methods,
@@ -2705,6 +4772,8 @@ PyMODINIT_FUNC PyInit__mrcal(void)
 {
     if (PyType_Ready(&CHOLMOD_factorization_type) < 0)
         return NULL;
+    if (PyType_Ready(&projector_type) < 0)
+        return NULL;
 
     PyObject* module =
         PyModule_Create(&module_def);
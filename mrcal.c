@@ -12,6 +12,7 @@
 #include "mrcal.h"
 #include "minimath/minimath.h"
 #include "util.h"
+#include "strides.h"
 
 // These are parameter variable scales. They have the units of the parameters
 // themselves, so the optimizer sees x/SCALE_X for each parameter. I.e. as far
@@ -603,7 +604,10 @@ int _mrcal_num_j_nonzero(int Nobservations_board,
 //
 // Here we sample two interpolated surfaces at once: one each for the x and y
 // focal-length scales
-static
+//
+// These are always inlined into _project_point_splined(): in the specialized
+// kernels stridey is then a compile-time constant
+static inline __attribute__((always_inline))
 void sample_bspline_surface_cubic(double* out,
                                   double* dout_dx,
                                   double* dout_dy,
@@ -682,7 +686,7 @@ void sample_bspline_surface_cubic(double* out,
     interp(dout_dx, ABCDgradx, ABCDy);
     interp(dout_dy, ABCDx,     ABCDgrady);
 }
-static
+static inline __attribute__((always_inline))
 void sample_bspline_surface_quadratic(double* out,
                                       double* dout_dx,
                                       double* dout_dy,
@@ -1473,6 +1477,19 @@ void mrcal_unproject_latlon( // output
 }
 
 
+// Splined-model configurations that get a dedicated projection kernel. This is
+// an "X macro": https://en.wikipedia.org/wiki/X_Macro
+//
+// Each entry is (order, Nx, Ny). For these configurations we generate a kernel
+// where the spline order and the control-point grid dimensions are known at
+// compile time, so the segment-clamping bounds and the control-point strides
+// are all constants. Any other configuration uses the generic kernel, which
+// reads these from the lens model configuration at runtime. The kernel is
+// selected once, in _mrcal_precompute_lensmodel_data()
+#define SPLINED_SPECIALIZED_CONFIG_LIST(_)      \
+    _(3, 30, 20)                                \
+    _(3, 60, 40)
+
 static void _mrcal_precompute_lensmodel_data_MRCAL_LENSMODEL_SPLINED_STEREOGRAPHIC
   ( // output
     mrcal_LENSMODEL_SPLINED_STEREOGRAPHIC__precomputed_t* precomputed,
@@ -1521,6 +1538,17 @@ static void _mrcal_precompute_lensmodel_data_MRCAL_LENSMODEL_SPLINED_STEREOGRAPH
     double th_edge_x = (double)config->fov_x_deg/2. * M_PI / 180.;
     double u_edge_x  = tan(th_edge_x / 2.) * 2;
     precomputed->segments_per_u = (config->Nx - 1 - Nknots_margin) / (u_edge_x*2.);
+
+    // Select the specialized kernel, if we have one for this configuration
+    precomputed->ispecialized_kernel = -1;
+    int ispecialized_kernel = 0;
+#define SELECT_SPECIALIZED_KERNEL(order_, Nx_, Ny_)                     \
+    if(precomputed->ispecialized_kernel < 0 &&                          \
+       config->order == order_ && config->Nx == Nx_ && config->Ny == Ny_) \
+        precomputed->ispecialized_kernel = ispecialized_kernel;         \
+    ispecialized_kernel++;
+    SPLINED_SPECIALIZED_CONFIG_LIST(SELECT_SPECIALIZED_KERNEL);
+#undef SELECT_SPECIALIZED_KERNEL
 }
 
 // NOT A PART OF THE EXTERNAL API. This is exported for the mrcal python wrapper
@@ -1595,7 +1623,11 @@ static int get_Ngradients(const mrcal_lensmodel_t* lensmodel,
     return N;
 }
 
-static
+// The generic splined-model projection kernel. spline_order, Nx, Ny come from
+// the lens model configuration. This is always inlined: the specialized kernels
+// below call it with constant configurations, and the compiler then knows all
+// the loop bounds and strides
+static inline __attribute__((always_inline))
 void _project_point_splined( // outputs
                             mrcal_point2_t* q,
                             mrcal_point2_t* dq_dfxy,
@@ -1823,6 +1855,64 @@ void _project_point_splined( // outputs
     }
 }
 
+// The specialized splined-model kernels. Each is _project_point_splined() with
+// a constant configuration from SPLINED_SPECIALIZED_CONFIG_LIST
+typedef void (splined_kernel_t)( // outputs
+                                mrcal_point2_t* q,
+                                mrcal_point2_t* dq_dfxy,
+                                double* grad_ABCDx_ABCDy,
+                                int* ivar0,
+                                mrcal_point3_t* restrict dq_drcamera,
+                                mrcal_point3_t* restrict dq_dtcamera,
+                                mrcal_point3_t* restrict dq_drframe,
+                                mrcal_point3_t* restrict dq_dtframe,
+
+                                // inputs
+                                const mrcal_point3_t* restrict p,
+                                const mrcal_point3_t* restrict dp_drc,
+                                const mrcal_point3_t* restrict dp_dtc,
+                                const mrcal_point3_t* restrict dp_drf,
+                                const mrcal_point3_t* restrict dp_dtf,
+
+                                const double* restrict intrinsics,
+                                bool camera_at_identity,
+                                double segments_per_u);
+
+#define DEFINE_SPLINED_SPECIALIZED_KERNEL(order, Nx, Ny)                \
+static void _project_point_splined_##order##_##Nx##_##Ny                \
+  ( mrcal_point2_t* q,                                                  \
+    mrcal_point2_t* dq_dfxy,                                            \
+    double* grad_ABCDx_ABCDy,                                           \
+    int* ivar0,                                                         \
+    mrcal_point3_t* restrict dq_drcamera,                               \
+    mrcal_point3_t* restrict dq_dtcamera,                               \
+    mrcal_point3_t* restrict dq_drframe,                                \
+    mrcal_point3_t* restrict dq_dtframe,                                \
+    const mrcal_point3_t* restrict p,                                   \
+    const mrcal_point3_t* restrict dp_drc,                              \
+    const mrcal_point3_t* restrict dp_dtc,                              \
+    const mrcal_point3_t* restrict dp_drf,                              \
+    const mrcal_point3_t* restrict dp_dtf,                              \
+    const double* restrict intrinsics,                                  \
+    bool camera_at_identity,                                            \
+    double segments_per_u)                                              \
+{                                                                       \
+    _project_point_splined(q, dq_dfxy, grad_ABCDx_ABCDy, ivar0,         \
+                           dq_drcamera, dq_dtcamera, dq_drframe, dq_dtframe, \
+                           p, dp_drc, dp_dtc, dp_drf, dp_dtf,           \
+                           intrinsics, camera_at_identity,              \
+                           order, Nx, Ny, segments_per_u);              \
+}
+SPLINED_SPECIALIZED_CONFIG_LIST(DEFINE_SPLINED_SPECIALIZED_KERNEL)
+#undef DEFINE_SPLINED_SPECIALIZED_KERNEL
+
+// Indexed by mrcal_LENSMODEL_SPLINED_STEREOGRAPHIC__precomputed_t.ispecialized_kernel
+#define SPLINED_SPECIALIZED_KERNEL_ENTRY(order, Nx, Ny) \
+    &_project_point_splined_##order##_##Nx##_##Ny,
+static splined_kernel_t* const splined_specialized_kernels[] =
+    { SPLINED_SPECIALIZED_CONFIG_LIST(SPLINED_SPECIALIZED_KERNEL_ENTRY) };
+#undef SPLINED_SPECIALIZED_KERNEL_ENTRY
+
 typedef struct
 {
     double* pool;
@@ -2156,21 +2246,39 @@ void project( // out
             double grad_ABCDx_ABCDy[4+4];
             int ivar0;
 
-            _project_point_splined( // outputs
-                                   q, p_dq_dfxy,
-                                   grad_ABCDx_ABCDy,
-                                   &ivar0,
-
-                                   dq_drcamera,dq_dtcamera,dq_drframe,dq_dtframe,
-                                   // inputs
-                                   p,
-                                   dp_drc, dp_dtc, dp_drf, dp_dtf,
-                                   intrinsics,
-                                   camera_at_identity,
-                                   lensmodel->LENSMODEL_SPLINED_STEREOGRAPHIC__config.order,
-                                   lensmodel->LENSMODEL_SPLINED_STEREOGRAPHIC__config.Nx,
-                                   lensmodel->LENSMODEL_SPLINED_STEREOGRAPHIC__config.Ny,
-                                   precomputed->LENSMODEL_SPLINED_STEREOGRAPHIC__precomputed.segments_per_u);
+            const mrcal_LENSMODEL_SPLINED_STEREOGRAPHIC__precomputed_t* precomputed_splined =
+                &precomputed->LENSMODEL_SPLINED_STEREOGRAPHIC__precomputed;
+
+            if(precomputed_splined->ispecialized_kernel >= 0)
+                splined_specialized_kernels[precomputed_splined->ispecialized_kernel]
+                    ( // outputs
+                     q, p_dq_dfxy,
+                     grad_ABCDx_ABCDy,
+                     &ivar0,
+
+                     dq_drcamera,dq_dtcamera,dq_drframe,dq_dtframe,
+                     // inputs
+                     p,
+                     dp_drc, dp_dtc, dp_drf, dp_dtf,
+                     intrinsics,
+                     camera_at_identity,
+                     precomputed_splined->segments_per_u);
+            else
+                _project_point_splined( // outputs
+                                       q, p_dq_dfxy,
+                                       grad_ABCDx_ABCDy,
+                                       &ivar0,
+
+                                       dq_drcamera,dq_dtcamera,dq_drframe,dq_dtframe,
+                                       // inputs
+                                       p,
+                                       dp_drc, dp_dtc, dp_drf, dp_dtf,
+                                       intrinsics,
+                                       camera_at_identity,
+                                       lensmodel->LENSMODEL_SPLINED_STEREOGRAPHIC__config.order,
+                                       lensmodel->LENSMODEL_SPLINED_STEREOGRAPHIC__config.Nx,
+                                       lensmodel->LENSMODEL_SPLINED_STEREOGRAPHIC__config.Ny,
+                                       precomputed_splined->segments_per_u);
             // WARNING: if I could assume that dq_dintrinsics_pool_double!=NULL then I wouldnt need to copy the context
             if(dq_dintrinsics_pool_int != NULL)
             {
@@ -2314,19 +2422,96 @@ void project( // out
     }
 }
 
+// The CAHVORE projection solves for theta with Newton's method. The initial
+// guess includes a first-order correction for the "E" terms, and with realistic
+// models nearly every point converges within CAHVORE_NEWTON_ITERATIONS_FIXED
+// steps. We always take that many steps, without checking for convergence in
+// between, so every point does the same amount of work. The rare points that
+// haven't converged by then keep iterating, up to CAHVORE_NEWTON_ITERATIONS_MAX
+// steps total
+#define CAHVORE_NEWTON_ITERATIONS_FIXED 2
+#define CAHVORE_NEWTON_ITERATIONS_MAX   100
+
+// Updates (sth,cth) = (sin(theta),cos(theta)) after theta was moved by dtheta.
+// The Newton steps are small, so instead of calling sincos() again I rotate by
+// dtheta, using the Taylor series for sin(dtheta) and cos(dtheta). For
+// |dtheta| < 1e-2 the truncation error is < 1e-17
+static inline
+void cahvore_sincos_advance(double* sth, double* cth,
+                            double theta, double dtheta)
+{
+    if(fabs(dtheta) >= 1e-2)
+    {
+        sincos(theta, sth, cth);
+        return;
+    }
+
+    double d2 = dtheta*dtheta;
+    double sd = dtheta*(1. - d2/6.*(1. - d2/20.));
+    double cd = 1. - d2/2.*(1. - d2/12.*(1. - d2/30.));
+
+    double s = *sth*cd + *cth*sd;
+    double c = *cth*cd - *sth*sd;
+    *sth = s;
+    *cth = c;
+}
+
+// One Newton step for the CAHVORE theta. Updates theta and its sin,cos, and
+// returns the step that was taken
+static inline
+double cahvore_theta_newton_step(double* theta, double* sth, double* cth,
+                                 double omega, double l,
+                                 double e0, double e1, double e2)
+{
+    // Compute terms from the current value of theta
+    double theta2  = *theta * *theta;
+    double theta3  = *theta * theta2;
+    double theta4  = *theta * theta3;
+    double upsilon =
+        omega*(*cth) + l*(*sth)
+        - (1.0    - *cth) * (e0 +      e1*theta2 +     e2*theta4)
+        - (*theta - *sth) * (      2.0*e1*(*theta) + 4.0*e2*theta3);
+
+    // Update theta
+    double dtheta =
+        (
+         omega*(*sth) - l*(*cth)
+         - (*theta - *sth) * (e0 + e1*theta2 + e2*theta4)
+         ) / upsilon;
+
+    *theta -= dtheta;
+    cahvore_sincos_advance(sth, cth, *theta, -dtheta);
+    return dtheta;
+}
+
 // NOT A PART OF THE EXTERNAL API. This is exported for the mrcal python wrapper
 // only
-bool _mrcal_project_internal_cahvore( // out
-                                     mrcal_point2_t* out,
-
-                                     // in
-                                     const mrcal_point3_t* p,
-                                     int N,
+//
+// The batched CAHVORE projection. The points and the projections are stored as
+// separate x,y,z and qx,qy arrays (SoA). Each array has its own stride, in
+// bytes; a stride <= 0 means "contiguous". Any layout can be described this
+// way: _mrcal_project_internal_cahvore() passes AoS data by pointing into the
+// structures, and passing the structure size as the stride
+bool _mrcal_project_internal_cahvore_soa( // out
+                                         double* qx, int qx_stride0,
+                                         double* qy, int qy_stride0,
 
-                                     // core, distortions concatenated
-                                     const double* intrinsics,
-                                     const double  linearity)
+                                         // in
+                                         const double* px, int px_stride0,
+                                         const double* py, int py_stride0,
+                                         const double* pz, int pz_stride0,
+                                         int N,
+
+                                         // core, distortions concatenated
+                                         const double* intrinsics,
+                                         const double  linearity)
 {
+    init_stride_1D(qx, N);
+    init_stride_1D(qy, N);
+    init_stride_1D(px, N);
+    init_stride_1D(py, N);
+    init_stride_1D(pz, N);
+
     // Apply a CAHVORE warp to an un-distorted point
 
     //  Given intrinsic parameters of a CAHVORE model and a set of
@@ -2380,14 +2565,15 @@ bool _mrcal_project_internal_cahvore( // out
         // So I'm doing that here. mrcal supports cahvore only for
         // compatibility, so nobody's using this code. IF YOU ARE GOING TO USE
         // THIS CODE, PLEASE CONFIRM THAT THIS CAHVORE PROJECTION IS CORRECT
-        double pnorm = sqrt(p[i_pt].x*p[i_pt].x +
-                            p[i_pt].y*p[i_pt].y +
-                            p[i_pt].z*p[i_pt].z );
+        const double x = P1(px, i_pt);
+        const double y = P1(py, i_pt);
+        const double z = P1(pz, i_pt);
+        double pnorm = sqrt(x*x + y*y + z*z);
         double v[] =
             {
-                p[i_pt].x / pnorm,
-                p[i_pt].y / pnorm,
-                p[i_pt].z / pnorm
+                x / pnorm,
+                y / pnorm,
+                z / pnorm
             };
 
         // cos( angle between p and o ) = inner(p,o) / (norm(o) * norm(p)) =
@@ -2405,41 +2591,40 @@ bool _mrcal_project_internal_cahvore( // out
         for(int i=0; i<3; i++) ll[i] = v[i]-u[i];
         double l = sqrt(ll[0]*ll[0] + ll[1]*ll[1] + ll[2]*ll[2]);
 
-        // Calculate theta using Newton's Method
+        // Calculate theta using Newton's Method. The angle between v and o is
+        // the solution if e0=e1=e2=0. I seed with that, corrected to first
+        // order for the E terms:
+        //
+        //   omega sin(th) - l cos(th) = (th - sin(th)) E(th)
+        //
+        // v and o are unit vectors, so omega and l are the cos and sin of th0.
+        // The left side is sin(th - th0) ~ th - th0, so th ~ th0 + (th0 - l)
+        // E(th0)
         double theta = atan2(l, omega);
-
-        int inewton;
-        for( inewton = 100; inewton; inewton--)
+        double sth   = l;
+        double cth   = omega;
         {
-            // Compute terms from the current value of theta
-            double sth,cth;
-            sincos(theta, &sth, &cth);
-
-            double theta2  = theta * theta;
-            double theta3  = theta * theta2;
-            double theta4  = theta * theta3;
-            double upsilon =
-                omega*cth + l*sth
-                - (1.0   - cth) * (e0 +      e1*theta2 +     e2*theta4)
-                - (theta - sth) * (      2.0*e1*theta  + 4.0*e2*theta3);
-
-            // Update theta
-            double dtheta =
-                (
-                 omega*sth - l*cth
-                 - (theta - sth) * (e0 + e1*theta2 + e2*theta4)
-                 ) / upsilon;
-
-            theta -= dtheta;
-
-            // Check exit criterion from last update
-            if(fabs(dtheta) < 1e-8)
-                break;
+            double theta2 = theta*theta;
+            double dtheta0 = (theta - l) * (e0 + e1*theta2 + e2*theta2*theta2);
+            theta += dtheta0;
+            cahvore_sincos_advance(&sth, &cth, theta, dtheta0);
         }
-        if(inewton == 0)
+
+        double dtheta = 0.0;
+        for(int inewton=0; inewton<CAHVORE_NEWTON_ITERATIONS_FIXED; inewton++)
+            dtheta = cahvore_theta_newton_step(&theta, &sth, &cth, omega, l, e0, e1, e2);
+
+        // Check exit criterion from last update. Keep going if needed
+        for(int inewton = CAHVORE_NEWTON_ITERATIONS_FIXED;
+            fabs(dtheta) >= 1e-8;
+            inewton++)
         {
-            fprintf(stderr, "%s(): too many iterations\n", __func__);
-            return false;
+            if(inewton == CAHVORE_NEWTON_ITERATIONS_MAX)
+            {
+                fprintf(stderr, "%s(): too many iterations\n", __func__);
+                return false;
+            }
+            dtheta = cahvore_theta_newton_step(&theta, &sth, &cth, omega, l, e0, e1, e2);
         }
 
         // got a theta
@@ -2480,77 +2665,127 @@ bool _mrcal_project_internal_cahvore( // out
             for(int i=0; i<3; i++)
                 u[i] = uu[i] + vv[i];
             // now I apply a normal projection to the warped 3d point p
-            out[i_pt].x = core->focal_xy[0] * u[0]/u[2] + core->center_xy[0];
-            out[i_pt].y = core->focal_xy[1] * u[1]/u[2] + core->center_xy[1];
+            P1(qx, i_pt) = core->focal_xy[0] * u[0]/u[2] + core->center_xy[0];
+            P1(qy, i_pt) = core->focal_xy[1] * u[1]/u[2] + core->center_xy[1];
         }
         else
         {
             // now I apply a normal projection to the warped 3d point p
-            out[i_pt].x = core->focal_xy[0] * v[0]/v[2] + core->center_xy[0];
-            out[i_pt].y = core->focal_xy[1] * v[1]/v[2] + core->center_xy[1];
+            P1(qx, i_pt) = core->focal_xy[0] * v[0]/v[2] + core->center_xy[0];
+            P1(qy, i_pt) = core->focal_xy[1] * v[1]/v[2] + core->center_xy[1];
         }
     }
     return true;
 }
 
-
 // NOT A PART OF THE EXTERNAL API. This is exported for the mrcal python wrapper
 // only
-bool _mrcal_project_internal( // out
-                             mrcal_point2_t* q,
+bool _mrcal_project_internal_cahvore( // out
+                                     mrcal_point2_t* out,
 
-                             // Stored as a row-first array of shape (N,2,3). Each
-                             // row lives in a mrcal_point3_t
-                             mrcal_point3_t* dq_dp,
-                             // core, distortions concatenated. Stored as a row-first
-                             // array of shape (N,2,Nintrinsics). This is a DENSE array.
-                             // High-parameter-count lens models have very sparse
-                             // gradients here, and the internal project() function
-                             // returns those sparsely. For now THIS function densifies
-                             // all of these
-                             double*   dq_dintrinsics,
+                                     // in
+                                     const mrcal_point3_t* p,
+                                     int N,
 
-                             // in
-                             const mrcal_point3_t* p,
-                             int N,
-                             const mrcal_lensmodel_t* lensmodel,
-                             // core, distortions concatenated
-                             const double* intrinsics,
+                                     // core, distortions concatenated
+                                     const double* intrinsics,
+                                     const double  linearity)
+{
+    return
+        _mrcal_project_internal_cahvore_soa(&out->x, sizeof(mrcal_point2_t),
+                                            &out->y, sizeof(mrcal_point2_t),
+                                            &p->x,   sizeof(mrcal_point3_t),
+                                            &p->y,   sizeof(mrcal_point3_t),
+                                            &p->z,   sizeof(mrcal_point3_t),
+                                            N,
+                                            intrinsics, linearity);
+}
 
-                             int Nintrinsics,
-                             const mrcal_projection_precomputed_t* precomputed)
+
+// NOT A PART OF THE EXTERNAL API. This is exported for the mrcal python wrapper
+// only
+//
+// The general strided implementation of the projection loop. All the arrays
+// are given as pointers and strides, in bytes. A stride <= 0 means
+// "contiguous". The gradient arrays may be NULL if they're not wanted.
+// dq_dintrinsics reports only the columns dq_dintrinsics_icol0 ..
+// dq_dintrinsics_icol0+dq_dintrinsics_Ncols-1 of the full dense (N,2,Nintrinsics)
+// gradient. dq_dintrinsics_Ncols <= 0 means "all the rest of the columns"
+//
+// The caller is responsible for making sure that gradients are only requested
+// from lens models that support them
+bool _mrcal_project_internal_soa( // out
+                                 double* qx,             // (N,) array
+                                 int     qx_stride0,
+                                 double* qy,             // (N,) array
+                                 int     qy_stride0,
+                                 double* dq_dp,          // (N,2,3) array. May be NULL
+                                 int     dq_dp_stride0,
+                                 int     dq_dp_stride1,
+                                 int     dq_dp_stride2,
+                                 double* dq_dintrinsics, // (N,2,Ncols) array. May be NULL
+                                 int     dq_dintrinsics_stride0,
+                                 int     dq_dintrinsics_stride1,
+                                 int     dq_dintrinsics_stride2,
+                                 int     dq_dintrinsics_icol0,
+                                 int     dq_dintrinsics_Ncols,
+
+                                 // in
+                                 const double* px,       // (N,) array
+                                 int           px_stride0,
+                                 const double* py,       // (N,) array
+                                 int           py_stride0,
+                                 const double* pz,       // (N,) array
+                                 int           pz_stride0,
+                                 int N,
+                                 const mrcal_lensmodel_t* lensmodel,
+                                 // core, distortions concatenated
+                                 const double* intrinsics,
+
+                                 int Nintrinsics,
+                                 const mrcal_projection_precomputed_t* precomputed)
 {
-    if( dq_dintrinsics == NULL )
+    if(dq_dintrinsics_Ncols <= 0)
+        dq_dintrinsics_Ncols = Nintrinsics - dq_dintrinsics_icol0;
+    if(dq_dintrinsics != NULL &&
+       (dq_dintrinsics_icol0 < 0 ||
+        dq_dintrinsics_icol0 + dq_dintrinsics_Ncols > Nintrinsics))
     {
-        for(int i=0; i<N; i++)
-        {
-            mrcal_pose_t frame = {.r = {},
-                            .t = p[i]};
+        MSG("Requested intrinsics gradient columns [%d,%d) are out of bounds. Have Nintrinsics=%d",
+            dq_dintrinsics_icol0, dq_dintrinsics_icol0 + dq_dintrinsics_Ncols,
+            Nintrinsics);
+        return false;
+    }
 
-            // simple non-intrinsics-gradient path. dp_dp is handled entirely in
-            // project()
-            project( &q[i],
-                     NULL, NULL, NULL, NULL, NULL,
-                     NULL, NULL, NULL, dq_dp, NULL,
+    init_stride_1D(qx, N);
+    init_stride_1D(qy, N);
+    init_stride_3D(dq_dp, N,2,3);
+    init_stride_3D(dq_dintrinsics, N,2,dq_dintrinsics_Ncols);
+    init_stride_1D(px, N);
+    init_stride_1D(py, N);
+    init_stride_1D(pz, N);
 
-                     // in
-                     intrinsics, NULL, &frame, NULL, true,
-                     lensmodel, precomputed,
-                     0.0, 0,0);
-        }
-        return true;
-    }
+    if( lensmodel->type == MRCAL_LENSMODEL_CAHVORE &&
+        dq_dp == NULL && dq_dintrinsics == NULL )
+        return _mrcal_project_internal_cahvore_soa(qx, qx_stride0, qy, qy_stride0,
+                                                   px, px_stride0, py, py_stride0, pz, pz_stride0,
+                                                   N, intrinsics,
+                                                   lensmodel->LENSMODEL_CAHVORE__config.linearity);
 
-    // Some models have sparse gradients, but I'm returning a dense array here.
-    // So I init everything to 0
-    memset(dq_dintrinsics, 0, N*2*Nintrinsics*sizeof(double));
+    const int icol0 = dq_dintrinsics_icol0;
+    const int icol1 = dq_dintrinsics_icol0 + dq_dintrinsics_Ncols;
 
     int Ngradients = get_Ngradients(lensmodel, Nintrinsics);
 
     for(int i=0; i<N; i++)
     {
         mrcal_pose_t frame = {.r = {},
-                              .t = p[i]};
+                              .t = {.x = P1(px,i),
+                                    .y = P1(py,i),
+                                    .z = P1(pz,i)}};
+
+        mrcal_point2_t q;
+        mrcal_point3_t dq_dp_here[2];
 
         // simple non-intrinsics-gradient path. dp_dp is handled entirely in
         // project()
@@ -2560,42 +2795,67 @@ bool _mrcal_project_internal( // out
         double* dq_dintrinsics_nocore = NULL;
         gradient_sparse_meta_t gradient_sparse_meta = {}; // init to pacify compiler warning
 
-        project( &q[i],
+        // project() computes the intrinsics gradients only if it is given
+        // the pools. It then requires all the pointers to be non-NULL
+        const bool want_dq_dintrinsics = (dq_dintrinsics != NULL);
+        project( &q,
 
-                 dq_dintrinsics_pool_double,
-                 dq_dintrinsics_pool_int,
-                 &dq_dfxy, &dq_dintrinsics_nocore, &gradient_sparse_meta,
+                 want_dq_dintrinsics ? dq_dintrinsics_pool_double : NULL,
+                 want_dq_dintrinsics ? dq_dintrinsics_pool_int    : NULL,
+                 want_dq_dintrinsics ? &dq_dfxy                   : NULL,
+                 want_dq_dintrinsics ? &dq_dintrinsics_nocore     : NULL,
+                 want_dq_dintrinsics ? &gradient_sparse_meta      : NULL,
 
-                 NULL, NULL, NULL, dq_dp, NULL,
+                 NULL, NULL, NULL,
+                 dq_dp != NULL ? dq_dp_here : NULL,
+                 NULL,
 
                  // in
                  intrinsics, NULL, &frame, NULL, true,
                  lensmodel, precomputed,
                  0.0, 0,0);
 
+        P1(qx,i) = q.x;
+        P1(qy,i) = q.y;
+
+        if(dq_dp != NULL)
+            for(int i_xy=0; i_xy<2; i_xy++)
+                for(int j=0; j<3; j++)
+                    P3(dq_dp, i,i_xy,j) = dq_dp_here[i_xy].xyz[j];
+
+        if(dq_dintrinsics == NULL)
+            continue;
+
+        // Some models have sparse gradients, but I'm returning a dense array
+        // here. So I init everything to 0, and fill in the requested columns
+        // that have data
+        for(int i_xy=0; i_xy<2; i_xy++)
+            for(int icol=0; icol<dq_dintrinsics_Ncols; icol++)
+                P3(dq_dintrinsics, i,i_xy,icol) = 0.0;
+
+#define DQ_DINTRINSICS(i_xy,ivar) P3(dq_dintrinsics, i,i_xy,(ivar)-icol0)
+
         int Ncore = 0;
         if(dq_dfxy != NULL)
         {
             Ncore = 4;
 
             // fxy. off-diagonal elements are 0
-            dq_dintrinsics[0*Nintrinsics + 0] = dq_dfxy[0];
-            dq_dintrinsics[0*Nintrinsics + 1] = 0.0;
-            dq_dintrinsics[1*Nintrinsics + 0] = 0.0;
-            dq_dintrinsics[1*Nintrinsics + 1] = dq_dfxy[1];
+            if(icol0 <= 0 && 0 < icol1) DQ_DINTRINSICS(0,0) = dq_dfxy[0];
+            if(icol0 <= 1 && 1 < icol1) DQ_DINTRINSICS(1,1) = dq_dfxy[1];
 
             // cxy. Identity
-            dq_dintrinsics[0*Nintrinsics + 2] = 1.0;
-            dq_dintrinsics[0*Nintrinsics + 3] = 0.0;
-            dq_dintrinsics[1*Nintrinsics + 2] = 0.0;
-            dq_dintrinsics[1*Nintrinsics + 3] = 1.0;
+            if(icol0 <= 2 && 2 < icol1) DQ_DINTRINSICS(0,2) = 1.0;
+            if(icol0 <= 3 && 3 < icol1) DQ_DINTRINSICS(1,3) = 1.0;
         }
         if( dq_dintrinsics_nocore != NULL )
         {
             for(int i_xy=0; i_xy<2; i_xy++)
-                memcpy(&dq_dintrinsics[i_xy*Nintrinsics + Ncore],
-                       &dq_dintrinsics_nocore[i_xy*(Nintrinsics-Ncore)],
-                       (Nintrinsics-Ncore)*sizeof(double));
+                for(int ivar = icol0 > Ncore ? icol0 : Ncore;
+                    ivar < icol1;
+                    ivar++)
+                    DQ_DINTRINSICS(i_xy,ivar) =
+                        dq_dintrinsics_nocore[i_xy*(Nintrinsics-Ncore) + ivar-Ncore];
         }
         if(gradient_sparse_meta.pool != NULL)
         {
@@ -2620,19 +2880,120 @@ bool _mrcal_project_internal( // out
                     for(int ix=0; ix<len; ix++)
                     {
                         int ivar = ivar0 + ivar_stridey*iy + ix*2 + i_xy;
-                        dq_dintrinsics[ivar + i_xy*Nintrinsics] =
-                            ABCDx[ix]*ABCDy[iy]*fxy[i_xy];
+                        if(icol0 <= ivar && ivar < icol1)
+                            DQ_DINTRINSICS(i_xy,ivar) =
+                                ABCDx[ix]*ABCDy[iy]*fxy[i_xy];
                     }
         }
-
-        // advance
-        dq_dintrinsics = &dq_dintrinsics[2*Nintrinsics];
-        if(dq_dp != NULL)
-            dq_dp = &dq_dp[2];
+#undef DQ_DINTRINSICS
     }
     return true;
 }
 
+// NOT A PART OF THE EXTERNAL API. This is exported for the mrcal python wrapper
+// only
+bool _mrcal_project_internal( // out
+                             mrcal_point2_t* q,
+
+                             // Stored as a row-first array of shape (N,2,3). Each
+                             // row lives in a mrcal_point3_t
+                             mrcal_point3_t* dq_dp,
+                             // core, distortions concatenated. Stored as a row-first
+                             // array of shape (N,2,Nintrinsics). This is a DENSE array.
+                             // High-parameter-count lens models have very sparse
+                             // gradients here, and the internal project() function
+                             // returns those sparsely. For now THIS function densifies
+                             // all of these
+                             double*   dq_dintrinsics,
+
+                             // in
+                             const mrcal_point3_t* p,
+                             int N,
+                             const mrcal_lensmodel_t* lensmodel,
+                             // core, distortions concatenated
+                             const double* intrinsics,
+
+                             int Nintrinsics,
+                             const mrcal_projection_precomputed_t* precomputed)
+{
+    return
+        _mrcal_project_internal_soa(&q[0].x, sizeof(q[0]),
+                                    &q[0].y, sizeof(q[0]),
+                                    dq_dp != NULL ? dq_dp[0].xyz : NULL,
+                                    2*sizeof(dq_dp[0]), sizeof(dq_dp[0]), sizeof(double),
+                                    dq_dintrinsics,
+                                    2*Nintrinsics*sizeof(double), Nintrinsics*sizeof(double), sizeof(double),
+                                    0, Nintrinsics,
+
+                                    &p[0].x, sizeof(p[0]),
+                                    &p[0].y, sizeof(p[0]),
+                                    &p[0].z, sizeof(p[0]),
+                                    N, lensmodel, intrinsics,
+                                    Nintrinsics, precomputed);
+}
+
+// The outer logic (outside the loop-over-N-points) of mrcal_project() and of
+// mrcal_projector_project(). If precomputed is NULL, I compute it here, if it is
+// needed
+static bool project_dispatch( // out
+                              mrcal_point2_t* q,
+                              mrcal_point3_t* dq_dp,
+                              double*         dq_dintrinsics,
+
+                              // in
+                              const mrcal_point3_t* p,
+                              int N,
+                              const mrcal_lensmodel_t* lensmodel,
+                              const double* intrinsics,
+                              int Nintrinsics,
+                              const mrcal_projection_precomputed_t* precomputed)
+{
+    // The outer logic (outside the loop-over-N-points) is duplicated in
+    // mrcal_project() and in the python wrapper definition in _project() and
+    // _project_withgrad() in mrcal-genpywrap.py. Please keep them in sync
+
+    // project() doesn't handle cahvore, so I special-case it here
+    if(dq_dintrinsics != NULL || dq_dp != NULL)
+    {
+        mrcal_lensmodel_metadata_t meta = mrcal_lensmodel_metadata(lensmodel);
+        if(!meta.has_gradients)
+        {
+            MSG("mrcal_project(lensmodel='%s') cannot return gradients; this is not yet implemented",
+                mrcal_lensmodel_name_unconfigured(lensmodel));
+            return false;
+        }
+    }
+
+    if( lensmodel->type == MRCAL_LENSMODEL_CAHVORE )
+        return _mrcal_project_internal_cahvore(q, p, N, intrinsics,
+                                               lensmodel->LENSMODEL_CAHVORE__config.linearity);
+
+    // Special-case for opencv/pinhole and projection-only. cvProjectPoints2 and
+    // project() have a lot of overhead apparently, and calling either in a loop
+    // is very slow. I can call it once, and use its fast internal loop,
+    // however. This special case does the same thing, but much faster.
+    if(dq_dintrinsics == NULL && dq_dp == NULL &&
+       (MRCAL_LENSMODEL_IS_OPENCV(lensmodel->type) ||
+        lensmodel->type == MRCAL_LENSMODEL_PINHOLE))
+    {
+        _mrcal_project_internal_opencv( q, NULL,NULL,
+                                        p, N, intrinsics, Nintrinsics);
+        return true;
+    }
+
+    mrcal_projection_precomputed_t precomputed_local;
+    if(precomputed == NULL)
+    {
+        _mrcal_precompute_lensmodel_data(&precomputed_local, lensmodel);
+        precomputed = &precomputed_local;
+    }
+
+    return
+        _mrcal_project_internal(q, dq_dp, dq_dintrinsics,
+                                p, N, lensmodel, intrinsics,
+                                Nintrinsics, precomputed);
+}
+
 // External interface to the internal project() function. The internal function
 // is more general (supports geometric transformations prior to projection, and
 // supports chessboards). dq_dintrinsics and/or dq_dp are allowed to be NULL if
@@ -2668,48 +3029,59 @@ bool mrcal_project( // out
                    // core, distortions concatenated
                    const double* intrinsics)
 {
-    // The outer logic (outside the loop-over-N-points) is duplicated in
-    // mrcal_project() and in the python wrapper definition in _project() and
-    // _project_withgrad() in mrcal-genpywrap.py. Please keep them in sync
+    return project_dispatch(q, dq_dp, dq_dintrinsics,
+                            p, N, lensmodel, intrinsics,
+                            mrcal_lensmodel_num_params(lensmodel),
+                            NULL);
+}
 
-    // project() doesn't handle cahvore, so I special-case it here
+
+// Strided, SoA version of mrcal_project(). See the docs in mrcal.h
+bool mrcal_project_soa( // out
+                       double* qx,             int qx_stride0,
+                       double* qy,             int qy_stride0,
+                       double* dq_dp,          int dq_dp_stride0,
+                                               int dq_dp_stride1,
+                                               int dq_dp_stride2,
+                       double* dq_dintrinsics, int dq_dintrinsics_stride0,
+                                               int dq_dintrinsics_stride1,
+                                               int dq_dintrinsics_stride2,
+                       int dq_dintrinsics_icol0,
+                       int dq_dintrinsics_Ncols,
+
+                       // in
+                       const double* px,       int px_stride0,
+                       const double* py,       int py_stride0,
+                       const double* pz,       int pz_stride0,
+                       int N,
+                       const mrcal_lensmodel_t* lensmodel,
+                       // core, distortions concatenated
+                       const double* intrinsics)
+{
     if(dq_dintrinsics != NULL || dq_dp != NULL)
     {
         mrcal_lensmodel_metadata_t meta = mrcal_lensmodel_metadata(lensmodel);
         if(!meta.has_gradients)
         {
-            MSG("mrcal_project(lensmodel='%s') cannot return gradients; this is not yet implemented",
+            MSG("mrcal_project_soa(lensmodel='%s') cannot return gradients; this is not yet implemented",
                 mrcal_lensmodel_name_unconfigured(lensmodel));
             return false;
         }
     }
 
-    if( lensmodel->type == MRCAL_LENSMODEL_CAHVORE )
-        return _mrcal_project_internal_cahvore(q, p, N, intrinsics,
-                                               lensmodel->LENSMODEL_CAHVORE__config.linearity);
-
-    int Nintrinsics = mrcal_lensmodel_num_params(lensmodel);
-
-    // Special-case for opencv/pinhole and projection-only. cvProjectPoints2 and
-    // project() have a lot of overhead apparently, and calling either in a loop
-    // is very slow. I can call it once, and use its fast internal loop,
-    // however. This special case does the same thing, but much faster.
-    if(dq_dintrinsics == NULL && dq_dp == NULL &&
-       (MRCAL_LENSMODEL_IS_OPENCV(lensmodel->type) ||
-        lensmodel->type == MRCAL_LENSMODEL_PINHOLE))
-    {
-        _mrcal_project_internal_opencv( q, NULL,NULL,
-                                        p, N, intrinsics, Nintrinsics);
-        return true;
-    }
-
     mrcal_projection_precomputed_t precomputed;
     _mrcal_precompute_lensmodel_data(&precomputed, lensmodel);
 
     return
-        _mrcal_project_internal(q, dq_dp, dq_dintrinsics,
-                                p, N, lensmodel, intrinsics,
-                                Nintrinsics, &precomputed);
+        _mrcal_project_internal_soa(qx, qx_stride0, qy, qy_stride0,
+                                    dq_dp, dq_dp_stride0, dq_dp_stride1, dq_dp_stride2,
+                                    dq_dintrinsics,
+                                    dq_dintrinsics_stride0, dq_dintrinsics_stride1, dq_dintrinsics_stride2,
+                                    dq_dintrinsics_icol0, dq_dintrinsics_Ncols,
+                                    px, px_stride0, py, py_stride0, pz, pz_stride0,
+                                    N, lensmodel, intrinsics,
+                                    mrcal_lensmodel_num_params(lensmodel),
+                                    &precomputed);
 }
 
 
@@ -2750,6 +3122,138 @@ bool mrcal_unproject( // out
     return _mrcal_unproject_internal(out, q, N, lensmodel, intrinsics, &precomputed);
 }
 
+
+struct mrcal_projector_t
+{
+    mrcal_lensmodel_t              lensmodel;
+    bool                           has_gradients;
+    int                            Nintrinsics;
+    mrcal_projection_precomputed_t precomputed;
+
+    // core, distortions concatenated. A copy of what was passed to
+    // mrcal_projector_new()
+    double                         intrinsics[];
+};
+
+mrcal_projector_t* mrcal_projector_new(const mrcal_lensmodel_t* lensmodel,
+                                       // core, distortions concatenated
+                                       const double* intrinsics)
+{
+    if(!mrcal_lensmodel_type_is_valid(lensmodel->type))
+    {
+        MSG("mrcal_projector_new() got an invalid lens model");
+        return NULL;
+    }
+
+    int Nintrinsics = mrcal_lensmodel_num_params(lensmodel);
+    mrcal_projector_t* projector =
+        malloc(sizeof(mrcal_projector_t) + Nintrinsics*sizeof(double));
+    if(projector == NULL)
+    {
+        MSG("malloc() failed");
+        return NULL;
+    }
+
+    projector->lensmodel     = *lensmodel;
+    projector->has_gradients = mrcal_lensmodel_metadata(lensmodel).has_gradients;
+    projector->Nintrinsics   = Nintrinsics;
+    _mrcal_precompute_lensmodel_data(&projector->precomputed, lensmodel);
+    memcpy(projector->intrinsics, intrinsics, Nintrinsics*sizeof(double));
+    return projector;
+}
+
+void mrcal_projector_free(mrcal_projector_t** projector)
+{
+    free(*projector);
+    *projector = NULL;
+}
+
+const mrcal_lensmodel_t* mrcal_projector_lensmodel(const mrcal_projector_t* projector)
+{
+    return &projector->lensmodel;
+}
+
+const double* mrcal_projector_intrinsics(const mrcal_projector_t* projector)
+{
+    return projector->intrinsics;
+}
+
+bool mrcal_projector_project( // out
+                             mrcal_point2_t* q,
+                             mrcal_point3_t* dq_dp,
+                             double*         dq_dintrinsics,
+
+                             // in
+                             const mrcal_point3_t* p,
+                             int N,
+                             const mrcal_projector_t* projector)
+{
+    return project_dispatch(q, dq_dp, dq_dintrinsics,
+                            p, N,
+                            &projector->lensmodel, projector->intrinsics,
+                            projector->Nintrinsics,
+                            &projector->precomputed);
+}
+
+bool mrcal_projector_project_soa( // out
+                                 double* qx,             int qx_stride0,
+                                 double* qy,             int qy_stride0,
+                                 double* dq_dp,          int dq_dp_stride0,
+                                                         int dq_dp_stride1,
+                                                         int dq_dp_stride2,
+                                 double* dq_dintrinsics, int dq_dintrinsics_stride0,
+                                                         int dq_dintrinsics_stride1,
+                                                         int dq_dintrinsics_stride2,
+                                 int dq_dintrinsics_icol0,
+                                 int dq_dintrinsics_Ncols,
+
+                                 // in
+                                 const double* px,       int px_stride0,
+                                 const double* py,       int py_stride0,
+                                 const double* pz,       int pz_stride0,
+                                 int N,
+                                 const mrcal_projector_t* projector)
+{
+    if((dq_dintrinsics != NULL || dq_dp != NULL) && !projector->has_gradients)
+    {
+        MSG("mrcal_projector_project_soa(lensmodel='%s') cannot return gradients; this is not yet implemented",
+            mrcal_lensmodel_name_unconfigured(&projector->lensmodel));
+        return false;
+    }
+
+    return
+        _mrcal_project_internal_soa(qx, qx_stride0, qy, qy_stride0,
+                                    dq_dp, dq_dp_stride0, dq_dp_stride1, dq_dp_stride2,
+                                    dq_dintrinsics,
+                                    dq_dintrinsics_stride0, dq_dintrinsics_stride1, dq_dintrinsics_stride2,
+                                    dq_dintrinsics_icol0, dq_dintrinsics_Ncols,
+                                    px, px_stride0, py, py_stride0, pz, pz_stride0,
+                                    N,
+                                    &projector->lensmodel, projector->intrinsics,
+                                    projector->Nintrinsics,
+                                    &projector->precomputed);
+}
+
+bool mrcal_projector_unproject( // out
+                               mrcal_point3_t* v,
+
+                               // in
+                               const mrcal_point2_t* q,
+                               int N,
+                               const mrcal_projector_t* projector)
+{
+    if(!projector->has_gradients)
+    {
+        MSG("mrcal_projector_unproject(lensmodel='%s') is not yet implemented: we need gradients",
+            mrcal_lensmodel_name_unconfigured(&projector->lensmodel));
+        return false;
+    }
+
+    return _mrcal_unproject_internal(v, q, N,
+                                     &projector->lensmodel, projector->intrinsics,
+                                     &projector->precomputed);
+}
+
 // NOT A PART OF THE EXTERNAL API. This is exported for the mrcal python wrapper
 // only
 bool _mrcal_unproject_internal( // out
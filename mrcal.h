@@ -305,6 +305,48 @@ bool mrcal_project( // out
                    const double* intrinsics);
 
 
+// Strided, structure-of-arrays version of mrcal_project()
+//
+// Computes the same thing as mrcal_project(), but each input and output lives
+// in its own array, with its own strides. The points p are given in 3 separate
+// (N,) arrays px,py,pz. The projections q are written to 2 separate (N,) arrays
+// qx,qy. Each array is followed by its strides, one per dimension, in bytes. A
+// stride <= 0 means "contiguous". This allows the caller to read and write
+// directly into their own buffers, without any copies or reshuffling
+//
+// dq_dp is an (N,2,3) array of gradients. May be NULL if not wanted
+//
+// dq_dintrinsics is an (N,2,dq_dintrinsics_Ncols) array. It contains the
+// columns dq_dintrinsics_icol0 .. dq_dintrinsics_icol0+dq_dintrinsics_Ncols-1
+// of the full (N,2,Nintrinsics) gradient array that mrcal_project() would
+// return. This makes it possible to compute only the gradients for the
+// intrinsics we care about. dq_dintrinsics_Ncols <= 0 means "all the rest of
+// the columns". May be NULL if not wanted
+//
+// As with mrcal_project(), this function supports CAHVORE distortions only if
+// we don't ask for any gradients
+bool mrcal_project_soa( // out
+                       double* qx,             int qx_stride0,
+                       double* qy,             int qy_stride0,
+                       double* dq_dp,          int dq_dp_stride0,
+                                               int dq_dp_stride1,
+                                               int dq_dp_stride2,
+                       double* dq_dintrinsics, int dq_dintrinsics_stride0,
+                                               int dq_dintrinsics_stride1,
+                                               int dq_dintrinsics_stride2,
+                       int dq_dintrinsics_icol0,
+                       int dq_dintrinsics_Ncols,
+
+                       // in
+                       const double* px,       int px_stride0,
+                       const double* py,       int py_stride0,
+                       const double* pz,       int pz_stride0,
+                       int N,
+                       const mrcal_lensmodel_t* lensmodel,
+                       // core, distortions concatenated
+                       const double* intrinsics);
+
+
 // Unproject the given pixel coordinates
 //
 // Compute an "unprojection", a mapping of pixel coordinates to the camera
@@ -332,6 +374,77 @@ bool mrcal_unproject( // out
                      const double* intrinsics);
 
 
+// A projector: a lens model and a set of intrinsics, to be used for many
+// project/unproject calls
+//
+// mrcal_project() and mrcal_unproject() look at the lens model and compute some
+// lensmodel-specific data every time they're called. That is fine for big
+// batches of points, but the overhead dominates if we're calling these
+// functions many times with few points each time: processing video frames for
+// instance. A projector does all that work once, in mrcal_projector_new().
+// mrcal_projector_project() and mrcal_projector_unproject() then behave exactly
+// like mrcal_project() and mrcal_unproject(), but pay only for the math.
+//
+// The intrinsics are copied into the projector, so the caller's array doesn't
+// need to stay alive. A projector isn't modified by the project/unproject
+// calls, so it may be used from several threads at once
+//
+// mrcal_projector_new() returns NULL on error. Projectors created with
+// mrcal_projector_new() must be freed with mrcal_projector_free()
+typedef struct mrcal_projector_t mrcal_projector_t;
+
+mrcal_projector_t* mrcal_projector_new(const mrcal_lensmodel_t* lensmodel,
+                                       // core, distortions concatenated
+                                       const double* intrinsics);
+void mrcal_projector_free(mrcal_projector_t** projector);
+
+const mrcal_lensmodel_t* mrcal_projector_lensmodel (const mrcal_projector_t* projector);
+const double*            mrcal_projector_intrinsics(const mrcal_projector_t* projector);
+
+// Same as mrcal_project(), but using the lens model and intrinsics in the
+// projector
+bool mrcal_projector_project( // out
+                             mrcal_point2_t* q,
+                             mrcal_point3_t* dq_dp,
+                             double*         dq_dintrinsics,
+
+                             // in
+                             const mrcal_point3_t* p,
+                             int N,
+                             const mrcal_projector_t* projector);
+
+// Same as mrcal_project_soa(), but using the lens model and intrinsics in the
+// projector
+bool mrcal_projector_project_soa( // out
+                                 double* qx,             int qx_stride0,
+                                 double* qy,             int qy_stride0,
+                                 double* dq_dp,          int dq_dp_stride0,
+                                                         int dq_dp_stride1,
+                                                         int dq_dp_stride2,
+                                 double* dq_dintrinsics, int dq_dintrinsics_stride0,
+                                                         int dq_dintrinsics_stride1,
+                                                         int dq_dintrinsics_stride2,
+                                 int dq_dintrinsics_icol0,
+                                 int dq_dintrinsics_Ncols,
+
+                                 // in
+                                 const double* px,       int px_stride0,
+                                 const double* py,       int py_stride0,
+                                 const double* pz,       int pz_stride0,
+                                 int N,
+                                 const mrcal_projector_t* projector);
+
+// Same as mrcal_unproject(), but using the lens model and intrinsics in the
+// projector
+bool mrcal_projector_unproject( // out
+                               mrcal_point3_t* v,
+
+                               // in
+                               const mrcal_point2_t* q,
+                               int N,
+                               const mrcal_projector_t* projector);
+
+
 // Project the given camera-coordinate-system points using a pinhole
 // model. See the docs for projection details:
 // http://mrcal.secretsauce.net/lensmodels.html#lensmodel-pinhole
@@ -1020,5 +1133,402 @@ void                 mrcal_free_cameramodel(mrcal_cameramodel_t** cameramodel);
 bool mrcal_write_cameramodel_file(const char* filename,
                                   const mrcal_cameramodel_t* cameramodel);
 
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////// Triangulation
+////////////////////////////////////////////////////////////////////////////////
+
+// Triangulate N points observed by a pair of cameras, and compute the gradients
+// needed to propagate the observation-time and calibration-time noise. This is
+// the C implementation of the core of mrcal.triangulate(): it is called for
+// each camera pair when propagating noise
+//
+// q is a (N,2) array of pixel observations: q[2*i + icam]. The cameras are
+// given by their lens models, intrinsics and rt_cam_ref transformations. The
+// triangulation method is one of the mrcal_triangulation_function_t routines
+// in triangulation.h. The triangulated points are written to p, in the
+// coordinate system of camera 0
+//
+// If Var_p_observation != NULL, we write the (N,3,3) covariances of the
+// triangulated points due to the observation noise, given the (4,4) covariance
+// Var_q of the 4 observed pixel coordinates of each point
+//
+// If dp_dstate != NULL, we write the (N,3,Nstate) gradients of the
+// triangulated points in respect to the UNPACKED optimization state vector. Only
+// the columns that depend on the calibration are written; the caller must zero
+// the array beforehand. The layout of the state vector is described by the
+// istate_... and Nintrinsics_state arguments; an istate_... < 0 means "not in
+// the state vector". The optimized intrinsics are columns
+// icol0_intrinsics..icol0_intrinsics+Nintrinsics_state-1 of the full
+// intrinsics. If stabilize, we compensate for the motion of the camera-0
+// coordinate system with the calibration, as described in the docs of
+// mrcal.triangulate(). The (Nframes,6) rt_ref_frame array contains the frame
+// poses, used by the stabilization. It is NULL if the frames aren't being
+// optimized
+//
+// Nthreads <= 0 means "use all the cores". Returns false on error
+bool mrcal_triangulate_with_uncertainty( // output
+                                        mrcal_point3_t* p,
+                                        double*         Var_p_observation,
+                                        double*         dp_dstate,
+
+                                        // input
+                                        const mrcal_point2_t*           q,
+                                        int                             N,
+                                        mrcal_triangulation_function_t* triangulate,
+                                        const mrcal_lensmodel_t*        lensmodel0,
+                                        const double*                   intrinsics0,
+                                        const double*                   rt_0ref,
+                                        const mrcal_lensmodel_t*        lensmodel1,
+                                        const double*                   intrinsics1,
+                                        const double*                   rt_1ref,
+                                        const double*                   Var_q,
+
+                                        int Nstate,
+                                        int istate_intrinsics0, int istate_intrinsics1,
+                                        int icol0_intrinsics,   int Nintrinsics_state,
+                                        int istate_extrinsics0, int istate_extrinsics1,
+                                        bool stabilize,
+                                        const double* rt_ref_frame,
+                                        int Nframes, int istate_frames,
+
+                                        int Nthreads);
+
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////// Projection uncertainty
+////////////////////////////////////////////////////////////////////////////////
+
+// Evaluate the projection uncertainty on a regular grid of pixels covering the
+// imager. This is the C implementation of the core of
+// mrcal.projection_uncertainty_grid(): mrcal-show-projection-uncertainty and
+// mrcal.show_projection_uncertainty() use it
+//
+// The grid is the same as the one produced by mrcal.sample_imager(): gridn_width
+// columns and gridn_height rows, spanning the whole (W,H) imager given in
+// imagersize. Each pixel is unprojected, and observed at the given distance. If
+// atinfinity, the distance is ignored, and we look out to infinity: all the
+// translations are ignored, as in mrcal.projection_uncertainty(atinfinity =
+// True). The camera is at rt_cam_ref in the reference coordinate system; NULL if
+// it sits at the reference
+//
+// The gradient of the projection in respect to the calibration state has the
+// form
+//
+//   dq/dstate = dq/dbasis dbasis/dstate
+//
+// where the "basis" has Nbasis = Nintrinsics_state+12 elements:
+//
+// - The Nintrinsics_state optimized intrinsics. These are columns
+//   icol0_intrinsics..icol0_intrinsics+Nintrinsics_state-1 of the full
+//   intrinsics
+// - 4 3-vectors g0, gx, gy, gz. dq/dg = dq/dp_cam * (1, p_ref)[i] for each of
+//   these: dq/dstate is affine in the point p_ref in the reference coordinate
+//   system. At infinity dq/dstate is linear in p_ref, and g0 is unused
+//
+// dbasis/dstate does not depend on the pixel, so the caller propagates the
+// calibration-time noise to the basis once, and passes in the (Nbasis,Nbasis)
+// covariance Var_basis. Here we compute dq/dbasis Var_basis transpose(dq/dbasis)
+// at each pixel. The (gridn_height,gridn_width) stdev array receives the
+// worst-direction standard deviation at each pixel, or the RMS of the worst and
+// best direction standard deviations if rms. Pixels that couldn't be
+// unprojected get NaN
+//
+// The work is split into rows, which are processed by Nthreads threads.
+// Nthreads <= 0 means "use all the cores". Returns true on success
+bool mrcal_projection_uncertainty_grid( // output
+                                        double* stdev,
+
+                                        // input
+                                        int gridn_width, int gridn_height,
+                                        const mrcal_lensmodel_t* lensmodel,
+                                        const double*            intrinsics,
+                                        const unsigned int*      imagersize,
+                                        double                   distance,
+                                        bool                     atinfinity,
+                                        const double*            rt_cam_ref,
+                                        const double*            Var_basis,
+                                        int icol0_intrinsics, int Nintrinsics_state,
+                                        bool rms,
+                                        int Nthreads);
+
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////// Stereo
+////////////////////////////////////////////////////////////////////////////////
+
+// Compute the rectification maps for a stereo pair. This is the C
+// implementation of mrcal.rectification_maps(); see the docs for that function
+//
+// The rectified system is described by a LENSMODEL_LATLON or LENSMODEL_PINHOLE
+// model with the given fxycxy and imager size (Naz,Nel), shared by both
+// rectified cameras. Each camera is described by its lens model and intrinsics,
+// and by the rotation R_cam_rect that maps vectors in the rectified coordinate
+// system to that camera's coordinate system
+//
+// The maps are written to the caller-supplied dense float arrays of shape
+// (Nel,Naz,2). Each (2,) row contains the pixel coordinates in the input image
+// that correspond to that pixel in the rectified image
+//
+// The work is split into tiles of rows, which are processed by Nthreads
+// threads. Nthreads <= 0 means "use all the cores". Returns true on success
+bool mrcal_rectification_maps( // output
+                              // Dense arrays of shape (Nel,Naz,2)
+                              float* rectification_map0,
+                              float* rectification_map1,
+
+                              // input
+                              const mrcal_lensmodel_t* lensmodel0,
+                              const double*            intrinsics0,
+                              const double*            R_cam0_rect, // (3,3)
+                              const mrcal_lensmodel_t* lensmodel1,
+                              const double*            intrinsics1,
+                              const double*            R_cam1_rect, // (3,3)
+
+                              const mrcal_lensmodel_type_t rectification_model_type,
+                              const double*            fxycxy_rectified,
+                              const unsigned int*      imagersize_rectified,
+                              int                      Nthreads);
+
+// Precompute a lookup table to convert integer disparities to ranges. This is
+// the C implementation of mrcal.stereo_range_lut(); see the docs for that
+// function
+//
+// The disparities are integers in units of 1/disparity_scale pixels (the OpenCV
+// StereoSGBM matcher uses disparity_scale = 16). Disparities in [0,Ndisparities)
+// are covered by the table. Disparity 0 is invalid, and maps to a range of 0
+//
+// The layout of the LUT depends on the rectification model:
+//
+// - LENSMODEL_LATLON: the range depends on the az column and the disparity only.
+//   The LUT has shape (Ndisparities,Naz)
+//
+// - LENSMODEL_PINHOLE: the range is the norm of the unprojected vector scaled
+//   by a function of the disparity only. The LUT has shape (Ndisparities,), and
+//   contains that function
+//
+// Returns true on success
+bool mrcal_stereo_range_lut( // output
+                             float* lut,
+
+                             // input
+                             int                          Ndisparities,
+                             const mrcal_lensmodel_type_t rectification_model_type,
+                             const double*                fxycxy_rectified,
+                             const unsigned int*          imagersize_rectified,
+                             double                       baseline,
+                             double                       disparity_scale);
+
+// Convert a dense disparity image of shape (Nel,Naz) to a dense range image of
+// the same shape, using a LUT from mrcal_stereo_range_lut(). Disparities <= 0
+// or >= Ndisparities are invalid, and produce a range of 0. This is the
+// semantics of mrcal.stereo_range()
+//
+// The work is split into tiles of rows, which are processed by Nthreads
+// threads. Nthreads <= 0 means "use all the cores". Returns true on success
+bool mrcal_stereo_range_from_lut( // output
+                                  float* range,
+
+                                  // input
+                                  const int16_t*               disparity,
+                                  const float*                 lut,
+                                  int                          Ndisparities,
+                                  const mrcal_lensmodel_type_t rectification_model_type,
+                                  const double*                fxycxy_rectified,
+                                  const unsigned int*          imagersize_rectified,
+                                  int                          Nthreads);
+
+// Convert a dense disparity image of shape (Nel,Naz) to a point cloud in one
+// pass, using a LUT from mrcal_stereo_range_lut(). This is the C implementation
+// of mrcal.stereo_point_cloud(); see the docs for that function
+//
+// Pixels with invalid disparities (as in mrcal_stereo_range_from_lut()) are
+// skipped. The valid points are written densely to the caller-supplied
+// points[] array, in row-major pixel order. This array must have room for
+// Nel*Naz points: the whole buffer is used as scratch space
+//
+// The points are reported in the rectified camera-0 coordinate system if
+// Rt_out_rect0 is NULL. Otherwise they are transformed by this (4,3) Rt
+// transformation; to report the points in the camera-0 or the reference
+// coordinate system, for instance
+//
+// If image is non-NULL, the colors[] array receives the Ncolor_channels
+// channels of each valid pixel in this rectified camera-0 image. The image has
+// shape (Nel,Naz,Ncolor_channels), and is stored densely. Like points[], the
+// colors[] array must have room for Nel*Naz pixels. colors and image must be
+// NULL or non-NULL together. Only 1-channel and 3-channel images are supported
+//
+// The work is split into tiles of rows, which are processed by Nthreads
+// threads. Nthreads <= 0 means "use all the cores". Returns the number of valid
+// points or <0 on error
+int mrcal_stereo_point_cloud( // output
+                              float*   points, // (Nel*Naz,3)
+                              uint8_t* colors, // (Nel*Naz,Ncolor_channels) or NULL
+
+                              // input
+                              const int16_t*               disparity,
+                              const float*                 lut,
+                              int                          Ndisparities,
+                              const uint8_t*               image,
+                              int                          Ncolor_channels,
+                              const double*                Rt_out_rect0, // (4,3) or NULL
+                              const mrcal_lensmodel_type_t rectification_model_type,
+                              const double*                fxycxy_rectified,
+                              const unsigned int*          imagersize_rectified,
+                              int                          Nthreads);
+
+// A semi-global stereo matcher. This is the C implementation of
+// mrcal.stereo_sgm(); see the docs for that function
+//
+// The configuration is given as an "X macro":
+// https://en.wikipedia.org/wiki/X_Macro. Each entry is (name, default value)
+#define MRCAL_STEREO_SGM_PARAMETERS_LIST(_)                                     \
+    /* The smallest disparity we search, in pixels */                           \
+    _(disparity_min,    0)                                                      \
+    /* How many disparities we search, in pixels */                             \
+    _(Ndisparities,     64)                                                     \
+    /* The penalty for a disparity change of 1 pixel between neighbors */       \
+    _(P1,               7)                                                      \
+    /* The penalty for a larger disparity change between neighbors */           \
+    _(P2,               100)                                                    \
+    /* How many directions we aggregate the costs along: 4 or 8 */              \
+    _(Npaths,           8)                                                      \
+    /* The best cost must be this many percent better than the costs of all */  \
+    /* the non-neighboring disparities. 0 disables this check */                \
+    _(uniqueness_ratio, 10)                                                     \
+    /* The maximum difference, in pixels, between the camera0 and camera1 */    \
+    /* disparities of a match. <0 disables this check */                        \
+    _(disp12_max_diff,  1)
+#define _MRCAL_STEREO_SGM_PARAMETER_DEFINE_ELEMENT(name, default) int name;
+typedef struct
+{
+    MRCAL_STEREO_SGM_PARAMETERS_LIST(_MRCAL_STEREO_SGM_PARAMETER_DEFINE_ELEMENT)
+} mrcal_stereo_sgm_parameters_t;
+#undef _MRCAL_STEREO_SGM_PARAMETER_DEFINE_ELEMENT
+
+// The disparities are reported in units of 1/MRCAL_STEREO_SGM_DISPARITY_SCALE
+// pixels. This is the convention of the OpenCV StereoSGBM matcher, and the
+// output can be passed to mrcal_stereo_range_from_lut() directly.
+// Invalid disparities are reported as MRCAL_STEREO_SGM_DISPARITY_INVALID
+#define MRCAL_STEREO_SGM_DISPARITY_SCALE   16
+#define MRCAL_STEREO_SGM_DISPARITY_INVALID (-1)
+
+// Compute the disparity image from a pair of rectified grayscale images. The
+// images and the output disparity image have shape (H,W), and are stored
+// densely. The intermediate results need W*H*(3*Ndisparities + 8) bytes of
+// memory
+//
+// The work is split among Nthreads threads. Nthreads <= 0 means "use all the
+// cores". Returns true on success
+bool mrcal_stereo_sgm( // output
+                       int16_t* disparity,
+
+                       // input
+                       const uint8_t*                       image0,
+                       const uint8_t*                       image1,
+                       int                                  W,
+                       int                                  H,
+                       const mrcal_stereo_sgm_parameters_t* parameters,
+                       int                                  Nthreads);
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////// Image remapping
+////////////////////////////////////////////////////////////////////////////////
+
+// Compute a transformation map between two cameras whose observation vectors
+// are related linearly: v_from = M v_to. This is the C implementation of the
+// common modes of mrcal.image_transformation_map():
+//
+// - intrinsics-only: M is the identity
+// - reprojection at infinity: M is the rotation R_from_to
+// - reprojection of a plane: M is the plane-induced homography
+//
+// The map is written to the caller-supplied dense float array of shape
+// (Nheight_to,Nwidth_to,2). Each (2,) row contains the pixel coordinates in the
+// FROM image that correspond to that pixel in the TO image
+//
+// If the TO model is LENSMODEL_PINHOLE, the observation vectors are evaluated
+// analytically, without calling unproject(). If the FROM model is
+// LENSMODEL_PINHOLE, the projection is evaluated analytically also. So a
+// pinhole-to-pinhole map is evaluated as a pure homography. The TO model must
+// be LENSMODEL_PINHOLE or have gradients: LENSMODEL_CAHVORE is not supported
+// there, since mrcal_unproject() can't handle it
+//
+// The work is split into tiles of rows, which are processed by Nthreads
+// threads. Nthreads <= 0 means "use all the cores". Returns true on success
+bool mrcal_image_transformation_map( // output
+                                     float* mapxy,
+
+                                     // input
+                                     const mrcal_lensmodel_t* lensmodel_from,
+                                     const double*            intrinsics_from,
+                                     const mrcal_lensmodel_t* lensmodel_to,
+                                     const double*            intrinsics_to,
+                                     const double*            M, // (3,3)
+                                     const unsigned int*      imagersize_to,
+                                     int                      Nthreads);
+
+// mrcal_remap() applies a transformation map to an image, using bilinear
+// interpolation. The map is stored in a compact fixed-point format: the same
+// format as OpenCV's CV_16SC2 maps (as produced by cv2.convertMaps()), so these
+// maps may be passed to cv2.remap() also
+//
+// For each output pixel, the integer part of the source pixel coordinates is
+// stored in map_xy as an (x,y) pair of int16_t. The fractional parts are
+// quantized to 1/MRCAL_REMAP_FRACTION_N, and stored in map_fraction as a
+// uint16_t: ifraction_y*MRCAL_REMAP_FRACTION_N + ifraction_x
+#define MRCAL_REMAP_FRACTION_BITS 5
+#define MRCAL_REMAP_FRACTION_N    (1 << MRCAL_REMAP_FRACTION_BITS)
+
+// The supported pixel types. Each pixel has 1-4 channels of one of these
+#define MRCAL_REMAP_PIXEL_TYPE_LIST(_)          \
+    _(UINT8,  uint8_t)                          \
+    _(UINT16, uint16_t)                         \
+    _(FLOAT,  float)
+#define _REMAP_PIXEL_TYPE_ENUM(name,type) MRCAL_REMAP_PIXEL_ ## name,
+typedef enum
+    { MRCAL_REMAP_PIXEL_TYPE_LIST( _REMAP_PIXEL_TYPE_ENUM ) } mrcal_remap_pixel_type_t;
+#undef _REMAP_PIXEL_TYPE_ENUM
+
+// Convert a dense float transformation map of N pixels (N (x,y) pairs, as
+// returned by mrcal.image_transformation_map()) to the fixed-point format.
+// Pixels that cannot be represented (out of the int16_t range or not finite)
+// are mapped out of bounds
+void mrcal_remap_map_fixedpoint( // out
+                                 int16_t*  map_xy,       // (N,2)
+                                 uint16_t* map_fraction, // (N,)
+                                 // in
+                                 const float* mapxy,     // (N,2)
+                                 int N );
+
+// Apply the fixed-point map (map_xy,map_fraction) to image_in, writing the
+// result to image_out. The map has one entry per output pixel, stored densely,
+// in row-major order. The images have Nchannels channels of the given
+// pixel_type; the channels within a row are stored densely, and the rows are
+// separated by the given strides, in bytes. Strides <= 0 mean "dense"
+//
+// Source pixels outside the input image have the value border_value, in all
+// channels. The work is split into tiles of rows, which are processed by
+// Nthreads threads. Nthreads <= 0 means "use all the cores". Returns true on
+// success
+bool mrcal_remap( // out
+                  void*                    image_out,
+                  int                      Nwidth_out,
+                  int                      Nheight_out,
+                  int                      stride_out,
+
+                  // in
+                  const void*              image_in,
+                  int                      Nwidth_in,
+                  int                      Nheight_in,
+                  int                      stride_in,
+
+                  mrcal_remap_pixel_type_t pixel_type,
+                  int                      Nchannels,
+                  const int16_t*           map_xy,
+                  const uint16_t*          map_fraction,
+                  double                   border_value,
+                  int                      Nthreads);
+
 // Public ABI stuff, that's not for end-user consumption
 #include "mrcal_internal.h"
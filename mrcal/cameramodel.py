@@ -30,9 +30,29 @@ import re
 import warnings
 import io
 import base64
+import threading
+import weakref
 
 import mrcal
 
+# The evaluated optimization problems used by the uncertainty computations. Each
+# one contains a full J and a factorization of J'J, so these are expensive to
+# compute, and large. All the models produced by the same optimization share one
+# entry: the key is the _optimization_inputs_string. Each model holds a
+# reference to its entry, and this cache holds weak references only. So an entry
+# is freed when the last model using it goes away, or gets new
+# optimization_inputs. See cameramodel._optimization_context()
+_optimization_context_cache      = weakref.WeakValueDictionary()
+_optimization_context_cache_lock = threading.Lock()
+
+class _OptimizationContext:
+    r'''An entry in _optimization_context_cache
+
+    A plain tuple can't be weakly referenced, so I wrap it in this'''
+    def __init__(self, key, context):
+        self.key     = key
+        self.context = context
+
 def _validateExtrinsics(e):
     r'''Raises an exception if the given extrinsics are invalid'''
 
@@ -1007,6 +1027,8 @@ tuple where
         else:
             self._optimization_inputs_string = None
             self._icam_intrinsics            = None
+        # The old optimization context doesn't apply anymore
+        self._optimization_context_entry = None
 
 
     def _extrinsics_rt(self, toref, rt=None):
@@ -1342,6 +1364,52 @@ The optimization_inputs dict, or None if one isn't stored in this model.
         return x
 
 
+    def _optimization_context(self):
+        r'''Evaluate the optimization problem that produced this model, with caching
+
+NOT A PART OF THE EXTERNAL API. This is for the uncertainty computations:
+mrcal.projection_uncertainty(), mrcal.triangulate() and friends. Each of those
+needs the optimization problem evaluated at its optimum, and J'J factored. This
+is expensive, so I compute it once, and cache it. The models that came from the
+same optimization share the cache, and changing the optimization_inputs (by
+calling intrinsics()) invalidates it. The cached context is freed when no models
+are using it.
+
+Returns a tuple
+
+  (optimization_inputs, ppacked, x, Jpacked, factorization)
+
+where the last 4 are what mrcal.optimizer_callback(**optimization_inputs)
+returns. Or returns None if this model doesn't contain optimization_inputs.
+
+The returned objects are shared by all the callers. They must NOT be modified
+        '''
+
+        key = self._optimization_inputs_string
+        if key is None:
+            return None
+
+        entry = getattr(self, '_optimization_context_entry', None)
+        if entry is not None and entry.key == key:
+            return entry.context
+
+        with _optimization_context_cache_lock:
+            entry = _optimization_context_cache.get(key)
+
+        if entry is None:
+            optimization_inputs = self.optimization_inputs()
+            entry = _OptimizationContext(key,
+                                         (optimization_inputs,) + \
+                                         tuple(mrcal.optimizer_callback(**optimization_inputs)))
+            with _optimization_context_cache_lock:
+                # Another thread may have computed this in the meantime. If so,
+                # I use that one
+                entry = _optimization_context_cache.setdefault(key, entry)
+
+        self._optimization_context_entry = entry
+        return entry.context
+
+
     def _optimization_inputs_match(self, other_model):
         if self.       _optimization_inputs_string is None:
             if other_model._optimization_inputs_string is None:
@@ -10,9 +10,21 @@ mrcal.image_transforms.fff() or mrcal.fff(). The latter is preferred.
 import numpy as np
 import numpysane as nps
 import sys
+import os
 import re
+import hashlib
+import tempfile
+import warnings
 import mrcal
 
+# The directory containing the on-disk map cache. None if the cache is disabled.
+# Set with mrcal.set_map_cache_directory()
+_map_cache_directory = None
+
+# Hashed into each map-cache key. Bump this when the contents or the layout of
+# the cached maps change: the stale entries are then ignored
+_map_cache_format_version = 1
+
 def scale_focal__best_pinhole_fit(model, fit):
     r'''Compute the optimal focal-length scale for reprojection to a pinhole lens
 
@@ -264,13 +276,272 @@ the input model.
                            imagersize            = imagersize )
 
 
+def set_map_cache_directory(directory):
+    r'''Enable or disable the on-disk cache of transformation maps
+
+SYNOPSIS
+
+    mrcal.set_map_cache_directory('/var/cache/mrcal-maps')
+
+    # Computes the maps, and writes them to the cache
+    rectification_maps = mrcal.rectification_maps(models, models_rectified)
+
+    # Reads the maps from the cache
+    rectification_maps = mrcal.rectification_maps(models, models_rectified)
+
+Computing transformation maps is expensive, but the same maps are usually
+needed over and over: the camera models change rarely. If a cache directory is
+configured, mrcal.image_transformation_map() and mrcal.rectification_maps()
+look up each requested map in this directory before computing it, and write
+each newly-computed map into it.
+
+Each map is keyed by a hash of the contents of the camera models (lens models,
+intrinsics, extrinsics, imager sizes) and of all the arguments that affect the
+map. Editing a model or changing any mapping parameter thus produces a new
+cache entry; stale entries are never used, but they're also never removed.
+
+The maps are stored as .npy files containing raw 32-bit floats. They're read
+back with a copy-on-write memory map, so reading a cached map is nearly free,
+and only the parts of the map that are used are ever read from disk.
+
+ARGUMENTS
+
+- directory: the directory to hold the cache. It is created if it doesn't
+  exist. If None, the cache is disabled. This is the default
+
+RETURNED VALUE
+
+None
+
+    '''
+
+    global _map_cache_directory
+    if directory is not None:
+        os.makedirs(directory, exist_ok = True)
+    _map_cache_directory = directory
+
+
+def _map_cache_key(what, models, *params):
+    r'''Computes the map-cache key for a map
+
+    The key is a hash of the cache format version, the contents of the given
+    models, and the given parameters
+
+    NOT A PART OF THE EXTERNAL API'''
+
+    h = hashlib.sha256()
+    def update(x):
+        if isinstance(x, np.ndarray):
+            # repr() would summarize big arrays, so I hash the data itself
+            h.update(str(x.shape).encode())
+            h.update(np.ascontiguousarray(x, dtype=float).tobytes())
+        else:
+            h.update(repr(x).encode())
+
+    update(_map_cache_format_version)
+    update(what)
+    for m in models:
+        lensmodel,intrinsics_data = m.intrinsics()
+        update(lensmodel)
+        update(intrinsics_data)
+        update(m.extrinsics_rt_fromref())
+        update(tuple(m.imagersize()))
+    for p in params:
+        update(p)
+
+    return h.hexdigest()
+
+
+def _map_cache_read(key):
+    r'''Reads a map from the cache
+
+    Returns (mapxy, approximation_error) or None if the map isn't in the cache.
+    approximation_error is None if the map is exact
+
+    NOT A PART OF THE EXTERNAL API'''
+
+    if _map_cache_directory is None:
+        return None
+
+    filename = os.path.join(_map_cache_directory, key)
+    try:
+        # copy-on-write: the caller may modify the map, but the cache is never
+        # touched
+        mapxy = np.load(filename + '.npy', mmap_mode = 'c')
+    except FileNotFoundError:
+        return None
+
+    approximation_error = None
+    if os.path.isfile(filename + '.approximation-error'):
+        with open(filename + '.approximation-error') as f:
+            approximation_error = float(f.read())
+
+    return mapxy, approximation_error
+
+
+def _map_cache_write(key, mapxy, approximation_error = None):
+    r'''Writes a map into the cache
+
+    Failures are reported as warnings: the cache is an optimization only
+
+    NOT A PART OF THE EXTERNAL API'''
+
+    if _map_cache_directory is None:
+        return
+
+    filename = os.path.join(_map_cache_directory, key)
+
+    # Each file is written to a temporary file, and renamed into place, so
+    # concurrent readers never see a partial map. Each temporary file is unique,
+    # so concurrent writers of the same key (in other processes or threads)
+    # don't clobber each other. The error is written first: a map entry without
+    # its error would look exact
+    def write(suffix, write_contents):
+        fd,filename_tmp = tempfile.mkstemp(dir    = os.path.dirname(filename),
+                                           prefix = os.path.basename(filename) + '.',
+                                           suffix = '.tmp')
+        try:
+            with os.fdopen(fd, 'wb') as f:
+                write_contents(f)
+            os.replace(filename_tmp, filename + suffix)
+        except:
+            os.unlink(filename_tmp)
+            raise
+
+    try:
+        if approximation_error is not None:
+            write('.approximation-error',
+                  lambda f: f.write(repr(float(approximation_error)).encode()))
+        write('.npy',
+              lambda f: np.save(f, np.ascontiguousarray(mapxy, dtype=np.float32)))
+    except Exception as e:
+        warnings.warn(f"Couldn't write map to the cache in '{_map_cache_directory}': {e}")
+
+
+def _pixel_grid(x, y):
+    r'''Returns the pixel coordinates of the grid spanned by the given x,y
+
+    Returns an array of shape (len(y),len(x),2). Contains (x,y) rows
+
+    NOT A PART OF THE EXTERNAL API'''
+    return np.ascontiguousarray(nps.mv(nps.cat(*np.meshgrid(x,y)),
+                                       0,-1),
+                                dtype = float)
+
+
+def _cubic_interpolation_weights(x, spacing, N):
+    r'''Computes the cubic-convolution weights for sampling a 1D grid
+
+    The grid has N nodes at 0, spacing, 2*spacing, ... and one extra node on
+    either side. For each x we return the index of the first of the 4 nodes
+    used (in the padded array) and the 4 weights. Same kernel as
+    cv2.INTER_CUBIC: Catmull-Rom, so the grid values are reproduced exactly
+
+    NOT A PART OF THE EXTERNAL API'''
+
+    t = x / spacing
+    i = np.clip(np.floor(t).astype(int), 0, N-2)
+    u = t - i
+
+    u2 = u*u
+    u3 = u2*u
+    w = nps.cat( (-u3 + 2.*u2 - u  ) / 2.,
+                 (3.*u3 - 5.*u2 + 2.) / 2.,
+                 (-3.*u3 + 4.*u2 + u) / 2.,
+                 (u3 - u2           ) / 2. )
+    return i, w
+
+
+def _interpolate_grid(grid, spacing, x, y):
+    r'''Bicubic interpolation of a padded grid of map values
+
+    grid has shape (Ny+2,Nx+2,2), with node (0,0) at grid[1,1]. We sample it at
+    the tensor product of x and y, returning an array of shape (len(y),len(x),2)
+
+    NOT A PART OF THE EXTERNAL API'''
+
+    Ny,Nx = grid.shape[0]-2, grid.shape[1]-2
+
+    ix,wx = _cubic_interpolation_weights(x, spacing, Nx)
+    iy,wy = _cubic_interpolation_weights(y, spacing, Ny)
+
+    # Separable: interpolate each grid row horizontally, then the results
+    # vertically
+    gx = sum( grid[:,ix+k,:] * nps.dummy(wx[k],-1) for k in range(4) )
+    return sum( gx[iy+k,:,:] * wy[k][:,np.newaxis,np.newaxis] for k in range(4) )
+
+
+def _approximate_transformation_map(mapxy_exact, W, H, max_error):
+    r'''Computes a transformation map by interpolating a coarse grid
+
+    mapxy_exact(q) evaluates the map at pixel coordinates q of shape (...,2). We
+    evaluate it on a coarse grid, interpolate bicubically, and check the result
+    against mapxy_exact() at each quarter-cell point. The grid spacing is halved
+    until the worst error at those points is within max_error. The pixels
+    between the check points aren't checked, so this is an estimate of the worst
+    error, not a bound. If we get down to a tiny spacing, the checks cost as
+    much as the exact map, and we evaluate the whole map exactly.
+
+    Returns (mapxy, worst_error)
+
+    NOT A PART OF THE EXTERNAL API'''
+
+    if max_error <= 0:
+        raise Exception("approximation_max_error must be > 0")
+
+    def error(a, b):
+        e = nps.mag(a - b)
+        # Invalid regions (projections behind the camera, for instance) must be
+        # invalid in both maps. Anything else is an infinite error
+        finite_a = np.isfinite(a).all(axis=-1)
+        finite_b = np.isfinite(b).all(axis=-1)
+        e[ ~finite_a & ~finite_b ] = 0
+        e[  finite_a != finite_b ] = np.inf
+        return np.max(e) if e.size else 0.
+
+    # Start with a grid spacing of about 1/8 of the image; a power of 2
+    spacing = 1 << max(int(np.log2(max(W,H)/8)), 3)
+
+    while spacing >= 8:
+
+        Nx = (W-1 + spacing-1) // spacing + 1
+        Ny = (H-1 + spacing-1) // spacing + 1
+
+        # The grid nodes, including a padding node on each side. The padding and
+        # the last node may lie outside the image; the map is evaluated there
+        # anyway
+        grid = mapxy_exact(_pixel_grid(np.arange(-1, Nx+1, dtype=float) * spacing,
+                                       np.arange(-1, Ny+1, dtype=float) * spacing))
+
+        # Check points: a grid 4x denser than the nodes, inside the image.
+        # Checking only the cell midpoints misses the worst error in the
+        # high-curvature regions. The error at the nodes themselves is 0, but
+        # evaluating the full tensor product keeps this simple
+        x = np.arange(0, W-1 + 1e-6, spacing/4.)
+        y = np.arange(0, H-1 + 1e-6, spacing/4.)
+        e = error(_interpolate_grid(grid, spacing, x, y),
+                  mapxy_exact(_pixel_grid(x,y)))
+        if e <= max_error:
+            return \
+                _interpolate_grid(grid, spacing,
+                                  np.arange(W, dtype=float),
+                                  np.arange(H, dtype=float)), \
+                e
+
+        spacing //= 2
+
+    return mapxy_exact(_pixel_grid(np.arange(W, dtype=float),
+                                   np.arange(H, dtype=float))), 0.
+
+
 def image_transformation_map(model_from, model_to,
 
                              intrinsics_only                   = False,
                              distance                          = None,
                              plane_n                           = None,
                              plane_d                           = None,
-                             mask_valid_intrinsics_region_from = False):
+                             mask_valid_intrinsics_region_from = False,
+                             approximation_max_error           = None):
 
     r'''Compute a reprojection map between two models
 
@@ -344,6 +615,10 @@ This function has several modes of operation:
   points p such that inner(p,plane_n) = plane_d. plane_n does not need to be
   normalized; any scaling is compensated in plane_d.
 
+If a map cache directory has been configured with
+mrcal.set_map_cache_directory(), the map is read from the cache, if it's there,
+and written to the cache, if it isn't.
+
 ARGUMENTS
 
 - model_from: the mrcal.cameramodel object describing the camera used to capture
@@ -383,15 +658,77 @@ ARGUMENTS
   True, points outside the valid-intrinsics region in the FROM image are set to
   black, and thus do not appear in the output image
 
+- approximation_max_error: optional value, defaulting to None. By default we
+  compute the map exactly: each pixel is unprojected and projected. This is
+  slow for large images and for complex lens models. If approximation_max_error
+  is given, we instead evaluate the map exactly on a coarse grid only, and
+  interpolate bicubically between the grid points. The grid is refined until
+  the interpolation error is at most approximation_max_error pixels. This error
+  is ESTIMATED: it is measured against the exact map on a sample grid 4x denser
+  than the interpolation grid, not at every pixel. So the true worst-case error
+  may be somewhat larger than approximation_max_error. If the map is not smooth
+  enough for any reasonable grid, we fall back to the exact computation
+
 RETURNED VALUE
 
-A numpy array of shape (Nheight,Nwidth,2) where Nheight and Nwidth represent the
-imager dimensions of model_to. This array contains 32-bit floats, as required by
-cv2.remap() (the function providing the internals of mrcal.transform_image()).
-This array can be passed to mrcal.transform_image()
+if approximation_max_error is None: a numpy array of shape (Nheight,Nwidth,2)
+where Nheight and Nwidth represent the imager dimensions of model_to. This array
+contains 32-bit floats, as required by cv2.remap() (the function providing the
+internals of mrcal.transform_image()). This array can be passed to
+mrcal.transform_image()
+
+if approximation_max_error is not None: a tuple
+
+- mapxy: the map array, as described above
+
+- approximation_error: the worst interpolation error we observed on the sample
+  grid, in pixels. This is at most approximation_max_error. It is an estimate of
+  the worst error over the whole map
 
     '''
 
+    if _map_cache_directory is not None:
+        key = _map_cache_key('image_transformation_map',
+                             (model_from, model_to),
+                             intrinsics_only, distance, plane_n, plane_d,
+                             model_from.valid_intrinsics_region() \
+                             if mask_valid_intrinsics_region_from else None,
+                             approximation_max_error)
+        cached = _map_cache_read(key)
+        if cached is not None:
+            mapxy,approximation_error = cached
+            if approximation_max_error is not None:
+                return mapxy, approximation_error
+            return mapxy
+
+    result = \
+        _image_transformation_map(model_from, model_to,
+                                  intrinsics_only,
+                                  distance,
+                                  plane_n,
+                                  plane_d,
+                                  mask_valid_intrinsics_region_from,
+                                  approximation_max_error)
+
+    if _map_cache_directory is not None:
+        if approximation_max_error is not None:
+            _map_cache_write(key, *result)
+        else:
+            _map_cache_write(key, result)
+    return result
+
+
+def _image_transformation_map(model_from, model_to,
+                              intrinsics_only,
+                              distance,
+                              plane_n,
+                              plane_d,
+                              mask_valid_intrinsics_region_from,
+                              approximation_max_error):
+    r'''The implementation of image_transformation_map(), without the map cache
+
+    NOT A PART OF THE EXTERNAL API'''
+
     if (plane_n is      None and plane_d is not None) or \
        (plane_n is not  None and plane_d is     None):
         raise Exception("plane_n and plane_d should both be None or neither should be None")
@@ -449,23 +786,23 @@ This array can be passed to mrcal.transform_image()
         else:
             R_to_from = None
 
-        return nps.glue( *[ nps.dummy(arr,-1) for arr in \
-                            cv2.initUndistortRectifyMap(cameraMatrix_from, distortion_coeffs,
-                                                        R_to_from,
-                                                        cameraMatrix_to, tuple(output_shape),
-                                                        cv2.CV_32FC1)],
-                         axis = -1)
-
-    W_from,H_from = model_from.imagersize()
-    W_to,  H_to   = model_to.  imagersize()
-
-    # shape: (Nheight,Nwidth,2). Contains (x,y) rows
-    grid = np.ascontiguousarray(nps.mv(nps.cat(*np.meshgrid(np.arange(W_to),
-                                                            np.arange(H_to))),
-                                       0,-1),
-                                dtype = float)
-    v = mrcal.unproject(grid, lensmodel_to, intrinsics_data_to)
-
+        mapxy = nps.glue( *[ nps.dummy(arr,-1) for arr in \
+                             cv2.initUndistortRectifyMap(cameraMatrix_from, distortion_coeffs,
+                                                         R_to_from,
+                                                         cameraMatrix_to, tuple(output_shape),
+                                                         cv2.CV_32FC1)],
+                          axis = -1)
+        # This path is exact. If an approximation was requested, it has no
+        # error
+        if approximation_max_error is not None:
+            return mapxy, 0.
+        return mapxy
+
+    W_to,H_to = model_to.imagersize()
+
+    # In all the modes except for a finite distance, the observation vectors in
+    # the two cameras are related linearly: v_from = M v_to. These are evaluated
+    # by a fast path in C
     if plane_n is not None:
 
         R_to_from = Rt_to_from[:3,:]
@@ -475,19 +812,47 @@ This array can be passed to mrcal.transform_image()
         # "Motion and structure from motion in a piecewise planar environment"
         # by Olivier Faugeras, F. Lustman.
         A_to_from = plane_d * R_to_from + nps.outer(t_to_from, plane_n)
-        A_from_to = np.linalg.inv(A_to_from)
-        v = nps.matmult( v, nps.transpose(A_from_to) )
-
+        M = np.linalg.inv(A_to_from)
+    elif Rt_to_from is None:
+        M = np.eye(3)
+    elif distance is None:
+        M = nps.transpose(Rt_to_from[:3,:])
     else:
-        if Rt_to_from is not None:
-            if distance is not None:
-                v = mrcal.transform_point_Rt(mrcal.invert_Rt(Rt_to_from),
-                                             v/nps.dummy(nps.mag(v),-1) * distance)
-            else:
-                R_to_from = Rt_to_from[:3,:]
-                v = nps.matmult(v, R_to_from)
+        M = None
 
-    mapxy = mrcal.project( v, lensmodel_from, intrinsics_data_from )
+    def mapxy_exact(q):
+        r'''Evaluates the map at the given pixels in the TO image
+
+        q has shape (...,2). Returns an array of the same shape'''
+
+        v = mrcal.unproject(q, lensmodel_to, intrinsics_data_to)
+
+        if M is not None:
+            v = nps.matmult( v, nps.transpose(M) )
+        else:
+            v = mrcal.transform_point_Rt(mrcal.invert_Rt(Rt_to_from),
+                                         v/nps.dummy(nps.mag(v),-1) * distance)
+
+        return mrcal.project( v, lensmodel_from, intrinsics_data_from )
+
+    if approximation_max_error is not None:
+        mapxy,approximation_error = \
+            _approximate_transformation_map(mapxy_exact, W_to, H_to,
+                                            approximation_max_error)
+    elif M is not None and \
+         mrcal.lensmodel_metadata_and_config(lensmodel_to)['has_gradients']:
+        # The map is computed in C, one row at a time, split across all the
+        # cores. A pinhole-to-pinhole map is a pure homography, evaluated
+        # without any unproject() calls. The C unproject() needs gradients, so
+        # models without them (LENSMODEL_CAHVORE) on the TO side use the
+        # slow path below
+        mapxy = mrcal._mrcal._image_transformation_map(lensmodel_from, intrinsics_data_from,
+                                                       lensmodel_to,   intrinsics_data_to,
+                                                       M,
+                                                       (W_to,H_to))
+    else:
+        mapxy = mapxy_exact(_pixel_grid(np.arange(W_to, dtype=float),
+                                        np.arange(H_to, dtype=float)))
 
     if mask_valid_intrinsics_region_from:
 
@@ -498,8 +863,57 @@ This array can be passed to mrcal.transform_image()
         is_inside = region.contains_points(nps.clump(mapxy,n=2)).reshape(mapxy.shape[:2])
         mapxy[ ~is_inside, :] = -1
 
+    if approximation_max_error is not None:
+        return mapxy.astype(np.float32), approximation_error
+    return mapxy.astype(np.float32, copy = False)
+
+
+def transformation_map_fixedpoint(mapxy):
+
+    r'''Convert a transformation map to a compact fixed-point format
+
+SYNOPSIS
+
+    mapxy = mrcal.image_transformation_map(model_orig, model_pinhole,
+                                           intrinsics_only = True)
+
+    mapxy_fixedpoint = mrcal.transformation_map_fixedpoint(mapxy)
+
+    for image_orig in images:
+        image_undistorted = mrcal.transform_image(image_orig, mapxy_fixedpoint)
+
+mrcal.image_transformation_map() and mrcal.rectification_maps() produce dense
+float32 maps: 8 bytes per pixel. When applying a map to many images, it is more
+efficient to convert it to a compact fixed-point format first. This function
+does that conversion. The result may be passed to mrcal.transform_image() in
+place of the float map; this uses mrcal's own remap engine instead of OpenCV.
 
-    return mapxy.astype(np.float32)
+The fixed-point format is identical to OpenCV's CV_16SC2 map format, as
+produced by cv2.convertMaps(), so the result may be passed to cv2.remap() also:
+cv2.remap(image, *mapxy_fixedpoint, cv2.INTER_LINEAR).
+
+The integer part of each pixel coordinate is stored as an int16, and the
+fractional part is quantized to 1/32 pixel. Map entries that cannot be
+represented (not finite, or beyond the int16 range) are mapped out of bounds
+
+ARGUMENTS
+
+- mapxy: a numpy array of shape (Nheight,Nwidth,2), as returned by
+  mrcal.image_transformation_map() or mrcal.rectification_maps()
+
+RETURNED VALUE
+
+A tuple (map_xy, map_fraction):
+
+- map_xy: an int16 numpy array of shape (Nheight,Nwidth,2) containing the
+  integer part of each pixel coordinate
+
+- map_fraction: a uint16 numpy array of shape (Nheight,Nwidth) containing the
+  quantized fractional parts: ifraction_y*32 + ifraction_x
+
+    '''
+
+    return mrcal._mrcal._transformation_map_fixedpoint(mapxy)
 
 
 def transform_image(image, mapxy,
@@ -531,7 +945,17 @@ model to the image of the same scene using a different model, we can produce a
 suitable transformation map with mrcal.image_transformation_map(). An example of
 this common usage appears above in the synopsis.
 
-At this time this function is a thin wrapper around cv2.remap()
+The map may be given in one of two formats:
+
+- A dense float32 array, as returned by mrcal.image_transformation_map(). The
+  image is then transformed by cv2.remap()
+
+- A compact fixed-point map, as returned by
+  mrcal.transformation_map_fixedpoint(). The image is then transformed by
+  mrcal's own remap engine, which doesn't use OpenCV at all. This is faster and
+  more predictable, and is preferred if the same map is applied to many images.
+  This engine supports images containing uint8, uint16 or float32 data with 1-4
+  channels, and bilinear interpolation with a constant border only
 
 ARGUMENTS
 
@@ -542,7 +966,8 @@ ARGUMENTS
 - mapxy: a numpy array of shape (Nheight,Nwidth,2) where Nheight and Nwidth
   represent the dimensions of the target image. This array is expected to have
   dtype=np.float32, since the internals of this function are provided by
-  cv2.remap()
+  cv2.remap(). Or a fixed-point map: a tuple returned by
+  mrcal.transformation_map_fixedpoint()
 
 - out: optional numpy array of shape (Nheight,Nwidth) or (Nheight,Nwidth,3) to
   receive the result. If omitted, a new array is allocated and returned.
@@ -564,6 +989,22 @@ RGB. Contains the transformed image.
 
     '''
 
+    if isinstance(mapxy, tuple):
+        # A fixed-point map. Use our own remap engine. It only supports bilinear
+        # interpolation with a constant border. cv2.BORDER_CONSTANT = 0,
+        # cv2.INTER_LINEAR = 1. I don't import cv2 to check these, since the
+        # whole point of this path is to not need OpenCV
+        if not (borderMode is None or borderMode == 0):
+            raise Exception("A fixed-point map supports only borderMode = cv2.BORDER_CONSTANT")
+        if not (interpolation is None or interpolation == 1):
+            raise Exception("A fixed-point map supports only interpolation = cv2.INTER_LINEAR")
+        if len(mapxy) != 2:
+            raise Exception("A fixed-point map must be a tuple (map_xy, map_fraction), as returned by mrcal.transformation_map_fixedpoint()")
+        if not isinstance(image, np.ndarray): raise Exception("'image' must be a numpy array")
+        return mrcal._mrcal._remap(image, *mapxy,
+                                   out          = out,
+                                   border_value = borderValue)
+
     # necessary to avoid opencv crashing
     if not isinstance(image, np.ndarray): raise Exception("'image' must be a numpy array")
     if not isinstance(mapxy, np.ndarray): raise Exception("'mapxy' must be a numpy array")
@@ -535,19 +535,25 @@ In the regularized case:
 
     '''
 
-    # shape (2,Nstate)
-    A = factorization.solve_xt_JtJ_bt( dF_dppacked )
+    # All of this is done in C, by factorization.Var_dF(). It solves for all the
+    # blocks of F together, in as few CHOLMOD calls as possible, and
+    # accumulates the covariances directly. dF/dp* is sparse: I pass in only
+    # its non-zero columns
+    Nstate = dF_dppacked.shape[-1]
+    icol   = np.nonzero(np.any(dF_dppacked.reshape(-1,Nstate) != 0,
+                               axis = -2))[0].astype(np.int32)
+    dF     = np.ascontiguousarray(dF_dppacked[...,icol])
+
     if Nmeasurements_observations is not None:
         # I have regularization. Use the more complicated expression
-
-        # I see no python way to do matrix multiplication with sparse matrices,
-        # so I have my own routine in C. AND the C routine does the outer
-        # product, so there's no big temporary expression. It's much faster
-        Var_dF = mrcal._mrcal_npsp._A_Jt_J_At(A, Jpacked.indptr, Jpacked.indices, Jpacked.data,
-                                              Nleading_rows_J = Nmeasurements_observations)
+        Var_dF = factorization.Var_dF(dF, icol,
+                                      Jp = Jpacked.indptr,
+                                      Ji = Jpacked.indices,
+                                      Jx = Jpacked.data,
+                                      Nleading_rows_J = Nmeasurements_observations)
     else:
         # No regularization. Use the simplified expression
-        Var_dF = nps.matmult(dF_dppacked, nps.transpose(A))
+        Var_dF = factorization.Var_dF(dF, icol)
 
     if what == 'covariance':           return Var_dF * observed_pixel_uncertainty*observed_pixel_uncertainty
     if what == 'worstdirection-stdev': return worst_direction_stdev(Var_dF) * observed_pixel_uncertainty
@@ -555,6 +561,105 @@ In the regularized case:
     else: raise Exception("Shouldn't have gotten here. There's a bug")
 
 
+def _projection_uncertainty_setup(model, observed_pixel_uncertainty):
+    r'''Helper for projection_uncertainty() and projection_uncertainty_grid()
+
+    Collects everything the uncertainty computations need to know about the
+    calibration that produced this model. Returns a dict of the arguments of
+    _projection_uncertainty() and _projection_uncertainty_rotationonly(), other
+    than p_cam and what
+
+    '''
+
+    lensmodel = model.intrinsics()[0]
+
+    # The evaluated optimization problem is cached in the model, so repeated
+    # queries don't re-evaluate and re-factor it
+    optimization_context = model._optimization_context()
+    if optimization_context is None:
+        raise Exception("optimization_inputs are unavailable in this model. Uncertainty cannot be computed")
+
+    optimization_inputs,ppacked,x,Jpacked,factorization = optimization_context
+
+    if not optimization_inputs.get('do_optimize_extrinsics'):
+        raise Exception("Computing uncertainty if !do_optimize_extrinsics not supported currently. This is possible, but not implemented. _projection_uncertainty...() would need a path for fixed extrinsics like they already do for fixed frames")
+
+    if factorization is None:
+        raise Exception("Cannot compute the uncertainty: factorization computation failed")
+
+    # The intrinsics,extrinsics,frames MUST come from the solve when
+    # evaluating the uncertainties. The user is allowed to update the
+    # extrinsics in the model after the solve, as long as I use the
+    # solve-time ones for the uncertainty computation. Updating the
+    # intrinsics invalidates the uncertainty stuff so I COULD grab those
+    # from the model. But for good hygiene I get them from the solve as
+    # well
+
+    # which calibration-time camera we're looking at
+    icam_intrinsics = model.icam_intrinsics()
+    icam_extrinsics = mrcal.corresponding_icam_extrinsics(icam_intrinsics, **optimization_inputs)
+
+    intrinsics_data   = optimization_inputs['intrinsics'][icam_intrinsics]
+
+    if not optimization_inputs.get('do_optimize_intrinsics_core') and \
+       not optimization_inputs.get('do_optimize_intrinsics_distortions'):
+        istate_intrinsics          = None
+        slice_optimized_intrinsics = None
+    else:
+        istate_intrinsics = mrcal.state_index_intrinsics(icam_intrinsics, **optimization_inputs)
+
+        i0,i1 = None,None # everything by default
+
+        has_core     = mrcal.lensmodel_metadata_and_config(lensmodel)['has_core']
+        Ncore        = 4 if has_core else 0
+        Ndistortions = mrcal.lensmodel_num_params(lensmodel) - Ncore
+
+        if not optimization_inputs.get('do_optimize_intrinsics_core'):
+            i0 = Ncore
+        if not optimization_inputs.get('do_optimize_intrinsics_distortions'):
+            i1 = -Ndistortions
+
+        slice_optimized_intrinsics  = slice(i0,i1)
+
+    istate_frames = mrcal.state_index_frames(0, **optimization_inputs)
+
+    if icam_extrinsics < 0:
+        extrinsics_rt_fromref = None
+        istate_extrinsics     = None
+    else:
+        extrinsics_rt_fromref = optimization_inputs['extrinsics_rt_fromref'][icam_extrinsics]
+        istate_extrinsics     = mrcal.state_index_extrinsics (icam_extrinsics, **optimization_inputs)
+
+    frames_rt_toref = None
+    if optimization_inputs.get('do_optimize_frames'):
+        frames_rt_toref = optimization_inputs.get('frames_rt_toref')
+
+
+    Nmeasurements_observations = mrcal.num_measurements_boards(**optimization_inputs)
+    if Nmeasurements_observations == mrcal.num_measurements(**optimization_inputs):
+        # Note the special-case where I'm using all the observations
+        Nmeasurements_observations = None
+
+    if observed_pixel_uncertainty is None:
+        observed_pixel_uncertainty = \
+            np.std(mrcal.residuals_chessboard(optimization_inputs,
+                                              residuals = x).ravel())
+
+    return dict(lensmodel                  = lensmodel,
+                intrinsics_data            = intrinsics_data,
+                extrinsics_rt_fromref      = extrinsics_rt_fromref,
+                frames_rt_toref            = frames_rt_toref,
+                factorization              = factorization,
+                Jpacked                    = Jpacked,
+                optimization_inputs        = optimization_inputs,
+                istate_intrinsics          = istate_intrinsics,
+                istate_extrinsics          = istate_extrinsics,
+                istate_frames              = istate_frames,
+                slice_optimized_intrinsics = slice_optimized_intrinsics,
+                Nmeasurements_observations = Nmeasurements_observations,
+                observed_pixel_uncertainty = observed_pixel_uncertainty)
+
+
 def _projection_uncertainty( p_cam,
                              lensmodel, intrinsics_data,
                              extrinsics_rt_fromref, frames_rt_toref,
@@ -708,6 +813,13 @@ def _projection_uncertainty_rotationonly( p_cam,
         _ = mrcal.rotate_point_r( frames_rt_toref[...,:3], p_frames,
                                   get_gradients = True)
 
+        # shape (..., 3,6*Nframes)
+        # /Nframes because I compute the mean over all the frames. The
+        # translations don't affect anything at infinity, so those columns are 0
+        dpref_dframes = np.zeros(p_cam.shape[:-1] + (3,Nframes,6), dtype=float)
+        dpref_dframes[..., :3] = nps.mv(dprefallframes_dframesr, -3, -2)
+        dpref_dframes = nps.clump(dpref_dframes, n = -2) / Nframes
+
     _, dq_dpcam, dq_dintrinsics = \
         mrcal.project( p_cam, lensmodel, intrinsics_data,
                        get_gradients = True)
@@ -726,19 +838,12 @@ def _projection_uncertainty_rotationonly( p_cam,
             nps.matmult(dq_dpcam, dpcam_dr)
 
         if frames_rt_toref is not None:
-
-            dq_dpref = nps.matmult(dq_dpcam, dpcam_dpref)
-
-            # dprefallframes_dframesr has shape (..., Nframes,3,3)
-            for i in range(Nframes):
-                dq_dpief[..., istate_frames+6*i:istate_frames+6*i+3] = \
-                    nps.matmult(dq_dpref, dprefallframes_dframesr[...,i,:,:]) / Nframes
+            dq_dpief[..., istate_frames:istate_frames+Nframes*6] = \
+                nps.matmult(dq_dpcam, dpcam_dpref, dpref_dframes)
     else:
         if frames_rt_toref is not None:
-            # dprefallframes_dframesr has shape (..., Nframes,3,3)
-            for i in range(Nframes):
-                dq_dpief[..., istate_frames+6*i:istate_frames+6*i+3] = \
-                    nps.matmult(dq_dpcam, dprefallframes_dframesr[...,i,:,:]) / Nframes
+            dq_dpief[..., istate_frames:istate_frames+Nframes*6] = \
+                nps.matmult(dq_dpcam, dpref_dframes)
 
     # Make dq_dpief use the packed state. I call "unpack_state" because the
     # state is in the denominator
@@ -908,104 +1013,235 @@ else:                    we return an array of shape (...)
     if not what in what_known:
         raise Exception(f"'what' kwarg must be in {what_known}, but got '{what}'")
 
+    setup = _projection_uncertainty_setup(model, observed_pixel_uncertainty)
 
-    lensmodel = model.intrinsics()[0]
+    # Two distinct paths here that are very similar, but different-enough to not
+    # share any code. If atinfinity, I ignore all translations
+    if not atinfinity:
+        return _projection_uncertainty(p_cam, what = what, **setup)
+    else:
+        return _projection_uncertainty_rotationonly(p_cam, what = what, **setup)
 
-    optimization_inputs = model.optimization_inputs()
-    if optimization_inputs is None:
-        raise Exception("optimization_inputs are unavailable in this model. Uncertainty cannot be computed")
 
-    if not optimization_inputs.get('do_optimize_extrinsics'):
-        raise Exception("Computing uncertainty if !do_optimize_extrinsics not supported currently. This is possible, but not implemented. _projection_uncertainty...() would need a path for fixed extrinsics like they already do for fixed frames")
+def _projection_uncertainty_grid_basis(extrinsics_rt_fromref, frames_rt_toref,
+                                       Jpacked, optimization_inputs,
+                                       istate_intrinsics, istate_extrinsics, istate_frames,
+                                       Nintrinsics_state,
+                                       atinfinity):
+    r'''Helper for projection_uncertainty_grid()
 
-    ppacked,x,Jpacked,factorization = \
-        mrcal.optimizer_callback( **optimization_inputs )
+    Returns dbasis/dppacked: the (Nintrinsics_state+12, Nstate) gradient of the
+    "basis" described in the docs for mrcal_projection_uncertainty_grid() in
+    mrcal.h, in respect to the packed state.
 
-    if factorization is None:
-        raise Exception("Cannot compute the uncertainty: factorization computation failed")
+    _projection_uncertainty() computes
 
-    # The intrinsics,extrinsics,frames MUST come from the solve when
-    # evaluating the uncertainties. The user is allowed to update the
-    # extrinsics in the model after the solve, as long as I use the
-    # solve-time ones for the uncertainty computation. Updating the
-    # intrinsics invalidates the uncertainty stuff so I COULD grab those
-    # from the model. But for good hygiene I get them from the solve as
-    # well
+      dq/dpief = [dq/dp_i   dq/dpcam dpcam/dp_e   dq/dpcam dpcam/dpref dpref/dp_f]
 
-    # which calibration-time camera we're looking at
-    icam_intrinsics = model.icam_intrinsics()
-    icam_extrinsics = mrcal.corresponding_icam_extrinsics(icam_intrinsics, **optimization_inputs)
+    p_ref = R_rc (p_cam - t_cr) and p_frame[i] = R_fr[i] (p_ref - t_rf[i]) are
+    affine in p_ref, and d(R(r) x)/dr is linear in x. So every dq/dpcam term is
+    affine in p_ref as well, and we can write
 
-    intrinsics_data   = optimization_inputs['intrinsics'][icam_intrinsics]
+      dq/dpief = [dq/dp_i   dq/dpcam (dg0/dp + sum(p_ref[m] dg[m]/dp))]
 
-    if not optimization_inputs.get('do_optimize_intrinsics_core') and \
-       not optimization_inputs.get('do_optimize_intrinsics_distortions'):
-        istate_intrinsics          = None
-        slice_optimized_intrinsics = None
-    else:
-        istate_intrinsics = mrcal.state_index_intrinsics(icam_intrinsics, **optimization_inputs)
+    with dg0/dp and dg[m]/dp NOT depending on the point. So the calibration-time
+    noise can be propagated to (p_i,g0,gx,gy,gz) once, and then cheaply applied
+    to each point.
 
-        i0,i1 = None,None # everything by default
+    If atinfinity, the translations are ignored, as in
+    _projection_uncertainty_rotationonly(). Then dq/dpief is linear in p_ref,
+    and dg0/dp = 0
 
-        has_core     = mrcal.lensmodel_metadata_and_config(lensmodel)['has_core']
-        Ncore        = 4 if has_core else 0
-        Ndistortions = mrcal.lensmodel_num_params(lensmodel) - Ncore
+    '''
 
-        if not optimization_inputs.get('do_optimize_intrinsics_core'):
-            i0 = Ncore
-        if not optimization_inputs.get('do_optimize_intrinsics_distortions'):
-            i1 = -Ndistortions
+    Nstate = Jpacked.shape[-1]
+    Ni     = Nintrinsics_state
 
-        slice_optimized_intrinsics  = slice(i0,i1)
+    dbasis_dp = np.zeros((Ni+12,Nstate), dtype=float)
 
-    istate_frames = mrcal.state_index_frames(0, **optimization_inputs)
+    if istate_intrinsics is not None:
+        dbasis_dp[np.arange(Ni), istate_intrinsics + np.arange(Ni)] = 1.
 
-    if icam_extrinsics < 0:
-        extrinsics_rt_fromref = None
-        istate_extrinsics     = None
+    # shape (3,Nstate): dg0/dp
+    dg0_dp = dbasis_dp[Ni:Ni+3,:]
+    # shape (3,3,Nstate): dg[m]/dp for each component m of p_ref
+    dg_dp  = dbasis_dp[Ni+3:,:].reshape(3,3,Nstate)
+
+    if extrinsics_rt_fromref is not None:
+        # dpcam/dr_e = sum(p_ref[m] d(R e_m)/dr_e). dpcam/dt_e = I
+        # dRem_dr has shape (3,3,3): d(R e_m)/dr for each basis vector e_m
+        _, dRem_dr, _ = mrcal.rotate_point_r(extrinsics_rt_fromref[:3], np.eye(3),
+                                             get_gradients = True)
+        dg_dp[..., istate_extrinsics:istate_extrinsics+3] = dRem_dr
+        if not atinfinity:
+            dg0_dp[:, istate_extrinsics+3:istate_extrinsics+6] = np.eye(3)
+        R_cr = mrcal.R_from_r(extrinsics_rt_fromref[:3])
     else:
-        extrinsics_rt_fromref = optimization_inputs['extrinsics_rt_fromref'][icam_extrinsics]
-        istate_extrinsics     = mrcal.state_index_extrinsics (icam_extrinsics, **optimization_inputs)
+        R_cr = np.eye(3)
 
-    frames_rt_toref = None
-    if optimization_inputs.get('do_optimize_frames'):
-        frames_rt_toref = optimization_inputs.get('frames_rt_toref')
+    if frames_rt_toref is not None:
+        Nframes = len(frames_rt_toref)
 
+        # dpref/dr_f[i] = sum(p_frame[i][k] d(R_rf[i] e_k)/dr_f[i]) / Nframes
+        # with p_frame[i][k] = sum(R_rf[i][m,k] p_ref[m]) - (R_fr[i] t_rf[i])[k].
+        # dpref/dt_f[i] = I/Nframes
+        #
+        # shape (Nframes,3,3,3)
+        _, dRek_dr, _ = mrcal.rotate_point_r(nps.dummy(frames_rt_toref[:,:3],-2), np.eye(3),
+                                             get_gradients = True)
+        # shape (Nframes,3,3)
+        R_rf = mrcal.R_from_r(frames_rt_toref[:,:3])
+
+        dg_dpf  = np.zeros((3,3,Nframes,6), dtype=float)
+        dg_dpf[..., :3] = np.einsum('ac,imk,ikcb->maib', R_cr, R_rf, dRek_dr) / Nframes
+        dg_dp[..., istate_frames:istate_frames+Nframes*6] = dg_dpf.reshape(3,3,Nframes*6)
+
+        if not atinfinity:
+            # shape (Nframes,3)
+            t_frame = np.einsum('imk,im->ik', R_rf, frames_rt_toref[:,3:])
+
+            dg0_dpf = np.zeros((3,Nframes,6), dtype=float)
+            dg0_dpf[..., :3] = -np.einsum('ac,ik,ikcb->aib', R_cr, t_frame, dRek_dr) / Nframes
+            dg0_dpf[..., 3:] =  nps.dummy(R_cr,-2) / Nframes
+            dg0_dp[..., istate_frames:istate_frames+Nframes*6] = dg0_dpf.reshape(3,Nframes*6)
+
+    # Make dbasis_dp use the packed state. I call "unpack_state" because the
+    # state is in the denominator
+    mrcal.unpack_state(dbasis_dp, **optimization_inputs)
+    return dbasis_dp
 
-    Nmeasurements_observations = mrcal.num_measurements_boards(**optimization_inputs)
-    if Nmeasurements_observations == mrcal.num_measurements(**optimization_inputs):
-        # Note the special-case where I'm using all the observations
-        Nmeasurements_observations = None
 
-    if observed_pixel_uncertainty is None:
-        observed_pixel_uncertainty = \
-            np.std(mrcal.residuals_chessboard(optimization_inputs,
-                                              residuals = x).ravel())
+def projection_uncertainty_grid( model,
+                                 gridn_width  = 60,
+                                 gridn_height = None,
+                                 distance     = None,
 
-    # Two distinct paths here that are very similar, but different-enough to not
-    # share any code. If atinfinity, I ignore all translations
-    if not atinfinity:
-        return \
-            _projection_uncertainty(p_cam,
-                                    lensmodel, intrinsics_data,
-                                    extrinsics_rt_fromref, frames_rt_toref,
-                                    factorization, Jpacked, optimization_inputs,
-                                    istate_intrinsics, istate_extrinsics, istate_frames,
-                                    slice_optimized_intrinsics,
-                                    Nmeasurements_observations,
-                                    observed_pixel_uncertainty,
-                                    what)
+                                 # what we're reporting
+                                 what = 'worstdirection-stdev',
+                                 observed_pixel_uncertainty = None):
+    r'''Compute the projection uncertainty across the whole imager
+
+SYNOPSIS
+
+    model = mrcal.cameramodel("xxx.cameramodel")
+
+    stdev = mrcal.projection_uncertainty_grid(model,
+                                              gridn_width  = 60,
+                                              gridn_height = 40,
+                                              distance     = 10.)
+
+    print(stdev.shape)
+    ===> (40, 60)
+
+    # stdev[i,j] is the worst-direction standard deviation of the projection of
+    # a point 10m out, observed at pixel
+    # mrcal.sample_imager(60,40,*model.imagersize())[i,j]
+
+This computes the same thing as
+
+    q     = mrcal.sample_imager(gridn_width, gridn_height, *model.imagersize())
+    pcam  = mrcal.unproject(q, *model.intrinsics(), normalize = True)
+    stdev = mrcal.projection_uncertainty(pcam * (distance if distance is not None else 1.0),
+                                         model      = model,
+                                         atinfinity = distance is None,
+                                         what       = what)
+
+but much more efficiently. This is what mrcal.show_projection_uncertainty() and
+the mrcal-show-projection-uncertainty tool use.
+
+projection_uncertainty() computes the gradient of each projection in respect to
+the full calibration state, and propagates the calibration-time noise to each
+projection separately. Here we instead note that these gradients are affine in
+the observed point, and that only a few intrinsics affect each projection. So
+the calibration-time noise is propagated just once, to a small set of
+quantities that don't depend on the point, and each pixel then costs only a few
+small dense operations. These are done in C, split across all the available
+cores. See the docs for mrcal_projection_uncertainty_grid() in mrcal.h for
+details.
+
+ARGUMENTS
+
+- model: a mrcal.cameramodel object that contains optimization_inputs, which are
+  used to propagate the uncertainty
+
+- gridn_width: optional integer, defaulting to 60. How many points along the
+  horizontal gridding dimension
+
+- gridn_height: optional integer, defaulting to None. How many points along the
+  vertical gridding dimension. If None, we compute an integer gridn_height to
+  maintain a square-ish grid: gridn_height/gridn_width ~ imager_height/imager_width
+
+- distance: optional value, defaulting to None. The projection uncertainty
+  varies depending on the range to the observed point, with the queried range
+  set in this 'distance' argument. If None, we look out to infinity, as with
+  mrcal.projection_uncertainty(atinfinity = True)
+
+- what: optional string, defaulting to 'worstdirection-stdev'. This chooses what
+  kind of output we want. Known options are:
+
+  - 'worstdirection-stdev': return the worst-direction standard deviation at
+                            each pixel
+  - 'rms-stdev':            return the RMS of the worst and best direction
+                            standard deviations
+
+- observed_pixel_uncertainty: optional value, defaulting to None. The
+  uncertainty of the observed chessboard corners being propagated through the
+  solve and projection. If omitted or None, this input uncertainty is inferred
+  from the residuals at the optimum. Most people should omit this
+
+RETURNED VALUE
+
+A numpy array of shape (gridn_height,gridn_width) containing the requested
+uncertainties
+
+    '''
+
+    what_known = set(('worstdirection-stdev', 'rms-stdev'))
+    if not what in what_known:
+        raise Exception(f"'what' kwarg must be in {what_known}, but got '{what}'")
+
+    W,H = model.imagersize()
+    if gridn_height is None:
+        gridn_height = int(round(H/W*gridn_width))
+
+    setup = _projection_uncertainty_setup(model, observed_pixel_uncertainty)
+
+    intrinsics_data = setup['intrinsics_data']
+    if setup['istate_intrinsics'] is None:
+        icol0_intrinsics  = 0
+        Nintrinsics_state = 0
     else:
-        return \
-            _projection_uncertainty_rotationonly(p_cam,
-                                                 lensmodel, intrinsics_data,
-                                                 extrinsics_rt_fromref, frames_rt_toref,
-                                                 factorization, Jpacked, optimization_inputs,
-                                                 istate_intrinsics, istate_extrinsics, istate_frames,
-                                                 slice_optimized_intrinsics,
-                                                 Nmeasurements_observations,
-                                                 observed_pixel_uncertainty,
-                                                 what)
+        icol0_intrinsics,i1,_ = \
+            setup['slice_optimized_intrinsics'].indices(len(intrinsics_data))
+        Nintrinsics_state = i1 - icol0_intrinsics
+
+    dbasis_dppacked = \
+        _projection_uncertainty_grid_basis(setup['extrinsics_rt_fromref'],
+                                           setup['frames_rt_toref'],
+                                           setup['Jpacked'],
+                                           setup['optimization_inputs'],
+                                           setup['istate_intrinsics'],
+                                           setup['istate_extrinsics'],
+                                           setup['istate_frames'],
+                                           Nintrinsics_state,
+                                           atinfinity = distance is None)
+    Var_basis = \
+        _propagate_calibration_uncertainty( dbasis_dppacked,
+                                            setup['factorization'], setup['Jpacked'],
+                                            setup['Nmeasurements_observations'],
+                                            setup['observed_pixel_uncertainty'],
+                                            'covariance')
+
+    return mrcal._mrcal._projection_uncertainty_grid(setup['lensmodel'], intrinsics_data,
+                                                     (int(W),int(H)),
+                                                     gridn_width, gridn_height,
+                                                     distance if distance is not None else 1.0,
+                                                     Var_basis,
+                                                     atinfinity        = distance is None,
+                                                     rt_cam_ref        = setup['extrinsics_rt_fromref'],
+                                                     icol0_intrinsics  = icol0_intrinsics,
+                                                     Nintrinsics_state = Nintrinsics_state,
+                                                     rms               = what == 'rms-stdev')
 
 
 def projection_diff(models,
@@ -13,6 +13,9 @@ mrcal.poseutils.fff() or mrcal.fff(). The latter is preferred.
 
 import numpy as np
 import numpysane as nps
+import os
+import threading
+import concurrent.futures
 
 # for python3
 from functools import reduce
@@ -20,6 +23,169 @@ from functools import reduce
 from . import _poseutils_npsp
 from . import _poseutils_scipy
 
+# The number of threads used to evaluate large broadcasted arrays. <= 0 means
+# "as many as there are cores". Set with mrcal.set_broadcast_Nthreads()
+_broadcast_Nthreads = 0
+
+# The thread pool used to evaluate large broadcasted arrays, created when first
+# needed
+_broadcast_pool      = None
+_broadcast_pool_lock = threading.Lock()
+
+# Broadcasting over fewer than this many points is done in the calling thread.
+# Below this size, the thread-pool overhead costs more than it saves
+_broadcast_parallel_Npoints_min = 20000
+
+def set_broadcast_Nthreads(Nthreads):
+    r'''Set the number of threads used to evaluate large broadcasted arrays
+
+SYNOPSIS
+
+    mrcal.set_broadcast_Nthreads(4)
+
+    # Uses up to 4 cores
+    p = mrcal.transform_point_rt(rt, points)
+
+Many of the poseutils and triangulation functions broadcast over large arrays of
+points: transform_point_rt(), compose_rt(), triangulate_leecivera_mid2() and
+others. If no gradients are requested, and the array is large, the outermost
+broadcasted dimension is split into chunks, and these are evaluated
+concurrently, in a pool of threads, with the GIL released. Small arrays are
+evaluated on the calling thread. The results are the same either way.
+
+This function sets the number of threads in that pool. By default we use as
+many threads as there are cores. Setting Nthreads = 1 turns this off: all the
+evaluation then happens on the calling thread.
+
+The functions that use this are
+
+- rotate_point_R(), rotate_point_r()
+- transform_point_Rt(), transform_point_rt()
+- compose_Rt(), compose_rt(), when composing exactly two transformations
+- triangulate_geometric(), triangulate_lindstrom(),
+  triangulate_leecivera_...()
+
+ARGUMENTS
+
+- Nthreads: the number of threads. If <= 0 or None, we use as many threads as
+  there are cores
+
+RETURNED VALUE
+
+None
+
+    '''
+
+    global _broadcast_Nthreads, _broadcast_pool
+    if Nthreads is None:
+        Nthreads = 0
+    with _broadcast_pool_lock:
+        _broadcast_Nthreads = int(Nthreads)
+        if _broadcast_pool is not None:
+            _broadcast_pool.shutdown()
+            _broadcast_pool = None
+
+
+def _parallel_chunks(process, Npoints):
+    r'''Calls process(i0,i1) for chunks of range(Npoints), maybe in parallel
+
+    If Npoints is large, we split range(Npoints) into one contiguous chunk per
+    thread, and process these in the broadcast thread pool. Otherwise, we call
+    process(0,Npoints) on the calling thread. process() must release the GIL
+    for the parallelism to help
+
+    NOT A PART OF THE EXTERNAL API
+
+    '''
+    global _broadcast_pool
+
+    with _broadcast_pool_lock:
+        Nthreads = _broadcast_Nthreads
+        if Nthreads <= 0:
+            Nthreads = os.cpu_count() or 1
+
+        # Each chunk has at least _broadcast_parallel_Npoints_min/2 points
+        Nchunks = min(Nthreads,
+                      Npoints // (_broadcast_parallel_Npoints_min // 2))
+        if Nchunks <= 1:
+            pool = None
+        else:
+            if _broadcast_pool is None:
+                _broadcast_pool = \
+                    concurrent.futures.ThreadPoolExecutor(max_workers = Nthreads)
+            pool = _broadcast_pool
+
+    if pool is None:
+        process(0, Npoints)
+        return
+
+    i = np.linspace(0, Npoints, Nchunks+1).astype(int)
+    # Evaluate all the chunks. list() waits for them, and re-raises any
+    # exceptions
+    list(pool.map(process, i[:-1], i[1:]))
+
+
+def _broadcast_parallel(f, f_nogil, args, Ndims_core, shape_output, out,
+                        **kwargs):
+    r'''Evaluates a no-gradients poseutils function, in parallel if large
+
+    f is the _poseutils_npsp function that evaluates one point per slice, and
+    f_nogil is the corresponding function that evaluates an (N,...) block of
+    points per slice, releasing the GIL. args are the inputs. Ndims_core are the
+    number of non-broadcasted dimensions of each input. shape_output is the
+    shape of each output slice. kwargs are passed through to f, f_nogil
+
+    Small arrays are evaluated with f, as before. Large arrays are flattened to
+    (N,...) arrays, without copying the broadcasted inputs, split into chunks,
+    and evaluated in the broadcast thread pool with f_nogil. Anything f_nogil
+    doesn't support (non-float64 data, a mis-shapen "out", ...) goes to f,
+    which reports the errors
+
+    NOT A PART OF THE EXTERNAL API
+
+    '''
+
+    def serial():
+        return f(*args, out=out, **kwargs)
+
+    if not all(isinstance(a, np.ndarray) and \
+               a.dtype == np.float64     and \
+               a.ndim >= n
+               for a,n in zip(args,Ndims_core)):
+        return serial()
+    try:
+        shape = np.broadcast_shapes(*[a.shape[:a.ndim-n] \
+                                      for a,n in zip(args,Ndims_core)])
+    except ValueError:
+        return serial()
+    Npoints = int(np.prod(shape))
+    if Npoints < _broadcast_parallel_Npoints_min:
+        return serial()
+    if out is not None and \
+       not (isinstance(out, np.ndarray) and \
+            out.dtype == np.float64     and \
+            out.shape == shape + shape_output):
+        return serial()
+
+    # Broadcasted inputs have 0 strides, and these reshapes don't copy them
+    args = [ np.broadcast_to(a, shape + a.shape[a.ndim-n:]). \
+             reshape((Npoints,) + a.shape[a.ndim-n:]) \
+             for a,n in zip(args,Ndims_core) ]
+    y = np.empty((Npoints,) + shape_output, dtype=float)
+
+    def process(i0, i1):
+        f_nogil(*[a[i0:i1] for a in args],
+                out = y[i0:i1],
+                **kwargs)
+    _parallel_chunks(process, Npoints)
+
+    y = y.reshape(shape + shape_output)
+    if out is None:
+        return y
+    out[...] = y
+    return out
+
+
 def r_from_R(R, get_gradients=False, out=None):
     r"""Compute a Rodrigues vector from a rotation matrix
 
@@ -585,6 +751,11 @@ RETURNED VALUE
 An array of composed Rt transformations. Each broadcasted slice has shape (4,3)
 
     """
+    if len(Rt) == 2:
+        return _broadcast_parallel(_poseutils_npsp._compose_Rt,
+                                   _poseutils_npsp._compose_Rt_nogil,
+                                   Rt, (2,2), (4,3), out)
+
     Rt1onwards = reduce( _poseutils_npsp._compose_Rt, Rt[1:], _poseutils_npsp.identity_Rt() )
     return _poseutils_npsp._compose_Rt(Rt[0], Rt1onwards, out=out)
 
@@ -707,6 +878,11 @@ drt/drt0,drt/drt1):
             raise Exception("compose_rt(..., get_gradients=True) is supported only if exactly 2 inputs are given")
         return _poseutils_npsp._compose_rt_withgrad(*rt, out=out)
 
+    if len(rt) == 2:
+        return _broadcast_parallel(_poseutils_npsp._compose_rt,
+                                   _poseutils_npsp._compose_rt_nogil,
+                                   rt, (1,1), (6,), out)
+
     # I convert them all to Rt and compose for efficiency. Otherwise each
     # internal composition will convert to Rt, compose, and then convert back to
     # rt. The way I'm doing it I convert to rt just once, at the end. This will
@@ -803,7 +979,10 @@ A tuple (u=r(x),du/dr,du/dx):
 
     """
     if not get_gradients:
-        return _poseutils_npsp._rotate_point_r(r,x, out=out, inverted=inverted)
+        return _broadcast_parallel(_poseutils_npsp._rotate_point_r,
+                                   _poseutils_npsp._rotate_point_r_nogil,
+                                   (r,x), (1,1), (3,), out,
+                                   inverted = inverted)
     return _poseutils_npsp._rotate_point_r_withgrad(r,x, out=out, inverted=inverted)
 
 def rotate_point_R(R, x, get_gradients=False, out=None, inverted=False):
@@ -895,7 +1074,10 @@ the gradients (u=R(x),du/dR,du/dx):
     """
 
     if not get_gradients:
-        return _poseutils_npsp._rotate_point_R(R,x, out=out, inverted=inverted)
+        return _broadcast_parallel(_poseutils_npsp._rotate_point_R,
+                                   _poseutils_npsp._rotate_point_R_nogil,
+                                   (R,x), (2,1), (3,), out,
+                                   inverted = inverted)
     return _poseutils_npsp._rotate_point_R_withgrad(R,x, out=out, inverted=inverted)
 
 def transform_point_rt(rt, x, get_gradients=False, out=None, inverted=False):
@@ -992,7 +1174,10 @@ gradients (u=rt(x),du/drt,du/dx):
     """
 
     if not get_gradients:
-        return _poseutils_npsp._transform_point_rt(rt,x, out=out, inverted=inverted)
+        return _broadcast_parallel(_poseutils_npsp._transform_point_rt,
+                                   _poseutils_npsp._transform_point_rt_nogil,
+                                   (rt,x), (1,1), (3,), out,
+                                   inverted = inverted)
     return _poseutils_npsp._transform_point_rt_withgrad(rt,x, out=out, inverted=inverted)
 
 def transform_point_Rt(Rt, x, get_gradients=False, out=None, inverted=False):
@@ -1090,7 +1275,10 @@ gradients (u=Rt(x),du/dRt,du/dx):
     """
 
     if not get_gradients:
-        return _poseutils_npsp._transform_point_Rt(Rt,x, out=out, inverted=inverted)
+        return _broadcast_parallel(_poseutils_npsp._transform_point_Rt,
+                                   _poseutils_npsp._transform_point_Rt_nogil,
+                                   (Rt,x), (2,1), (3,), out,
+                                   inverted = inverted)
     return _poseutils_npsp._transform_point_Rt_withgrad(Rt,x, out=out, inverted=inverted)
 
 
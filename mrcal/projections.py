@@ -96,6 +96,34 @@ if get_gradients: we return a tuple:
     # Internal function must have a different argument order so
     # that all the broadcasting stuff is in the leading arguments
     if not get_gradients:
+
+        def strides_positive(x):
+            return all(stride > 0 for n,stride in zip(x.shape,x.strides) if n > 1)
+
+        # CAHVORE projection has an iterative solve in it, and is relatively
+        # slow. If the intrinsics are shared by all the points, I project each
+        # set of points in one C call. That call reads and writes the arrays
+        # with their strides, which must be positive. So I copy reversed or
+        # broadcasted points, and use the generic path if the output isn't
+        # compatible
+        if lensmodel.startswith('LENSMODEL_CAHVORE') and \
+           np.ndim(intrinsics_data) == 1 and \
+           (out is None or strides_positive(out)):
+            v = np.asarray(v)
+            if not strides_positive(v):
+                v = np.ascontiguousarray(v)
+            if v.ndim == 1:
+                if out is not None:
+                    mrcal._mrcal_npsp._project_cahvore(v[np.newaxis,:],
+                                                       intrinsics_data,
+                                                       lensmodel=lensmodel,
+                                                       out=out[np.newaxis,:])
+                    return out
+                return mrcal._mrcal_npsp._project_cahvore(v[np.newaxis,:],
+                                                          intrinsics_data,
+                                                          lensmodel=lensmodel)[0]
+            return mrcal._mrcal_npsp._project_cahvore(v, intrinsics_data, lensmodel=lensmodel, out=out)
+
         return mrcal._mrcal_npsp._project(v, intrinsics_data, lensmodel=lensmodel, out=out)
     return mrcal._mrcal_npsp._project_withgrad(v, intrinsics_data, lensmodel=lensmodel, out=out)
 
@@ -528,8 +528,43 @@ rectified direction
         raise Exception("The two rectified models MUST have a translation ONLY in the +x rectified direction")
 
 
+def _validate_range_lut(range_lut, models_rectified, disparity_scale):
+    r'''Internal function to validate a range LUT
+
+The LUT should have been returned by stereo_range_lut() for these
+models_rectified and disparity_scale. The LUT doesn't store these, so I compute
+the range for the largest disparity in the table, and compare it to the table
+entry. At the principal point of a pinhole system the LUT contains the range
+itself. A LENSMODEL_LATLON LUT contains the range for each column
+
+    '''
+
+    lensmodel,intrinsics_data = models_rectified[0].intrinsics()
+    if lensmodel == 'LENSMODEL_LATLON':
+        Naz = models_rectified[0].imagersize()[0]
+        if range_lut.ndim != 2 or range_lut.shape[1] != Naz:
+            raise Exception(f"A LENSMODEL_LATLON range_lut must have shape (Ndisparities,{Naz}). Got {range_lut.shape}")
+        qrect0 = np.array((0., 0.))
+        r_lut  = range_lut[-1,0]
+    else:
+        if range_lut.ndim != 1:
+            raise Exception(f"A LENSMODEL_PINHOLE range_lut must have shape (Ndisparities,). Got {range_lut.shape}")
+        qrect0 = intrinsics_data[2:4]
+        r_lut  = range_lut[-1]
+
+    d = range_lut.shape[0] - 1
+    if d <= 0:
+        return
+    r = stereo_range(float(d), models_rectified,
+                     disparity_scale = disparity_scale,
+                     qrect0          = qrect0)
+    if not np.isclose(r_lut, r, rtol = 1e-3, atol = 0):
+        raise Exception(f"The range_lut doesn't match the given disparity_scale={disparity_scale} and models_rectified. It must come from mrcal.stereo_range_lut() with the same arguments")
+
+
 def rectification_maps(models,
-                       models_rectified):
+                       models_rectified,
+                       approximation_max_error = None):
 
     r'''Construct image transformation maps to make rectified images
 
@@ -615,60 +650,97 @@ ARGUMENTS
 - models_rectified: the pair of rectified models, corresponding to the input
   images. Usually this is returned by mrcal.rectified_system()
 
+- approximation_max_error: optional value, defaulting to None. By default the
+  maps are computed exactly. If given, we evaluate the maps exactly on a coarse
+  grid only, and interpolate bicubically, refining the grid until the
+  interpolation error is at most approximation_max_error pixels. This error is
+  estimated on a sample grid, so the true worst-case error may be somewhat
+  larger. See the docstring for mrcal.image_transformation_map() for details
+
+If a map cache directory has been configured with
+mrcal.set_map_cache_directory(), the maps are read from the cache, if they're
+there, and written to the cache, if they aren't.
+
 RETURNED VALUES
 
-We return a length-2 tuple of numpy arrays containing transformation maps for
-each camera. Each map can be used to mrcal.transform_image() images into
-rectified space. Each array contains 32-bit floats (as expected by
-mrcal.transform_image() and cv2.remap()). Each array has shape (Nel,Naz,2),
-where (Nel,Naz) is the shape of each rectified image. Each shape-(2,) row
-contains corresponding pixel coordinates in the input image
+if approximation_max_error is None: we return a length-2 tuple of numpy arrays
+containing transformation maps for each camera. Each map can be used to
+mrcal.transform_image() images into rectified space. Each array contains 32-bit
+floats (as expected by mrcal.transform_image() and cv2.remap()). Each array has
+shape (Nel,Naz,2), where (Nel,Naz) is the shape of each rectified image. Each
+shape-(2,) row contains corresponding pixel coordinates in the input image
+
+if approximation_max_error is not None: we return a tuple
+
+- the length-2 tuple of maps, as described above
+
+- approximation_error: the worst interpolation error we observed on the sample
+  grid in either map, in pixels. This is at most approximation_max_error
 
     '''
 
     _validate_models_rectified(models_rectified)
 
+    image_transforms = mrcal.image_transforms
+    if image_transforms._map_cache_directory is not None:
+        key = image_transforms._map_cache_key('rectification_maps',
+                                              (*models, *models_rectified),
+                                              approximation_max_error)
+        cached = image_transforms._map_cache_read(key)
+        if cached is not None:
+            # Both maps are stored in one array of shape (2,Nel,Naz,2)
+            maps,approximation_error = cached
+            if approximation_max_error is not None:
+                return (maps[0],maps[1]), approximation_error
+            return maps[0],maps[1]
+
     Naz,Nel = models_rectified[0].imagersize()
-    fxycxy  = models_rectified[0].intrinsics()[1]
 
     R_cam_rect = [ nps.matmult(models          [i].extrinsics_Rt_fromref()[:3,:],
                                models_rectified[i].extrinsics_Rt_toref  ()[:3,:]) \
                    for i in range(2) ]
 
-    # This is massively inefficient. I should
-    #
-    # - Not generate any intermediate ARRAYS, but loop through each pixel, and
-    #   perform the full transformation on each pixel. All the way through the
-    #   project(v0, ...) below
-    #
-    # - Not compute full sin/cos separately for each pixel, but take advantage
-    #   of my even angle steps to compute the sin/cos once, and take
-    #   multiplication/addition steps from there
+    if approximation_max_error is not None:
 
-    # shape (Nel,Naz,3)
-    if models_rectified[0].intrinsics()[0] == 'LENSMODEL_LATLON':
-        unproject = mrcal.unproject_latlon
-    else:
-        unproject = mrcal.unproject_pinhole
+        lensmodel_rectified,intrinsics_rectified = models_rectified[0].intrinsics()
+
+        def mapxy_exact(q, i):
+            v = mrcal.unproject(q, lensmodel_rectified, intrinsics_rectified)
+            return mrcal.project(nps.matmult(v, nps.transpose(R_cam_rect[i])),
+                                 *models[i].intrinsics())
 
-    v = unproject( np.ascontiguousarray( \
-           nps.mv( nps.cat( *np.meshgrid(np.arange(Naz,dtype=float),
-                                         np.arange(Nel,dtype=float))),
-                   0, -1)),
-                   fxycxy)
+        maps_errors = \
+            [ mrcal.image_transforms. \
+                _approximate_transformation_map(lambda q: mapxy_exact(q,i),
+                                                Naz, Nel,
+                                                approximation_max_error) \
+              for i in range(2) ]
+        maps = tuple(mapxy.astype(np.float32) for mapxy,_ in maps_errors)
+        approximation_error = max(e for _,e in maps_errors)
 
-    v0 = mrcal.rotate_point_R(R_cam_rect[0], v)
-    v1 = mrcal.rotate_point_R(R_cam_rect[1], v)
+        if image_transforms._map_cache_directory is not None:
+            image_transforms._map_cache_write(key, nps.cat(*maps),
+                                              approximation_error)
+        return maps, approximation_error
 
-    return                                                                \
-        (mrcal.project( v0, *models[0].intrinsics()).astype(np.float32),  \
-         mrcal.project( v1, *models[1].intrinsics()).astype(np.float32))
+    # The maps are computed in C, one row at a time, split across all the
+    # cores. No intermediate arrays are created
+    maps = \
+        mrcal._mrcal._rectification_maps(*models[0].intrinsics(), R_cam_rect[0],
+                                         *models[1].intrinsics(), R_cam_rect[1],
+                                         *models_rectified[0].intrinsics(),
+                                         (Naz,Nel))
+
+    if image_transforms._map_cache_directory is not None:
+        image_transforms._map_cache_write(key, nps.cat(*maps))
+    return maps
 
 
 def stereo_range(disparity,
                  models_rectified,
                  disparity_scale = 1,
-                 qrect0          = None):
+                 qrect0          = None,
+                 range_lut       = None):
 
     r'''Compute ranges from observed disparities
 
@@ -879,16 +951,40 @@ ARGUMENTS
   be broadcasting-compatible with the disparity array. See the
   description above.
 
+- range_lut: optional lookup table returned by mrcal.stereo_range_lut(). If
+  given, the ranges are looked up in this table instead of being computed. This
+  is much faster, and is the preferred way to process a sequence of disparity
+  images from the same rectified system. The disparity argument must then be a
+  full disparity IMAGE of integers (qrect0 must be None), and the range_lut must
+  have been computed with the same models_rectified and disparity_scale. This is
+  checked: we raise an exception if the LUT doesn't match. Disparities outside
+  the range covered by the LUT are invalid
+
 RETURNED VALUES
 
 - An array of ranges of the same dimensionality as the input disparity
   array. Contains floating-point data. Invalid or missing ranges are represented
-  as 0.
+  as 0. If range_lut is given, this is a float32 array
 
     '''
 
     _validate_models_rectified(models_rectified)
 
+    if range_lut is not None:
+        if qrect0 is not None:
+            raise Exception("range_lut is given, so qrect0 must be None")
+        if not np.issubdtype(disparity.dtype, np.integer):
+            raise Exception("range_lut is given, so the disparity must contain integers")
+
+        W,H = models_rectified[0].imagersize()
+        if disparity.shape != (H,W):
+            raise Exception(f"range_lut is given, so the disparity image must have the full dimensions of a rectified image")
+
+        _validate_range_lut(range_lut, models_rectified, disparity_scale)
+
+        return mrcal._mrcal._stereo_range_from_lut(disparity, range_lut,
+                                                   *models_rectified[0].intrinsics())
+
     # I want to support scalar disparities. If one is given, I convert it into
     # an array of shape (1,), and then pull it out at the end
     is_scalar = False
@@ -964,6 +1060,311 @@ RETURNED VALUES
     return r
 
 
+def stereo_range_lut(models_rectified,
+                     disparity_max,
+                     disparity_scale = 1):
+
+    r'''Precompute a lookup table to convert disparities to ranges
+
+SYNOPSIS
+
+    models_rectified = \
+        mrcal.rectified_system(models,
+                               az_fov_deg = 120,
+                               el_fov_deg = 100)
+
+    # The OpenCV StereoSGBM matcher reports disparities in units of 1/16 pixels
+    range_lut = mrcal.stereo_range_lut(models_rectified,
+                                       disparity_max   = 160,
+                                       disparity_scale = 16)
+
+    for images in image_pairs:
+        ...
+        disparity16 = matcher.compute(*images_rectified)
+
+        ranges = mrcal.stereo_range( disparity16,
+                                     models_rectified,
+                                     disparity_scale = 16,
+                                     range_lut       = range_lut)
+
+mrcal.stereo_range() converts disparities to ranges. Computing the ranges of a
+full disparity image requires evaluating trigonometric functions at each pixel.
+But many stereo-matching algorithms produce integer disparities, in units of
+1/disparity_scale pixels. And the ranges are a function of the disparity and of
+the rectified pixel coordinates only. So when processing a sequence of disparity
+images from the same rectified system, it is much faster to precompute the
+ranges once, and to look them up in a table afterwards. This function computes
+this table. Pass it to mrcal.stereo_range(range_lut = ...) to use it.
+
+The layout of the table depends on the rectification model:
+
+- LENSMODEL_LATLON: the range is a function of the az column and of the
+  disparity only. The table has shape (Ndisparities,Naz)
+
+- LENSMODEL_PINHOLE: the range is the norm of the unprojected vector (a cheap
+  function of the az and el) scaled by a function of the disparity only. The
+  table has shape (Ndisparities,), and contains that function of the disparity
+
+The table covers disparities from 0 to disparity_max*disparity_scale, inclusive.
+As in mrcal.stereo_range(), disparities <= 0 are invalid, and produce ranges of
+0. Disparities > disparity_max*disparity_scale are invalid also.
+
+ARGUMENTS
+
+- models_rectified: the pair of rectified models, corresponding to the input
+  images. Usually this is returned by mrcal.rectified_system()
+
+- disparity_max: the largest disparity, in pixels, covered by the table
+
+- disparity_scale: optional scale factor for the disparities. If omitted, the
+  disparities are assumed to be in pixels. Otherwise they're in units of
+  1/disparity_scale pixels. The OpenCV StereoSGBM and StereoBM routines use 16
+
+RETURNED VALUE
+
+A numpy array of float32 values: the lookup table to pass to
+mrcal.stereo_range(range_lut = ...)
+
+    '''
+
+    _validate_models_rectified(models_rectified)
+
+    Rt01 = mrcal.compose_Rt( models_rectified[0].extrinsics_Rt_fromref(),
+                             models_rectified[1].extrinsics_Rt_toref())
+    baseline = nps.mag(Rt01[3,:])
+
+    Ndisparities = int(round(disparity_max*disparity_scale)) + 1
+    if Ndisparities > 32768:
+        raise Exception(f"The integer disparities must fit into an int16, so disparity_max*disparity_scale must be < 32768. Got {Ndisparities-1}")
+
+    return mrcal._mrcal._stereo_range_lut(*models_rectified[0].intrinsics(),
+                                          models_rectified[0].imagersize(),
+                                          baseline, disparity_scale,
+                                          Ndisparities)
+
+
+def stereo_point_cloud(disparity,
+                       models_rectified,
+                       range_lut,
+                       image        = None,
+                       Rt_out_rect0 = None,
+                       out          = None):
+
+    r'''Convert a disparity image to a point cloud
+
+SYNOPSIS
+
+    models_rectified = \
+        mrcal.rectified_system(models,
+                               az_fov_deg = 120,
+                               el_fov_deg = 100)
+    range_lut = mrcal.stereo_range_lut(models_rectified,
+                                       disparity_max   = 160,
+                                       disparity_scale = 16)
+
+    # Report the points in the reference coordinate system
+    Rt_ref_rect0 = models_rectified[0].extrinsics_Rt_toref()
+
+    for images in image_pairs:
+        ...
+        disparity16 = matcher.compute(*images_rectified)
+
+        # shape (Npoints,3) and (Npoints,3)
+        points, colors = \
+            mrcal.stereo_point_cloud( disparity16,
+                                      models_rectified,
+                                      range_lut,
+                                      image        = images_rectified[0],
+                                      Rt_out_rect0 = Rt_ref_rect0 )
+
+This is the last step of the stereo-processing sequence described in the
+docstring of mrcal.stereo_range(): we take a disparity image, and produce the
+point cloud it describes. Doing this with mrcal.stereo_range(),
+mrcal.unproject() and mrcal.transform_point_Rt() creates several full-size
+intermediate arrays for each image. This function instead makes a single pass
+through the disparity image in C, looking up each range in the given
+range_lut, and writing the points directly into the output. Pixels with
+invalid disparities are dropped. So this is the preferred way to generate point
+clouds at a high rate.
+
+The points are returned in the rectified camera-0 coordinate system by default.
+To get them in some other coordinate system, pass the transformation in
+Rt_out_rect0. For instance:
+
+- Camera-0 coordinates: Rt_out_rect0 = mrcal.compose_Rt(models[0].extrinsics_Rt_fromref(),
+                                                        models_rectified[0].extrinsics_Rt_toref())
+
+- Reference coordinates: Rt_out_rect0 = models_rectified[0].extrinsics_Rt_toref()
+
+If an image is given, the color of each valid pixel in this rectified camera-0
+image is reported also.
+
+ARGUMENTS
+
+- disparity: the disparity IMAGE: an array of integers with shape (Nel,Naz) of
+  a rectified image. The units of these disparities are given by the
+  disparity_scale that was passed to mrcal.stereo_range_lut()
+
+- models_rectified: the pair of rectified models, corresponding to the input
+  images. Usually this is returned by mrcal.rectified_system()
+
+- range_lut: the lookup table returned by mrcal.stereo_range_lut(). Required
+
+- image: optional rectified camera-0 image of uint8 data with shape (Nel,Naz) or
+  (Nel,Naz,3). If given, the colors of the valid points are returned
+
+- Rt_out_rect0: optional (4,3) array transforming points from the rectified
+  camera-0 coordinate system to the output coordinate system. If omitted, the
+  points are reported in the rectified camera-0 coordinate system
+
+- out: optional preallocated float32 array of shape (N,3) with N >= Nel*Naz. If
+  given, the points are written into this array. The whole array is used as
+  scratch space. This is useful when processing a sequence of images, to avoid
+  reallocating the buffer for each one
+
+RETURNED VALUES
+
+If no image is given: an array of shape (Npoints,3) containing float32 points.
+These are in the row-major order of the pixels in the disparity image. If "out"
+was given, this is a view into its first Npoints rows
+
+If an image is given, we return a tuple
+
+- The points, as above
+
+- The colors of each point: a uint8 array of shape (Npoints,) for grayscale
+  images or (Npoints,3) for color images
+
+    '''
+
+    _validate_models_rectified(models_rectified)
+
+    if not np.issubdtype(disparity.dtype, np.integer):
+        raise Exception("The disparity must contain integers")
+    W,H = models_rectified[0].imagersize()
+    if disparity.shape != (H,W):
+        raise Exception(f"The disparity image must have the full dimensions of a rectified image")
+
+    points,colors = \
+        mrcal._mrcal._stereo_point_cloud(disparity, range_lut,
+                                         *models_rectified[0].intrinsics(),
+                                         image        = image,
+                                         Rt_out_rect0 = Rt_out_rect0,
+                                         out          = out)
+    if image is None:
+        return points
+    if image.ndim == 2:
+        colors = colors[:,0]
+    return points, colors
+
+
+def stereo_sgm(image0, image1,
+               *,
+               disparity_min    = 0,
+               Ndisparities     = 64,
+               P1               = 7,
+               P2               = 100,
+               Npaths           = 8,
+               uniqueness_ratio = 10,
+               disp12_max_diff  = 1):
+
+    r'''Compute a disparity image using the native semi-global matcher
+
+SYNOPSIS
+
+    models_rectified = \
+        mrcal.rectified_system(models,
+                               az_fov_deg = 120,
+                               el_fov_deg = 100)
+
+    rectification_maps = mrcal.rectification_maps(models, models_rectified)
+
+    images_rectified = [mrcal.transform_image(images[i], rectification_maps[i]) \
+                        for i in range(2)]
+
+    disparity16 = mrcal.stereo_sgm(*images_rectified,
+                                   Ndisparities = 128)
+
+    ranges = mrcal.stereo_range( disparity16,
+                                 models_rectified,
+                                 disparity_scale = 16 )
+
+This is a self-contained semi-global stereo matcher (Hirschmuller's SGM),
+implemented in C, and not requiring OpenCV. It is meant to be used with the
+rectified images produced by mrcal.rectification_maps(): the epipolar lines are
+the rows of the images, and a feature at column x in image0 appears at column
+x-disparity in image1. It works well with both LENSMODEL_PINHOLE and
+LENSMODEL_LATLON rectification, but LENSMODEL_LATLON is recommended for wide
+lenses: the disparities are then more uniform across the image.
+
+The matching cost is the Hamming distance between 5x5 census transforms of the
+two images. The costs are aggregated along Npaths directions, with a penalty of
+P1 for a disparity change of 1 pixel between neighbors, and P2 for larger
+changes. The winning disparity is refined to subpixel precision with a parabola
+fit, and then validated with a uniqueness test and a left-right consistency
+check. All the available cores are used.
+
+The output follows the conventions of the OpenCV StereoSGBM matcher: the
+disparities are int16 values in units of 1/16 pixels, with invalid pixels
+marked with a value of -1. So the result can be passed directly to
+mrcal.stereo_range() or mrcal.stereo_point_cloud() with disparity_scale=16, and
+a lookup table from mrcal.stereo_range_lut(disparity_scale = 16) covering
+disparity_max = disparity_min + Ndisparities may be used.
+
+ARGUMENTS
+
+- image0, image1: the rectified images. These must have the same dimensions.
+  Grayscale (2-dimensional) or BGR color (3-dimensional, with 3 channels) uint8
+  images are accepted. Color images are converted to grayscale before matching
+
+- disparity_min: optional smallest disparity to search, in pixels. Defaults to 0
+
+- Ndisparities: optional number of disparities to search, in pixels. Disparities
+  disparity_min..disparity_min+Ndisparities-1 are considered. Defaults to 64
+
+- P1: optional penalty for a disparity change of 1 pixel between neighboring
+  pixels. Defaults to 7
+
+- P2: optional penalty for a disparity change of more than 1 pixel between
+  neighboring pixels. Must be larger than P1. Defaults to 100
+
+- Npaths: optional number of aggregation directions. Must be 4 (horizontal and
+  vertical only) or 8 (diagonals also). Defaults to 8
+
+- uniqueness_ratio: optional uniqueness margin, in percent. A match is rejected
+  if another disparity (not adjacent to the winning one) has a cost within this
+  margin of the winning cost. Defaults to 10
+
+- disp12_max_diff: optional largest allowed difference, in pixels, in the
+  left-right consistency check. If < 0, the check is disabled. Defaults to 1
+
+RETURNED VALUE
+
+A numpy array of int16 disparities, in units of 1/16 pixels, with the same
+dimensions as the input images. Invalid pixels have a value of -1
+
+    '''
+
+    def grayscale(image):
+        if image.ndim == 3 and image.shape[-1] == 3:
+            # BGR, as produced by cv2.imread() and mrcal.load_image()
+            image = nps.inner(image.astype(np.float32),
+                              np.array((0.114, 0.587, 0.299), dtype=np.float32))
+            return (image + 0.5).astype(np.uint8)
+        if image.ndim != 2:
+            raise Exception(f"The images must be grayscale or 3-channel color. Got shape {image.shape}")
+        return image
+
+    return mrcal._mrcal._stereo_sgm(grayscale(image0), grayscale(image1),
+                                    disparity_min    = disparity_min,
+                                    Ndisparities     = Ndisparities,
+                                    P1               = P1,
+                                    P2               = P2,
+                                    Npaths           = Npaths,
+                                    uniqueness_ratio = uniqueness_ratio,
+                                    disp12_max_diff  = disp12_max_diff)
+
+
 def match_feature( image0, image1,
                    q0,
                    search_radius1,
@@ -50,6 +50,71 @@ def _parse_args(v1,
     return v1, t01
 
 
+# Below this many points, the no-gradients triangulation functions call the
+# per-point routines: rearranging the data for the batched routines costs more
+# than it saves
+_triangulate_batch_Npoints_min = 64
+
+def _triangulate_nograd(what, v0, v1, x, out):
+    r'''Triangulate without gradients: per-point, or in one batch
+
+    what is the name of the method: "geometric", "lindstrom", ... x is t01 or,
+    for Lindstrom, Rt01. The arguments broadcast as they do in
+    mrcal._triangulation_npsp._triangulate_{what}(). Large arrays of points are
+    triangulated with the batched routines, which compute several points at a
+    time in SIMD lanes. These take the data in the SoA layout, so I rearrange
+    it here
+
+    '''
+    v0 = np.asarray(v0)
+    v1 = np.asarray(v1)
+    x  = np.asarray(x)
+
+    # t01 has shape (3,), Rt01 has shape (4,3)
+    shape_x = (4,3) if what == 'lindstrom' else (3,)
+
+    def per_point():
+        return getattr(mrcal._triangulation_npsp, f"_triangulate_{what}")(v0, v1, x, out=out)
+
+    # Small or invalid input. The per-point routine handles it, and reports any
+    # errors
+    if v0.shape[-1:] != (3,) or v1.shape[-1:] != (3,) or \
+       x.shape[x.ndim-len(shape_x):] != shape_x:
+        return per_point()
+    try:
+        shape = np.broadcast_shapes(v0.shape[:-1], v1.shape[:-1],
+                                    x.shape[:x.ndim-len(shape_x)])
+    except ValueError:
+        return per_point()
+    Npoints = int(np.prod(shape))
+    if Npoints < _triangulate_batch_Npoints_min:
+        return per_point()
+
+    # Broadcasted inputs have 0 strides, and these reshapes don't copy them
+    args = [ np.broadcast_to(a, shape + shape_core).reshape(Npoints, -1) \
+             for a,shape_core in ((v0,(3,)), (v1,(3,)), (x,shape_x)) ]
+
+    f_batch = getattr(mrcal._triangulation_npsp, f"_triangulate_{what}_batch")
+    p = np.empty((Npoints,3), dtype=float)
+
+    def process(i0, i1):
+        # (Npoints,Nvars) -> (Nvars,Npoints) for each input
+        args_soa = [np.ascontiguousarray(nps.transpose(a[i0:i1]),
+                                         dtype = float) \
+                    for a in args]
+        p[i0:i1] = nps.transpose(f_batch(*args_soa))
+
+    # Large arrays are split into chunks, triangulated concurrently. The batched
+    # routines release the GIL
+    mrcal.poseutils._parallel_chunks(process, Npoints)
+
+    p = p.reshape(shape + (3,))
+    if out is None:
+        return p
+    out[...] = p
+    return out
+
+
 def triangulate_geometric(v0, v1,
                           t01           = None,
                           get_gradients = False,
@@ -190,7 +255,7 @@ if get_gradients: we return a tuple:
                           get_gradients, v_are_local, Rt01)
 
     if not get_gradients:
-        return mrcal._triangulation_npsp._triangulate_geometric(v0, v1, t01, out=out)
+        return _triangulate_nograd('geometric', v0, v1, t01, out)
     else:
         return mrcal._triangulation_npsp._triangulate_geometric_withgrad(v0, v1, t01, out=out)
 
@@ -340,7 +405,7 @@ if get_gradients: we return a tuple:
                           get_gradients, v_are_local, Rt01)
 
     if not get_gradients:
-        return mrcal._triangulation_npsp._triangulate_leecivera_l1(v0, v1, t01, out=out)
+        return _triangulate_nograd('leecivera_l1', v0, v1, t01, out)
     else:
         return mrcal._triangulation_npsp._triangulate_leecivera_l1_withgrad(v0, v1, t01, out=out)
 
@@ -491,7 +556,7 @@ if get_gradients: we return a tuple:
                           get_gradients, v_are_local, Rt01)
 
     if not get_gradients:
-        return mrcal._triangulation_npsp._triangulate_leecivera_linf(v0, v1, t01, out=out)
+        return _triangulate_nograd('leecivera_linf', v0, v1, t01, out)
     else:
         return mrcal._triangulation_npsp._triangulate_leecivera_linf_withgrad(v0, v1, t01, out=out)
 
@@ -637,7 +702,7 @@ if get_gradients: we return a tuple:
                           get_gradients, v_are_local, Rt01)
 
     if not get_gradients:
-        return mrcal._triangulation_npsp._triangulate_leecivera_mid2(v0, v1, t01, out=out)
+        return _triangulate_nograd('leecivera_mid2', v0, v1, t01, out)
     else:
         return mrcal._triangulation_npsp._triangulate_leecivera_mid2_withgrad(v0, v1, t01, out=out)
 
@@ -783,7 +848,7 @@ if get_gradients: we return a tuple:
                           get_gradients, v_are_local, Rt01)
 
     if not get_gradients:
-        return mrcal._triangulation_npsp._triangulate_leecivera_wmid2(v0, v1, t01, out=out)
+        return _triangulate_nograd('leecivera_wmid2', v0, v1, t01, out)
     else:
         return mrcal._triangulation_npsp._triangulate_leecivera_wmid2_withgrad(v0, v1, t01, out=out)
 
@@ -938,7 +1003,7 @@ if get_gradients: we return a tuple:
         v1 = mrcal.rotate_point_R(nps.transpose(Rt01[:3,:]), v1)
 
     if not get_gradients:
-        return mrcal._triangulation_npsp._triangulate_lindstrom(v0, v1, Rt01, out=out)
+        return _triangulate_nograd('lindstrom', v0, v1, Rt01, out)
     else:
         return mrcal._triangulation_npsp._triangulate_lindstrom_withgrad(v0, v1, Rt01, out=out)
 
@@ -946,17 +1011,163 @@ if get_gradients: we return a tuple:
 
 
 
-def _compute_Var_q_triangulation(sigma, stdev_cross_camera_correlation):
+def _triangulate_nview(what, v, t, get_gradients, out):
+    if not get_gradients:
+        return getattr(mrcal._triangulation_npsp,
+                       f"_triangulate_nview_{what}")(v, t, out=out)
+    return getattr(mrcal._triangulation_npsp,
+                   f"_triangulate_nview_{what}_withgrad")(v, t, out=out)
+
+
+def triangulate_nview_geometric(v, t,
+                                get_gradients = False,
+                                out           = None):
+
+    r'''Geometric triangulation of a point observed by N cameras
+
+SYNOPSIS
+
+    # v has shape (Ncameras,3): the observation vector in each camera, in
+    # camera-0 coordinates
+    # t has shape (Ncameras,3): the position of each camera, in camera-0
+    # coordinates
+    p = mrcal.triangulate_nview_geometric( v, t )
+
+This is the N-view generalization of mrcal.triangulate_geometric(). Instead of
+two rays we have Ncameras >= 2 rays, and we return the point that minimizes the
+sum of the squared distances to each ray. This is the linear least-squares
+"midpoint" method. With Ncameras = 2 this produces the same result as
+mrcal.triangulate_geometric().
+
+If the triangulated point lies behind any of the cameras, or if the rays are
+(nearly) parallel, (0,0,0) is returned.
+
+For a richer function that takes pixel observations and propagates observation
+noise, see mrcal.triangulate_nview()
+
+This function supports broadcasting fully.
+
+ARGUMENTS
+
+- v: (Ncameras,3) numpy array containing the not-necessarily-normalized
+  observation vectors of a feature observed by each camera. All are described
+  in the camera-0 coordinate system
+
+- t: (Ncameras,3) numpy array containing the position of each camera origin in
+  the camera-0 coordinate system. t[0] is usually 0, but this isn't required
+
+- get_gradients: optional boolean that defaults to False. Whether we should
+  compute and report the gradients. This affects what we return
+
+- out: optional argument specifying the destination. By default, new numpy
+  array(s) are created and returned. To write the results into existing (and
+  possibly non-contiguous) arrays, specify them with the 'out' kwarg. If not
+  get_gradients: 'out' is the one numpy array we will write into. Else: 'out' is
+  a tuple of all the output numpy arrays. If 'out' is given, we return the 'out'
+  that was passed in. This is the standard behavior provided by
+  numpysane_pywrap.
+
+RETURNED VALUE
+
+if not get_gradients:
+
+  we return an (...,3) array of triangulated point positions in the camera-0
+  coordinate system
+
+if get_gradients: we return a tuple:
+
+  - (...,3) array of triangulated point positions
+  - (...,Ncameras,3,3) array of the gradients of the triangulated positions in
+    respect to each v. dp_dv[...,i,:,:] = dp/dv[...,i,:]
+  - (...,Ncameras,3,3) array of the gradients of the triangulated positions in
+    respect to each t. dp_dt[...,i,:,:] = dp/dt[...,i,:]
+
+    '''
+    return _triangulate_nview('geometric', v, t, get_gradients, out)
+
+
+def triangulate_nview_angular(v, t,
+                              get_gradients = False,
+                              out           = None):
+
+    r'''Angular-error triangulation of a point observed by N cameras
+
+SYNOPSIS
+
+    # v has shape (Ncameras,3): the observation vector in each camera, in
+    # camera-0 coordinates
+    # t has shape (Ncameras,3): the position of each camera, in camera-0
+    # coordinates
+    p = mrcal.triangulate_nview_angular( v, t )
+
+Like mrcal.triangulate_nview_geometric(), but the solution is refined to
+minimize the sum of the squared sines of the angles between each observation
+ray and the vector from that camera to the point. This is a much better proxy
+for the reprojection error than the 3D distances minimized by the geometric
+method: the geometric method gives far-away cameras too much weight. The
+solution is computed by Gauss-Newton iterations, seeded from the geometric
+solution. This converges quickly, so the cost is a small multiple of the cost of
+the geometric method. The reported gradients are those of the minimizer, from
+the implicit function theorem.
+
+If the triangulated point lies behind any of the cameras, or if the rays are
+(nearly) parallel, (0,0,0) is returned.
+
+For a richer function that takes pixel observations and propagates observation
+noise, see mrcal.triangulate_nview()
+
+This function supports broadcasting fully.
+
+ARGUMENTS
+
+- v: (Ncameras,3) numpy array containing the not-necessarily-normalized
+  observation vectors of a feature observed by each camera. All are described
+  in the camera-0 coordinate system
+
+- t: (Ncameras,3) numpy array containing the position of each camera origin in
+  the camera-0 coordinate system. t[0] is usually 0, but this isn't required
+
+- get_gradients: optional boolean that defaults to False. Whether we should
+  compute and report the gradients. This affects what we return
+
+- out: optional argument specifying the destination. By default, new numpy
+  array(s) are created and returned. To write the results into existing (and
+  possibly non-contiguous) arrays, specify them with the 'out' kwarg. If not
+  get_gradients: 'out' is the one numpy array we will write into. Else: 'out' is
+  a tuple of all the output numpy arrays. If 'out' is given, we return the 'out'
+  that was passed in. This is the standard behavior provided by
+  numpysane_pywrap.
+
+RETURNED VALUE
+
+if not get_gradients:
+
+  we return an (...,3) array of triangulated point positions in the camera-0
+  coordinate system
+
+if get_gradients: we return a tuple:
+
+  - (...,3) array of triangulated point positions
+  - (...,Ncameras,3,3) array of the gradients of the triangulated positions in
+    respect to each v. dp_dv[...,i,:,:] = dp/dv[...,i,:]
+  - (...,Ncameras,3,3) array of the gradients of the triangulated positions in
+    respect to each t. dp_dt[...,i,:,:] = dp/dt[...,i,:]
+
+    '''
+    return _triangulate_nview('angular', v, t, get_gradients, out)
+
+
+def _compute_Var_q_triangulation(sigma, stdev_cross_camera_correlation,
+                                 Ncameras = 2):
     r'''Compute triangulation variance due to observation noise
 
-This is an internal piece of mrcal.triangulate(). It's available separately for
-the benefit of the test
+This is an internal piece of mrcal.triangulate() and mrcal.triangulate_nview().
+It's available separately for the benefit of the test
 
     '''
 
     # For each triangulation we ingest one pixel observation per camera.
-    # This is 4 numbers: 2 cameras, with (x,y) for each one
-    Ncameras = 2
+    # This is 2*Ncameras numbers: (x,y) for each camera
     Nxy      = 2
     var_q = np.eye(Ncameras*Nxy) * sigma*sigma
     var_q_reshaped = var_q.reshape( Ncameras, Nxy,
@@ -965,13 +1176,13 @@ the benefit of the test
     sigma_cross = sigma*stdev_cross_camera_correlation
     var_cross   = sigma_cross*sigma_cross
 
-    # cam0-cam1 correlations
-    var_q_reshaped[0,0, 1,0] = var_cross
-    var_q_reshaped[0,1, 1,1] = var_cross
-
-    # cam1-cam0 correlations
-    var_q_reshaped[1,0, 0,0] = var_cross
-    var_q_reshaped[1,1, 0,1] = var_cross
+    # cross-camera correlations. Between each pair of cameras, in both
+    # directions
+    for i0 in range(Ncameras):
+        for i1 in range(Ncameras):
+            if i0 == i1: continue
+            var_q_reshaped[i0,0, i1,0] = var_cross
+            var_q_reshaped[i0,1, i1,1] = var_cross
 
     return var_q
 
@@ -981,8 +1192,10 @@ def _triangulate_grad_simple(q, models,
                              method = triangulate_leecivera_mid2):
     r'''Compute a single triangulation, reporting a single gradient
 
-This is an internal piece of mrcal.triangulate(). It's available separately for
-the benefit of the test
+This is the straightforward numpy implementation of the gradient computed by
+mrcal.triangulate(). That function now does its work in C, so this is no
+longer used by mrcal itself: it is kept deliberately as an independent
+reference for test-triangulation-uncertainty.py
 
     '''
 
@@ -1032,6 +1245,148 @@ the benefit of the test
     return nps.clump(dp_triangulated_dq, n=-2)
 
 
+def _triangulation_method_name(method):
+    r'''Returns the name of a triangulation method, as the C code expects it
+
+The method is identified by identity, not by its __name__, so wrappers or
+unrelated functions with a similar name are rejected
+
+    '''
+
+    if method is triangulate_lindstrom:
+        raise Exception("Triangulation gradients not supported (yet?) with method=triangulate_lindstrom. It has slightly different inputs and slightly different gradients")
+
+    method_names = { triangulate_geometric:        'geometric',
+                     triangulate_leecivera_l1:     'leecivera_l1',
+                     triangulate_leecivera_linf:   'leecivera_linf',
+                     triangulate_leecivera_mid2:   'leecivera_mid2',
+                     triangulate_leecivera_wmid2:  'leecivera_wmid2' }
+    try:
+        return method_names[method]
+    except (KeyError,TypeError):
+        raise Exception(f"Unsupported triangulation method {method!r}. Must be one of mrcal.triangulate_geometric, mrcal.triangulate_leecivera_l1, mrcal.triangulate_leecivera_linf, mrcal.triangulate_leecivera_mid2, mrcal.triangulate_leecivera_wmid2") from None
+
+
+def _triangulation_calibration_setup(models_flat, q_calibration_stdev):
+    r'''Prepare the calibration problem for calibration-time noise propagation
+
+This is an internal piece of mrcal.triangulate() and mrcal.triangulator. It
+makes sure all the given models come from the same, unmoved calibration, and
+evaluates that calibration problem. Returns
+
+  (optimization_inputs, Jpacked, factorization, Nmeasurements_observations,
+   q_calibration_stdev)
+
+q_calibration_stdev < 0 is replaced by the stdev of the calibration residuals
+
+    '''
+
+    # The evaluated optimization problem is cached in the model, so repeated
+    # calls don't re-evaluate and re-factor it
+    optimization_context = models_flat[0]._optimization_context()
+
+    if optimization_context is None:
+        raise Exception("optimization_inputs are not available, so I cannot propagate calibration-time noise")
+
+    optimization_inputs,ppacked,x,Jpacked,factorization = optimization_context
+
+    for i0 in range(len(models_flat)):
+        for i1 in range(i0):
+            if not models_flat[i0]._optimization_inputs_match(models_flat[i1]):
+                raise Exception("The optimization_inputs for all of the given models must be identical")
+
+        if models_flat[i0]._extrinsics_moved_since_calibration():
+            raise Exception(f"The given models must have been fixed inside the initial calibration. Model {i0} has been moved")
+
+    if q_calibration_stdev < 0:
+        q_calibration_stdev = \
+            np.std(mrcal.residuals_chessboard(optimization_inputs,
+                                              residuals = x).ravel())
+
+    Nmeasurements_observations = mrcal.num_measurements_boards(**optimization_inputs)
+    if Nmeasurements_observations == mrcal.num_measurements(**optimization_inputs):
+        # Note the special-case where I'm using all the observations
+        Nmeasurements_observations = None
+
+    return                          \
+        optimization_inputs,        \
+        Jpacked,                    \
+        factorization,              \
+        Nmeasurements_observations, \
+        q_calibration_stdev
+
+
+def _triangulation_pair_kwargs(models01, optimization_inputs, stabilize_coords):
+    r'''Describe the calibration state of a camera pair
+
+This is an internal piece of mrcal.triangulate() and mrcal.triangulator. Returns
+the calibration-time-noise kwargs to pass to
+mrcal._mrcal._triangulate_with_uncertainty() for the points observed by the
+given pair of models, and the state indices of this pair, for the test suite:
+
+  (kwargs,
+   (istate_i0, istate_i1, icam_extrinsics0, icam_extrinsics1, istate_e1, istate_e0))
+
+If optimization_inputs is None, we're not propagating calibration-time noise,
+and kwargs is empty
+
+    '''
+
+    if optimization_inputs is None:
+        return dict(), (None,)*6
+
+    def istate_or_negative(istate):
+        return -1 if istate is None else istate
+
+    Nintrinsics = mrcal.num_intrinsics_optimization_params(**optimization_inputs)
+    Nstate      = mrcal.num_states(**optimization_inputs)
+
+    if stabilize_coords and optimization_inputs.get('do_optimize_frames'):
+        # We're re-optimizing (looking at calibration uncertainty) AND we
+        # are optimizing the frames AND we have stabilization enabled.
+        # Without stabilization, there's no dependence on rt_ref_frame
+        rt_ref_frame  = optimization_inputs['frames_rt_toref']
+        istate_f0     = mrcal.state_index_frames(0, **optimization_inputs)
+    else:
+        rt_ref_frame  = None
+        istate_f0     = None
+
+    # Do the right thing is we're optimizing partial intrinsics only
+    has_core = mrcal.lensmodel_metadata_and_config(optimization_inputs['lensmodel'])['has_core']
+    Ncore    = 4 if has_core else 0
+    if not optimization_inputs.get('do_optimize_intrinsics_core'):
+        icol0_intrinsics = Ncore
+    else:
+        icol0_intrinsics = 0
+
+    icam_intrinsics0 = models01[0].icam_intrinsics()
+    icam_intrinsics1 = models01[1].icam_intrinsics()
+
+    istate_i0 = mrcal.state_index_intrinsics(icam_intrinsics0, **optimization_inputs)
+    istate_i1 = mrcal.state_index_intrinsics(icam_intrinsics1, **optimization_inputs)
+
+    icam_extrinsics0 = mrcal.corresponding_icam_extrinsics(icam_intrinsics0, **optimization_inputs)
+    icam_extrinsics1 = mrcal.corresponding_icam_extrinsics(icam_intrinsics1, **optimization_inputs)
+
+    # set to None if icam_extrinsics<0 (i.e. when looking at the reference camera)
+    istate_e0 = mrcal.state_index_extrinsics(icam_extrinsics0, **optimization_inputs)
+    istate_e1 = mrcal.state_index_extrinsics(icam_extrinsics1, **optimization_inputs)
+
+    kwargs = dict(Nstate             = Nstate,
+                  istate_intrinsics0 = istate_or_negative(istate_i0),
+                  istate_intrinsics1 = istate_or_negative(istate_i1),
+                  icol0_intrinsics   = icol0_intrinsics,
+                  Nintrinsics_state  = Nintrinsics,
+                  istate_extrinsics0 = istate_or_negative(istate_e0),
+                  istate_extrinsics1 = istate_or_negative(istate_e1),
+                  stabilize          = bool(stabilize_coords),
+                  rt_ref_frame       = rt_ref_frame,
+                  istate_frames      = istate_or_negative(istate_f0))
+
+    return kwargs, \
+        (istate_i0, istate_i1, icam_extrinsics0, icam_extrinsics1, istate_e1, istate_e0)
+
+
 def _triangulation_uncertainty_internal(slices,
                                         optimization_inputs, # if None: we're not propagating calibration-time noise
                                         q_observation_stdev,
@@ -1048,206 +1403,71 @@ if optimization_inputs is None and q_observation_stdev is None:
 
     '''
 
-    def _triangulate_grad(models, q, out, method):
-
-        # Full path. Compute and return the gradients for most things
-        rt_ref1,drt_ref1_drt_1ref = \
-            mrcal.invert_rt(models[1].extrinsics_rt_fromref(),
-                            get_gradients=True)
-        rt01,drt01_drt_0ref,drt01_drt_ref1 = \
-            mrcal.compose_rt(models[0].extrinsics_rt_fromref(), rt_ref1, get_gradients=True)
-
-        # all the v have shape (3,)
-        vlocal0, dvlocal0_dq0, dvlocal0_dintrinsics0 = \
-            mrcal.unproject(q[0,:],
-                            *models[0].intrinsics(),
-                            get_gradients = True)
-        vlocal1, dvlocal1_dq1, dvlocal1_dintrinsics1 = \
-            mrcal.unproject(q[1,:],
-                            *models[1].intrinsics(),
-                            get_gradients = True)
-
-        v0 = vlocal0
-        v1, dv1_dr01, dv1_dvlocal1 = \
-            mrcal.rotate_point_r(rt01[:3], vlocal1,
-                                 get_gradients=True)
-
-        dp_triangulated_dv0  = np.zeros(out.shape + (3,), dtype=float)
-        dp_triangulated_dv1  = np.zeros(out.shape + (3,), dtype=float)
-        dp_triangulated_dt01 = np.zeros(out.shape + (3,), dtype=float)
-
-        if method is mrcal.triangulate_lindstrom:
-            raise Exception("Triangulation gradients not supported (yet?) with method=triangulate_lindstrom. It has slightly different inputs and slightly different gradients")
-        method(v0, v1, rt01[3:],
-               out = (out,
-                      dp_triangulated_dv0,
-                      dp_triangulated_dv1,
-                      dp_triangulated_dt01),
-               get_gradients = True)
-
-        dp_triangulated_dq = np.zeros((3,) + q.shape[-2:], dtype=float)
-        nps.matmult( dp_triangulated_dv0,
-                     dvlocal0_dq0,
-                     out = dp_triangulated_dq[..., 0, :])
-        nps.matmult( dp_triangulated_dv1,
-                     dv1_dvlocal1,
-                     dvlocal1_dq1,
-                     out = dp_triangulated_dq[..., 1, :])
-
-        # shape (3,4)
-        dp_triangulated_dq = nps.clump(dp_triangulated_dq, n=-2)
-
-        return                     \
-            dp_triangulated_dq,    \
-            drt_ref1_drt_1ref,     \
-            drt01_drt_0ref,        \
-            drt01_drt_ref1,        \
-            dvlocal0_dintrinsics0, \
-            dvlocal1_dintrinsics1, \
-            dv1_dr01,              \
-            dv1_dvlocal1,          \
-            dp_triangulated_dv0,   \
-            dp_triangulated_dv1,   \
-            dp_triangulated_dt01
-
-
-    def stabilize(p_cam0,
-                  rt_cam0_ref,
-                  rt_ref_frame):
-
-        # The triangulated point is reported in the coordinate system of
-        # camera0. If we perturb the calibration inputs, the coordinate
-        # system itself moves, and without extra effort, the reported
-        # triangulation uncertainty incorporates this extra coordinate
-        # system motion. Here, the stabilization logic is available to try
-        # to compensate for the effects of the shifting coordinate system.
-        # This is done very similarly to how we do this when computing the
-        # projection uncertainty.
-        #
-        # Let's say I have a triangulated point collected after a
-        # perturbation. I transform it to the coordinate systems of the
-        # frames. Those represent fixed objects in space, so THESE
-        # coordinate systems do not shift after a calibration-time
-        # perturbation. I then project the point in the coordinate systems
-        # of the frames back, using the unperturbed geometry. This gives me
-        # the triangulation in the UNPERTURBED (baseline) camera0 frame.
-        #
-        # The data flow:
-        #   point_cam_perturbed -> point_ref_perturbed -> point_frames
-        #   point_frames -> point_ref_baseline -> point_cam_baseline
-        #
-        # The final quantity point_cam_baseline depends on calibration
-        # parameters in two ways:
-        #
-        # 1. Indirectly, via point_cam_perturbed
-        # 2. Directly, via each of the transformations in the above data flow
-        #
-        # For the indirect dependencies, we have the unstabilized
-        # dpoint_cam_perturbed/dparam for a number of parameters, and we
-        # want to propagate that to the stabilized quantity:
-        #
-        #   dpoint_cam_baseline/dparam =
-        #     dpoint_cam_baseline/dpoint_ref_baseline
-        #     dpoint_ref_baseline/dpoint_frames
-        #     dpoint_frames/dpoint_ref_perturbed
-        #     dpoint_ref_perturbed/dpoint_cam_perturbed
-        #     dpoint_cam_perturbed/dparam
-        #
-        # We only consider small perturbations, and we assume that
-        # everything is locally linear. Thus the gradients in this
-        # expression all cancel out, and we get simply
-        #
-        #   dpoint_cam_baseline/dparam = dpoint_cam_perturbed/dparam
-        #
-        # Thus there's nothing for this function to do to handle these indirect
-        # dependencies.
-        #
-        # For the direct dependencies, we consider point_frames to be the
-        # nominal representation of the point. So for the purpose of
-        # computing gradients we don't look at the baseline parameter
-        # gradients:
-        #
-        #   dpoint_cam_baseline/dparam =
-        #     dpoint_cam_baseline/dpoint_frames
-        #     dpoint_frames/dparam =
-        #
-        # Simplifying notation:
-        #
-        #   dpc/dparam = dpc/dpf dpf/dparam
-        #
-        # Thus we have exactly two transformations whose parameters should
-        # be propagated:
-        #
-        # 1. rt_cam_ref
-        # 2. rt_ref_frame
-        #
-        # Propagating rt_cam_ref:
-        #
-        #   dpc/drt_cr = dpc/dpf dpf/drt_cr
-        #              = dpc/dpr dpr/dpf dpf/dpr dpr/drt_cr
-        #              = dpc/dpr dpr/drt_cr
-        #
-        # Propagating rt_ref_frame:
-        #
-        #   dpc/drt_rf = dpc/dpf dpf/drt_rf
-        #              = dpc/dpr dpr/dpf dpf/drt_rf
-
-        #
-        # If the frames are fixed, the same logic applies, with some
-        # simplifications. The cameras move in respect to the ref frame, but the
-        # frames are fixed in the ref frame. So the ref frame is the nominal
-        # representation
-        #
-        #   dpoint_cam_baseline/dparam =
-        #     dpoint_cam_baseline/dpoint_ref
-        #     dpoint_ref/dparam
-
-        # triangulated point in the perturbed reference coordinate system
-        p_ref,                     \
-        dp_ref_drt_0ref,           \
-        dp_ref_dp_cam0 = \
-            mrcal.transform_point_rt(rt_cam0_ref, p_cam0,
-                                     get_gradients = True,
-                                     inverted      = True)
-
-        dp_triangulated_drt_0ref = \
-            np.linalg.solve( dp_ref_dp_cam0,
-                             dp_ref_drt_0ref)
-
-
-        if rt_ref_frame is not None:
-
-            # we're optimizing the frames
-
-            # dp_frames_drtrf  has shape (..., Nframes, 3,6)
-            # dp_frames_dp_ref has shape (..., Nframes, 3,3)
-            _,                 \
-            dp_frames_drtrf,   \
-            dp_frames_dp_ref = \
-                mrcal.transform_point_rt(rt_ref_frame,
-                                         nps.dummy(p_ref,-2),
-                                         get_gradients = True,
-                                         inverted      = True)
-
-            dp_frames_dp_cam0 = \
-                nps.matmult( dp_frames_dp_ref,
-                             nps.dummy(dp_ref_dp_cam0, -3))
-
-            Nframes = len(rt_ref_frame)
-
-            # shape (..., 3,6)
-            dp_triangulated_drtrf = np.linalg.solve(dp_frames_dp_cam0,
-                                                    dp_frames_drtrf) / Nframes
-        else:
-            # the frames are fixed; not subject to optimization
-            dp_triangulated_drtrf = None
-
-        return \
-            dp_triangulated_drtrf, \
-            dp_triangulated_drt_0ref
-
-
+    # The work is done in C, by mrcal._mrcal._triangulate_with_uncertainty():
+    # all the points observed by the same pair of cameras are processed in one
+    # call. The data flow for each point:
+    #
+    #   q0,i0                       -> v0 (same as vlocal0; I'm working in the cam0 coord system)
+    #   q1,i1                       -> vlocal1
+    #   r_0ref,r_1ref               -> r01
+    #   r_0ref,r_1ref,t_0ref,t_1ref -> t01
+    #   vlocal1,r01                 -> v1
+    #   v0,v1,t01                   -> p_triangulated
+    #
+    # If stabilize_coords, the reported gradients also compensate for the
+    # motion of the coordinate system of camera0.
+    #
+    # The triangulated point is reported in the coordinate system of camera0.
+    # If we perturb the calibration inputs, the coordinate system itself moves,
+    # and without extra effort, the reported triangulation uncertainty
+    # incorporates this extra coordinate system motion. The stabilization logic
+    # tries to compensate for the effects of the shifting coordinate system.
+    # This is done very similarly to how we do this when computing the
+    # projection uncertainty.
+    #
+    # Let's say I have a triangulated point collected after a perturbation. I
+    # transform it to the coordinate systems of the frames. Those represent
+    # fixed objects in space, so THESE coordinate systems do not shift after a
+    # calibration-time perturbation. I then project the point in the coordinate
+    # systems of the frames back, using the unperturbed geometry. This gives me
+    # the triangulation in the UNPERTURBED (baseline) camera0 frame.
+    #
+    # The data flow:
+    #   point_cam_perturbed -> point_ref_perturbed -> point_frames
+    #   point_frames -> point_ref_baseline -> point_cam_baseline
+    #
+    # The final quantity point_cam_baseline depends on calibration parameters in
+    # two ways:
+    #
+    # 1. Indirectly, via point_cam_perturbed
+    # 2. Directly, via each of the transformations in the above data flow
+    #
+    # We only consider small perturbations, and we assume that everything is
+    # locally linear. Thus the gradients of the indirect dependencies all
+    # cancel out, and
+    #
+    #   dpoint_cam_baseline/dparam = dpoint_cam_perturbed/dparam
+    #
+    # So there's nothing extra to do to handle these indirect dependencies.
+    #
+    # For the direct dependencies, we consider point_frames to be the nominal
+    # representation of the point. Simplifying notation:
+    #
+    #   dpc/dparam = dpc/dpf dpf/dparam
+    #
+    # Thus we have exactly two transformations whose parameters should be
+    # propagated:
+    #
+    # 1. rt_cam_ref:   dpc/drt_cr = dpc/dpr dpr/drt_cr
+    # 2. rt_ref_frame: dpc/drt_rf = dpc/dpr dpr/dpf dpf/drt_rf
+    #
+    # The last one is averaged over all the frames. If the frames are fixed,
+    # the same logic applies, with some simplifications. The cameras move in
+    # respect to the ref frame, but the frames are fixed in the ref frame. So
+    # the ref frame is the nominal representation, and only rt_cam_ref is
+    # propagated
 
+    method_name = _triangulation_method_name(method)
 
     Npoints = len(slices)
 
@@ -1257,35 +1477,16 @@ if optimization_inputs is None and q_observation_stdev is None:
     p = np.zeros((Npoints,3), dtype=float)
 
     if optimization_inputs is not None:
-
-        Nintrinsics = mrcal.num_intrinsics_optimization_params(**optimization_inputs)
-        Nstate      = mrcal.num_states(**optimization_inputs)
+        Nstate = mrcal.num_states(**optimization_inputs)
 
         # I store dp_triangulated_dpstate initially, without worrying about the "packed"
         # part. I'll scale the thing when done to pack it
         dp_triangulated_dpstate = np.zeros((Npoints,3,Nstate), dtype=float)
-
-        if stabilize_coords and optimization_inputs.get('do_optimize_frames'):
-            # We're re-optimizing (looking at calibration uncertainty) AND we
-            # are optimizing the frames AND we have stabilization enabled.
-            # Without stabilization, there's no dependence on rt_ref_frame
-            rt_ref_frame  = optimization_inputs['frames_rt_toref']
-            istate_f0     = mrcal.state_index_frames(0, **optimization_inputs)
-            Nstate_frames = mrcal.num_states_frames(    **optimization_inputs)
-        else:
-            rt_ref_frame  = None
-            istate_f0     = None
-            Nstate_frames = None
-
     else:
         # We don't need to evaluate the calibration-time noise.
         dp_triangulated_dpstate = None
-        istate_i0               = None
-        istate_i1               = None
-        icam_extrinsics0        = None
-        icam_extrinsics1        = None
-        istate_e1               = None
-        istate_e0               = None
+
+    istate = (None,)*6
 
     if q_observation_stdev is not None:
         # observation-time variance of each observed pair of points
@@ -1295,168 +1496,43 @@ if optimization_inputs is None and q_observation_stdev is None:
                                          q_observation_stdev_correlation)
         Var_p_observation = np.zeros((Npoints,3,3), dtype=float)
     else:
-        Var_p_observation = None
-
+        Var_q_observation_flat = None
+        Var_p_observation      = None
 
+    # Group the points by the pair of cameras observing them. Usually all the
+    # points are observed by the same pair
+    ipts_from_pair = dict()
     for ipt in range(Npoints):
-        q,models01 = slices[ipt]
-
-        if optimization_inputs is None:
-            # shape (3,Ncameras*Nxy=4)
-            dp_triangulated_dq = \
-                _triangulate_grad_simple(q, models01,
-                                         out = p[ipt],
-                                         method = method)
-
-        else:
-            dp_triangulated_dq,    \
-            drt_ref1_drt_1ref,     \
-            drt01_drt_0ref,        \
-            drt01_drt_ref1,        \
-            dvlocal0_dintrinsics0, \
-            dvlocal1_dintrinsics1, \
-            dv1_dr01,              \
-            dv1_dvlocal1,          \
-            dp_triangulated_dv0,   \
-            dp_triangulated_dv1,   \
-            dp_triangulated_dt01 = \
-                _triangulate_grad(models01, q,
-                                  out = p[ipt],
-                                  method = method)
-
-        # triangulation-time uncertainty
-        if q_observation_stdev is not None:
-            nps.matmult( dp_triangulated_dq,
-                         Var_q_observation_flat,
-                         nps.transpose(dp_triangulated_dq),
-                         out = Var_p_observation[ipt,...])
-
-        if optimization_inputs is None:
-            # Not evaluating calibration-time uncertainty. Nothing else to do.
-            continue
-
-        # calibration-time uncertainty
-        if stabilize_coords:
-            dp_triangulated_drtrf,     \
-            dp_triangulated_drt_0ref = \
-                stabilize(p[ipt],
-                          models01[0].extrinsics_rt_fromref(),
-                          rt_ref_frame)
-        else:
-            dp_triangulated_drtrf    = None
-            dp_triangulated_drt_0ref = None
-
-
-        # Do the right thing is we're optimizing partial intrinsics only
-        i0,i1 = None,None # everything by default
-        has_core     = mrcal.lensmodel_metadata_and_config(optimization_inputs['lensmodel'])['has_core']
-        Ncore        = 4 if has_core else 0
-        Ndistortions = mrcal.lensmodel_num_params(optimization_inputs['lensmodel']) - Ncore
-        if not optimization_inputs.get('do_optimize_intrinsics_core'):
-            i0 = Ncore
-        if not optimization_inputs.get('do_optimize_intrinsics_distortions'):
-            i1 = -Ndistortions
-        slice_optimized_intrinsics  = slice(i0,i1)
-        dvlocal0_dintrinsics0 = dvlocal0_dintrinsics0[...,slice_optimized_intrinsics]
-        dvlocal1_dintrinsics1 = dvlocal1_dintrinsics1[...,slice_optimized_intrinsics]
-
-        ### Sensitivities
-        # The data flow:
-        #   q0,i0                       -> v0 (same as vlocal0; I'm working in the cam0 coord system)
-        #   q1,i1                       -> vlocal1
-        #   r_0ref,r_1ref               -> r01
-        #   r_0ref,r_1ref,t_0ref,t_1ref -> t01
-        #   vlocal1,r01                 -> v1
-        #   v0,v1,t01                   -> p_triangulated
-        icam_intrinsics0 = models01[0].icam_intrinsics()
-        icam_intrinsics1 = models01[1].icam_intrinsics()
-
-        istate_i0 = mrcal.state_index_intrinsics(icam_intrinsics0, **optimization_inputs)
-        istate_i1 = mrcal.state_index_intrinsics(icam_intrinsics1, **optimization_inputs)
-        if istate_i0 is not None:
-            # dp_triangulated_di0 = dp_triangulated_dv0              dvlocal0_di0
-            # dp_triangulated_di1 = dp_triangulated_dv1 dv1_dvlocal1 dvlocal1_di1
-            nps.matmult( dp_triangulated_dv0,
-                         dvlocal0_dintrinsics0,
-                         out = dp_triangulated_dpstate[ipt, :, istate_i0:istate_i0+Nintrinsics])
-        if istate_i1 is not None:
-            nps.matmult( dp_triangulated_dv1,
-                         dv1_dvlocal1,
-                         dvlocal1_dintrinsics1,
-                         out = dp_triangulated_dpstate[ipt, :, istate_i1:istate_i1+Nintrinsics])
-
-
-        icam_extrinsics0 = mrcal.corresponding_icam_extrinsics(icam_intrinsics0, **optimization_inputs)
-        icam_extrinsics1 = mrcal.corresponding_icam_extrinsics(icam_intrinsics1, **optimization_inputs)
-
-        # set to None if icam_extrinsics<0 (i.e. when looking at the reference camera)
-        istate_e0 = mrcal.state_index_extrinsics(icam_extrinsics0, **optimization_inputs)
-        istate_e1 = mrcal.state_index_extrinsics(icam_extrinsics1, **optimization_inputs)
-
-        if istate_e1 is not None:
-            # dp_triangulated_dr_0ref = dp_triangulated_dv1  dv1_dr01 dr01_dr_0ref +
-            #                           dp_triangulated_dt01          dt01_dr_0ref
-            # dp_triangulated_dr_1ref = dp_triangulated_dv1  dv1_dr01 dr01_dr_1ref +
-            #                           dp_triangulated_dt01          dt01_dr_1ref
-            # dp_triangulated_dt_0ref = dp_triangulated_dt01          dt01_dt_0ref
-            # dp_triangulated_dt_1ref = dp_triangulated_dt01          dt01_dt_1ref
-            dr01_dr_ref1    = drt01_drt_ref1[:3,:3]
-            dr_ref1_dr_1ref = drt_ref1_drt_1ref[:3,:3]
-            dr01_dr_1ref    = nps.matmult(dr01_dr_ref1, dr_ref1_dr_1ref)
-
-            dt01_drt_ref1 = drt01_drt_ref1[3:,:]
-            dt01_dr_1ref  = nps.matmult(dt01_drt_ref1, drt_ref1_drt_1ref[:,:3])
-            dt01_dt_1ref  = nps.matmult(dt01_drt_ref1, drt_ref1_drt_1ref[:,3:])
-
-            nps.matmult( dp_triangulated_dv1,
-                         dv1_dr01,
-                         dr01_dr_1ref,
-                         out = dp_triangulated_dpstate[ipt, :, istate_e1:istate_e1+3])
-            dp_triangulated_dpstate[ipt, :, istate_e1:istate_e1+3] += \
-                nps.matmult(dp_triangulated_dt01, dt01_dr_1ref)
-
-            nps.matmult( dp_triangulated_dt01,
-                         dt01_dt_1ref,
-                         out = dp_triangulated_dpstate[ipt, :, istate_e1+3:istate_e1+6])
-
-        if istate_e0 is not None:
-            dr01_dr_0ref = drt01_drt_0ref[:3,:3]
-            dt01_dr_0ref = drt01_drt_0ref[3:,:3]
-            dt01_dt_0ref = drt01_drt_0ref[3:,3:]
-
-            nps.matmult( dp_triangulated_dv1,
-                         dv1_dr01,
-                         dr01_dr_0ref,
-                         out = dp_triangulated_dpstate[ipt, :, istate_e0:istate_e0+3])
-            dp_triangulated_dpstate[ipt, :, istate_e0:istate_e0+3] += \
-                nps.matmult(dp_triangulated_dt01, dt01_dr_0ref)
-
-            nps.matmult( dp_triangulated_dt01,
-                         dt01_dt_0ref,
-                         out = dp_triangulated_dpstate[ipt, :, istate_e0+3:istate_e0+6])
-
-            if dp_triangulated_drt_0ref is not None:
-                dp_triangulated_dpstate[ipt, :, istate_e0:istate_e0+6] += dp_triangulated_drt_0ref
-
-        if dp_triangulated_drtrf is not None:
-            # We're re-optimizing (looking at calibration uncertainty) AND we
-            # are optimizing the frames AND we have stabilization enabled.
-            # Without stabilization, there's no dependence on rt_ref_frame
-
-            # dp_triangulated_drtrf has shape (Npoints,Nframes,3,6). I reshape to (Npoints,3,Nframes*6)
-            dp_triangulated_dpstate[ipt, :, istate_f0:istate_f0+Nstate_frames] = \
-                nps.clump(nps.xchg(dp_triangulated_drtrf,-2,-3), n=-2)
+        models01 = slices[ipt][1]
+        ipts_from_pair.setdefault( (id(models01[0]),id(models01[1])), [] ).append(ipt)
+
+    for ipts in ipts_from_pair.values():
+        models01 = slices[ipts[0]][1]
+
+        kwargs, istate = \
+            _triangulation_pair_kwargs(models01, optimization_inputs,
+                                       stabilize_coords)
+
+        q01 = nps.cat(*[slices[ipt][0] for ipt in ipts])
+
+        p_pair, Var_p_observation_pair, dp_triangulated_dpstate_pair = \
+            mrcal._mrcal._triangulate_with_uncertainty(q01, method_name,
+                                                       *models01[0].intrinsics(),
+                                                       models01[0].extrinsics_rt_fromref(),
+                                                       *models01[1].intrinsics(),
+                                                       models01[1].extrinsics_rt_fromref(),
+                                                       Var_q = Var_q_observation_flat,
+                                                       **kwargs)
+        p[ipts] = p_pair
+        if Var_p_observation is not None:
+            Var_p_observation[ipts] = Var_p_observation_pair
+        if dp_triangulated_dpstate is not None:
+            dp_triangulated_dpstate[ipts] = dp_triangulated_dpstate_pair
 
     # Returning the istate stuff for the test suite. These are the istate_...
-    # and icam_... for the last slice only. This is good-enough for the test
-    # suite
-    return p, Var_p_observation, dp_triangulated_dpstate, \
-        istate_i0,                            \
-        istate_i1,                            \
-        icam_extrinsics0,                     \
-        icam_extrinsics1,                     \
-        istate_e1,                            \
-        istate_e0
+    # and icam_... for the last camera pair only. This is good-enough for the
+    # test suite
+    return (p, Var_p_observation, dp_triangulated_dpstate) + istate
 
 
 def triangulate( q,
@@ -1752,29 +1828,13 @@ Complete logic:
     if q_calibration_stdev is not None and \
        q_calibration_stdev != 0:
         # we're propagating calibration-time noise
-
-        models_flat = models.ravel()
-
-        optimization_inputs = models_flat[0].optimization_inputs()
-
-        if optimization_inputs is None:
-            raise Exception("optimization_inputs are not available, so I cannot propagate calibration-time noise")
-
-        for i0 in range(len(models_flat)):
-            for i1 in range(i0):
-                if not models_flat[i0]._optimization_inputs_match(models_flat[i1]):
-                    raise Exception("The optimization_inputs for all of the given models must be identical")
-
-            if models_flat[i0]._extrinsics_moved_since_calibration():
-                raise Exception(f"The given models must have been fixed inside the initial calibration. Model {i0} has been moved")
-
-        ppacked,x,Jpacked,factorization = mrcal.optimizer_callback(**optimization_inputs)
-
-        if q_calibration_stdev < 0:
-            q_calibration_stdev = \
-                np.std(mrcal.residuals_chessboard(optimization_inputs,
-                                                  residuals = x).ravel())
-
+        optimization_inputs,        \
+        Jpacked,                    \
+        factorization,              \
+        Nmeasurements_observations, \
+        q_calibration_stdev =       \
+            _triangulation_calibration_setup(models.ravel(),
+                                             q_calibration_stdev)
     else:
         optimization_inputs = None
 
@@ -1806,11 +1866,6 @@ Complete logic:
         # So the Var(p) will end up with shape (Npoints*3, Npoints*3)
         dp_triangulated_dpstate = nps.clump(dp_triangulated_dpstate,n=2)
 
-        Nmeasurements_observations = mrcal.num_measurements_boards(**optimization_inputs)
-        if Nmeasurements_observations == mrcal.num_measurements(**optimization_inputs):
-            # Note the special-case where I'm using all the observations
-            Nmeasurements_observations = None
-
         # Var_p_calibration_flat has shape (Npoints*3,Npoints*3)
         Var_p_calibration_flat = \
             mrcal.model_analysis._propagate_calibration_uncertainty(
@@ -1869,3 +1924,350 @@ Complete logic:
                 Var_p_observation_flat[ipt,...]
 
     return p, Var_p_calibration, Var_p_observation, Var_p_joint
+
+
+class triangulator:
+    r'''Triangulate streams of observations from a fixed pair of cameras
+
+SYNOPSIS
+
+    t = mrcal.triangulator( (model0, model1),
+                            q_calibration_stdev = -1,
+                            q_observation_stdev = 0.3 )
+
+    for q01 in stream_of_matched_features():
+        # q01 has shape (Npoints,2,2)
+        p,                  \
+        Var_p_calibration,  \
+        Var_p_observation,  \
+        Var_p_joint = t(q01)
+
+This computes exactly what mrcal.triangulate() computes, but splits the work
+into a one-time setup and a cheap per-call evaluation. This is useful when
+triangulating a sequence of observations from the same pair of cameras: each
+frame of a video, for instance. mrcal.triangulate() redoes the setup on every
+call. Most notably, propagating the calibration-time noise requires evaluating
+the whole calibration problem, and factoring its J'J: this is usually far more
+expensive than the triangulation itself.
+
+The constructor does all the work that depends only on the models:
+
+- The intrinsics and extrinsics are extracted from the models, and the
+  geometry is set up
+- If propagating calibration-time noise: the models are checked for
+  consistency, the calibration problem is evaluated, and J'J is factored. The
+  state-packing scales are computed
+- The observation-time covariance of the pixel observations is constructed
+
+Each call to the object then only triangulates the given points, and propagates
+the noise through them. The models are NOT re-read on each call: if they change
+after the triangulator is created, a new triangulator must be created.
+
+ARGUMENTS
+
+All the arguments to the constructor have the same meaning as the corresponding
+arguments to mrcal.triangulate(), except no broadcasting over the models is
+available:
+
+- models: iterable of exactly 2 mrcal.cameramodel objects
+
+- q_calibration_stdev: optional value describing the calibration-time noise. If
+  omitted or None, we do not compute or return the uncertainty resulting from
+  this noise. Pass any q_calibration_stdev < 0 to use the optimization residuals
+
+- q_observation_stdev: optional value describing the observation-time noise. If
+  omitted or None, we do not compute or return the uncertainty resulting from
+  this noise
+
+- q_observation_stdev_correlation: optional value, describing the correlation
+  between the pair of pixel coordinates observing the same point in space. The
+  default is 0
+
+- method: optional value selecting the triangulation method. This is one of the
+  mrcal.triangulate_... functions. If omitted, we select
+  mrcal.triangulate_leecivera_mid2. mrcal.triangulate_lindstrom is usable only
+  if we do not propagate any uncertainties
+
+- stabilize_coords: optional boolean, defaulting to True. Same as in
+  mrcal.triangulate()
+
+CALLING
+
+The object is called with one argument: q, a (..., 2,2) numpy array of pixel
+observations. Each broadcasted slice describes a pixel observation from each of
+the two cameras. The returned values are the same as those from
+mrcal.triangulate(): p, optionally followed by Var_p_calibration,
+Var_p_observation and Var_p_joint, depending on which q_..._stdev were given.
+The points from each call are treated as one broadcasted set in
+mrcal.triangulate(): Var_p_calibration contains the cross-terms between all the
+points in one call. The calibration-time noise is the same in all the calls, so
+the results from separate calls are correlated, but these correlations are not
+reported
+
+    '''
+
+    def __init__(self,
+                 models,
+                 q_calibration_stdev             = None,
+                 q_observation_stdev             = None,
+                 q_observation_stdev_correlation = 0,
+                 method                          = triangulate_leecivera_mid2,
+                 stabilize_coords                = True):
+
+        models = tuple(models)
+        if len(models) != 2:
+            raise Exception(f"mrcal.triangulator requires exactly 2 models. Got {len(models)}")
+
+        if q_observation_stdev is not None and \
+           q_observation_stdev < 0:
+            raise Exception("q_observation_stdev MUST be None or >= 0")
+
+        self._q_calibration_stdev = q_calibration_stdev
+        self._q_observation_stdev = q_observation_stdev
+
+        self._propagate = \
+            not ((q_calibration_stdev is None or q_calibration_stdev == 0) and \
+                 (q_observation_stdev is None or q_observation_stdev == 0))
+
+        if not self._propagate:
+            # I don't need to propagate any noise. Any of the triangulation
+            # methods are supported, and I call them directly
+            self._method = method
+            self._lensmodel_intrinsics = [m.intrinsics() for m in models]
+            self._Rt01 = \
+                mrcal.compose_Rt(models[0].extrinsics_Rt_fromref(),
+                                 models[1].extrinsics_Rt_toref())
+            return
+
+        self._method_name = _triangulation_method_name(method)
+
+        # Everything _triangulate_with_uncertainty() needs to know about the
+        # cameras. The arrays are extracted once, here
+        self._args_cameras = \
+            tuple( x for m in models \
+                   for x in ( *m.intrinsics(),
+                              np.ascontiguousarray(m.extrinsics_rt_fromref()) ) )
+
+        if q_observation_stdev is not None:
+            self._Var_q_observation = \
+                _compute_Var_q_triangulation(q_observation_stdev,
+                                             q_observation_stdev_correlation)
+        else:
+            self._Var_q_observation = None
+
+        if q_calibration_stdev is not None and \
+           q_calibration_stdev != 0:
+
+            optimization_inputs,              \
+            self._Jpacked,                    \
+            self._factorization,              \
+            self._Nmeasurements_observations, \
+            self._q_calibration_stdev =       \
+                _triangulation_calibration_setup(models,
+                                                 q_calibration_stdev)
+
+            self._kwargs = \
+                _triangulation_pair_kwargs(models, optimization_inputs,
+                                           stabilize_coords)[0]
+
+            # The state packing is a per-variable scaling. I compute it here,
+            # and apply it to the gradients on each call
+            self._unpack_scale = np.ones( (self._kwargs['Nstate'],), dtype=float)
+            mrcal.unpack_state(self._unpack_scale, **optimization_inputs)
+
+        else:
+            self._kwargs = dict()
+
+
+    def __call__(self, q):
+
+        q = np.ascontiguousarray(q, dtype=float)
+        if q.ndim < 2 or q.shape[-2:] != (2,2):
+            raise Exception(f"q must have shape (...,2,2). Got {q.shape}")
+        shape_points = q.shape[:-2]
+        Npoints      = int(np.prod(shape_points))
+
+        if not self._propagate:
+            vlocal0 = mrcal.unproject(q[...,0,:], *self._lensmodel_intrinsics[0])
+            vlocal1 = mrcal.unproject(q[...,1,:], *self._lensmodel_intrinsics[1])
+            p = self._method(vlocal0, vlocal1,
+                             v_are_local = True,
+                             Rt01        = self._Rt01)
+
+            if self._q_calibration_stdev is None and \
+               self._q_observation_stdev is None:
+                return p
+
+            if self._q_calibration_stdev is not None:
+                Var_p_calibration = np.zeros(shape_points + (3,) +
+                                             shape_points + (3,),
+                                             dtype=float)
+            if self._q_observation_stdev is not None:
+                Var_p_observation = np.zeros(shape_points + (3,3), dtype=float)
+
+            if self._q_calibration_stdev is not None:
+                if self._q_observation_stdev is not None:
+                    return p, Var_p_calibration, Var_p_observation, Var_p_calibration
+                else:
+                    return p, Var_p_calibration
+            else:
+                return p, Var_p_observation
+
+        p, Var_p_observation, dp_triangulated_dpstate = \
+            mrcal._mrcal._triangulate_with_uncertainty(q.reshape(Npoints,2,2),
+                                                       self._method_name,
+                                                       *self._args_cameras,
+                                                       Var_q = self._Var_q_observation,
+                                                       **self._kwargs)
+
+        p = p.reshape(shape_points + (3,))
+        if Var_p_observation is not None:
+            Var_p_observation = Var_p_observation.reshape(shape_points + (3,3))
+
+        if dp_triangulated_dpstate is not None:
+            # pack the denominator by unpacking the numerator, and reshape to
+            # (Npoints*3, Nstate)
+            dp_triangulated_dpstate *= self._unpack_scale
+            Var_p_calibration = \
+                mrcal.model_analysis._propagate_calibration_uncertainty(
+                                                   nps.clump(dp_triangulated_dpstate,n=2),
+                                                   self._factorization, self._Jpacked,
+                                                   self._Nmeasurements_observations,
+                                                   self._q_calibration_stdev,
+                                                   what = 'covariance'). \
+                reshape(shape_points + (3,) + shape_points + (3,))
+        elif self._q_calibration_stdev is not None:
+            Var_p_calibration = \
+                np.zeros(shape_points + (3,) +
+                         shape_points + (3,))
+        else:
+            Var_p_calibration = None
+
+        if Var_p_observation is None:
+            return p, Var_p_calibration
+        if Var_p_calibration is None:
+            return p, Var_p_observation
+
+        # Propagating both types of noise. I create a joint covariance matrix
+        Var_p_joint = Var_p_calibration.copy()
+        Var_p_joint_flat = Var_p_joint.reshape(Npoints*3, Npoints*3)
+        Var_p_observation_flat = Var_p_observation.reshape(Npoints,3,3)
+        for ipt in range(Npoints):
+            Var_p_joint_flat[ipt*3:(ipt+1)*3,ipt*3:(ipt+1)*3] += \
+                Var_p_observation_flat[ipt,...]
+
+        return p, Var_p_calibration, Var_p_observation, Var_p_joint
+
+
+def triangulate_nview( q,
+                       models,
+                       q_observation_stdev             = None,
+                       q_observation_stdev_correlation = 0,
+                       method                          = triangulate_nview_angular):
+
+    r'''Triangulate points observed by N cameras, with uncertainty propagation
+
+SYNOPSIS
+
+    # q has shape (Npoints,Ncameras,2): pixel observations of each point in
+    # each camera
+    p, Var_p_observation = \
+        mrcal.triangulate_nview( q, models,
+                                 q_observation_stdev = q_observation_stdev )
+
+This is the N-camera counterpart to mrcal.triangulate(). Each point is observed
+by Ncameras >= 2 cameras, and all the observations are used together, instead of
+triangulating each pair of cameras, and combining the results. The pixel
+observations are unprojected, the observation vectors are transformed into the
+coordinate system of camera 0, and the lower-level N-view routine given in
+'method' is called. Both the inputs and the outputs are consistent with
+mrcal.triangulate(): q contains the observations in each camera in order, and
+the point and its covariance are reported in the coordinate system of camera 0.
+
+If q_observation_stdev is given, we propagate the observation-time noise in the
+pixel observations q to the triangulated point, exactly as mrcal.triangulate()
+does. Propagating calibration-time noise is not supported here: use
+mrcal.triangulate() for that.
+
+ARGUMENTS
+
+- q: (..., Ncameras,2) numpy array of pixel observations of each point in each
+  camera. Broadcasting is supported
+
+- models: iterable of Ncameras mrcal.cameramodel objects. The observations in
+  q[...,i,:] are from models[i]
+
+- q_observation_stdev: optional value describing the observation-time noise. If
+  omitted or None, we don't propagate this noise, and return only the
+  triangulated points. If given, this is the standard deviation of each pixel
+  coordinate in each observation
+
+- q_observation_stdev_correlation: optional value, describing the correlation
+  between the pixel coordinates observing the same feature in the different
+  cameras. Exactly as in mrcal.triangulate(). Applies to every pair of cameras.
+  Defaults to 0: independent noise
+
+- method: optional triangulation routine. Defaults to
+  mrcal.triangulate_nview_angular. The other choice is
+  mrcal.triangulate_nview_geometric
+
+RETURNED VALUE
+
+If q_observation_stdev is None: we return the (...,3) array of triangulated
+points, in the coordinate system of camera 0. Points that could not be
+triangulated are reported as (0,0,0)
+
+Otherwise we return a tuple:
+
+- (...,3) array of triangulated points
+- (...,3,3) array of the covariances of each point, due to the observation-time
+  noise
+
+    '''
+
+    Ncameras = len(models)
+    if Ncameras < 2:
+        raise Exception(f"N-view triangulation requires at least 2 cameras. Got {Ncameras}")
+
+    q = np.asarray(q, dtype=float)
+    if q.shape[-2:] != (Ncameras,2):
+        raise Exception(f"q must have shape (...,Ncameras={Ncameras},2). Got {q.shape}")
+
+    # shape (Ncameras,4,3)
+    Rt_0i = nps.cat(*[ mrcal.compose_Rt(models[0].extrinsics_Rt_fromref(),
+                                        m.extrinsics_Rt_toref()) \
+                       for m in models ])
+    R_0i = np.ascontiguousarray(Rt_0i[:,:3,:])
+    t_0i = np.ascontiguousarray(Rt_0i[:, 3,:])
+
+    get_gradients = q_observation_stdev is not None
+
+    vlocal = np.zeros(q.shape[:-1] + (3,), dtype=float)
+    if get_gradients:
+        dvlocal_dq = np.zeros(q.shape[:-1] + (3,2), dtype=float)
+    for i in range(Ncameras):
+        if get_gradients:
+            vlocal[...,i,:], dvlocal_dq[...,i,:,:], _ = \
+                mrcal.unproject(q[...,i,:], *models[i].intrinsics(),
+                                get_gradients = True)
+        else:
+            vlocal[...,i,:] = mrcal.unproject(q[...,i,:], *models[i].intrinsics())
+
+    # The observation vectors in the camera-0 coordinate system. Shape
+    # (...,Ncameras,3)
+    v = mrcal.rotate_point_R(R_0i, vlocal)
+
+    if not get_gradients:
+        return method(v, t_0i)
+
+    p, dp_dv, _ = method(v, t_0i, get_gradients = True)
+
+    # dp/dq[i] = dp/dv[i] R_0i dvlocal[i]/dq[i]. Shape (...,Ncameras,3,2)
+    dp_dq = nps.matmult(dp_dv, R_0i, dvlocal_dq)
+    # shape (...,3,Ncameras*2)
+    dp_dq = nps.clump(nps.mv(dp_dq, -3, -2), n=-2)
+
+    Var_q = _compute_Var_q_triangulation(q_observation_stdev,
+                                         q_observation_stdev_correlation,
+                                         Ncameras = Ncameras)
+    return p, nps.matmult(dp_dq, Var_q, nps.transpose(dp_dq))
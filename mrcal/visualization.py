@@ -1252,17 +1252,11 @@ plot
     if gridn_height is None:
         gridn_height = int(round(H/W*gridn_width))
 
-    lensmodel, intrinsics_data = model.intrinsics()
-
-    q    = mrcal.sample_imager( gridn_width, gridn_height, *model.imagersize() )
-    pcam = mrcal.unproject(q, *model.intrinsics(),
-                           normalize = True)
-
-    err = mrcal.projection_uncertainty(pcam * (distance if distance is not None else 1.0),
-                                       model           = model,
-                                       atinfinity      = distance is None,
-                                       what            = 'rms-stdev' if isotropic else 'worstdirection-stdev',
-                                       observed_pixel_uncertainty = observed_pixel_uncertainty)
+    err = mrcal.projection_uncertainty_grid(model,
+                                            gridn_width, gridn_height,
+                                            distance = distance,
+                                            what     = 'rms-stdev' if isotropic else 'worstdirection-stdev',
+                                            observed_pixel_uncertainty = observed_pixel_uncertainty)
     if 'title' not in kwargs:
         if distance is None:
             distance_description = ". Looking out to infinity"
@@ -22,6 +22,11 @@ typedef struct
     // The distance between adjacent knots (1 segment) is u_per_segment =
     // 1/segments_per_u
     double segments_per_u;
+
+    // Common configurations have a projection kernel specialized for that
+    // (order,Nx,Ny). This is the index of that kernel, or <0 if this
+    // configuration uses the generic kernel
+    int ispecialized_kernel;
 } mrcal_LENSMODEL_SPLINED_STEREOGRAPHIC__precomputed_t;
 
 typedef struct
@@ -56,6 +61,48 @@ bool _mrcal_project_internal_cahvore( // out
                                      // core, distortions concatenated
                                      const double* intrinsics,
                                      const double  linearity);
+// Batched CAHVORE projection. The points and the projections are given as
+// separate x,y,z and qx,qy arrays (SoA). Each array has its own stride, in
+// bytes. A stride <= 0 means "contiguous"
+bool _mrcal_project_internal_cahvore_soa( // out
+                                         double* qx, int qx_stride0,
+                                         double* qy, int qy_stride0,
+
+                                         // in
+                                         const double* px, int px_stride0,
+                                         const double* py, int py_stride0,
+                                         const double* pz, int pz_stride0,
+                                         int N,
+
+                                         // core, distortions concatenated
+                                         const double* intrinsics,
+                                         const double  linearity);
+// The general strided implementation of the projection loop. Used by
+// mrcal_project_soa() and by _mrcal_project_internal(). Strides are in bytes;
+// <= 0 means "contiguous"
+bool _mrcal_project_internal_soa( // out
+                                 double* qx,             int qx_stride0,
+                                 double* qy,             int qy_stride0,
+                                 double* dq_dp,          int dq_dp_stride0,
+                                                         int dq_dp_stride1,
+                                                         int dq_dp_stride2,
+                                 double* dq_dintrinsics, int dq_dintrinsics_stride0,
+                                                         int dq_dintrinsics_stride1,
+                                                         int dq_dintrinsics_stride2,
+                                 int dq_dintrinsics_icol0,
+                                 int dq_dintrinsics_Ncols,
+
+                                 // in
+                                 const double* px,       int px_stride0,
+                                 const double* py,       int py_stride0,
+                                 const double* pz,       int pz_stride0,
+                                 int N,
+                                 const mrcal_lensmodel_t* lensmodel,
+                                 // core, distortions concatenated
+                                 const double* intrinsics,
+
+                                 int Nintrinsics,
+                                 const mrcal_projection_precomputed_t* precomputed);
 bool _mrcal_project_internal( // out
                              mrcal_point2_t* q,
 
@@ -104,3 +151,14 @@ int _mrcal_num_j_nonzero(int Nobservations_board,
                          const mrcal_observation_point_t* observations_point,
                          mrcal_problem_selections_t problem_selections,
                          const mrcal_lensmodel_t* lensmodel);
+
+// Thread helpers used by the multithreaded image-processing functions.
+// _mrcal_run_threads() runs thread() Nthreads times in parallel; thread i gets
+// the context at &ctx[i*ctx_size], and thread 0 runs in the calling thread.
+// Returns false if we couldn't start all the threads. _mrcal_get_Nthreads()
+// returns how many threads to use to process Ntiles tiles: Nthreads <= 0 means
+// "as many as there are cores"
+bool _mrcal_run_threads(void* (*thread)(void*),
+                        void* ctx, int ctx_size,
+                        int Nthreads);
+int _mrcal_get_Nthreads(int Nthreads, int Ntiles);
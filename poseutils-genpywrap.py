@@ -32,6 +32,9 @@ m = npsp.module( name      = "_poseutils_npsp",
                  header    = r'''
 #include "poseutils.h"
 #include <string.h>
+
+// The data of point i of an (N,...) block. Used by the _..._nogil functions
+#define POINT(x) ((double*)((char*)data_slice__ ## x + i*strides_slice__ ## x[0]))
 ''')
 
 m.function( "identity_R",
@@ -884,4 +887,162 @@ We return an array of rotation matrices. Each broadcasted slice has shape (3,3)
 '''}
 )
 
+
+# Variants of the common no-gradients routines that evaluate a whole (N,...)
+# block of points per slice, with the GIL released. mrcal.poseutils splits large
+# broadcasted arrays into such blocks, and evaluates them concurrently in a
+# thread pool. These support arbitrary strides, so the blocks may be views into
+# broadcasted arrays, with a 0 stride along N
+DOCS_NOGIL = """Internal {WHAT}: N points at a time, with the GIL released
+
+This is an internal function. You probably want mrcal.{WHAT}(). See the docs for
+that function for details. This internal function differs from that one:
+
+- It evaluates a whole (N,...) block of points in each broadcasted slice,
+  releasing the GIL while doing that. So several Python threads can call this
+  function concurrently, to use several cores
+
+- It never reports gradients
+"""
+BODY_SLICE_NOGIL = r'''
+    const int N = dims_slice__output[0];
+    Py_BEGIN_ALLOW_THREADS;
+    for(int i=0; i<N; i++)
+    {{
+{CALL}
+    }}
+    Py_END_ALLOW_THREADS;
+    return true;
+'''
+
+m.function( "_rotate_point_R_nogil",
+            DOCS_NOGIL.format(WHAT = "rotate_point_R"),
+            args_input       = ('R', 'x'),
+            prototype_input  = (('N',3,3), ('N',3,)),
+            prototype_output = ('N',3,),
+            extra_args = (("int", "inverted", "false", "p"),),
+
+            Ccode_slice_eval = \
+                {np.float64:
+                 BODY_SLICE_NOGIL.format(CALL = r'''
+        mrcal_rotate_point_R_full( POINT(output),
+                                   strides_slice__output[1],
+                                   NULL,0,0,0,
+                                   NULL,0,0,
+                                   POINT(R),
+                                   strides_slice__R[1],
+                                   strides_slice__R[2],
+                                   POINT(x),
+                                   strides_slice__x[1],
+                                   *inverted );''')},
+)
+
+m.function( "_rotate_point_r_nogil",
+            DOCS_NOGIL.format(WHAT = "rotate_point_r"),
+            args_input       = ('r', 'x'),
+            prototype_input  = (('N',3,), ('N',3,)),
+            prototype_output = ('N',3,),
+            extra_args = (("int", "inverted", "false", "p"),),
+
+            Ccode_slice_eval = \
+                {np.float64:
+                 BODY_SLICE_NOGIL.format(CALL = r'''
+        mrcal_rotate_point_r_full( POINT(output),
+                                   strides_slice__output[1],
+                                   NULL,0,0,
+                                   NULL,0,0,
+                                   POINT(r),
+                                   strides_slice__r[1],
+                                   POINT(x),
+                                   strides_slice__x[1],
+                                   *inverted );''')},
+)
+
+m.function( "_transform_point_Rt_nogil",
+            DOCS_NOGIL.format(WHAT = "transform_point_Rt"),
+            args_input       = ('Rt', 'x'),
+            prototype_input  = (('N',4,3), ('N',3,)),
+            prototype_output = ('N',3,),
+            extra_args = (("int", "inverted", "false", "p"),),
+
+            Ccode_slice_eval = \
+                {np.float64:
+                 BODY_SLICE_NOGIL.format(CALL = r'''
+        mrcal_transform_point_Rt_full( POINT(output),
+                                       strides_slice__output[1],
+                                       NULL,0,0,0,
+                                       NULL,0,0,
+                                       POINT(Rt),
+                                       strides_slice__Rt[1],
+                                       strides_slice__Rt[2],
+                                       POINT(x),
+                                       strides_slice__x[1],
+                                       *inverted );''')},
+)
+
+m.function( "_transform_point_rt_nogil",
+            DOCS_NOGIL.format(WHAT = "transform_point_rt"),
+            args_input       = ('rt', 'x'),
+            prototype_input  = (('N',6,), ('N',3,)),
+            prototype_output = ('N',3,),
+            extra_args = (("int", "inverted", "false", "p"),),
+
+            Ccode_slice_eval = \
+                {np.float64:
+                 BODY_SLICE_NOGIL.format(CALL = r'''
+        mrcal_transform_point_rt_full( POINT(output),
+                                       strides_slice__output[1],
+                                       NULL,0,0,
+                                       NULL,0,0,
+                                       POINT(rt),
+                                       strides_slice__rt[1],
+                                       POINT(x),
+                                       strides_slice__x[1],
+                                       *inverted );''')},
+)
+
+m.function( "_compose_Rt_nogil",
+            DOCS_NOGIL.format(WHAT = "compose_Rt") + """
+- It supports exactly two arguments, while compose_Rt() can compose N
+  transformations
+""",
+            args_input       = ('Rt0', 'Rt1'),
+            prototype_input  = (('N',4,3,), ('N',4,3,)),
+            prototype_output = ('N',4,3),
+
+            Ccode_slice_eval = \
+                {np.float64:
+                 BODY_SLICE_NOGIL.format(CALL = r'''
+        mrcal_compose_Rt_full( POINT(output),
+                               strides_slice__output[1], strides_slice__output[2],
+                               POINT(Rt0),
+                               strides_slice__Rt0[1], strides_slice__Rt0[2],
+                               POINT(Rt1),
+                               strides_slice__Rt1[1], strides_slice__Rt1[2] );''')},
+)
+
+m.function( "_compose_rt_nogil",
+            DOCS_NOGIL.format(WHAT = "compose_rt") + """
+- It supports exactly two arguments, while compose_rt() can compose N
+  transformations
+""",
+            args_input       = ('rt0', 'rt1'),
+            prototype_input  = (('N',6,), ('N',6,)),
+            prototype_output = ('N',6,),
+
+            Ccode_slice_eval = \
+                {np.float64:
+                 BODY_SLICE_NOGIL.format(CALL = r'''
+        mrcal_compose_rt_full( POINT(output),
+                               strides_slice__output[1],
+                               NULL,0,0,
+                               NULL,0,0,
+                               NULL,0,0,
+                               NULL,0,0,
+                               POINT(rt0),
+                               strides_slice__rt0[1],
+                               POINT(rt1),
+                               strides_slice__rt1[1] );''')},
+)
+
 m.write()
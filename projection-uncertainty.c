@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "mrcal.h"
+#include "util.h"
+
+// Each tile is a row of the grid. The rows are distributed among the threads
+typedef struct
+{
+    double*                  stdev;
+
+    int                      gridn_width, gridn_height;
+    const mrcal_projector_t* projector;
+    const unsigned int*      imagersize;
+    double                   distance;
+    bool                     atinfinity;
+    const double*            rt_cam_ref;
+    double                   R_cam_ref[3*3];
+    const double*            Var_basis;
+    int                      icol0_intrinsics, Nintrinsics_state;
+    bool                     rms;
+
+    int                      ithread, Nthreads;
+    bool                     result;
+} projection_uncertainty_grid_context_t;
+
+static void* projection_uncertainty_grid_thread(void* _ctx)
+{
+    projection_uncertainty_grid_context_t* ctx = (projection_uncertainty_grid_context_t*)_ctx;
+    ctx->result = false;
+
+    const int Ni     = ctx->Nintrinsics_state;
+    const int Nbasis = Ni + 12;
+
+    // dq/dintrinsics: (2,Ni). And the non-zero columns of dq/dbasis: (2,Nbasis)
+    // with their indices in ibasis[]. For splined models only a few of the
+    // intrinsics affect each projection, so I skip all the others
+    double* dq_dintrinsics = malloc((2*Ni + 2*Nbasis)*sizeof(double));
+    int*    ibasis         = malloc(Nbasis*sizeof(int));
+    if(dq_dintrinsics == NULL || ibasis == NULL)
+    {
+        MSG("malloc() failed");
+        goto done;
+    }
+    double* dq_dbasis = &dq_dintrinsics[2*Ni];
+
+    const double W = (double)ctx->imagersize[0];
+    const double H = (double)ctx->imagersize[1];
+
+    for(int iy = ctx->ithread; iy < ctx->gridn_height; iy += ctx->Nthreads)
+    {
+        for(int ix = 0; ix < ctx->gridn_width; ix++)
+        {
+            double* stdev = &ctx->stdev[iy*ctx->gridn_width + ix];
+
+            // Same as mrcal.sample_imager()
+            const mrcal_point2_t q =
+                { .x = ctx->gridn_width  > 1 ? (W-1.) * ix / (ctx->gridn_width -1) : 0.,
+                  .y = ctx->gridn_height > 1 ? (H-1.) * iy / (ctx->gridn_height-1) : 0. };
+            mrcal_point3_t v;
+            if(!mrcal_projector_unproject(&v, &q, 1, ctx->projector))
+            {
+                *stdev = NAN;
+                continue;
+            }
+            const double norm_v = sqrt(v.x*v.x + v.y*v.y + v.z*v.z);
+            if(!(norm_v > 0.0))
+            {
+                *stdev = NAN;
+                continue;
+            }
+            // At infinity the translations don't matter, and the range of the
+            // point doesn't affect anything. So I use a unit range
+            const double   range = ctx->atinfinity ? 1.0 : ctx->distance;
+            mrcal_point3_t p_cam;
+            for(int i=0; i<3; i++)
+                p_cam.xyz[i] = v.xyz[i] * range / norm_v;
+
+            mrcal_point2_t q_reprojected;
+            double         dq_dpcam[2*3];
+            if(!mrcal_projector_project_soa(&q_reprojected.x, 0,
+                                            &q_reprojected.y, 0,
+                                            dq_dpcam, 0, 3*sizeof(double), sizeof(double),
+                                            Ni > 0 ? dq_dintrinsics : NULL,
+                                            0, Ni*sizeof(double), sizeof(double),
+                                            ctx->icol0_intrinsics, Ni,
+                                            &p_cam.x, 0,
+                                            &p_cam.y, 0,
+                                            &p_cam.z, 0,
+                                            1,
+                                            ctx->projector))
+            {
+                *stdev = NAN;
+                continue;
+            }
+
+            // dq/dstate = dq/dbasis dbasis/dstate. The basis is described in
+            // the docs for mrcal_projection_uncertainty_grid(): the optimized
+            // intrinsics, then dq/dpcam scaled by each element of (1,p_ref)
+            double p_ref[3];
+            if(ctx->rt_cam_ref != NULL)
+            {
+                double d[3];
+                for(int i=0; i<3; i++)
+                    d[i] = p_cam.xyz[i] - (ctx->atinfinity ? 0.0 : ctx->rt_cam_ref[3+i]);
+                for(int i=0; i<3; i++)
+                    p_ref[i] =
+                        ctx->R_cam_ref[0*3+i]*d[0] +
+                        ctx->R_cam_ref[1*3+i]*d[1] +
+                        ctx->R_cam_ref[2*3+i]*d[2];
+            }
+            else
+                memcpy(p_ref, p_cam.xyz, sizeof(p_ref));
+
+            int Nnonzero = 0;
+            for(int j=0; j<Ni; j++)
+            {
+                if(dq_dintrinsics[0*Ni + j] == 0.0 &&
+                   dq_dintrinsics[1*Ni + j] == 0.0)
+                    continue;
+                dq_dbasis[0*Nbasis + Nnonzero] = dq_dintrinsics[0*Ni + j];
+                dq_dbasis[1*Nbasis + Nnonzero] = dq_dintrinsics[1*Ni + j];
+                ibasis[Nnonzero++]             = j;
+            }
+            // At infinity g0 isn't used: it comes from the translations only
+            const double c[4] = {1.0, p_ref[0], p_ref[1], p_ref[2]};
+            for(int m=ctx->atinfinity ? 1 : 0; m<4; m++)
+                for(int j=0; j<3; j++)
+                {
+                    dq_dbasis[0*Nbasis + Nnonzero] = dq_dpcam[0*3 + j] * c[m];
+                    dq_dbasis[1*Nbasis + Nnonzero] = dq_dpcam[1*3 + j] * c[m];
+                    ibasis[Nnonzero++]             = Ni + 3*m + j;
+                }
+
+            // Var(q) = dq/dbasis Var(basis) transpose(dq/dbasis)
+            double Var_q[3] = {}; // 00, 01, 11
+            for(int k=0; k<Nnonzero; k++)
+            {
+                const double* Var_basis_row = &ctx->Var_basis[ibasis[k]*Nbasis];
+                double s0 = 0.0, s1 = 0.0;
+                for(int l=0; l<Nnonzero; l++)
+                {
+                    const double m = Var_basis_row[ibasis[l]];
+                    s0 += m * dq_dbasis[0*Nbasis + l];
+                    s1 += m * dq_dbasis[1*Nbasis + l];
+                }
+                Var_q[0] += dq_dbasis[0*Nbasis + k] * s0;
+                Var_q[1] += dq_dbasis[0*Nbasis + k] * s1;
+                Var_q[2] += dq_dbasis[1*Nbasis + k] * s1;
+            }
+
+            // Same as mrcal.worst_direction_stdev() and the 'rms-stdev' path in
+            // mrcal.projection_uncertainty()
+            const double a = Var_q[0], b = Var_q[1], cc = Var_q[2];
+            if(ctx->rms)
+                *stdev = sqrt((a+cc)/2.);
+            else
+                *stdev = sqrt((a+cc)/2. + sqrt( (a-cc)*(a-cc)/4. + b*b));
+        }
+    }
+
+    ctx->result = true;
+
+ done:
+    free(dq_dintrinsics);
+    free(ibasis);
+    return NULL;
+}
+
+bool mrcal_projection_uncertainty_grid( // output
+                                        double* stdev,
+
+                                        // input
+                                        int gridn_width, int gridn_height,
+                                        const mrcal_lensmodel_t* lensmodel,
+                                        const double*            intrinsics,
+                                        const unsigned int*      imagersize,
+                                        double                   distance,
+                                        bool                     atinfinity,
+                                        const double*            rt_cam_ref,
+                                        const double*            Var_basis,
+                                        int icol0_intrinsics, int Nintrinsics_state,
+                                        bool rms,
+                                        int Nthreads)
+{
+    if(gridn_width <= 0 || gridn_height <= 0)
+    {
+        MSG("The grid must be non-empty. Got gridn_width=%d, gridn_height=%d",
+            gridn_width, gridn_height);
+        return false;
+    }
+    if(Nintrinsics_state < 0 || icol0_intrinsics < 0 ||
+       icol0_intrinsics + Nintrinsics_state > mrcal_lensmodel_num_params(lensmodel))
+    {
+        MSG("Invalid optimized-intrinsics columns: icol0_intrinsics=%d, Nintrinsics_state=%d",
+            icol0_intrinsics, Nintrinsics_state);
+        return false;
+    }
+
+    mrcal_projector_t* projector = mrcal_projector_new(lensmodel, intrinsics);
+    if(projector == NULL)
+        return false;
+
+    bool result = false;
+    {
+        Nthreads = _mrcal_get_Nthreads(Nthreads, gridn_height);
+
+        projection_uncertainty_grid_context_t ctx[Nthreads];
+        for(int i=0; i<Nthreads; i++)
+            ctx[i] = (projection_uncertainty_grid_context_t)
+                { .stdev             = stdev,
+                  .gridn_width       = gridn_width,
+                  .gridn_height      = gridn_height,
+                  .projector         = projector,
+                  .imagersize        = imagersize,
+                  .distance          = distance,
+                  .atinfinity        = atinfinity,
+                  .rt_cam_ref        = rt_cam_ref,
+                  .Var_basis         = Var_basis,
+                  .icol0_intrinsics  = icol0_intrinsics,
+                  .Nintrinsics_state = Nintrinsics_state,
+                  .rms               = rms,
+                  .ithread           = i,
+                  .Nthreads          = Nthreads };
+        if(rt_cam_ref != NULL)
+            for(int i=0; i<Nthreads; i++)
+                mrcal_R_from_r(ctx[i].R_cam_ref, NULL, rt_cam_ref);
+
+        result = _mrcal_run_threads(&projection_uncertainty_grid_thread,
+                                    ctx, sizeof(ctx[0]), Nthreads);
+        for(int i=0; i<Nthreads; i++)
+            result = result && ctx[i].result;
+    }
+
+    mrcal_projector_free(&projector);
+    return result;
+}
@@ -0,0 +1,435 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "mrcal.h"
+#include "util.h"
+
+// The output image is processed in tiles of this many rows. The tiles are
+// distributed among the threads
+#define REMAP_TILE_NROWS 16
+
+// Each bilinear weight is a product of two quantized fractions, so the weights
+// sum to (1 << REMAP_WEIGHT_BITS)
+#define REMAP_WEIGHT_BITS (2*MRCAL_REMAP_FRACTION_BITS)
+
+typedef struct
+{
+    char*                    image_out;
+    int                      Nwidth_out, Nheight_out, stride_out;
+
+    const char*              image_in;
+    int                      Nwidth_in, Nheight_in, stride_in;
+
+    mrcal_remap_pixel_type_t pixel_type;
+    int                      Nchannels;
+    const int16_t*           map_xy;
+    const uint16_t*          map_fraction;
+    double                   border_value;
+
+    int                      ithread, Nthreads;
+} remap_context_t;
+
+// The transformation maps are computed one row at a time, in tiles of this
+// many rows
+#define TRANSFORMATION_MAP_TILE_NROWS 16
+
+typedef struct
+{
+    float*                   mapxy;
+    const mrcal_projector_t* projector_from;
+    const mrcal_projector_t* projector_to;
+    // Non-NULL if the corresponding model is LENSMODEL_PINHOLE
+    const double*            fxycxy_from;
+    const double*            fxycxy_to;
+    const double*            M;
+    int                      Nwidth, Nheight;
+
+    int                      ithread, Nthreads;
+    bool                     result;
+} transformation_map_context_t;
+
+static void* transformation_map_thread(void* _ctx)
+{
+    transformation_map_context_t* ctx = (transformation_map_context_t*)_ctx;
+    ctx->result = false;
+
+    const int     W = ctx->Nwidth;
+    const double* M = ctx->M;
+
+    mrcal_point3_t* v = malloc(W*sizeof(mrcal_point3_t));
+    mrcal_point2_t* q = malloc(W*sizeof(mrcal_point2_t));
+    if(v == NULL || q == NULL)
+    {
+        MSG("malloc() failed");
+        goto done;
+    }
+
+    for(int iy0 = ctx->ithread*TRANSFORMATION_MAP_TILE_NROWS;
+        iy0 < ctx->Nheight;
+        iy0 += ctx->Nthreads*TRANSFORMATION_MAP_TILE_NROWS)
+    {
+        for(int iy = iy0;
+            iy < iy0 + TRANSFORMATION_MAP_TILE_NROWS && iy < ctx->Nheight;
+            iy++)
+        {
+            if(ctx->fxycxy_to != NULL)
+            {
+                // Pinhole TO model. The unprojection is linear, so
+                //   v = M (x_normalized(ix), y_normalized, 1)
+                // is linear in ix: v = v0 + ix*dv
+                const double* fxycxy = ctx->fxycxy_to;
+                const double  x0 = -fxycxy[2] / fxycxy[0];
+                const double  y  = ((double)iy - fxycxy[3]) / fxycxy[1];
+
+                double v0[3], dv[3];
+                for(int i=0; i<3; i++)
+                {
+                    v0[i] = M[3*i+0]*x0 + M[3*i+1]*y + M[3*i+2];
+                    dv[i] = M[3*i+0] / fxycxy[0];
+                }
+                for(int ix=0; ix<W; ix++)
+                    v[ix] = (mrcal_point3_t){.x = v0[0] + (double)ix*dv[0],
+                                             .y = v0[1] + (double)ix*dv[1],
+                                             .z = v0[2] + (double)ix*dv[2]};
+            }
+            else
+            {
+                for(int ix=0; ix<W; ix++)
+                    q[ix] = (mrcal_point2_t){.x = (double)ix, .y = (double)iy};
+                if(!mrcal_projector_unproject(v, q, W, ctx->projector_to))
+                    goto done;
+                for(int ix=0; ix<W; ix++)
+                {
+                    const mrcal_point3_t vto = v[ix];
+                    mrcal_rotate_point_R(v[ix].xyz, NULL, NULL,
+                                         M, vto.xyz);
+                }
+            }
+
+            float* map = &ctx->mapxy[iy*W*2];
+            if(ctx->fxycxy_from != NULL)
+            {
+                // Pinhole FROM model: same as mrcal_project_pinhole()
+                const double* fxycxy = ctx->fxycxy_from;
+                for(int ix=0; ix<W; ix++)
+                {
+                    const double zrecip = 1. / v[ix].z;
+                    map[2*ix + 0] = (float)(v[ix].x*zrecip*fxycxy[0] + fxycxy[2]);
+                    map[2*ix + 1] = (float)(v[ix].y*zrecip*fxycxy[1] + fxycxy[3]);
+                }
+            }
+            else
+            {
+                if(!mrcal_projector_project(q, NULL, NULL,
+                                            v, W, ctx->projector_from))
+                    goto done;
+                for(int ix=0; ix<W; ix++)
+                {
+                    map[2*ix + 0] = (float)q[ix].x;
+                    map[2*ix + 1] = (float)q[ix].y;
+                }
+            }
+        }
+    }
+
+    ctx->result = true;
+
+ done:
+    free(v);
+    free(q);
+    return NULL;
+}
+
+bool mrcal_image_transformation_map( // output
+                                     float* mapxy,
+
+                                     // input
+                                     const mrcal_lensmodel_t* lensmodel_from,
+                                     const double*            intrinsics_from,
+                                     const mrcal_lensmodel_t* lensmodel_to,
+                                     const double*            intrinsics_to,
+                                     const double*            M,
+                                     const unsigned int*      imagersize_to,
+                                     int                      Nthreads)
+{
+    bool result = false;
+
+    // I only need the projectors for the non-pinhole sides
+    mrcal_projector_t* projector_from = NULL;
+    mrcal_projector_t* projector_to   = NULL;
+    const bool pinhole_from = lensmodel_from->type == MRCAL_LENSMODEL_PINHOLE;
+    const bool pinhole_to   = lensmodel_to  ->type == MRCAL_LENSMODEL_PINHOLE;
+
+    // mrcal_projector_unproject() needs gradients. I check this here to fail
+    // once, instead of in each thread
+    if(!pinhole_to && !mrcal_lensmodel_metadata(lensmodel_to).has_gradients)
+    {
+        MSG("mrcal_image_transformation_map(lensmodel_to='%s') is not yet implemented: we need gradients",
+            mrcal_lensmodel_name_unconfigured(lensmodel_to));
+        return false;
+    }
+
+    if(!pinhole_from &&
+       NULL == (projector_from = mrcal_projector_new(lensmodel_from, intrinsics_from)))
+        goto done;
+    if(!pinhole_to &&
+       NULL == (projector_to   = mrcal_projector_new(lensmodel_to,   intrinsics_to)))
+        goto done;
+
+    const int W = (int)imagersize_to[0];
+    const int H = (int)imagersize_to[1];
+
+    Nthreads = _mrcal_get_Nthreads(Nthreads,
+                                   (H + TRANSFORMATION_MAP_TILE_NROWS-1) / TRANSFORMATION_MAP_TILE_NROWS);
+
+    {
+        transformation_map_context_t ctx[Nthreads];
+        for(int i=0; i<Nthreads; i++)
+            ctx[i] = (transformation_map_context_t)
+                { .mapxy          = mapxy,
+                  .projector_from = projector_from,
+                  .projector_to   = projector_to,
+                  .fxycxy_from    = pinhole_from ? intrinsics_from : NULL,
+                  .fxycxy_to      = pinhole_to   ? intrinsics_to   : NULL,
+                  .M              = M,
+                  .Nwidth         = W,
+                  .Nheight        = H,
+                  .ithread        = i,
+                  .Nthreads       = Nthreads };
+
+        result = _mrcal_run_threads(&transformation_map_thread,
+                                    ctx, sizeof(ctx[0]), Nthreads);
+        for(int i=0; i<Nthreads; i++)
+            result = result && ctx[i].result;
+    }
+
+ done:
+    mrcal_projector_free(&projector_from);
+    mrcal_projector_free(&projector_to);
+    return result;
+}
+
+void mrcal_remap_map_fixedpoint( // out
+                                 int16_t*  map_xy,
+                                 uint16_t* map_fraction,
+                                 // in
+                                 const float* mapxy,
+                                 int N )
+{
+    for(int i=0; i<N; i++)
+    {
+        const float x = mapxy[2*i + 0] * (float)MRCAL_REMAP_FRACTION_N;
+        const float y = mapxy[2*i + 1] * (float)MRCAL_REMAP_FRACTION_N;
+
+        // The range check is written to fail for NaN also
+        const float max = (float)(INT16_MAX << MRCAL_REMAP_FRACTION_BITS);
+        if( !(x > -max && x < max &&
+              y > -max && y < max) )
+        {
+            // Entirely out of bounds: the neighbor at +1 is out of bounds also
+            map_xy[2*i + 0] = INT16_MIN;
+            map_xy[2*i + 1] = INT16_MIN;
+            map_fraction[i] = 0;
+            continue;
+        }
+
+        const int ix = (int)lrintf(x);
+        const int iy = (int)lrintf(y);
+
+        // >> rounds towards -infinity, so this works for negative coordinates
+        // also
+        map_xy[2*i + 0] = (int16_t)(ix >> MRCAL_REMAP_FRACTION_BITS);
+        map_xy[2*i + 1] = (int16_t)(iy >> MRCAL_REMAP_FRACTION_BITS);
+        map_fraction[i] = (uint16_t)( ((iy & (MRCAL_REMAP_FRACTION_N-1)) << MRCAL_REMAP_FRACTION_BITS) |
+                                       (ix & (MRCAL_REMAP_FRACTION_N-1)) );
+    }
+}
+
+// The interpolation kernels. I generate one per pixel type, and specialize each
+// on the number of channels, so that the channel loops have compile-time
+// bounds. The integer types are interpolated entirely in fixed-point
+#define NORMALIZE_INTEGER(accum) (((accum) + (1 << (REMAP_WEIGHT_BITS-1))) >> REMAP_WEIGHT_BITS)
+#define NORMALIZE_FLOAT(accum)   ((accum) * (1.0f / (float)(1 << REMAP_WEIGHT_BITS)))
+
+#define REMAP_ROW(name, T, accum_t, NORMALIZE)                          \
+static inline __attribute__((always_inline))                            \
+void remap_row_ ## name ## _Nchannels(T* restrict out,                  \
+                                      const remap_context_t* ctx,       \
+                                      const int16_t*  map_xy,           \
+                                      const uint16_t* map_fraction,     \
+                                      const T border,                   \
+                                      const int Nchannels)              \
+{                                                                       \
+    const int W = ctx->Nwidth_in;                                       \
+    const int H = ctx->Nheight_in;                                      \
+                                                                        \
+    for(int i=0; i<ctx->Nwidth_out; i++, out += Nchannels)              \
+    {                                                                   \
+        const int x  = map_xy[2*i + 0];                                 \
+        const int y  = map_xy[2*i + 1];                                 \
+        const int fx = map_fraction[i] & (MRCAL_REMAP_FRACTION_N-1);    \
+        const int fy = map_fraction[i] >> MRCAL_REMAP_FRACTION_BITS;    \
+                                                                        \
+        const accum_t w00 = (accum_t)((MRCAL_REMAP_FRACTION_N-fx) * (MRCAL_REMAP_FRACTION_N-fy)); \
+        const accum_t w10 = (accum_t)(                        fx  * (MRCAL_REMAP_FRACTION_N-fy)); \
+        const accum_t w01 = (accum_t)((MRCAL_REMAP_FRACTION_N-fx) *                         fy ); \
+        const accum_t w11 = (accum_t)(                        fx  *                         fy ); \
+                                                                        \
+        const T* p00 = (const T*)&ctx->image_in[y*ctx->stride_in] + x*Nchannels; \
+                                                                        \
+        if(x >= 0 && y >= 0 && x < W-1 && y < H-1)                      \
+        {                                                               \
+            /* All 4 neighbors are in bounds. This is the usual case */ \
+            const T* p01 = (const T*)((const char*)p00 + ctx->stride_in); \
+            for(int c=0; c<Nchannels; c++)                              \
+                out[c] = (T)NORMALIZE( w00*(accum_t)p00[c] + w10*(accum_t)p00[Nchannels + c] + \
+                                       w01*(accum_t)p01[c] + w11*(accum_t)p01[Nchannels + c] ); \
+            continue;                                                   \
+        }                                                               \
+        if(x < -1 || y < -1 || x >= W || y >= H)                        \
+        {                                                               \
+            /* All 4 neighbors are out of bounds */                     \
+            for(int c=0; c<Nchannels; c++)                              \
+                out[c] = border;                                        \
+            continue;                                                   \
+        }                                                               \
+                                                                        \
+        /* At the edge of the image. Out-of-bounds neighbors have the border \
+           value */                                                     \
+        const bool in_x0 = x   >= 0, in_x1 = x+1 < W;                   \
+        const bool in_y0 = y   >= 0, in_y1 = y+1 < H;                   \
+        const T* p01 = (const T*)((const char*)p00 + ctx->stride_in);   \
+        for(int c=0; c<Nchannels; c++)                                  \
+        {                                                               \
+            const accum_t v00 = (accum_t)((in_x0 && in_y0) ? p00[c]             : border); \
+            const accum_t v10 = (accum_t)((in_x1 && in_y0) ? p00[Nchannels + c] : border); \
+            const accum_t v01 = (accum_t)((in_x0 && in_y1) ? p01[c]             : border); \
+            const accum_t v11 = (accum_t)((in_x1 && in_y1) ? p01[Nchannels + c] : border); \
+            out[c] = (T)NORMALIZE( w00*v00 + w10*v10 + w01*v01 + w11*v11 ); \
+        }                                                               \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+static void remap_row_ ## name(char* out,                               \
+                               const remap_context_t* ctx,              \
+                               const int16_t*  map_xy,                  \
+                               const uint16_t* map_fraction)            \
+{                                                                       \
+    const T border = (T)ctx->border_value;                              \
+    switch(ctx->Nchannels)                                              \
+    {                                                                   \
+    case 1: remap_row_ ## name ## _Nchannels((T*)out, ctx, map_xy, map_fraction, border, 1); break; \
+    case 2: remap_row_ ## name ## _Nchannels((T*)out, ctx, map_xy, map_fraction, border, 2); break; \
+    case 3: remap_row_ ## name ## _Nchannels((T*)out, ctx, map_xy, map_fraction, border, 3); break; \
+    case 4: remap_row_ ## name ## _Nchannels((T*)out, ctx, map_xy, map_fraction, border, 4); break; \
+    default: ;                                                          \
+    }                                                                   \
+}
+
+REMAP_ROW(UINT8,  uint8_t,  int32_t, NORMALIZE_INTEGER)
+REMAP_ROW(UINT16, uint16_t, int32_t, NORMALIZE_INTEGER)
+REMAP_ROW(FLOAT,  float,    float,   NORMALIZE_FLOAT)
+
+#undef REMAP_ROW
+#undef NORMALIZE_INTEGER
+#undef NORMALIZE_FLOAT
+
+static void* remap_thread(void* _ctx)
+{
+    const remap_context_t* ctx = (const remap_context_t*)_ctx;
+
+    for(int iy0 = ctx->ithread*REMAP_TILE_NROWS;
+        iy0 < ctx->Nheight_out;
+        iy0 += ctx->Nthreads*REMAP_TILE_NROWS)
+    {
+        for(int iy = iy0;
+            iy < iy0 + REMAP_TILE_NROWS && iy < ctx->Nheight_out;
+            iy++)
+        {
+            char*           out          = &ctx->image_out[iy*ctx->stride_out];
+            const int16_t*  map_xy       = &ctx->map_xy      [iy*ctx->Nwidth_out*2];
+            const uint16_t* map_fraction = &ctx->map_fraction[iy*ctx->Nwidth_out];
+
+            switch(ctx->pixel_type)
+            {
+#define REMAP_ROW_CASE(name,type)                                       \
+            case MRCAL_REMAP_PIXEL_ ## name:                            \
+                remap_row_ ## name(out, ctx, map_xy, map_fraction);     \
+                break;
+                MRCAL_REMAP_PIXEL_TYPE_LIST(REMAP_ROW_CASE)
+#undef REMAP_ROW_CASE
+            default: ;
+            }
+        }
+    }
+    return NULL;
+}
+
+bool mrcal_remap( // out
+                  void*                    image_out,
+                  int                      Nwidth_out,
+                  int                      Nheight_out,
+                  int                      stride_out,
+
+                  // in
+                  const void*              image_in,
+                  int                      Nwidth_in,
+                  int                      Nheight_in,
+                  int                      stride_in,
+
+                  mrcal_remap_pixel_type_t pixel_type,
+                  int                      Nchannels,
+                  const int16_t*           map_xy,
+                  const uint16_t*          map_fraction,
+                  double                   border_value,
+                  int                      Nthreads)
+{
+    if(Nchannels < 1 || Nchannels > 4)
+    {
+        MSG("Nchannels must be in [1,4]; got %d", Nchannels);
+        return false;
+    }
+
+    int pixel_size;
+    switch(pixel_type)
+    {
+#define PIXEL_SIZE_CASE(name,type)                                      \
+    case MRCAL_REMAP_PIXEL_ ## name: pixel_size = Nchannels*(int)sizeof(type); break;
+        MRCAL_REMAP_PIXEL_TYPE_LIST(PIXEL_SIZE_CASE)
+#undef PIXEL_SIZE_CASE
+    default:
+        MSG("Unknown pixel_type %d", (int)pixel_type);
+        return false;
+    }
+
+    if(stride_out <= 0) stride_out = Nwidth_out*pixel_size;
+    if(stride_in  <= 0) stride_in  = Nwidth_in *pixel_size;
+
+    Nthreads = _mrcal_get_Nthreads(Nthreads,
+                                   (Nheight_out + REMAP_TILE_NROWS-1) / REMAP_TILE_NROWS);
+
+    remap_context_t ctx[Nthreads];
+    for(int i=0; i<Nthreads; i++)
+        ctx[i] = (remap_context_t)
+            { .image_out    = (char*)image_out,
+              .Nwidth_out   = Nwidth_out,
+              .Nheight_out  = Nheight_out,
+              .stride_out   = stride_out,
+              .image_in     = (const char*)image_in,
+              .Nwidth_in    = Nwidth_in,
+              .Nheight_in   = Nheight_in,
+              .stride_in    = stride_in,
+              .pixel_type   = pixel_type,
+              .Nchannels    = Nchannels,
+              .map_xy       = map_xy,
+              .map_fraction = map_fraction,
+              .border_value = border_value,
+              .ithread      = i,
+              .Nthreads     = Nthreads };
+
+    return _mrcal_run_threads(&remap_thread,
+                              ctx, sizeof(ctx[0]), Nthreads);
+}
@@ -0,0 +1,579 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "mrcal.h"
+#include "util.h"
+
+// A semi-global matcher (Hirschmüller, "Stereo Processing by Semiglobal
+// Matching and Mutual Information", 2008). The matching cost is the Hamming
+// distance between 5x5 census transforms. The costs are aggregated along 4 or 8
+// directions, and the best disparity is refined to subpixel precision with a
+// parabola fit. Finally the matches are validated with a uniqueness check and a
+// left/right consistency check
+//
+// Each aggregation direction decomposes the image into independent straight
+// lines of pixels (rows, columns, diagonals, anti-diagonals). So each direction
+// is processed by distributing its lines among the threads, with no
+// approximation at the thread boundaries. The directions are processed one
+// after another, so the threads never write to the same aggregated cost at the
+// same time
+
+// The census transform compares each pixel to its neighbors in a window of this
+// radius. A radius of 2 produces a 5x5 window, with 24 bits per pixel
+#define SGM_CENSUS_RADIUS 2
+#define SGM_COST_MAX      ((2*SGM_CENSUS_RADIUS+1)*(2*SGM_CENSUS_RADIUS+1) - 1)
+
+// The per-row phases process tiles of this many rows. The aggregation phases
+// process tiles of this many lines of pixels, in lockstep. The tiles are
+// distributed among the threads
+#define SGM_TILE_NROWS  16
+#define SGM_TILE_NLINES 16
+
+// The aggregated path costs are bounded by SGM_COST_MAX + P2, and their sums are
+// bounded by 8 times that. mrcal_stereo_sgm() makes sure this stays below this
+// sentinel, so all the costs are stored as int16_t: signed 16-bit min() is
+// available in every SIMD instruction set, so the aggregation vectorizes well.
+// The sentinel is the cost of the out-of-bounds disparities on either side of
+// each path cost buffer
+#define SGM_PATH_COST_SENTINEL 0x3FFF
+
+typedef enum { SGM_PHASE_CENSUS,
+               SGM_PHASE_COST,
+               SGM_PHASE_AGGREGATE,
+               SGM_PHASE_SELECT } sgm_phase_t;
+
+typedef struct
+{
+    int16_t*                             disparity;
+
+    const uint8_t*                       images[2];
+    int                                  W, H;
+    const mrcal_stereo_sgm_parameters_t* parameters;
+
+    // Intermediate results, shared by all the threads
+    uint32_t*                            census[2]; // (H,W)
+    uint8_t*                             cost;      // (H,W,Ndisparities)
+    int16_t*                             S;         // (H,W,Ndisparities)
+
+    sgm_phase_t                          phase;
+    // The direction being aggregated, for SGM_PHASE_AGGREGATE. The first
+    // direction initializes S
+    int                                  dx, dy;
+    bool                                 initialize_S;
+
+    int                                  ithread, Nthreads;
+    bool                                 result;
+} sgm_context_t;
+
+static void census_row(// out
+                       uint32_t* restrict census,
+                       // in
+                       const uint8_t* restrict image, int W, int H, int y)
+{
+    const uint8_t* center = &image[y*W];
+
+    for(int x=0; x<W; x++)
+        census[x] = 0;
+
+    // Each neighbor contributes one bit. I loop over the neighbors on the
+    // outside, so that the inner loop over the pixels can be vectorized. The
+    // neighbors outside the image are clamped to the image edge
+    for(int dy=-SGM_CENSUS_RADIUS; dy<=SGM_CENSUS_RADIUS; dy++)
+    {
+        int yy = y+dy;
+        if(yy < 0)  yy = 0;
+        if(yy >= H) yy = H-1;
+        const uint8_t* row = &image[yy*W];
+
+        for(int dx=-SGM_CENSUS_RADIUS; dx<=SGM_CENSUS_RADIUS; dx++)
+        {
+            if(dx == 0 && dy == 0)
+                continue;
+
+            int x = 0;
+            for(; x<W && x+dx < 0; x++)
+                census[x] = (census[x] << 1) | (row[0] < center[x]);
+            const int x1 = W-dx < W ? W-dx : W;
+            for(; x<x1; x++)
+                census[x] = (census[x] << 1) | (row[x+dx] < center[x]);
+            for(; x<W; x++)
+                census[x] = (census[x] << 1) | (row[W-1] < center[x]);
+        }
+    }
+}
+
+// A portable popcount() that the compiler can vectorize
+static inline uint8_t popcount32(uint32_t x)
+{
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    return (uint8_t)((x * 0x01010101u) >> 24);
+}
+
+static void cost_row(// out
+                     uint8_t* restrict cost,
+                     // in
+                     const uint32_t* restrict census0, const uint32_t* restrict census1,
+                     int W, int disparity_min, int Ndisparities)
+{
+    for(int x=0; x<W; x++)
+    {
+        uint8_t* c = &cost[x*Ndisparities];
+
+        // camera1 is to the right of camera0, so it sees the same feature
+        // further to the left: at x1 = x - disparity_min - d. I split the
+        // disparities into those where x1 is in bounds, and the others
+        int d_lo = x - disparity_min - (W-1);
+        int d_hi = x - disparity_min + 1;
+        if(d_lo < 0)            d_lo = 0;
+        if(d_hi > Ndisparities) d_hi = Ndisparities;
+        if(d_hi < d_lo)         d_hi = d_lo;
+
+        const uint32_t c0 = census0[x];
+        int d=0;
+        for(; d<d_lo;         d++) c[d] = SGM_COST_MAX;
+        for(; d<d_hi;         d++) c[d] = popcount32(c0 ^ census1[x - disparity_min - d]);
+        for(; d<Ndisparities; d++) c[d] = SGM_COST_MAX;
+    }
+}
+
+// One step along an aggregation path. Lprev and L have Ndisparities+2
+// elements, with sentinels at each end, so that the d-1 and d+1 neighbors
+// always exist. This loop is written to be vectorized by the compiler
+//
+// The aggregated cost S is accumulated, unless this is the first path to
+// touch it, in which case it's initialized
+static int16_t path_step(// out
+                         int16_t* restrict L,
+                         int16_t* restrict S,
+                         // in
+                         const int16_t* restrict Lprev,
+                         int16_t                 Lprev_min,
+                         const uint8_t* restrict cost,
+                         int Ndisparities, int16_t P1, int16_t P2,
+                         bool initialize_S)
+{
+    const int16_t jump = Lprev_min + P2;
+    int16_t       Lmin = SGM_PATH_COST_SENTINEL;
+
+    for(int d=0; d<Ndisparities; d++)
+    {
+        int16_t a = Lprev[d+1];
+        int16_t b = Lprev[d] < Lprev[d+2] ? Lprev[d] : Lprev[d+2];
+        b += P1;
+        if(b    < a) a = b;
+        if(jump < a) a = jump;
+
+        a = a + cost[d] - Lprev_min;
+
+        L[d+1] = a;
+        S[d]   = initialize_S ? a : S[d] + a;
+        if(a < Lmin) Lmin = a;
+    }
+    return Lmin;
+}
+
+// The lines of pixels for the direction (dx,dy). dy = 0 or 1. I return the
+// number of lines. If iline >= 0, I also return the starting pixel and length
+// of that line
+static int aggregation_line(// out
+                            int* x0, int* y0, int* N,
+                            // in
+                            int iline, int dx, int dy, int W, int H)
+{
+    if(dy == 0)
+    {
+        // rows
+        if(iline >= 0)
+        {
+            *x0 = 0; *y0 = iline; *N = W;
+        }
+        return H;
+    }
+    if(dx == 0)
+    {
+        // columns
+        if(iline >= 0)
+        {
+            *x0 = iline; *y0 = 0; *N = H;
+        }
+        return W;
+    }
+
+    // Diagonals. The lines start at each pixel in the top row, and then at each
+    // pixel in the left (dx>0) or right (dx<0) column
+    if(iline >= 0)
+    {
+        if(iline < W)
+        {
+            *x0 = iline;
+            *y0 = 0;
+            const int Nx = dx > 0 ? W-iline : iline+1;
+            *N = Nx < H ? Nx : H;
+        }
+        else
+        {
+            *x0 = dx > 0 ? 0 : W-1;
+            *y0 = iline - W + 1;
+            const int Ny = H - *y0;
+            *N = Ny < W ? Ny : W;
+        }
+    }
+    return W+H-1;
+}
+
+static bool aggregate(sgm_context_t* ctx)
+{
+    const int      W            = ctx->W;
+    const int      H            = ctx->H;
+    const int      Ndisparities = ctx->parameters->Ndisparities;
+    const int16_t P1           = (int16_t)ctx->parameters->P1;
+    const int16_t P2           = (int16_t)ctx->parameters->P2;
+    const int      dx           = ctx->dx;
+    const int      dy           = ctx->dy;
+
+    // Two path-cost buffers per line: the previous and the current step
+    const int Nbuf = Ndisparities+2;
+    int16_t* buffers = malloc(2*SGM_TILE_NLINES*Nbuf*sizeof(int16_t));
+    if(buffers == NULL)
+    {
+        MSG("malloc() failed");
+        return false;
+    }
+
+    const int Nlines = aggregation_line(NULL,NULL,NULL, -1, dx,dy, W,H);
+
+    for(int iline0 = ctx->ithread*SGM_TILE_NLINES;
+        iline0 < Nlines;
+        iline0 += ctx->Nthreads*SGM_TILE_NLINES)
+    {
+        const int Nlines_tile =
+            iline0 + SGM_TILE_NLINES <= Nlines ?
+            SGM_TILE_NLINES : Nlines - iline0;
+
+        // Only the first Nlines_tile entries are used. The rest are zeroed to
+        // pacify the compiler
+        int x0[SGM_TILE_NLINES] = {}, y0[SGM_TILE_NLINES] = {}, N[SGM_TILE_NLINES] = {};
+        int Nmax = 0;
+        for(int j=0; j<Nlines_tile; j++)
+        {
+            aggregation_line(&x0[j], &y0[j], &N[j], iline0+j, dx,dy, W,H);
+            if(N[j] > Nmax) Nmax = N[j];
+        }
+
+        // Forward along (dx,dy), then backward
+        for(int sign = 1; sign >= -1; sign -= 2)
+        {
+            int16_t* Lprev[SGM_TILE_NLINES];
+            int16_t* L    [SGM_TILE_NLINES];
+            int16_t  Lprev_min[SGM_TILE_NLINES];
+            for(int j=0; j<Nlines_tile; j++)
+            {
+                Lprev[j] = &buffers[(2*j + 0)*Nbuf];
+                L    [j] = &buffers[(2*j + 1)*Nbuf];
+
+                // The first step along each path has no predecessor: L = cost
+                memset(Lprev[j], 0, Nbuf*sizeof(int16_t));
+                Lprev[j][0] = Lprev[j][Nbuf-1] = SGM_PATH_COST_SENTINEL;
+                L    [j][0] = L    [j][Nbuf-1] = SGM_PATH_COST_SENTINEL;
+                Lprev_min[j] = 0;
+            }
+
+            for(int istep=0; istep<Nmax; istep++)
+                for(int j=0; j<Nlines_tile; j++)
+                {
+                    if(istep >= N[j])
+                        continue;
+                    const int k = sign > 0 ? istep : N[j]-1-istep;
+                    const int i = (y0[j] + k*dy)*W + x0[j] + k*dx;
+
+                    Lprev_min[j] = path_step(L[j], &ctx->S[i*Ndisparities],
+                                             Lprev[j], Lprev_min[j],
+                                             &ctx->cost[i*Ndisparities],
+                                             Ndisparities, P1, P2,
+                                             ctx->initialize_S && sign > 0);
+                    int16_t* t = Lprev[j];
+                    Lprev[j] = L[j];
+                    L[j]     = t;
+                }
+        }
+    }
+
+    free(buffers);
+    return true;
+}
+
+static bool select_disparities(sgm_context_t* ctx)
+{
+    const mrcal_stereo_sgm_parameters_t* parameters = ctx->parameters;
+
+    const int W             = ctx->W;
+    const int Ndisparities  = parameters->Ndisparities;
+    const int disparity_min = parameters->disparity_min;
+
+    // Per-row scratch: the integer disparities in camera0 and camera1
+    int* d0 = malloc(W*sizeof(int));
+    int* d1 = malloc(W*sizeof(int));
+    if(d0 == NULL || d1 == NULL)
+    {
+        MSG("malloc() failed");
+        free(d0);
+        free(d1);
+        return false;
+    }
+
+    for(int y0 = ctx->ithread*SGM_TILE_NROWS;
+        y0 < ctx->H;
+        y0 += ctx->Nthreads*SGM_TILE_NROWS)
+        for(int y = y0; y < y0 + SGM_TILE_NROWS && y < ctx->H; y++)
+        {
+            int16_t* disparity = &ctx->disparity[y*W];
+
+            // The best match for each pixel in camera1 is found from the same
+            // aggregated costs: along the diagonal of the cost volume. This
+            // approximation is described in the SGM paper, and is used by
+            // OpenCV too
+            if(parameters->disp12_max_diff >= 0)
+                for(int x1=0; x1<W; x1++)
+                {
+                    int d_lo = -x1 - disparity_min;
+                    int d_hi = W - x1 - disparity_min;
+                    if(d_lo < 0)            d_lo = 0;
+                    if(d_hi > Ndisparities) d_hi = Ndisparities;
+
+                    const int16_t* S    = &ctx->S[(y*W + x1 + disparity_min)*Ndisparities];
+                    int16_t        Smin = INT16_MAX;
+                    int      dmin = -1;
+                    for(int d=d_lo; d<d_hi; d++)
+                    {
+                        const int16_t Sd = S[d*(Ndisparities+1)];
+                        if(Sd < Smin)
+                        {
+                            Smin = Sd;
+                            dmin = d;
+                        }
+                    }
+                    d1[x1] = dmin;
+                }
+
+            for(int x=0; x<W; x++)
+            {
+                const int16_t* S = &ctx->S[(y*W + x)*Ndisparities];
+
+                // I find the lowest cost first, and then its disparity. Both
+                // loops are simple enough to be vectorized
+                int16_t Sbest = S[0];
+                for(int d=1; d<Ndisparities; d++)
+                    if(S[d] < Sbest) Sbest = S[d];
+                int dbest = 0;
+                while(S[dbest] != Sbest)
+                    dbest++;
+
+                d0[x] = -1;
+                disparity[x] = MRCAL_STEREO_SGM_DISPARITY_INVALID;
+
+                // The match must be within camera1's image
+                const int x1 = x - disparity_min - dbest;
+                if(x1 < 0 || x1 >= W)
+                    continue;
+
+                if(parameters->uniqueness_ratio > 0)
+                {
+                    // The lowest cost away from the best disparity
+                    int16_t Sother = INT16_MAX;
+                    for(int d=0; d<dbest-1; d++)
+                        if(S[d] < Sother) Sother = S[d];
+                    for(int d=dbest+2; d<Ndisparities; d++)
+                        if(S[d] < Sother) Sother = S[d];
+
+                    if((uint32_t)Sother*(100 - parameters->uniqueness_ratio) <
+                       (uint32_t)Sbest*100)
+                        continue;
+                }
+
+                // Fit a parabola to the costs around the best disparity
+                double ddisparity = 0.0;
+                if(dbest > 0 && dbest < Ndisparities-1)
+                {
+                    const int denominator = (int)S[dbest-1] + (int)S[dbest+1] - 2*(int)Sbest;
+                    if(denominator > 0)
+                        ddisparity = (double)((int)S[dbest-1] - (int)S[dbest+1]) /
+                            (double)(2*denominator);
+                }
+
+                d0[x] = dbest;
+                disparity[x] =
+                    (int16_t)lrint( ((double)(disparity_min + dbest) + ddisparity) *
+                                    MRCAL_STEREO_SGM_DISPARITY_SCALE );
+            }
+
+            if(parameters->disp12_max_diff >= 0)
+                for(int x=0; x<W; x++)
+                {
+                    if(d0[x] < 0)
+                        continue;
+                    const int x1 = x - disparity_min - d0[x];
+                    if(abs(d1[x1] - d0[x]) > parameters->disp12_max_diff)
+                        disparity[x] = MRCAL_STEREO_SGM_DISPARITY_INVALID;
+                }
+        }
+
+    free(d0);
+    free(d1);
+    return true;
+}
+
+static void* sgm_thread(void* _ctx)
+{
+    sgm_context_t* ctx = (sgm_context_t*)_ctx;
+    ctx->result = false;
+
+    const int W            = ctx->W;
+    const int Ndisparities = ctx->parameters->Ndisparities;
+
+    switch(ctx->phase)
+    {
+    case SGM_PHASE_CENSUS:
+    case SGM_PHASE_COST:
+        for(int y0 = ctx->ithread*SGM_TILE_NROWS;
+            y0 < ctx->H;
+            y0 += ctx->Nthreads*SGM_TILE_NROWS)
+            for(int y = y0; y < y0 + SGM_TILE_NROWS && y < ctx->H; y++)
+            {
+                if(ctx->phase == SGM_PHASE_CENSUS)
+                    for(int i=0; i<2; i++)
+                        census_row(&ctx->census[i][y*W],
+                                   ctx->images[i], W, ctx->H, y);
+                else
+                    cost_row(&ctx->cost[y*W*Ndisparities],
+                             &ctx->census[0][y*W], &ctx->census[1][y*W],
+                             W, ctx->parameters->disparity_min, Ndisparities);
+            }
+        ctx->result = true;
+        break;
+
+    case SGM_PHASE_AGGREGATE:
+        ctx->result = aggregate(ctx);
+        break;
+
+    case SGM_PHASE_SELECT:
+        ctx->result = select_disparities(ctx);
+        break;
+    }
+    return NULL;
+}
+
+bool mrcal_stereo_sgm( // output
+                       int16_t* disparity,
+
+                       // input
+                       const uint8_t*                       image0,
+                       const uint8_t*                       image1,
+                       int                                  W,
+                       int                                  H,
+                       const mrcal_stereo_sgm_parameters_t* parameters,
+                       int                                  Nthreads)
+{
+    if(parameters->Ndisparities <= 0)
+    {
+        MSG("Ndisparities must be > 0");
+        return false;
+    }
+    if(!(parameters->Npaths == 4 || parameters->Npaths == 8))
+    {
+        MSG("Npaths must be 4 or 8. Got %d", parameters->Npaths);
+        return false;
+    }
+    // The costs are stored as int16_t. Each path cost is at most
+    // SGM_COST_MAX + P2, and we sum up to 8 of them
+    if(!(parameters->P1 > 0 && parameters->P1 < parameters->P2 &&
+         8*(SGM_COST_MAX + parameters->P2) < SGM_PATH_COST_SENTINEL))
+    {
+        MSG("Must have 0 < P1 < P2 and 8*(%d + P2) < %d. Got P1=%d, P2=%d",
+            SGM_COST_MAX, SGM_PATH_COST_SENTINEL, parameters->P1, parameters->P2);
+        return false;
+    }
+    if(parameters->uniqueness_ratio < 0 || parameters->uniqueness_ratio >= 100)
+    {
+        MSG("uniqueness_ratio must be in [0,100). Got %d", parameters->uniqueness_ratio);
+        return false;
+    }
+
+    bool result = false;
+
+    const size_t Npixels = (size_t)W*(size_t)H;
+    uint32_t* census0 = malloc(Npixels*sizeof(uint32_t));
+    uint32_t* census1 = malloc(Npixels*sizeof(uint32_t));
+    uint8_t*  cost    = malloc(Npixels*parameters->Ndisparities*sizeof(uint8_t));
+    int16_t* S       = malloc(Npixels*parameters->Ndisparities*sizeof(int16_t));
+    if(census0 == NULL || census1 == NULL || cost == NULL || S == NULL)
+    {
+        MSG("malloc() failed");
+        goto done;
+    }
+
+    // The aggregation directions. Each one is traversed forwards and backwards
+    const int directions[][2] = { {1,0}, {0,1}, {1,1}, {-1,1} };
+    const int Ndirections     = parameters->Npaths / 2;
+
+    // I size the thread pool for the largest number of tiles of any phase.
+    // Phases with fewer tiles leave some threads idle
+    Nthreads = _mrcal_get_Nthreads(Nthreads,
+                                   (W+H-1 + SGM_TILE_NLINES-1) / SGM_TILE_NLINES);
+
+    {
+        sgm_context_t ctx[Nthreads];
+        for(int i=0; i<Nthreads; i++)
+            ctx[i] = (sgm_context_t)
+                { .disparity  = disparity,
+                  .images     = {image0, image1},
+                  .W          = W,
+                  .H          = H,
+                  .parameters = parameters,
+                  .census     = {census0, census1},
+                  .cost       = cost,
+                  .S          = S,
+                  .ithread    = i,
+                  .Nthreads   = Nthreads };
+
+        // Runs one phase on all the threads
+        bool run_phase(sgm_phase_t phase, int dx, int dy)
+        {
+            for(int i=0; i<Nthreads; i++)
+            {
+                ctx[i].phase        = phase;
+                ctx[i].dx           = dx;
+                ctx[i].dy           = dy;
+                ctx[i].initialize_S = (dx == directions[0][0] &&
+                                       dy == directions[0][1]);
+            }
+            if(!_mrcal_run_threads(&sgm_thread, ctx, sizeof(ctx[0]), Nthreads))
+                return false;
+            for(int i=0; i<Nthreads; i++)
+                if(!ctx[i].result)
+                    return false;
+            return true;
+        }
+
+        if(!run_phase(SGM_PHASE_CENSUS, 0,0)) goto done;
+        if(!run_phase(SGM_PHASE_COST,   0,0)) goto done;
+        for(int i=0; i<Ndirections; i++)
+            if(!run_phase(SGM_PHASE_AGGREGATE, directions[i][0], directions[i][1]))
+                goto done;
+        if(!run_phase(SGM_PHASE_SELECT, 0,0)) goto done;
+    }
+
+    result = true;
+
+ done:
+    free(census0);
+    free(census1);
+    free(cost);
+    free(S);
+    return result;
+}
@@ -0,0 +1,701 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "mrcal.h"
+#include "util.h"
+
+// The rectification maps are computed one row at a time. The rows are split
+// into tiles of this many rows, and the tiles are distributed among the threads
+#define RECTIFICATION_MAPS_TILE_NROWS 16
+
+typedef struct
+{
+    float*                   rectification_maps[2];
+    const mrcal_projector_t* projectors[2];
+    const double*            R_cam_rect[2];
+
+    mrcal_lensmodel_type_t   rectification_model_type;
+    const double*            fxycxy_rectified;
+    int                      Naz, Nel;
+
+    int                      ithread, Nthreads;
+    bool                     result;
+} rectification_maps_context_t;
+
+// Unprojects one row of the rectified image into the rectified coordinate
+// system. The LATLON rectified model has even angular steps across the row, so
+// I compute the sin/cos of the first pixel only, and then rotate by a constant
+// step. Each row starts with a fresh sincos(), so the accumulated error is
+// bounded by the row length
+static void unproject_rectified_row(// out
+                                    mrcal_point3_t* v,
+                                    // in
+                                    int iel, int Naz,
+                                    mrcal_lensmodel_type_t rectification_model_type,
+                                    const double* fxycxy)
+{
+    const double fx = fxycxy[0];
+    const double fy = fxycxy[1];
+    const double cx = fxycxy[2];
+    const double cy = fxycxy[3];
+
+    if(rectification_model_type == MRCAL_LENSMODEL_LATLON)
+    {
+        // Same as mrcal_unproject_latlon(). lat = (qx-cx)/fx, lon = (qy-cy)/fy
+        double slon,clon;
+        sincos(((double)iel - cy) / fy, &slon, &clon);
+
+        double slat,clat;
+        sincos((0. - cx) / fx, &slat, &clat);
+
+        double sdlat,cdlat;
+        sincos(1. / fx, &sdlat, &cdlat);
+
+        for(int iaz=0; iaz<Naz; iaz++)
+        {
+            v[iaz] = (mrcal_point3_t){.x = slat,
+                                      .y = clat * slon,
+                                      .z = clat * clon};
+
+            double s = slat*cdlat + clat*sdlat;
+            clat     = clat*cdlat - slat*sdlat;
+            slat     = s;
+        }
+    }
+    else
+    {
+        // Same as mrcal_unproject_pinhole()
+        const double y = ((double)iel - cy) / fy;
+        for(int iaz=0; iaz<Naz; iaz++)
+            v[iaz] = (mrcal_point3_t){.x = ((double)iaz - cx) / fx,
+                                      .y = y,
+                                      .z = 1.0};
+    }
+}
+
+static void* rectification_maps_thread(void* _ctx)
+{
+    rectification_maps_context_t* ctx = (rectification_maps_context_t*)_ctx;
+    ctx->result = false;
+
+    const int Naz = ctx->Naz;
+
+    mrcal_point3_t* v_rect = malloc(Naz*sizeof(mrcal_point3_t));
+    mrcal_point3_t* v_cam  = malloc(Naz*sizeof(mrcal_point3_t));
+    mrcal_point2_t* q      = malloc(Naz*sizeof(mrcal_point2_t));
+    if(v_rect == NULL || v_cam == NULL || q == NULL)
+    {
+        MSG("malloc() failed");
+        goto done;
+    }
+
+    for(int iel0 = ctx->ithread*RECTIFICATION_MAPS_TILE_NROWS;
+        iel0 < ctx->Nel;
+        iel0 += ctx->Nthreads*RECTIFICATION_MAPS_TILE_NROWS)
+    {
+        for(int iel = iel0;
+            iel < iel0 + RECTIFICATION_MAPS_TILE_NROWS && iel < ctx->Nel;
+            iel++)
+        {
+            unproject_rectified_row(v_rect,
+                                    iel, Naz,
+                                    ctx->rectification_model_type,
+                                    ctx->fxycxy_rectified);
+
+            for(int icam=0; icam<2; icam++)
+            {
+                const double* R = ctx->R_cam_rect[icam];
+                for(int iaz=0; iaz<Naz; iaz++)
+                    mrcal_rotate_point_R(v_cam[iaz].xyz, NULL, NULL,
+                                         R, v_rect[iaz].xyz);
+
+                if(!mrcal_projector_project(q, NULL, NULL,
+                                            v_cam, Naz,
+                                            ctx->projectors[icam]))
+                    goto done;
+
+                float* map = &ctx->rectification_maps[icam][iel*Naz*2];
+                for(int iaz=0; iaz<Naz; iaz++)
+                {
+                    map[2*iaz + 0] = (float)q[iaz].x;
+                    map[2*iaz + 1] = (float)q[iaz].y;
+                }
+            }
+        }
+    }
+
+    ctx->result = true;
+
+ done:
+    free(v_rect);
+    free(v_cam);
+    free(q);
+    return NULL;
+}
+
+// Runs the given thread function Nthreads times, in parallel. Thread i gets
+// the context at &ctx[i*ctx_size]. Thread 0 runs in the calling thread. Returns
+// false if we couldn't start all the threads
+bool _mrcal_run_threads(void* (*thread)(void*),
+                        void* ctx, int ctx_size,
+                        int Nthreads)
+{
+    pthread_t threads[Nthreads];
+    int       Nthreads_started = 1;
+
+    for(int i=1; i<Nthreads; i++)
+    {
+        if(0 != pthread_create(&threads[i], NULL, thread, &((char*)ctx)[i*ctx_size]))
+        {
+            MSG("pthread_create() failed");
+            break;
+        }
+        Nthreads_started++;
+    }
+    thread(ctx);
+
+    for(int i=1; i<Nthreads_started; i++)
+        pthread_join(threads[i], NULL);
+
+    return Nthreads_started == Nthreads;
+}
+
+// How many threads to use to process Ntiles tiles. Nthreads <= 0 means "as
+// many as there are cores"
+int _mrcal_get_Nthreads(int Nthreads, int Ntiles)
+{
+    if(Nthreads <= 0)
+    {
+        Nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if(Nthreads <= 0)
+            Nthreads = 1;
+    }
+    // No point in having more threads than tiles
+    if(Nthreads > Ntiles)
+        Nthreads = Ntiles > 0 ? Ntiles : 1;
+    return Nthreads;
+}
+
+bool mrcal_rectification_maps( // output
+                              // Dense arrays of shape (Nel,Naz,2)
+                              float* rectification_map0,
+                              float* rectification_map1,
+
+                              // input
+                              const mrcal_lensmodel_t* lensmodel0,
+                              const double*            intrinsics0,
+                              const double*            R_cam0_rect,
+                              const mrcal_lensmodel_t* lensmodel1,
+                              const double*            intrinsics1,
+                              const double*            R_cam1_rect,
+
+                              const mrcal_lensmodel_type_t rectification_model_type,
+                              const double*            fxycxy_rectified,
+                              const unsigned int*      imagersize_rectified,
+                              int                      Nthreads)
+{
+    if( !(rectification_model_type == MRCAL_LENSMODEL_LATLON ||
+          rectification_model_type == MRCAL_LENSMODEL_PINHOLE) )
+    {
+        MSG("The rectified model must be LENSMODEL_LATLON or LENSMODEL_PINHOLE");
+        return false;
+    }
+
+    bool result = false;
+
+    mrcal_projector_t* projectors[2] =
+        { mrcal_projector_new(lensmodel0, intrinsics0),
+          mrcal_projector_new(lensmodel1, intrinsics1) };
+    if(projectors[0] == NULL || projectors[1] == NULL)
+        goto done;
+
+    const int Naz = (int)imagersize_rectified[0];
+    const int Nel = (int)imagersize_rectified[1];
+
+    Nthreads = _mrcal_get_Nthreads(Nthreads,
+                                   (Nel + RECTIFICATION_MAPS_TILE_NROWS-1) / RECTIFICATION_MAPS_TILE_NROWS);
+
+    {
+        rectification_maps_context_t ctx[Nthreads];
+        for(int i=0; i<Nthreads; i++)
+            ctx[i] = (rectification_maps_context_t)
+                { .rectification_maps       = {rectification_map0, rectification_map1},
+                  .projectors               = {projectors[0], projectors[1]},
+                  .R_cam_rect               = {R_cam0_rect, R_cam1_rect},
+                  .rectification_model_type = rectification_model_type,
+                  .fxycxy_rectified         = fxycxy_rectified,
+                  .Naz                      = Naz,
+                  .Nel                      = Nel,
+                  .ithread                  = i,
+                  .Nthreads                 = Nthreads };
+
+        result = _mrcal_run_threads(&rectification_maps_thread,
+                                    ctx, sizeof(ctx[0]), Nthreads);
+        for(int i=0; i<Nthreads; i++)
+            result = result && ctx[i].result;
+    }
+
+ done:
+    mrcal_projector_free(&projectors[0]);
+    mrcal_projector_free(&projectors[1]);
+    return result;
+}
+
+bool mrcal_stereo_range_lut( // output
+                             float* lut,
+
+                             // input
+                             int                          Ndisparities,
+                             const mrcal_lensmodel_type_t rectification_model_type,
+                             const double*                fxycxy_rectified,
+                             const unsigned int*          imagersize_rectified,
+                             double                       baseline,
+                             double                       disparity_scale)
+{
+    if( !(rectification_model_type == MRCAL_LENSMODEL_LATLON ||
+          rectification_model_type == MRCAL_LENSMODEL_PINHOLE) )
+    {
+        MSG("The rectified model must be LENSMODEL_LATLON or LENSMODEL_PINHOLE");
+        return false;
+    }
+    if(Ndisparities <= 0)
+    {
+        MSG("Ndisparities must be > 0");
+        return false;
+    }
+
+    const double fx  = fxycxy_rectified[0];
+    const double cx  = fxycxy_rectified[2];
+    const int    Naz = (int)imagersize_rectified[0];
+
+    // Disparity 0 is invalid: lut[0] is always 0
+    if(rectification_model_type == MRCAL_LENSMODEL_LATLON)
+    {
+        // Same as mrcal.stereo_range(). The angular disparity is
+        // az0-az1 = d/(fx*disparity_scale), and
+        //
+        //   range = baseline cos(az0 - (az0-az1)) / sin(az0-az1)
+        //
+        // This depends on the az column and the disparity only. The LUT is
+        // stored as (Ndisparities,Naz): adjacent pixels usually have similar
+        // disparities, so they hit the same cache lines
+        for(int iaz=0; iaz<Naz; iaz++)
+            lut[iaz] = 0.0f;
+        for(int d=1; d<Ndisparities; d++)
+        {
+            const double disparity_rad = (double)d / (fx * disparity_scale);
+            const double s_recip       = 1.0 / sin(disparity_rad);
+            for(int iaz=0; iaz<Naz; iaz++)
+            {
+                const double az0 = ((double)iaz - cx) / fx;
+                lut[d*Naz + iaz] = (float)(baseline * cos(az0 - disparity_rad) * s_recip);
+            }
+        }
+    }
+    else
+    {
+        // The expression in mrcal.stereo_range() simplifies to
+        //
+        //   range = baseline sqrt(1 + tanaz0^2 + tanel^2) / (tanaz0-tanaz1)
+        //
+        // with tanaz0-tanaz1 = d/(fx*disparity_scale). The sqrt() is the norm of
+        // the unprojected pinhole vector, which is cheap to compute per pixel.
+        // So the LUT stores the rest, keyed on the disparity only
+        lut[0] = 0.0f;
+        for(int d=1; d<Ndisparities; d++)
+            lut[d] = (float)(baseline * fx * disparity_scale / (double)d);
+    }
+    return true;
+}
+
+// The disparity images are processed in tiles of this many rows, which are
+// distributed among the threads
+#define STEREO_RANGE_TILE_NROWS 16
+
+typedef struct
+{
+    float*                 range;
+    const int16_t*         disparity;
+    const float*           lut;
+    int                    Ndisparities;
+
+    mrcal_lensmodel_type_t rectification_model_type;
+    const double*          fxycxy_rectified;
+    int                    Naz, Nel;
+
+    int                    ithread, Nthreads;
+    bool                   result;
+} stereo_range_context_t;
+
+static void* stereo_range_thread(void* _ctx)
+{
+    stereo_range_context_t* ctx = (stereo_range_context_t*)_ctx;
+    ctx->result = false;
+
+    const int          Naz          = ctx->Naz;
+    const unsigned int Ndisparities = (unsigned int)ctx->Ndisparities;
+    const float*       lut          = ctx->lut;
+
+    // Pinhole only: tanaz^2 for each column
+    float* tanaz_sq = NULL;
+    if(ctx->rectification_model_type == MRCAL_LENSMODEL_PINHOLE)
+    {
+        tanaz_sq = malloc(Naz*sizeof(float));
+        if(tanaz_sq == NULL)
+        {
+            MSG("malloc() failed");
+            return NULL;
+        }
+        const double fx = ctx->fxycxy_rectified[0];
+        const double cx = ctx->fxycxy_rectified[2];
+        for(int iaz=0; iaz<Naz; iaz++)
+        {
+            const double tanaz = ((double)iaz - cx) / fx;
+            tanaz_sq[iaz] = (float)(tanaz*tanaz);
+        }
+    }
+
+    for(int iel0 = ctx->ithread*STEREO_RANGE_TILE_NROWS;
+        iel0 < ctx->Nel;
+        iel0 += ctx->Nthreads*STEREO_RANGE_TILE_NROWS)
+    {
+        for(int iel = iel0;
+            iel < iel0 + STEREO_RANGE_TILE_NROWS && iel < ctx->Nel;
+            iel++)
+        {
+            const int16_t* disparity = &ctx->disparity[iel*Naz];
+            float*         range     = &ctx->range    [iel*Naz];
+
+            // Negative disparities wrap around to huge unsigned values, so a
+            // single comparison rejects them along with the too-large ones. And
+            // lut[0] = 0, so disparity 0 needs no special handling
+            if(tanaz_sq == NULL)
+                for(int iaz=0; iaz<Naz; iaz++)
+                {
+                    const unsigned int d = (unsigned int)(int)disparity[iaz];
+                    range[iaz] = d < Ndisparities ? lut[d*Naz + iaz] : 0.0f;
+                }
+            else
+            {
+                const double fy    = ctx->fxycxy_rectified[1];
+                const double cy    = ctx->fxycxy_rectified[3];
+                const double tanel = ((double)iel - cy) / fy;
+                const float  s_sq  = (float)(1.0 + tanel*tanel);
+                for(int iaz=0; iaz<Naz; iaz++)
+                {
+                    const unsigned int d = (unsigned int)(int)disparity[iaz];
+                    range[iaz] = d < Ndisparities ?
+                        lut[d] * sqrtf(s_sq + tanaz_sq[iaz]) :
+                        0.0f;
+                }
+            }
+        }
+    }
+
+    ctx->result = true;
+    free(tanaz_sq);
+    return NULL;
+}
+
+bool mrcal_stereo_range_from_lut( // output
+                                  float* range,
+
+                                  // input
+                                  const int16_t*               disparity,
+                                  const float*                 lut,
+                                  int                          Ndisparities,
+                                  const mrcal_lensmodel_type_t rectification_model_type,
+                                  const double*                fxycxy_rectified,
+                                  const unsigned int*          imagersize_rectified,
+                                  int                          Nthreads)
+{
+    if( !(rectification_model_type == MRCAL_LENSMODEL_LATLON ||
+          rectification_model_type == MRCAL_LENSMODEL_PINHOLE) )
+    {
+        MSG("The rectified model must be LENSMODEL_LATLON or LENSMODEL_PINHOLE");
+        return false;
+    }
+
+    const int Naz = (int)imagersize_rectified[0];
+    const int Nel = (int)imagersize_rectified[1];
+
+    Nthreads = _mrcal_get_Nthreads(Nthreads,
+                                   (Nel + STEREO_RANGE_TILE_NROWS-1) / STEREO_RANGE_TILE_NROWS);
+
+    stereo_range_context_t ctx[Nthreads];
+    for(int i=0; i<Nthreads; i++)
+        ctx[i] = (stereo_range_context_t)
+            { .range                    = range,
+              .disparity                = disparity,
+              .lut                      = lut,
+              .Ndisparities             = Ndisparities,
+              .rectification_model_type = rectification_model_type,
+              .fxycxy_rectified         = fxycxy_rectified,
+              .Naz                      = Naz,
+              .Nel                      = Nel,
+              .ithread                  = i,
+              .Nthreads                 = Nthreads };
+
+    bool result = _mrcal_run_threads(&stereo_range_thread,
+                                     ctx, sizeof(ctx[0]), Nthreads);
+    for(int i=0; i<Nthreads; i++)
+        result = result && ctx[i].result;
+    return result;
+}
+
+typedef struct
+{
+    float*                 points;
+    uint8_t*               colors;
+    int*                   Npoints_tile;
+
+    const int16_t*         disparity;
+    const float*           lut;
+    int                    Ndisparities;
+    const uint8_t*         image;
+    int                    Ncolor_channels;
+    const double*          Rt_out_rect0;
+
+    mrcal_lensmodel_type_t rectification_model_type;
+    const double*          fxycxy_rectified;
+    int                    Naz, Nel;
+
+    int                    ithread, Nthreads;
+    bool                   result;
+} stereo_point_cloud_context_t;
+
+// Each tile writes its valid points at the start of its own region of the
+// output: tile itile writes at most STEREO_RANGE_TILE_NROWS*Naz points, starting
+// at point itile*STEREO_RANGE_TILE_NROWS*Naz. The caller then compacts the tiles
+static void* stereo_point_cloud_thread(void* _ctx)
+{
+    stereo_point_cloud_context_t* ctx = (stereo_point_cloud_context_t*)_ctx;
+    ctx->result = false;
+
+    const int          Naz          = ctx->Naz;
+    const unsigned int Ndisparities = (unsigned int)ctx->Ndisparities;
+    const float*       lut          = ctx->lut;
+    const int          Nc           = ctx->Ncolor_channels;
+
+    const double fx = ctx->fxycxy_rectified[0];
+    const double fy = ctx->fxycxy_rectified[1];
+    const double cx = ctx->fxycxy_rectified[2];
+    const double cy = ctx->fxycxy_rectified[3];
+
+    const bool latlon = ctx->rectification_model_type == MRCAL_LENSMODEL_LATLON;
+
+    // Per-column terms of the unprojection. LENSMODEL_LATLON: sin(lat),cos(lat).
+    // LENSMODEL_PINHOLE: tan(az)
+    float* column_terms = malloc(2*Naz*sizeof(float));
+    if(column_terms == NULL)
+    {
+        MSG("malloc() failed");
+        return NULL;
+    }
+    for(int iaz=0; iaz<Naz; iaz++)
+    {
+        const double x = ((double)iaz - cx) / fx;
+        if(latlon)
+        {
+            double s,c;
+            sincos(x, &s, &c);
+            column_terms[2*iaz + 0] = (float)s;
+            column_terms[2*iaz + 1] = (float)c;
+        }
+        else
+            column_terms[2*iaz + 0] = (float)x;
+    }
+
+    // Identity unless we're given a transformation
+    float R[9] = {1.f, 0.f, 0.f,
+                  0.f, 1.f, 0.f,
+                  0.f, 0.f, 1.f};
+    float t[3] = {};
+    if(ctx->Rt_out_rect0 != NULL)
+    {
+        for(int i=0; i<9; i++) R[i] = (float)ctx->Rt_out_rect0[i];
+        for(int i=0; i<3; i++) t[i] = (float)ctx->Rt_out_rect0[9+i];
+    }
+
+    for(int iel0 = ctx->ithread*STEREO_RANGE_TILE_NROWS;
+        iel0 < ctx->Nel;
+        iel0 += ctx->Nthreads*STEREO_RANGE_TILE_NROWS)
+    {
+        const int itile   = iel0 / STEREO_RANGE_TILE_NROWS;
+        int       Npoints = 0;
+        float*    points  = &ctx->points[iel0*Naz*3];
+        uint8_t*  colors  = ctx->colors == NULL ? NULL : &ctx->colors[iel0*Naz*Nc];
+
+        for(int iel = iel0;
+            iel < iel0 + STEREO_RANGE_TILE_NROWS && iel < ctx->Nel;
+            iel++)
+        {
+            const int16_t* disparity = &ctx->disparity[iel*Naz];
+
+            // Per-row terms of the unprojection. LENSMODEL_LATLON:
+            // sin(lon),cos(lon). LENSMODEL_PINHOLE: tan(el)
+            float row_terms[2];
+            {
+                const double y = ((double)iel - cy) / fy;
+                if(latlon)
+                {
+                    double s,c;
+                    sincos(y, &s, &c);
+                    row_terms[0] = (float)s;
+                    row_terms[1] = (float)c;
+                }
+                else
+                    row_terms[0] = (float)y;
+            }
+
+            for(int iaz=0; iaz<Naz; iaz++)
+            {
+                // Same range lookup as in stereo_range_thread()
+                const unsigned int d = (unsigned int)(int)disparity[iaz];
+                if(d >= Ndisparities)
+                    continue;
+
+                float p[3];
+                if(latlon)
+                {
+                    // Same as mrcal_unproject_latlon(), scaled by the range
+                    const float r = lut[d*Naz + iaz];
+                    if(!(r > 0.0f))
+                        continue;
+                    const float slat = column_terms[2*iaz + 0];
+                    const float clat = column_terms[2*iaz + 1];
+                    p[0] = r * slat;
+                    p[1] = r * clat * row_terms[0];
+                    p[2] = r * clat * row_terms[1];
+                }
+                else
+                {
+                    // range = lut[d] |v| with the pinhole v = (tanaz,tanel,1).
+                    // So the point is simply lut[d] v
+                    const float k = lut[d];
+                    if(!(k > 0.0f))
+                        continue;
+                    p[0] = k * column_terms[2*iaz + 0];
+                    p[1] = k * row_terms[0];
+                    p[2] = k;
+                }
+
+                float* pout = &points[3*Npoints];
+                if(ctx->Rt_out_rect0 != NULL)
+                    for(int i=0; i<3; i++)
+                        pout[i] = R[3*i+0]*p[0] + R[3*i+1]*p[1] + R[3*i+2]*p[2] + t[i];
+                else
+                    for(int i=0; i<3; i++)
+                        pout[i] = p[i];
+
+                if(colors != NULL)
+                    for(int i=0; i<Nc; i++)
+                        colors[Nc*Npoints + i] = ctx->image[(iel*Naz + iaz)*Nc + i];
+
+                Npoints++;
+            }
+        }
+        ctx->Npoints_tile[itile] = Npoints;
+    }
+
+    ctx->result = true;
+    free(column_terms);
+    return NULL;
+}
+
+int mrcal_stereo_point_cloud( // output
+                              float*   points,
+                              uint8_t* colors,
+
+                              // input
+                              const int16_t*               disparity,
+                              const float*                 lut,
+                              int                          Ndisparities,
+                              const uint8_t*               image,
+                              int                          Ncolor_channels,
+                              const double*                Rt_out_rect0,
+                              const mrcal_lensmodel_type_t rectification_model_type,
+                              const double*                fxycxy_rectified,
+                              const unsigned int*          imagersize_rectified,
+                              int                          Nthreads)
+{
+    if( !(rectification_model_type == MRCAL_LENSMODEL_LATLON ||
+          rectification_model_type == MRCAL_LENSMODEL_PINHOLE) )
+    {
+        MSG("The rectified model must be LENSMODEL_LATLON or LENSMODEL_PINHOLE");
+        return -1;
+    }
+    if((colors == NULL) != (image == NULL))
+    {
+        MSG("The colors and the image must be given together");
+        return -1;
+    }
+    if(colors != NULL && !(Ncolor_channels == 1 || Ncolor_channels == 3))
+    {
+        MSG("The image must have 1 or 3 channels. Got %d", Ncolor_channels);
+        return -1;
+    }
+
+    const int Naz    = (int)imagersize_rectified[0];
+    const int Nel    = (int)imagersize_rectified[1];
+    const int Ntiles = (Nel + STEREO_RANGE_TILE_NROWS-1) / STEREO_RANGE_TILE_NROWS;
+
+    Nthreads = _mrcal_get_Nthreads(Nthreads, Ntiles);
+
+    int* Npoints_tile = malloc(Ntiles*sizeof(int));
+    if(Npoints_tile == NULL)
+    {
+        MSG("malloc() failed");
+        return -1;
+    }
+
+    stereo_point_cloud_context_t ctx[Nthreads];
+    for(int i=0; i<Nthreads; i++)
+        ctx[i] = (stereo_point_cloud_context_t)
+            { .points                   = points,
+              .colors                   = colors,
+              .Npoints_tile             = Npoints_tile,
+              .disparity                = disparity,
+              .lut                      = lut,
+              .Ndisparities             = Ndisparities,
+              .image                    = image,
+              .Ncolor_channels          = Ncolor_channels,
+              .Rt_out_rect0             = Rt_out_rect0,
+              .rectification_model_type = rectification_model_type,
+              .fxycxy_rectified         = fxycxy_rectified,
+              .Naz                      = Naz,
+              .Nel                      = Nel,
+              .ithread                  = i,
+              .Nthreads                 = Nthreads };
+
+    bool result = _mrcal_run_threads(&stereo_point_cloud_thread,
+                                     ctx, sizeof(ctx[0]), Nthreads);
+    for(int i=0; i<Nthreads; i++)
+        result = result && ctx[i].result;
+
+    int Npoints = -1;
+    if(result)
+    {
+        // Compact the tiles. The first tile is already in place
+        Npoints = Npoints_tile[0];
+        for(int itile=1; itile<Ntiles; itile++)
+        {
+            const int i0 = itile*STEREO_RANGE_TILE_NROWS*Naz;
+            memmove(&points[3*Npoints], &points[3*i0],
+                    3*Npoints_tile[itile]*sizeof(float));
+            if(colors != NULL)
+                memmove(&colors[Ncolor_channels*Npoints], &colors[Ncolor_channels*i0],
+                        Ncolor_channels*Npoints_tile[itile]);
+            Npoints += Npoints_tile[itile];
+        }
+    }
+
+    free(Npoints_tile);
+    return Npoints;
+}
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../mrcal.h"
+
+/* Throughput benchmark of the semi-global stereo matcher, mrcal_stereo_sgm().
+
+   I synthesize a rectified stereo pair with a known disparity: a random
+   texture observed at a slanted background plane, with a closer box in the
+   middle. I then run the matcher a few times, and report the throughput and
+   the fraction of pixels that were matched correctly
+ */
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+// The true disparity at each pixel in camera0, in pixels
+static double disparity_true(int x, int y, int W, int H)
+{
+    if(x > W/3 && x < 2*W/3 &&
+       y > H/3 && y < 2*H/3)
+        return 40.0;
+    return 10.0 + 10.0*(double)y/(double)H;
+}
+
+// A smooth random texture, sampled at a non-integer x
+static double texture(const float* t, int Wt, double x, int y)
+{
+    int    ix = (int)floor(x);
+    double f  = x - (double)ix;
+    if(ix < 0)    { ix = 0;    f = 0.0; }
+    if(ix >= Wt-1){ ix = Wt-2; f = 1.0; }
+    return (1.0-f)*t[y*Wt + ix] + f*t[y*Wt + ix+1];
+}
+
+int main(int argc, char* argv[])
+{
+    const char* usage =
+        "Usage: %s [--width W] [--height H] [--ndisparities N] [--npaths 4|8]\n"
+        "          [--nthreads N] [--iterations N]\n";
+
+    int W = 1280, H = 720, Niterations = 5, Nthreads = 0;
+    mrcal_stereo_sgm_parameters_t parameters = {
+#define DEFAULT(name, default) .name = default,
+        MRCAL_STEREO_SGM_PARAMETERS_LIST(DEFAULT)
+#undef DEFAULT
+    };
+    parameters.Ndisparities = 64;
+
+    for(int i=1; i<argc; i++)
+    {
+        if(i+1 >= argc)
+        {
+            fprintf(stderr, usage, argv[0]);
+            return 1;
+        }
+        const int value = atoi(argv[i+1]);
+        if     (0 == strcmp(argv[i], "--width"))        W                       = value;
+        else if(0 == strcmp(argv[i], "--height"))       H                       = value;
+        else if(0 == strcmp(argv[i], "--ndisparities")) parameters.Ndisparities = value;
+        else if(0 == strcmp(argv[i], "--npaths"))       parameters.Npaths       = value;
+        else if(0 == strcmp(argv[i], "--nthreads"))     Nthreads                = value;
+        else if(0 == strcmp(argv[i], "--iterations"))   Niterations             = value;
+        else
+        {
+            fprintf(stderr, usage, argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    // Each texel is a random value, box-filtered a bit to have some
+    // correlation between neighbors
+    const int Wt = W + 64;
+    float*    t  = malloc(Wt*H*sizeof(float));
+    uint8_t*  image0    = malloc(W*H);
+    uint8_t*  image1    = malloc(W*H);
+    int16_t*  disparity = malloc(W*H*sizeof(int16_t));
+    if(t == NULL || image0 == NULL || image1 == NULL || disparity == NULL)
+    {
+        fprintf(stderr, "malloc() failed\n");
+        return 1;
+    }
+    srandom(0);
+    for(int i=0; i<Wt*H; i++)
+        t[i] = (float)(random() % 256);
+    for(int y=1; y<H; y++)
+        for(int x=1; x<Wt; x++)
+            t[y*Wt + x] = 0.5f*t[y*Wt + x] + 0.25f*(t[y*Wt + x-1] + t[(y-1)*Wt + x]);
+
+    // camera1 sees the point at camera0's pixel x at x-disparity. I build
+    // image1 by searching for the camera0 pixel that lands at each camera1
+    // pixel. The nearest surface wins
+    for(int y=0; y<H; y++)
+    {
+        for(int x=0; x<W; x++)
+            image0[y*W + x] = (uint8_t)texture(t, Wt, (double)x, y);
+
+        for(int x1=0; x1<W; x1++)
+        {
+            double dbest = -1.0;
+            double x0best = 0.0;
+            for(int x0 = x1; x0 < W && x0 < x1+64; x0++)
+            {
+                // The disparity is piecewise-smooth, so I assume it's constant
+                // across each pixel
+                const double d = disparity_true(x0, y, W, H);
+                const double x0_exact = (double)x1 + d;
+                if(fabs(x0_exact - (double)x0) <= 0.5 && d > dbest)
+                {
+                    dbest  = d;
+                    x0best = x0_exact;
+                }
+            }
+            image1[y*W + x1] = (uint8_t)texture(t, Wt, x0best, y);
+        }
+    }
+
+    double dt_min = 1e9;
+    for(int i=0; i<Niterations; i++)
+    {
+        const double t0 = now();
+        if(!mrcal_stereo_sgm(disparity, image0, image1, W, H, &parameters, Nthreads))
+        {
+            fprintf(stderr, "mrcal_stereo_sgm() failed\n");
+            return 1;
+        }
+        const double dt = now() - t0;
+        if(dt < dt_min) dt_min = dt;
+    }
+
+    int Nvalid = 0, Ncorrect = 0;
+    for(int y=0; y<H; y++)
+        for(int x=0; x<W; x++)
+        {
+            const int16_t d = disparity[y*W + x];
+            if(d == MRCAL_STEREO_SGM_DISPARITY_INVALID)
+                continue;
+            Nvalid++;
+            if(fabs((double)d / MRCAL_STEREO_SGM_DISPARITY_SCALE -
+                    disparity_true(x, y, W, H)) <= 1.0)
+                Ncorrect++;
+        }
+
+    printf("Image: %dx%d, %d disparities, %d paths\n",
+           W, H, parameters.Ndisparities, parameters.Npaths);
+    printf("Best time of %d iterations: %.1fms\n", Niterations, dt_min*1e3);
+    printf("Throughput: %.1f Mpixels/s, %.0f Mdisparities/s\n",
+           (double)W*H / dt_min * 1e-6,
+           (double)W*H*parameters.Ndisparities / dt_min * 1e-6);
+    printf("Valid pixels: %.1f%%. Of those, within 1 pixel of the truth: %.1f%%\n",
+           100.0*Nvalid/(W*H), 100.0*Ncorrect/(Nvalid > 0 ? Nvalid : 1));
+
+    free(t);
+    free(image0);
+    free(image1);
+    free(disparity);
+    return 0;
+}
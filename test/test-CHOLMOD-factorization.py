@@ -49,4 +49,79 @@ testutils.confirm_equal(xt, xt_ref,
                         eps       = 1e-6,
                         msg       = "solve_xt_JtJ_bt produces the correct result")
 
+# Var_dF() computes dF inv(JtJ) dFt for each block of dF. It is given only the
+# non-zero columns of dF
+dF   = np.array((((1.,  2.), ( 3., -1.)),
+                 ((0.5, 0.), (-2.,  4.)),
+                 ((1.,  1.), ( 0.,  3.))))
+icol = np.array((0,2), dtype=np.int32)
+dF_dense = np.zeros((3,2,3), dtype=float)
+dF_dense[...,icol] = dF
+
+inv_JtJ_dFt = np.linalg.solve(JtJ, nps.transpose(dF_dense))
+testutils.confirm_equal(F.Var_dF(dF, icol),
+                        nps.matmult(dF_dense, inv_JtJ_dFt),
+                        relative  = True,
+                        worstcase = True,
+                        eps       = 1e-6,
+                        msg       = "Var_dF produces the correct result")
+
+# Using only the leading rows of J
+Jobs = Jdense[:3,:]
+testutils.confirm_equal(F.Var_dF(dF, icol,
+                                 Jp = indptr .astype(np.int32),
+                                 Ji = indices.astype(np.int32),
+                                 Jx = data,
+                                 Nleading_rows_J = 3),
+                        nps.matmult(nps.transpose(inv_JtJ_dFt),
+                                    nps.transpose(Jobs), Jobs,
+                                    inv_JtJ_dFt),
+                        relative  = True,
+                        worstcase = True,
+                        eps       = 1e-6,
+                        msg       = "Var_dF(Nleading_rows_J) produces the correct result")
+
+# inv_JtJ_blocks() returns diagonal blocks of inv(JtJ). I use a bigger J with
+# two decoupled halves of the state: rows 0-19 see only the state 0-5, and rows
+# 20-39 see only the state 6-11. JtJ is then block-diagonal, so the factor has
+# no entries coupling the two halves. The (3,6) block below straddles them, so
+# its cross terms are outside the sparsity pattern of the factor
+np.random.seed(0)
+Jdense_big = np.random.randn(40,12) * (np.random.rand(40,12) < 0.4)
+Jdense_big[:20,6:] = 0
+Jdense_big[20:,:6] = 0
+# Make sure each half is well-conditioned. Each half only boosts its own rows
+Jdense_big[np.arange( 0, 6),np.arange(0, 6)] += 3.
+Jdense_big[np.arange(20,26),np.arange(6,12)] += 3.
+JtJ_big     = nps.matmult(nps.transpose(Jdense_big), Jdense_big)
+F_big       = mrcal.CHOLMOD_factorization(csr_matrix(Jdense_big))
+inv_JtJ_big = np.linalg.inv(JtJ_big)
+
+testutils.confirm_equal(JtJ_big[:6,6:],
+                        0,
+                        worstcase = True,
+                        eps       = 0,
+                        msg       = "The two halves of the big J are decoupled")
+
+testutils.confirm_equal(F.inv_JtJ_blocks((1,2)),
+                        np.linalg.inv(JtJ)[1:3,1:3],
+                        relative  = True,
+                        worstcase = True,
+                        eps       = 1e-6,
+                        msg       = "inv_JtJ_blocks() works with a single block")
+for b,(istate0,N) in zip(F_big.inv_JtJ_blocks( ((0,6), (6,6), (3,6), (0,12)) ),
+                         ((0,6), (6,6), (3,6), (0,12))):
+    testutils.confirm_equal(b,
+                            inv_JtJ_big[istate0:istate0+N,istate0:istate0+N],
+                            relative  = True,
+                            worstcase = True,
+                            eps       = 1e-6,
+                            msg       = f"inv_JtJ_blocks() produces the correct result for block ({istate0},{N})")
+    if (istate0,N) == (3,6):
+        testutils.confirm_equal(b[:3,3:],
+                                0,
+                                worstcase = True,
+                                eps       = 1e-12,
+                                msg       = "inv_JtJ_blocks() reports 0 for the cross terms outside the factor's sparsity pattern")
+
 testutils.finish()
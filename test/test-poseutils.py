@@ -186,4 +186,69 @@ for th in (1e-12, 1e-11, 1e-10, 1e-9, 1e-8, 1e-7, 1e-6):
                              msg = f'r_from_R() for tiny rotations: th = {th}')
 
 
+# Large broadcasted arrays are split into chunks, and evaluated by the _..._nogil
+# routines, possibly in a thread pool. The results must match the per-point
+# routines, which are called directly here
+N        = 3*mrcal.poseutils._broadcast_parallel_Npoints_min
+rt_many  = np.random.random((N,6))
+Rt_many  = mrcal.Rt_from_rt(rt_many)
+x_many   = np.random.random((N,3))
+rt_one   = mrcal.rt_from_Rt(Rt)
+v0_many  = x_many + np.array((0,0,10.))
+v1_many  = v0_many - rt_one[3:]
+
+npsp = mrcal._poseutils_npsp
+tests = \
+    ( ('transform_point_rt',
+       lambda: mrcal.transform_point_rt(rt_one,  x_many),
+       lambda: npsp._transform_point_rt(rt_one,  x_many)),
+      ('transform_point_rt(inverted)',
+       lambda: mrcal.transform_point_rt(rt_many, x_many, inverted = True),
+       lambda: npsp._transform_point_rt(rt_many, x_many, inverted = True)),
+      ('transform_point_Rt',
+       lambda: mrcal.transform_point_Rt(Rt_many, x_many),
+       lambda: npsp._transform_point_Rt(Rt_many, x_many)),
+      ('transform_point_Rt(inverted)',
+       lambda: mrcal.transform_point_Rt(Rt, x_many, inverted = True),
+       lambda: npsp._transform_point_Rt(Rt, x_many, inverted = True)),
+      ('rotate_point_r',
+       lambda: mrcal.rotate_point_r(rt_many[:,:3], x_many),
+       lambda: npsp._rotate_point_r(rt_many[:,:3], x_many)),
+      ('rotate_point_r(inverted)',
+       lambda: mrcal.rotate_point_r(rt_one[:3], x_many, inverted = True),
+       lambda: npsp._rotate_point_r(rt_one[:3], x_many, inverted = True)),
+      ('rotate_point_R',
+       lambda: mrcal.rotate_point_R(Rt[:3,:], x_many),
+       lambda: npsp._rotate_point_R(Rt[:3,:], x_many)),
+      ('rotate_point_R(inverted)',
+       lambda: mrcal.rotate_point_R(Rt_many[:,:3,:], x_many, inverted = True),
+       lambda: npsp._rotate_point_R(Rt_many[:,:3,:], x_many, inverted = True)),
+      ('compose_rt',
+       lambda: mrcal.compose_rt(rt_many, rt_one),
+       lambda: npsp._compose_rt(rt_many, rt_one)),
+      ('compose_Rt',
+       lambda: mrcal.compose_Rt(Rt, Rt_many),
+       lambda: npsp._compose_Rt(Rt, Rt_many)),
+      ('triangulate_leecivera_mid2',
+       lambda: mrcal.triangulate_leecivera_mid2(v0_many, v1_many, rt_one[3:]),
+       lambda: mrcal._triangulation_npsp._triangulate_leecivera_mid2(v0_many, v1_many, rt_one[3:])) )
+
+for what, f, f_ref in tests:
+    result_ref = f_ref()
+    for Nthreads in (1,4):
+        mrcal.set_broadcast_Nthreads(Nthreads)
+        testutils.confirm_equal( f(), result_ref,
+                                 worstcase = True,
+                                 eps       = 1e-10,
+                                 msg = f'{what}: large arrays with Nthreads={Nthreads} match the per-point routine')
+
+mrcal.set_broadcast_Nthreads(0)
+x_out = np.zeros((N,3))
+testutils.confirm( mrcal.transform_point_rt(rt_one, x_many, out = x_out) is x_out,
+                   msg = 'Parallel broadcasting writes to "out"')
+testutils.confirm_equal( x_out, mrcal.transform_point_rt(rt_one, x_many),
+                         worstcase = True,
+                         msg = 'Parallel broadcasting writes to "out" correctly')
+
+
 testutils.finish()
@@ -1059,6 +1059,62 @@ for icam in (0,3):
                             relative  = True,
                             msg = f"var(dq) (infinity) is invariant to point scale for camera {icam}")
 
+# The evaluated optimization problem is cached, and shared by all the models
+# with the same optimization_inputs. Including those read separately from disk
+optimization_context = models_baseline[0]._optimization_context()
+testutils.confirm(optimization_context is models_baseline[0]._optimization_context(),
+                  msg = "The optimization context is cached")
+models_baseline[0].write(f'{workdir}/out0.cameramodel')
+testutils.confirm(optimization_context is mrcal.cameramodel(f'{workdir}/out0.cameramodel')._optimization_context(),
+                  msg = "The optimization context is shared with the same model read from disk")
+
+# New optimization_inputs invalidate the context. And the cache doesn't keep the
+# contexts alive by itself: they go away with the models that use them
+model = mrcal.cameramodel(models_baseline[0])
+optimization_inputs = model.optimization_inputs()
+optimization_inputs['intrinsics'][0,0] += 1e-3
+model.intrinsics(model.intrinsics(),
+                 optimization_inputs = optimization_inputs,
+                 icam_intrinsics     = model.icam_intrinsics())
+optimization_context_new = model._optimization_context()
+testutils.confirm(optimization_context_new is not optimization_context,
+                  msg = "New optimization_inputs invalidate the optimization context")
+testutils.confirm_equal(optimization_context_new[0]['intrinsics'], optimization_inputs['intrinsics'],
+                        worstcase = True,
+                        msg = "The new optimization context uses the new optimization_inputs")
+key = model._optimization_inputs_string
+cache = sys.modules['mrcal.cameramodel']._optimization_context_cache
+testutils.confirm(key in cache,
+                  msg = "The new optimization context is cached")
+del model, optimization_context_new
+testutils.confirm(key not in cache,
+                  msg = "The optimization context is freed with its models")
+
+# The imager-grid uncertainty map should match projection_uncertainty() at each
+# gridded pixel
+for icam in (0,3):
+    if icam >= args.Ncameras: break
+
+    q_grid = mrcal.sample_imager(12, 8, *models_baseline[icam].imagersize())
+    p_cam_grid = mrcal.unproject( q_grid, *models_baseline[icam].intrinsics(),
+                                  normalize = True)
+    for what in ('worstdirection-stdev', 'rms-stdev'):
+        for distance in (5., None):
+            testutils.confirm_equal(mrcal.projection_uncertainty_grid(models_baseline[icam],
+                                                                      12, 8,
+                                                                      distance = distance,
+                                                                      what     = what,
+                                                                      observed_pixel_uncertainty = pixel_uncertainty_stdev),
+                                    mrcal.projection_uncertainty( p_cam_grid * (distance if distance is not None else 1.0),
+                                                                  model      = models_baseline[icam],
+                                                                  atinfinity = distance is None,
+                                                                  what       = what,
+                                                                  observed_pixel_uncertainty = pixel_uncertainty_stdev),
+                                    eps = 1e-6,
+                                    worstcase = True,
+                                    relative  = True,
+                                    msg = f"projection_uncertainty_grid({what}) matches projection_uncertainty() for camera {icam} at distance={distance}")
+
 if not args.do_sample:
     testutils.finish()
     sys.exit()
@@ -397,6 +397,24 @@ check( ('LENSMODEL_CAHVORE_linearity=0.40', np.array((4842.918, 4842.771, 1970.5
                  [ 423.27156274, 1513.20891648],
                  [ 872.53696336, -731.32905711]]))
 
+# CAHVORE projection without gradients evaluates all the points in one C call,
+# reading the arrays with their strides. Reversed and broadcasted points must
+# work also
+lensmodel_cahvore  = 'LENSMODEL_CAHVORE_linearity=0.40'
+intrinsics_cahvore = np.array((4842.918, 4842.771, 1970.528, 1085.302,
+                               -0.001, 0.002, -0.637, -0.002, 0.016, 1e-2, 2e-2, 3e-2))
+q_ref = mrcal.project(p, lensmodel_cahvore, intrinsics_cahvore)
+testutils.confirm_equal(mrcal.project(p[::-1], lensmodel_cahvore, intrinsics_cahvore),
+                        q_ref[::-1],
+                        msg = "CAHVORE projection of reversed points")
+testutils.confirm_equal(mrcal.project(np.broadcast_to(p[0], (4,3)), lensmodel_cahvore, intrinsics_cahvore),
+                        np.broadcast_to(q_ref[0], (4,2)),
+                        msg = "CAHVORE projection of broadcasted points")
+out = np.zeros((3,2), dtype=float)
+mrcal.project(p, lensmodel_cahvore, intrinsics_cahvore, out = out[::-1])
+testutils.confirm_equal(out, q_ref[::-1],
+                        msg = "CAHVORE projection into a reversed output")
+
 
 # Note that some of the projected points are behind the camera (z<0), which is
 # possible with these models. Also note that some of the projected points are
@@ -486,4 +504,57 @@ check( ('LENSMODEL_SPLINED_STEREOGRAPHIC_order=2_Nx=11_Ny=8_fov_x_deg=200',
                  [4327.8166836 , 3183.44237796]]))
 
 
+# Some splined configurations (order=3 with 30x20 and 60x40 knots) have their own
+# specialized projection kernels. The models above all use the generic kernel,
+# so I compare the specialized ones against it here. I make an equivalent model
+# that uses the generic kernel by adding a row of control points above and below
+# the grid: Nx and the field of view are unchanged, so the knot spacing is the
+# same, and the grid center moves by exactly one knot in y. Points whose spline
+# neighborhood is inside the original grid then project identically
+np.random.seed(0)
+for Nx,Ny in ((30,20), (60,40)):
+    lensmodel = f'LENSMODEL_SPLINED_STEREOGRAPHIC_order=3_Nx={Nx}_Ny={Ny}_fov_x_deg=120'
+    lensmodel_generic = \
+        f'LENSMODEL_SPLINED_STEREOGRAPHIC_order=3_Nx={Nx}_Ny={Ny+2}_fov_x_deg=120'
+
+    controlpoints = (np.random.random((Ny,Nx,2)) - 0.5) * 0.2
+    intrinsics_core = np.array((1500., 1800., 1499.5, 999.5))
+    intrinsics = \
+        nps.glue(intrinsics_core, controlpoints.ravel(), axis=-1)
+    intrinsics_generic = \
+        nps.glue(intrinsics_core,
+                 np.pad(controlpoints, ((1,1),(0,0),(0,0))).ravel(),
+                 axis=-1)
+
+    # Observation directions within ~25deg of the center: well inside the grid
+    th  = np.random.random(50) * 25. * np.pi/180.
+    phi = np.random.random(50) * 2.  * np.pi
+    p = nps.transpose(nps.cat(np.sin(th)*np.cos(phi),
+                              np.sin(th)*np.sin(phi),
+                              np.cos(th))) * 5.
+
+    q,         dq_dp,         dq_di         = \
+        mrcal.project(p, lensmodel,         intrinsics,         get_gradients = True)
+    q_generic, dq_dp_generic, dq_di_generic = \
+        mrcal.project(p, lensmodel_generic, intrinsics_generic, get_gradients = True)
+
+    testutils.confirm_equal(q, q_generic,
+                            eps = 1e-8,
+                            msg = f"Specialized {Nx}x{Ny} splined kernel: projections match the generic kernel")
+    testutils.confirm_equal(dq_dp, dq_dp_generic,
+                            eps = 1e-8,
+                            msg = f"Specialized {Nx}x{Ny} splined kernel: dq_dp matches the generic kernel")
+    testutils.confirm_equal(dq_di[..., :4], dq_di_generic[..., :4],
+                            eps = 1e-8,
+                            msg = f"Specialized {Nx}x{Ny} splined kernel: dq_dcore matches the generic kernel")
+    testutils.confirm_equal(dq_di[..., 4:],
+                            dq_di_generic[..., 4+2*Nx:4+2*Nx*(Ny+1)],
+                            eps = 1e-8,
+                            msg = f"Specialized {Nx}x{Ny} splined kernel: dq_dcontrolpoints matches the generic kernel")
+    testutils.confirm_equal(mrcal.unproject(q, lensmodel,         intrinsics),
+                            mrcal.unproject(q, lensmodel_generic, intrinsics_generic),
+                            eps = 1e-8,
+                            msg = f"Specialized {Nx}x{Ny} splined kernel: unprojections match the generic kernel")
+
+
 testutils.finish()
@@ -0,0 +1,66 @@
+#!/usr/bin/python3
+
+r'''Tests the mrcal.projector python class
+
+The projector should produce the same results as mrcal.project() and
+mrcal.unproject()
+
+'''
+
+import sys
+import numpy as np
+import numpysane as nps
+import os
+
+testdir = os.path.dirname(os.path.realpath(__file__))
+
+# I import the LOCAL mrcal since that's what I'm testing
+sys.path[:0] = f"{testdir}/..",
+import mrcal
+import testutils
+
+np.random.seed(0)
+
+v = np.array(((1.,   2.,   10.),
+              (-3.,  0.5,  8.),
+              (0.2, -4.,   20.),
+              (2.,   2.,   5.)))
+v = nps.cat(v, v*1.5)
+
+intrinsics_core = np.array((1512., 1112, 500., 333.))
+for lensmodel, distortions in \
+    ( ('LENSMODEL_PINHOLE',    ()),
+      ('LENSMODEL_OPENCV8',    (0.01,-0.02,0.001,0.002,0.001,0.02,0.001,-0.005)),
+      ('LENSMODEL_CAHVOR',     (0.001,-0.003,0.002,0.01,-0.02)),
+      ('LENSMODEL_SPLINED_STEREOGRAPHIC_order=3_Nx=11_Ny=8_fov_x_deg=100',
+       None), ):
+
+    if distortions is None:
+        Nintrinsics = mrcal.lensmodel_num_params(lensmodel)
+        distortions = (np.random.random(Nintrinsics-4) - 0.5) * 0.01
+    intrinsics = nps.glue(intrinsics_core, np.array(distortions), axis=-1)
+
+    P = mrcal.projector(lensmodel, intrinsics)
+
+    q_ref = mrcal.project(v, lensmodel, intrinsics)
+    q     = P.project(v)
+    testutils.confirm_equal(q, q_ref,
+                            worstcase = True,
+                            eps       = 1e-8,
+                            msg       = f"projector.project() matches mrcal.project() for {lensmodel}")
+
+    vu_ref = mrcal.unproject(q_ref, lensmodel, intrinsics)
+    vu     = P.unproject(q_ref)
+    testutils.confirm_equal(vu, vu_ref,
+                            worstcase = True,
+                            eps       = 1e-8,
+                            msg       = f"projector.unproject() matches mrcal.unproject() for {lensmodel}")
+
+    # I can keep using the projector after the intrinsics array changes
+    intrinsics[:] = 0
+    testutils.confirm_equal(P.project(v), q_ref,
+                            worstcase = True,
+                            eps       = 1e-8,
+                            msg       = f"projector keeps its own copy of the intrinsics for {lensmodel}")
+
+testutils.finish()
@@ -0,0 +1,134 @@
+#!/usr/bin/python3
+
+r'''Test of the mrcal-reproject-image tool
+
+I check that the --stream and --stream-raw modes produce the same images as the
+default mode, which processes one image at a time. And that errors in the
+streaming pipeline are reported
+
+'''
+
+import sys
+import numpy as np
+import numpysane as nps
+import os
+import subprocess
+import cv2
+
+testdir = os.path.dirname(os.path.realpath(__file__))
+
+# I import the LOCAL mrcal since that's what I'm testing
+sys.path[:0] = f"{testdir}/..",
+import mrcal
+import testutils
+
+
+
+import tempfile
+import atexit
+import shutil
+workdir = tempfile.mkdtemp()
+def cleanup():
+    global workdir
+    try:
+        shutil.rmtree(workdir)
+        workdir = None
+    except:
+        pass
+atexit.register(cleanup)
+
+
+
+W,H = 80,60
+model_from = \
+    mrcal.cameramodel( intrinsics = ('LENSMODEL_OPENCV4',
+                                     np.array((60., 60., (W-1)/2, (H-1)/2,
+                                               -0.1, 0.02, 0., 0.))),
+                       imagersize = np.array((W,H)) )
+# A longer lens than model_from, so all of the TO image maps to the interior of
+# the FROM image
+model_to = \
+    mrcal.cameramodel( intrinsics = ('LENSMODEL_PINHOLE',
+                                     np.array((90., 90., (W-1)/2, (H-1)/2))),
+                       imagersize = np.array((W,H)) )
+
+filename_from = f"{workdir}/from.cameramodel"
+filename_to   = f"{workdir}/to.cameramodel"
+model_from.write(filename_from)
+model_to  .write(filename_to)
+
+# Smooth images: the streaming modes use a fixed-point map, so their results
+# differ slightly from the default mode's. The difference is small if the images
+# don't change much from pixel to pixel
+Nimages = 4
+x,y = np.meshgrid(np.arange(W), np.arange(H))
+images = []
+for i in range(Nimages):
+    image = nps.cat(*[ 128. + 100.*np.sin(x/(7.+i+ichannel)) * np.cos(y/(5.+ichannel)) \
+                       for ichannel in range(3) ])
+    image = np.ascontiguousarray(nps.mv(image, 0, -1)).astype(np.uint8)
+    cv2.imwrite(f"{workdir}/image{i}.png", image)
+    images.append(image)
+
+def reproject(outdir, *args_extra):
+    os.mkdir(f"{workdir}/{outdir}")
+    subprocess.check_output( (f"{testdir}/../mrcal-reproject-image",
+                              '--outdir', f"{workdir}/{outdir}",
+                              *args_extra,
+                              filename_from, filename_to,
+                              f"{workdir}/image*.png"),
+                             stderr = subprocess.DEVNULL)
+    return [cv2.imread(f"{workdir}/{outdir}/image{i}-reprojected.png") \
+            for i in range(Nimages)]
+
+images_ref    = reproject('ref')
+images_stream = reproject('stream', '--stream', '--jobs', '3')
+
+for i in range(Nimages):
+    testutils.confirm( images_ref[i] is not None,
+                       msg = f"Default mode wrote image {i}")
+    testutils.confirm( images_stream[i] is not None,
+                       msg = f"--stream wrote image {i}")
+    if images_ref[i] is None or images_stream[i] is None:
+        continue
+    testutils.confirm_equal( images_stream[i].astype(float),
+                             images_ref[i].astype(float),
+                             worstcase = True,
+                             eps       = 2,
+                             msg = f"--stream image {i} matches the default mode")
+
+# --stream-raw: frames from stdin to stdout. This uses the same fixed-point map
+# as --stream, so the results must be identical
+out = subprocess.check_output( (f"{testdir}/../mrcal-reproject-image",
+                                '--stream-raw',
+                                filename_from, filename_to),
+                               input  = b''.join(image.tobytes() for image in images),
+                               stderr = subprocess.DEVNULL)
+testutils.confirm_equal( len(out), Nimages*H*W*3,
+                         msg = "--stream-raw wrote all the frames")
+if len(out) == Nimages*H*W*3:
+    images_stream_raw = np.frombuffer(out, dtype=np.uint8).reshape(Nimages,H,W,3)
+    for i in range(Nimages):
+        if images_stream[i] is None:
+            continue
+        testutils.confirm_equal( images_stream_raw[i], images_stream[i],
+                                 worstcase = True,
+                                 eps       = 0,
+                                 msg = f"--stream-raw frame {i} matches --stream")
+
+# A failure to read the input in the feeder thread must not look like the end
+# of the stream: the tool must fail. Reading a write-only stdin fails
+fd = os.open(f"{workdir}/stdin-write-only", os.O_WRONLY | os.O_CREAT)
+try:
+    result = subprocess.run( (f"{testdir}/../mrcal-reproject-image",
+                              '--stream-raw',
+                              filename_from, filename_to),
+                             stdin  = fd,
+                             stdout = subprocess.DEVNULL,
+                             stderr = subprocess.DEVNULL)
+finally:
+    os.close(fd)
+testutils.confirm( result.returncode != 0,
+                   msg = "--stream-raw fails if the input can't be read")
+
+testutils.finish()
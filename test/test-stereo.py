@@ -7,6 +7,9 @@ import sys
 import numpy as np
 import numpysane as nps
 import os
+import tempfile
+import subprocess
+import cv2
 
 testdir = os.path.dirname(os.path.realpath(__file__))
 
@@ -281,6 +284,36 @@ for lensmodel in ('LENSMODEL_LATLON', 'LENSMODEL_PINHOLE'):
     rectification_maps = mrcal.rectification_maps((model0,model1),
                                                   models_rectified)
 
+    (rectification_map0_approx,rectification_map1_approx), approximation_error = \
+        mrcal.rectification_maps((model0,model1),
+                                 models_rectified,
+                                 approximation_max_error = 0.01)
+    testutils.confirm( approximation_error <= 0.01,
+                       msg=f'approximate rectification maps report an in-bounds error ({lensmodel})')
+    # The reported error is estimated on a sample grid, so the true worst-case
+    # error may be somewhat larger. Within 2x is expected
+    testutils.confirm_equal( rectification_map0_approx, rectification_maps[0],
+                             worstcase = True,
+                             eps=0.02,
+                             msg=f'approximate rectification map for camera 0 ({lensmodel})')
+    testutils.confirm_equal( rectification_map1_approx, rectification_maps[1],
+                             worstcase = True,
+                             eps=0.02,
+                             msg=f'approximate rectification map for camera 1 ({lensmodel})')
+
+    with tempfile.TemporaryDirectory() as map_cache_directory:
+        mrcal.set_map_cache_directory(map_cache_directory)
+        # The first call fills the cache, the second reads it
+        for what in ('computed','cached'):
+            rectification_maps_cache = mrcal.rectification_maps((model0,model1),
+                                                                models_rectified)
+            for i in range(2):
+                testutils.confirm_equal( rectification_maps_cache[i], rectification_maps[i],
+                                         worstcase = True,
+                                         eps=1e-6,
+                                         msg=f'{what} rectification map for camera {i} with a map cache ({lensmodel})')
+        mrcal.set_map_cache_directory(None)
+
     interp_rectification_map0x = \
         scipy.interpolate.RectBivariateSpline(row, col,
                                               nps.transpose(rectification_maps[0][...,0]))
@@ -330,4 +363,171 @@ for lensmodel in ('LENSMODEL_LATLON', 'LENSMODEL_PINHOLE'):
     testutils.confirm_equal( r, nps.mag(pcam0),
                              msg=f'stereo_range reports the right thing ({lensmodel})')
 
+    # The range LUT should produce the same ranges as the direct computation.
+    # I use OpenCV-style disparities: int16 in units of 1/16 pixels, with
+    # invalid values sprinkled in
+    Naz,Nel = models_rectified[0].imagersize()
+    disparity_max   = 40
+    disparity_scale = 16
+    disparity16 = (np.random.random((Nel,Naz)) * disparity_max*disparity_scale).astype(np.int16)
+    disparity16[np.random.random((Nel,Naz)) < 0.1] = -16
+    disparity16[0,:10] = 0
+    range_lut = mrcal.stereo_range_lut(models_rectified,
+                                       disparity_max   = disparity_max,
+                                       disparity_scale = disparity_scale)
+    r_lut = mrcal.stereo_range( disparity16,
+                                models_rectified,
+                                disparity_scale = disparity_scale,
+                                range_lut       = range_lut)
+    r_ref = mrcal.stereo_range( disparity16,
+                                models_rectified,
+                                disparity_scale = disparity_scale)
+    testutils.confirm_equal( r_lut, r_ref,
+                             relative  = True,
+                             worstcase = True,
+                             eps       = 1e-5,
+                             msg=f'stereo_range with a LUT matches the direct computation ({lensmodel})')
+    testutils.confirm_equal( r_lut[disparity16 <= 0], 0,
+                             worstcase = True,
+                             msg=f'stereo_range with a LUT reports invalid disparities as 0 ({lensmodel})')
+    # The LUT must have been computed with the same disparity_scale
+    testutils.confirm_raises( lambda: mrcal.stereo_range( disparity16,
+                                                          models_rectified,
+                                                          range_lut = range_lut),
+                              msg=f'stereo_range with a LUT checks the disparity_scale ({lensmodel})')
+
+    # The one-pass point cloud should match the points computed from the ranges
+    image = (np.random.random((Nel,Naz,3)) * 255).astype(np.uint8)
+    Rt_ref_rect0 = models_rectified[0].extrinsics_Rt_toref()
+    q = np.ascontiguousarray( \
+           nps.mv( nps.cat( *np.meshgrid(np.arange(Naz,dtype=float),
+                                         np.arange(Nel,dtype=float))),
+                   0, -1))
+    p_ref = mrcal.transform_point_Rt( Rt_ref_rect0,
+                                      mrcal.unproject(q, *models_rectified[0].intrinsics(),
+                                                      normalize = True) * \
+                                      nps.dummy(r_ref, axis=-1))
+    mask_valid = r_ref > 0
+    out = np.zeros((Nel*Naz,3), dtype=np.float32)
+    points, colors = mrcal.stereo_point_cloud(disparity16,
+                                              models_rectified,
+                                              range_lut,
+                                              image        = image,
+                                              Rt_out_rect0 = Rt_ref_rect0,
+                                              out          = out)
+    testutils.confirm_equal( points.shape, (np.count_nonzero(mask_valid),3),
+                             msg=f'stereo_point_cloud drops the invalid pixels ({lensmodel})')
+    testutils.confirm_equal( nps.mag(points - p_ref[mask_valid]) / nps.mag(p_ref[mask_valid]),
+                             0,
+                             worstcase = True,
+                             eps       = 1e-5,
+                             msg=f'stereo_point_cloud reports the right points ({lensmodel})')
+    testutils.confirm_equal( colors, image[mask_valid],
+                             worstcase = True,
+                             msg=f'stereo_point_cloud reports the right colors ({lensmodel})')
+    testutils.confirm( np.shares_memory(points, out),
+                       msg=f'stereo_point_cloud writes into the given buffer ({lensmodel})')
+
+    disparity16[:] = disparity_max*disparity_scale + 1
+    testutils.confirm_equal( mrcal.stereo_range( disparity16,
+                                                 models_rectified,
+                                                 disparity_scale = disparity_scale,
+                                                 range_lut       = range_lut),
+                             0,
+                             worstcase = True,
+                             msg=f'stereo_range with a LUT reports out-of-bounds disparities as 0 ({lensmodel})')
+
+
+# The native SGM matcher. A synthetic rectified pair: a random texture on a
+# fronto-parallel plane, shifted by a known integer disparity
+np.random.seed(0)
+W,H          = 200,100
+disparity_px = 13
+texture = np.random.randint(0,256, size=(H,W+disparity_px)).astype(np.uint8)
+# A feature at column x in image0 appears at column x-disparity in image1
+image0  = np.ascontiguousarray(texture[:, :W])
+image1  = texture[:, disparity_px:]
+disparity16 = mrcal.stereo_sgm(image0, image1,
+                               Ndisparities = 32)
+testutils.confirm_equal( disparity16.shape, (H,W),
+                         msg='stereo_sgm returns a full-size disparity image')
+testutils.confirm_equal( disparity16.dtype, np.int16,
+                         msg='stereo_sgm returns int16 disparities')
+# Away from the borders where the census windows run off the image, and from
+# the left edge, where image1 doesn't see the scene
+mask_interior = np.zeros((H,W), dtype=bool)
+mask_interior[3:-3, 32+3:-3] = True
+testutils.confirm_equal( disparity16[mask_interior], disparity_px*16,
+                         worstcase = True,
+                         eps       = 8,
+                         msg='stereo_sgm reports the right disparities')
+testutils.confirm_equal( mrcal.stereo_sgm(nps.glue(*[image0[...,np.newaxis]]*3, axis=-1),
+                                          nps.glue(*[image1[...,np.newaxis]]*3, axis=-1),
+                                          Ndisparities = 32),
+                         disparity16,
+                         worstcase = True,
+                         msg='stereo_sgm accepts gray color images')
+testutils.confirm_equal( mrcal.stereo_sgm(image0, image1,
+                                          disparity_min = 8,
+                                          Ndisparities  = 16)[mask_interior],
+                         disparity_px*16,
+                         worstcase = True,
+                         eps       = 8,
+                         msg='stereo_sgm respects disparity_min')
+
+
+# The mrcal-stereo tool processes a sequence of image pairs in a pipeline of
+# threads if --pipeline. This must produce the same outputs as the sequential
+# path. I use several workers in each stage, and --clahe, which uses a stateful
+# OpenCV object
+with tempfile.TemporaryDirectory() as workdir:
+    W,H = 320,240
+    model_stereo0 = \
+        mrcal.cameramodel( intrinsics = ('LENSMODEL_PINHOLE',
+                                         np.array((200., 200., (W-1)/2, (H-1)/2))),
+                           imagersize = np.array((W,H)) )
+    model_stereo1 = mrcal.cameramodel(model_stereo0)
+    model_stereo1.extrinsics_rt_toref(np.array((0,0,0, 0.2,0,0)))
+    model_stereo0.write(f"{workdir}/cam0.cameramodel")
+    model_stereo1.write(f"{workdir}/cam1.cameramodel")
+
+    Npairs = 4
+    for i in range(Npairs):
+        texture = np.random.randint(0,256, size=(H,W+disparity_px)).astype(np.uint8)
+        cv2.imwrite(f"{workdir}/left-{i}.png",  texture[:, :W])
+        cv2.imwrite(f"{workdir}/right-{i}.png", texture[:, disparity_px:])
+
+    for outdir,args_extra in (('sequential', ()),
+                              ('pipeline',   ('--pipeline',
+                                              '--pipeline-workers', '3'))):
+        os.mkdir(f"{workdir}/{outdir}")
+        subprocess.check_output( (f"{testdir}/../mrcal-stereo",
+                                  '--az-fov-deg', '60',
+                                  '--el-fov-deg', '40',
+                                  '--force-grayscale',
+                                  '--clahe',
+                                  '--disparity-range', '0', '32',
+                                  '--outdir', f"{workdir}/{outdir}",
+                                  *args_extra,
+                                  f"{workdir}/cam0.cameramodel",
+                                  f"{workdir}/cam1.cameramodel",
+                                  f"{workdir}/left-*.png",
+                                  f"{workdir}/right-*.png"),
+                                 encoding = 'ascii',
+                                 stderr   = subprocess.DEVNULL )
+
+    filenames = sorted(os.listdir(f"{workdir}/sequential"))
+    testutils.confirm_equal( len(filenames), 2 + 4*Npairs,
+                             msg = 'mrcal-stereo wrote all the outputs')
+    testutils.confirm_equal( sorted(os.listdir(f"{workdir}/pipeline")), filenames,
+                             msg = 'mrcal-stereo --pipeline wrote the same outputs')
+    for f in filenames:
+        with open(f"{workdir}/sequential/{f}", 'rb') as fp: sequential = fp.read()
+        try:
+            with open(f"{workdir}/pipeline/{f}", 'rb') as fp: pipeline = fp.read()
+        except FileNotFoundError:
+            pipeline = None
+        testutils.confirm( sequential == pipeline,
+                           msg = f'mrcal-stereo --pipeline output {f} matches the sequential path')
+
 testutils.finish()
@@ -0,0 +1,167 @@
+#!/usr/bin/python3
+
+r'''Tests mrcal.transform_image() with fixed-point maps and the native paths
+of mrcal.image_transformation_map()
+
+The native remap engine should produce the same results as a bilinear
+interpolation at the quantized map coordinates. The native transformation maps
+should match a direct unproject/transform/project
+
+'''
+
+import sys
+import numpy as np
+import numpysane as nps
+import os
+
+testdir = os.path.dirname(os.path.realpath(__file__))
+
+# I import the LOCAL mrcal since that's what I'm testing
+sys.path[:0] = f"{testdir}/..",
+import mrcal
+import testutils
+
+np.random.seed(0)
+
+W_in,H_in   = 64,48
+W_out,H_out = 70,50
+
+x,y = np.meshgrid(np.arange(W_out, dtype=np.float32),
+                  np.arange(H_out, dtype=np.float32))
+mapxy = np.ascontiguousarray( nps.mv( nps.cat( (x - 35.) * 1.02 + 32. + 2.*np.sin(y*0.1),
+                                               (y - 25.) * 1.03 + 24. + 1.*np.cos(x*0.2) ),
+                                      0, -1),
+                              dtype = np.float32)
+mapxy[0,0,:] = np.nan
+
+map_xy, map_fraction = mrcal.transformation_map_fixedpoint(mapxy)
+
+# The coordinates actually used by the fixed-point map
+mapxy_quantized = map_xy + \
+    nps.mv(nps.cat(map_fraction & 31, map_fraction >> 5), 0, -1) / 32.
+
+testutils.confirm_equal( mapxy_quantized[1:,...], mapxy[1:,...],
+                         worstcase = True,
+                         eps = 1./64. + 1e-4,
+                         msg = 'fixed-point map quantization')
+testutils.confirm( np.all(map_xy[0,0] < 0),
+                   msg = 'non-finite map entries are out of bounds')
+
+
+def remap_reference(image, border_value):
+    r'''Bilinear interpolation at the quantized coordinates, in float64'''
+
+    image = image.astype(float)
+    if image.ndim == 2:
+        image = nps.dummy(image, -1)
+    x = mapxy_quantized[...,0]
+    y = mapxy_quantized[...,1]
+    x0 = np.floor(x).astype(int)
+    y0 = np.floor(y).astype(int)
+    ax = nps.dummy(x - x0, -1)
+    ay = nps.dummy(y - y0, -1)
+
+    def sample(ix,iy):
+        inbounds = (ix >= 0) * (iy >= 0) * (ix < W_in) * (iy < H_in)
+        v = image[np.clip(iy,0,H_in-1), np.clip(ix,0,W_in-1)]
+        v[~inbounds] = border_value
+        return v
+
+    return \
+        sample(x0,  y0  ) * (1-ax) * (1-ay) + \
+        sample(x0+1,y0  ) *    ax  * (1-ay) + \
+        sample(x0,  y0+1) * (1-ax) *    ay  + \
+        sample(x0+1,y0+1) *    ax  *    ay
+
+
+for Nchannels in (1,3):
+    shape = (H_in,W_in) if Nchannels == 1 else (H_in,W_in,Nchannels)
+
+    image_float = np.random.random(shape).astype(np.float32) * 255.
+    for dtype,scale,eps in ((np.uint8,    1.,   0.5 + 1e-6),
+                            (np.uint16, 257.,   0.5 + 1e-6),
+                            (np.float32,  1.,   1e-3)):
+        image = (image_float * scale).astype(dtype)
+
+        ref = remap_reference(image, 7)
+        if Nchannels == 1:
+            ref = ref[...,0]
+
+        image_transformed = mrcal.transform_image(image, (map_xy, map_fraction),
+                                                  borderValue = 7)
+        testutils.confirm( image_transformed.shape == ref.shape,
+                           msg = f'remapped image has the right shape ({dtype.__name__}, Nchannels={Nchannels})')
+        testutils.confirm( image_transformed.dtype == dtype,
+                           msg = f'remapped image has the right dtype ({dtype.__name__}, Nchannels={Nchannels})')
+        testutils.confirm_equal( image_transformed.astype(float), ref,
+                                 worstcase = True,
+                                 eps = eps,
+                                 msg = f'remapped image matches the reference ({dtype.__name__}, Nchannels={Nchannels})')
+
+        out = np.zeros(ref.shape, dtype=dtype)
+        mrcal.transform_image(image, (map_xy, map_fraction),
+                              out         = out,
+                              borderValue = 7)
+        testutils.confirm_equal( out, image_transformed,
+                                 msg = f'remapping into out= works ({dtype.__name__}, Nchannels={Nchannels})')
+
+
+
+# mrcal.image_transformation_map() evaluates the plane-homography, rotation and
+# intrinsics-only modes in C. I compare against a direct evaluation at a few
+# pixels
+model_opencv  = mrcal.cameramodel(f"{testdir}/data/cam0.opencv8.cameramodel")
+model_pinhole = mrcal.pinhole_model_for_reprojection(model_opencv,
+                                                     scale_image = 0.1)
+model_pinhole.extrinsics_rt_fromref( mrcal.compose_rt( np.array((0.01, -0.02, 0.03, 0.1, 0.2, -0.05)),
+                                                       model_opencv.extrinsics_rt_fromref()))
+# CAHVORE has no gradients, so the C unproject() can't handle it. Those maps are
+# computed by the slow path. A small imager keeps the per-pixel optimizations
+# quick
+model_cahvore = mrcal.cameramodel( intrinsics = ('LENSMODEL_CAHVORE_linearity=0.40',
+                                                 np.array((50., 51., 19.5, 14.5,
+                                                           -0.001, 0.002,
+                                                           0., 0.01, -0.001,
+                                                           1e-3, 2e-3, 3e-3))),
+                                   imagersize = (40,30),
+                                   extrinsics_rt_fromref = model_opencv.extrinsics_rt_fromref())
+plane_n = np.array((0.1, -0.2, 1.))
+plane_d = 5.
+
+for model_from,model_to in ((model_opencv,  model_pinhole),
+                            (model_pinhole, model_pinhole),
+                            (model_pinhole, model_opencv),
+                            (model_pinhole, model_cahvore),
+                            (model_cahvore, model_pinhole)):
+
+    lensmodel_from = model_from.intrinsics()[0]
+    lensmodel_to   = model_to.  intrinsics()[0]
+    W,H = model_to.imagersize()
+    q_to = nps.transpose(nps.cat(np.random.random(20) * (W-1),
+                                 np.random.random(20) * (H-1)))
+    # the map is sampled at integer pixels
+    q_to = np.round(q_to)
+    iq   = q_to.astype(int)
+
+    Rt_to_from = mrcal.compose_Rt(model_to.  extrinsics_Rt_fromref(),
+                                  model_from.extrinsics_Rt_toref())
+
+    for what,kwargs,v_from in \
+        ( ('intrinsics-only', dict(intrinsics_only = True),
+           lambda v: v),
+          ('rotation',        dict(),
+           lambda v: nps.matmult(v, Rt_to_from[:3,:])),
+          ('plane',           dict(plane_n = plane_n, plane_d = plane_d),
+           lambda v: nps.matmult(v,
+                                 nps.transpose(np.linalg.inv(plane_d * Rt_to_from[:3,:] + \
+                                                             nps.outer(Rt_to_from[3,:], plane_n))))) ):
+
+        mapxy = mrcal.image_transformation_map(model_from, model_to, **kwargs)
+        q_from_ref = mrcal.project( v_from(mrcal.unproject(q_to, *model_to.intrinsics())),
+                                    *model_from.intrinsics())
+        testutils.confirm_equal( mapxy[iq[:,1],iq[:,0]], q_from_ref,
+                                 worstcase = True,
+                                 eps = 1e-2,
+                                 msg = f'image_transformation_map() in the {what} mode: {lensmodel_to} -> {lensmodel_from}')
+
+testutils.finish()
@@ -641,6 +641,28 @@ for ipt in range(Npoints):
                             eps       = 1e-9,
                             msg       = "Var(joint) should be Var(cal-time-noise) + Var(obs-time-noise)")
 
+# The persistent triangulator object computes the same thing. I call it twice,
+# to make sure nothing is consumed by the first call
+triangulator = \
+    mrcal.triangulator( (models_baseline[icam0],models_baseline[icam1]),
+                        q_calibration_stdev             = args.q_calibration_stdev,
+                        q_observation_stdev             = args.q_observation_stdev,
+                        q_observation_stdev_correlation = args.q_observation_stdev_correlation,
+                        stabilize_coords                = args.stabilize_coords)
+for icall in range(2):
+    for what,x,x_ref in zip( ('p', 'Var_p_calibration', 'Var_p_observation', 'Var_p_joint'),
+                             triangulator(q_true),
+                             (p, Var_p_calibration, Var_p_observation, Var_p_joint)):
+        testutils.confirm_equal(x, x_ref,
+                                worstcase = True,
+                                eps       = 1e-9,
+                                msg       = f"mrcal.triangulator() call {icall} reports the same {what} as mrcal.triangulate()")
+testutils.confirm_equal(mrcal.triangulator( (models_baseline[icam0],models_baseline[icam1]) )(q_true),
+                        p_alone,
+                        worstcase = True,
+                        eps       = 1e-9,
+                        msg       = "mrcal.triangulator(no noise) reports the same p as mrcal.triangulate()")
+
 if not args.do_sample:
     testutils.finish()
     sys.exit()
@@ -126,6 +126,34 @@ def test_geometry( Rt01, p, whatgeometry,
 
         what = f"{whatgeometry} {f.__name__}"
 
+        # Large arrays of points are triangulated by the batched routines if no
+        # gradients are requested. Those must produce the same results. I
+        # include degenerate observations: parallel rays, and rays along the
+        # baseline. These fail to triangulate, and both paths must report
+        # (0,0,0)
+        if f is mrcal.triangulate_lindstrom:
+            v0_degenerate = args[0][:1]
+            # v1 is in the camera-1 coord system
+            v1_degenerate = nps.matmult(v0_degenerate, R01)
+        else:
+            v0_degenerate = nps.cat(args[0][0], t01)
+            v1_degenerate = v0_degenerate
+        p_degenerate = f(v0_degenerate, v1_degenerate, args[2])
+        testutils.confirm_equal( p_degenerate, np.zeros(v0_degenerate.shape),
+                                 worstcase = True,
+                                 msg = f"{what}: degenerate rays report (0,0,0)")
+
+        Ntile = mrcal.triangulation._triangulate_batch_Npoints_min
+        p_batch = f(nps.glue(np.tile(args[0], (Ntile,1)), v0_degenerate, axis=-2),
+                    nps.glue(np.tile(args[1], (Ntile,1)), v1_degenerate, axis=-2),
+                    args[2])
+        testutils.confirm_equal( p_batch,
+                                 nps.glue(np.tile(p_reported, (Ntile,1)), p_degenerate, axis=-2),
+                                 relative  = True,
+                                 worstcase = True,
+                                 msg = f"{what}: batched no-gradients path",
+                                 eps = 1e-8)
+
         if out_of_bounds:
             p_optimized = np.zeros(p_reported.shape)
         else:
@@ -253,4 +281,117 @@ p = np.array((( 110.,  25.,    50.  ),
               ))
 test_geometry(Rt01, p, "cameras-90deg-to-each-other out-of-bounds", out_of_bounds = True )
 
+
+############### N-view triangulation
+
+# With 2 views, the N-view geometric method is the usual geometric method
+t01  = np.array(( 1.,   0.1,  -0.2))
+R01  = mrcal.R_from_r(np.array((0.001, -0.002, -0.003)))
+p    = np.array((( 300.,  20.,   2000.),
+                 (-3100., 180.,  2000.),
+                 ( 300.,  2900., 15.  )))
+v0   = p         + np.random.randn(*p.shape) * 1e-2
+v1   = p - t01   + np.random.randn(*p.shape) * 1e-2
+testutils.confirm_equal( mrcal.triangulate_nview_geometric(nps.mv(nps.cat(v0,v1),0,-2),
+                                                           nps.cat(np.zeros((3,)),t01)),
+                         mrcal.triangulate_geometric(v0, v1, t01),
+                         relative  = True,
+                         worstcase = True,
+                         msg = "2-view triangulate_nview_geometric matches triangulate_geometric",
+                         eps = 1e-8)
+
+# The C uncertainty propagation writes dp/dstate at the given state indices. Out
+# of bounds indices must be rejected
+def triangulate_with_uncertainty(**kwargs):
+    intrinsics = np.array((1000., 1000., 500., 500.))
+    return mrcal._mrcal._triangulate_with_uncertainty(np.array(((( 500., 500.),
+                                                                 ( 450., 500.)),)),
+                                                      'leecivera_mid2',
+                                                      'LENSMODEL_PINHOLE', intrinsics,
+                                                      np.zeros((6,), dtype=float),
+                                                      'LENSMODEL_PINHOLE', intrinsics,
+                                                      np.array((0., 0., 0., -1., 0., 0.)),
+                                                      **kwargs)
+testutils.confirm_equal( triangulate_with_uncertainty(Nstate             = 20,
+                                                      istate_intrinsics0 = 0,
+                                                      istate_intrinsics1 = 4,
+                                                      Nintrinsics_state  = 4,
+                                                      istate_extrinsics0 = 8,
+                                                      istate_extrinsics1 = 14)[2].shape,
+                         (1,3,20),
+                         msg = "_triangulate_with_uncertainty() accepts in-bounds state indices")
+for kwargs in ( dict(istate_extrinsics0 = 0),
+                dict(Nstate = 20, istate_extrinsics1 = 15),
+                dict(Nstate = 20, istate_intrinsics0 = 17, Nintrinsics_state = 4),
+                dict(Nstate = 20, icol0_intrinsics = 1,    Nintrinsics_state = 4),
+                dict(Nstate = 20, rt_ref_frame = np.zeros((2,6), dtype=float),
+                     istate_frames = 10),
+                dict(Nstate = 20, rt_ref_frame = np.zeros((2,6), dtype=float)) ):
+    testutils.confirm_raises( lambda: triangulate_with_uncertainty(**kwargs),
+                              msg = f"_triangulate_with_uncertainty() rejects out-of-bounds state indices: {kwargs}")
+
+# A rig of 4 cameras, with noiseless observations
+models_nview = \
+    [ mrcal.cameramodel( intrinsics = ('LENSMODEL_PINHOLE',
+                                       np.array((1000., 1000., 500., 500.))),
+                         imagersize = np.array((1000,1000)),
+                         extrinsics_rt_fromref = np.array((0.01*i, -0.02*i, 0.003*i,
+                                                           -0.5*i, 0.1*i, 0.02*i))) \
+      for i in range(4) ]
+p_ref = np.array((( 3.,  2.,   20.),
+                  (-1.,  0.5,  30.),
+                  ( 1.,  -2.,  10.)))
+q_nview = \
+    nps.mv(nps.cat(*[ mrcal.project(mrcal.transform_point_rt(m.extrinsics_rt_fromref(), p_ref),
+                                    *m.intrinsics()) \
+                      for m in models_nview ]),
+           0, -2)
+
+for method in (mrcal.triangulate_nview_geometric,
+               mrcal.triangulate_nview_angular):
+
+    testutils.confirm_equal( mrcal.triangulate_nview(q_nview, models_nview,
+                                                     method = method),
+                             p_ref,
+                             worstcase = True,
+                             msg = f"{method.__name__}: noiseless 4-view triangulation",
+                             eps = 1e-6)
+
+    v = mrcal.rotate_point_r(models_nview[0].extrinsics_rt_fromref()[:3],
+                             mrcal.rotate_point_r(nps.cat(*[m.extrinsics_rt_toref()[:3] for m in models_nview]),
+                                                  mrcal.unproject(q_nview[0], *models_nview[0].intrinsics())))
+    t = mrcal.transform_point_rt(models_nview[0].extrinsics_rt_fromref(),
+                                 nps.cat(*[m.extrinsics_rt_toref()[3:] for m in models_nview]))
+    v += np.random.randn(*v.shape) * 1e-3
+
+    _, dp_dv, dp_dt = method(v, t, get_gradients = True)
+    testutils.confirm_equal( dp_dv,
+                             nps.mv(grad(lambda v: method(v,t), v, step = 1e-6), -3, -2),
+                             relative  = True,
+                             worstcase = True,
+                             msg = f"{method.__name__}: dp/dv",
+                             eps = 1e-3)
+    testutils.confirm_equal( dp_dt,
+                             nps.mv(grad(lambda t: method(v,t), t, step = 1e-6), -3, -2),
+                             relative  = True,
+                             worstcase = True,
+                             msg = f"{method.__name__}: dp/dt",
+                             eps = 1e-3)
+
+# The angular method minimizes the sum of the squared sines of the angular
+# errors, so the gradient of that cost is 0 at its solution, and the cost there
+# is no larger than at the geometric solution
+def cost_angular(p):
+    d = p - t
+    return np.sum(1. - (nps.inner(d,v) / (nps.mag(d)*nps.mag(v)))**2)
+p_angular   = mrcal.triangulate_nview_angular  (v, t)
+p_geometric = mrcal.triangulate_nview_geometric(v, t)
+testutils.confirm_equal( grad(cost_angular, p_angular),
+                         0,
+                         worstcase = True,
+                         msg = "triangulate_nview_angular: the solution is a stationary point of the angular cost",
+                         eps = 1e-8)
+testutils.confirm( cost_angular(p_angular) <= cost_angular(p_geometric),
+                   msg = "triangulate_nview_angular: the angular cost is no worse than at the geometric solution")
+
 testutils.finish()
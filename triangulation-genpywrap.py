@@ -207,4 +207,130 @@ THAT function, and see the docs for that function. The differences:
 ''' },
 )
 
+
+# N-view triangulation. Each broadcasted slice is one point, observed by Nviews
+# cameras
+for WHAT,LONGNAME in (('geometric', 'N-view geometric'),
+                      ('angular',   'N-view angular')):
+
+    m.function( f"_triangulate_nview_{WHAT}",
+                f"""Internal {LONGNAME} triangulation routine
+
+This is the internals for mrcal.triangulate_nview_{WHAT}(get_gradients = False).
+As a user, please call THAT function, and see the docs for that function. The
+differences:
+
+- This is just the no-gradients function. The internal function that returns
+  gradients is _triangulate_nview_{WHAT}_withgrad
+
+- This function is wrapped with numpysane_pywrap, so the arguments broadcast as
+  expected
+
+""",
+                args_input       = ('v', 't'),
+                prototype_input  = (('Nviews',3), ('Nviews',3)),
+                prototype_output = (3,),
+                Ccode_validate = r'''
+                return CHECK_CONTIGUOUS_AND_SETERROR_ALL();''',
+                Ccode_slice_eval = { (np.float64,np.float64,
+                                      np.float64):
+                                     f'''
+                *(mrcal_point3_t*)data_slice__output =
+                  mrcal_triangulate_nview_{WHAT}(NULL, NULL,
+                                                 (const mrcal_point3_t*)data_slice__v,
+                                                 (const mrcal_point3_t*)data_slice__t,
+                                                 dims_slice__v[0]);
+                return true;
+''' },
+    )
+
+    m.function( f"_triangulate_nview_{WHAT}_withgrad",
+                f"""Internal {LONGNAME} triangulation routine (with gradients)
+
+This is the internals for mrcal.triangulate_nview_{WHAT}(get_gradients = True).
+As a user, please call THAT function, and see the docs for that function. The
+differences:
+
+- This is just the gradients-returning function. The internal function that
+  skips those is _triangulate_nview_{WHAT}
+
+- This function is wrapped with numpysane_pywrap, so the arguments broadcast as
+  expected
+
+""",
+                args_input       = ('v', 't'),
+                prototype_input  = (('Nviews',3), ('Nviews',3)),
+                prototype_output = ((3,), ('Nviews',3,3), ('Nviews',3,3)),
+                Ccode_validate = r'''
+                return CHECK_CONTIGUOUS_AND_SETERROR_ALL();''',
+                Ccode_slice_eval = { (np.float64,np.float64,
+                                      np.float64,np.float64,np.float64):
+                                     f'''
+                *(mrcal_point3_t*)data_slice__output0 =
+                  mrcal_triangulate_nview_{WHAT}((double*)data_slice__output1,
+                                                 (double*)data_slice__output2,
+                                                 (const mrcal_point3_t*)data_slice__v,
+                                                 (const mrcal_point3_t*)data_slice__t,
+                                                 dims_slice__v[0]);
+                return true;
+''' },
+    )
+
+
+# The batched no-gradients routines. These take and return SoA arrays: each
+# argument has shape (Nvars,N). mrcal.triangulate_...() rearranges the data to
+# call these for large arrays of points. These release the GIL, so large arrays
+# can be split into chunks, and evaluated concurrently in several threads
+DOCS_BATCH = r"""Internal batched {LONGNAME} triangulation routine
+
+This is the internals for mrcal.triangulate_{WHAT}(get_gradients = False),
+called for large arrays of points. As a user, please call THAT function, and see
+the docs for that function. The differences:
+
+- This is just the no-gradients function
+
+- The data is stored in the SoA layout: each input has shape (Nvars,N), and the
+  output has shape (3,N). The (N,Nvars) arrays mrcal.triangulate_{WHAT}()
+  takes are the transposes of these
+
+- Many points are triangulated in each call, several at a time in SIMD lanes
+
+- The GIL is released while triangulating, so several Python threads can call
+  this function concurrently, to use several cores
+
+"""
+BODY_SLICE_BATCH = r'''
+                Py_BEGIN_ALLOW_THREADS;
+                mrcal_triangulate_{WHAT}_batch((double*)data_slice__output,
+                                               (const double*)data_slice__{ARG0},
+                                               (const double*)data_slice__{ARG1},
+                                               (const double*)data_slice__{ARG2},
+                                               dims_slice__output[1]);
+                Py_END_ALLOW_THREADS;
+                return true;
+'''
+
+for WHAT,LONGNAME,args,Nvars2 in (('geometric',       'geometric',             ('v0', 'v1', 't01'),             3),
+                                  ('leecivera_l1',    'Lee-Civera L1',         ('v0', 'v1', 't01'),             3),
+                                  ('leecivera_linf',  'Lee-Civera L-infinity', ('v0', 'v1', 't01'),             3),
+                                  ('leecivera_mid2',  'Lee-Civera Mid2',       ('v0', 'v1', 't01'),             3),
+                                  ('leecivera_wmid2', 'Lee-Civera wMid2',      ('v0', 'v1', 't01'),             3),
+                                  ('lindstrom',       'Lindstrom',             ('v0_local', 'v1_local', 'Rt01'), 12)):
+
+    m.function( NAME.format(WHAT = WHAT) + "_batch",
+                DOCS_BATCH.format(WHAT     = WHAT,
+                                  LONGNAME = LONGNAME),
+                args_input       = args,
+                prototype_input  = ((3,'N'), (3,'N'), (Nvars2,'N')),
+                prototype_output = (3,'N'),
+                Ccode_validate = r'''
+                return CHECK_CONTIGUOUS_AND_SETERROR_ALL();''',
+                Ccode_slice_eval = { (np.float64,np.float64,np.float64,
+                                      np.float64):
+                                     BODY_SLICE_BATCH.format(WHAT = WHAT,
+                                                             ARG0 = args[0],
+                                                             ARG1 = args[1],
+                                                             ARG2 = args[2]) },
+    )
+
 m.write()
@@ -0,0 +1,458 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "mrcal.h"
+#include "util.h"
+
+// The points are split into tiles of this many points, and the tiles are
+// distributed among the threads
+#define TRIANGULATION_UNCERTAINTY_TILE_NPOINTS 256
+
+// The quantities that depend on the camera pair only, not on the individual
+// points. Computed once, and shared by all the threads
+typedef struct
+{
+    // rt01 = compose(rt_0ref, invert(rt_1ref)), and its gradients in respect
+    // to each piece of the extrinsics of each camera. All (3,3)
+    double rt01[6];
+    double dr01_dr_0ref[3*3], dt01_dr_0ref[3*3];
+    double dr01_dr_1ref[3*3], dt01_dr_1ref[3*3], dt01_dt_1ref[3*3];
+} pair_geometry_t;
+
+typedef struct
+{
+    mrcal_point3_t*                 p;
+    double*                         Var_p_observation;
+    double*                         dp_dstate;
+
+    const mrcal_point2_t*           q;
+    int                             N;
+    mrcal_triangulation_function_t* triangulate;
+    const mrcal_projector_t*        projectors[2];
+    const double*                   rt_0ref;
+    const double*                   Var_q;
+    const pair_geometry_t*          geometry;
+
+    int                             Nstate;
+    int                             istate_intrinsics[2];
+    int                             icol0_intrinsics, Nintrinsics_state;
+    int                             istate_extrinsics[2];
+    bool                            stabilize;
+    const double*                   rt_ref_frame;
+    int                             Nframes, istate_frames;
+
+    int                             ithread, Nthreads;
+    bool                            result;
+} triangulation_uncertainty_context_t;
+
+// out = A B, where A is (N,3) and B is (3,M). out may not alias the inputs.
+// All the matrices are dense
+static void mul_N3_3M(double* out, const double* A, const double* B,
+                      int N, int M)
+{
+    for(int i=0; i<N; i++)
+        for(int j=0; j<M; j++)
+            out[i*M + j] =
+                A[i*3 + 0]*B[0*M + j] +
+                A[i*3 + 1]*B[1*M + j] +
+                A[i*3 + 2]*B[2*M + j];
+}
+
+// Inverts a 3x3 matrix. Returns false if it is singular
+static bool invert_33(double* out, const double* m)
+{
+    out[0] = m[4]*m[8] - m[5]*m[7];
+    out[1] = m[2]*m[7] - m[1]*m[8];
+    out[2] = m[1]*m[5] - m[2]*m[4];
+    out[3] = m[5]*m[6] - m[3]*m[8];
+    out[4] = m[0]*m[8] - m[2]*m[6];
+    out[5] = m[2]*m[3] - m[0]*m[5];
+    out[6] = m[3]*m[7] - m[4]*m[6];
+    out[7] = m[1]*m[6] - m[0]*m[7];
+    out[8] = m[0]*m[4] - m[1]*m[3];
+    const double det = m[0]*out[0] + m[1]*out[3] + m[2]*out[6];
+    if(det == 0.0)
+        return false;
+    for(int i=0; i<9; i++)
+        out[i] /= det;
+    return true;
+}
+
+// Unprojects q, and computes dq/dv and dq/dintrinsics at the unprojected v.
+// dq_dintrinsics has shape (2,Nintrinsics_state), and contains only the columns
+// of the optimized intrinsics. It may be NULL if not wanted. Returns false on
+// error
+static bool unproject_withgrad(// out
+                               mrcal_point3_t* v,
+                               double*         dv_dq,          // (3,2)
+                               double*         dq_dintrinsics, // (2,Nintrinsics_state)
+                               // in
+                               const mrcal_point2_t*    q,
+                               const mrcal_projector_t* projector,
+                               int icol0_intrinsics, int Nintrinsics_state)
+{
+    if(!mrcal_projector_unproject(v, q, 1, projector))
+        return false;
+
+    mrcal_point2_t q_reprojected;
+    double         dq_dv[2*3];
+    if(!mrcal_projector_project_soa(&q_reprojected.x, 0,
+                                    &q_reprojected.y, 0,
+                                    dq_dv, 0, 3*sizeof(double), sizeof(double),
+                                    dq_dintrinsics,
+                                    0, Nintrinsics_state*sizeof(double), sizeof(double),
+                                    icol0_intrinsics, Nintrinsics_state,
+                                    &v->x, 0,
+                                    &v->y, 0,
+                                    &v->z, 0,
+                                    1,
+                                    projector))
+        return false;
+
+    // dq/dv is (2,3), and has rank 2: moving v along itself doesn't move q. I
+    // need dv/dq, a right-inverse of dq/dv. Any right-inverse will do: they
+    // differ only in the component along v, and the triangulated point doesn't
+    // depend on the length of v. So I use the pseudo-inverse
+    //
+    //   dv/dq = transpose(dq/dv) inv( dq/dv transpose(dq/dv) )
+    const double a = dq_dv[0]*dq_dv[0] + dq_dv[1]*dq_dv[1] + dq_dv[2]*dq_dv[2];
+    const double b = dq_dv[0]*dq_dv[3] + dq_dv[1]*dq_dv[4] + dq_dv[2]*dq_dv[5];
+    const double c = dq_dv[3]*dq_dv[3] + dq_dv[4]*dq_dv[4] + dq_dv[5]*dq_dv[5];
+    const double det = a*c - b*b;
+    if(det == 0.0)
+        return false;
+    const double inv[4] = {  c/det, -b/det,
+                            -b/det,  a/det };
+    for(int i=0; i<3; i++)
+    {
+        dv_dq[i*2 + 0] = dq_dv[0*3 + i]*inv[0] + dq_dv[1*3 + i]*inv[2];
+        dv_dq[i*2 + 1] = dq_dv[0*3 + i]*inv[1] + dq_dv[1*3 + i]*inv[3];
+    }
+    return true;
+}
+
+static void* triangulation_uncertainty_thread(void* _ctx)
+{
+    triangulation_uncertainty_context_t* ctx = (triangulation_uncertainty_context_t*)_ctx;
+    ctx->result = false;
+
+    const pair_geometry_t* geometry = ctx->geometry;
+    const int Nstate = ctx->Nstate;
+    const int Ni     = ctx->Nintrinsics_state;
+
+    // dq/dintrinsics for each camera, if I need it. Shape (2,Ni)
+    double* dq_dintrinsics[2] = {};
+    if(ctx->dp_dstate != NULL && Ni > 0)
+    {
+        dq_dintrinsics[0] = malloc(2*2*Ni*sizeof(double));
+        if(dq_dintrinsics[0] == NULL)
+        {
+            MSG("malloc() failed");
+            return NULL;
+        }
+        dq_dintrinsics[1] = &dq_dintrinsics[0][2*Ni];
+    }
+
+    const int Ntiles =
+        (ctx->N + TRIANGULATION_UNCERTAINTY_TILE_NPOINTS-1) / TRIANGULATION_UNCERTAINTY_TILE_NPOINTS;
+    for(int itile = ctx->ithread; itile < Ntiles; itile += ctx->Nthreads)
+    {
+        const int i0 = itile*TRIANGULATION_UNCERTAINTY_TILE_NPOINTS;
+        int       i1 = i0 + TRIANGULATION_UNCERTAINTY_TILE_NPOINTS;
+        if(i1 > ctx->N) i1 = ctx->N;
+
+        for(int ipt=i0; ipt<i1; ipt++)
+        {
+            // The data flow:
+            //   q0,i0                       -> v0 (same as vlocal0; I'm working in the cam0 coord system)
+            //   q1,i1                       -> vlocal1
+            //   r_0ref,r_1ref               -> r01
+            //   r_0ref,r_1ref,t_0ref,t_1ref -> t01
+            //   vlocal1,r01                 -> v1
+            //   v0,v1,t01                   -> p_triangulated
+            mrcal_point3_t v0, vlocal1, v1;
+            double dv0_dq0[3*2], dvlocal1_dq1[3*2];
+            double dv1_dr01[3*3], dv1_dvlocal1[3*3];
+
+            for(int icam=0; icam<2; icam++)
+                if(!unproject_withgrad(icam == 0 ? &v0      : &vlocal1,
+                                       icam == 0 ? dv0_dq0  : dvlocal1_dq1,
+                                       dq_dintrinsics[icam],
+                                       &ctx->q[2*ipt + icam],
+                                       ctx->projectors[icam],
+                                       ctx->icol0_intrinsics, Ni))
+                {
+                    MSG("Couldn't unproject point %d in camera %d", ipt, icam);
+                    goto done;
+                }
+
+            mrcal_rotate_point_r(v1.xyz, dv1_dr01, dv1_dvlocal1,
+                                 geometry->rt01, vlocal1.xyz);
+
+            // The triangulation routines don't touch the gradients if the
+            // triangulation fails. Those are 0 then
+            mrcal_point3_t dp_dv0[3] = {}, dp_dv1[3] = {}, dp_dt01[3] = {};
+            mrcal_point3_t* p = &ctx->p[ipt];
+            *p = ctx->triangulate(dp_dv0, dp_dv1, dp_dt01,
+                                  &v0, &v1,
+                                  (const mrcal_point3_t*)&geometry->rt01[3]);
+
+            // dp/dq has shape (3,4): (q0x,q0y,q1x,q1y) in each row
+            double dp_dvlocal1[3*3];
+            double dp_dq[3*4];
+            mul_N3_3M(dp_dvlocal1, dp_dv1[0].xyz, dv1_dvlocal1, 3,3);
+            for(int i=0; i<3; i++)
+                for(int j=0; j<2; j++)
+                {
+                    dp_dq[i*4 + j] =
+                        dp_dv0[i].x*dv0_dq0[0*2 + j] +
+                        dp_dv0[i].y*dv0_dq0[1*2 + j] +
+                        dp_dv0[i].z*dv0_dq0[2*2 + j];
+                    dp_dq[i*4 + 2 + j] =
+                        dp_dvlocal1[i*3 + 0]*dvlocal1_dq1[0*2 + j] +
+                        dp_dvlocal1[i*3 + 1]*dvlocal1_dq1[1*2 + j] +
+                        dp_dvlocal1[i*3 + 2]*dvlocal1_dq1[2*2 + j];
+                }
+
+            // triangulation-time uncertainty: dp/dq Var(q) transpose(dp/dq)
+            if(ctx->Var_p_observation != NULL)
+            {
+                double dp_dq__Var_q[3*4];
+                for(int i=0; i<3; i++)
+                    for(int j=0; j<4; j++)
+                    {
+                        double s = 0.0;
+                        for(int k=0; k<4; k++)
+                            s += dp_dq[i*4 + k]*ctx->Var_q[k*4 + j];
+                        dp_dq__Var_q[i*4 + j] = s;
+                    }
+                double* Var_p = &ctx->Var_p_observation[ipt*3*3];
+                for(int i=0; i<3; i++)
+                    for(int j=0; j<3; j++)
+                    {
+                        double s = 0.0;
+                        for(int k=0; k<4; k++)
+                            s += dp_dq__Var_q[i*4 + k]*dp_dq[j*4 + k];
+                        Var_p[i*3 + j] = s;
+                    }
+            }
+
+            if(ctx->dp_dstate == NULL)
+                continue;
+
+            // calibration-time uncertainty. I fill in the columns of
+            // dp/dstate that depend on the calibration. The rest are assumed
+            // to have been zeroed by the caller
+            double* dp_dstate = &ctx->dp_dstate[ipt*3*Nstate];
+
+            // The intrinsics: q is fixed, so moving the intrinsics moves v:
+            //   dq/dv dv + dq/di di = 0 -> dv/di = -dv/dq dq/di
+            // and thus
+            //   dp/di = dp/dv dv/di = -dp/dq dq/di
+            for(int icam=0; icam<2; icam++)
+            {
+                const int istate = ctx->istate_intrinsics[icam];
+                if(istate < 0 || Ni <= 0)
+                    continue;
+                const double* dqi = dq_dintrinsics[icam];
+                for(int i=0; i<3; i++)
+                    for(int j=0; j<Ni; j++)
+                        dp_dstate[i*Nstate + istate + j] =
+                            -dp_dq[i*4 + 2*icam + 0]*dqi[0*Ni + j]
+                            -dp_dq[i*4 + 2*icam + 1]*dqi[1*Ni + j];
+            }
+
+            // The extrinsics. These affect p through r01 (via v1) and t01
+            double dp_dr01[3*3];
+            mul_N3_3M(dp_dr01, dp_dv1[0].xyz, dv1_dr01, 3,3);
+
+            for(int icam=0; icam<2; icam++)
+            {
+                const int istate = ctx->istate_extrinsics[icam];
+                if(istate < 0)
+                    continue;
+
+                const double* dr01_dr = icam == 0 ? geometry->dr01_dr_0ref : geometry->dr01_dr_1ref;
+                const double* dt01_dr = icam == 0 ? geometry->dt01_dr_0ref : geometry->dt01_dr_1ref;
+
+                double dp_dr[3*3], dp_dr_t[3*3], dp_dt[3*3];
+                mul_N3_3M(dp_dr,   dp_dr01,        dr01_dr, 3,3);
+                mul_N3_3M(dp_dr_t, dp_dt01[0].xyz, dt01_dr, 3,3);
+                if(icam == 0)
+                    // dt01/dt_0ref is the identity
+                    memcpy(dp_dt, dp_dt01[0].xyz, sizeof(dp_dt));
+                else
+                    mul_N3_3M(dp_dt, dp_dt01[0].xyz, geometry->dt01_dt_1ref, 3,3);
+
+                for(int i=0; i<3; i++)
+                    for(int j=0; j<3; j++)
+                    {
+                        dp_dstate[i*Nstate + istate + j    ] = dp_dr[i*3 + j] + dp_dr_t[i*3 + j];
+                        dp_dstate[i*Nstate + istate + j + 3] = dp_dt[i*3 + j];
+                    }
+            }
+
+            if(!ctx->stabilize)
+                continue;
+
+            // The triangulated point is reported in the coordinate system of
+            // camera0, which moves if the calibration is perturbed. I
+            // compensate for this motion; see the detailed description in
+            // _triangulation_uncertainty_internal() in mrcal/triangulation.py.
+            // In short, the point in the (fixed) frame coordinate systems is
+            // the nominal representation, and the direct dependencies on
+            // rt_cam0_ref and rt_ref_frame are
+            //
+            //   dpc/drt_cr = dpc/dpr dpr/drt_cr
+            //   dpc/drt_rf = dpc/dpr dpr/dpf dpf/drt_rf
+            double p_ref[3];
+            double dp_ref_drt_0ref[3*6], dp_ref_dp_cam0[3*3];
+            double dp_cam0_dp_ref[3*3];
+            mrcal_transform_point_rt_inverted(p_ref, dp_ref_drt_0ref, dp_ref_dp_cam0,
+                                              ctx->rt_0ref, p->xyz);
+            if(!invert_33(dp_cam0_dp_ref, dp_ref_dp_cam0))
+            {
+                MSG("Singular transformation when stabilizing point %d", ipt);
+                goto done;
+            }
+
+            const int istate_e0 = ctx->istate_extrinsics[0];
+            if(istate_e0 >= 0)
+            {
+                double dp_drt_0ref[3*6];
+                mul_N3_3M(dp_drt_0ref, dp_cam0_dp_ref, dp_ref_drt_0ref, 3,6);
+                for(int i=0; i<3; i++)
+                    for(int j=0; j<6; j++)
+                        dp_dstate[i*Nstate + istate_e0 + j] += dp_drt_0ref[i*6 + j];
+            }
+
+            for(int iframe=0; iframe<ctx->Nframes; iframe++)
+            {
+                double p_frame[3];
+                double dp_frame_drtrf[3*6], dp_frame_dp_ref[3*3];
+                double dp_frame_dp_cam0[3*3], dp_cam0_dp_frame[3*3];
+                double dp_drtrf[3*6];
+                mrcal_transform_point_rt_inverted(p_frame, dp_frame_drtrf, dp_frame_dp_ref,
+                                                  &ctx->rt_ref_frame[iframe*6], p_ref);
+                mul_N3_3M(dp_frame_dp_cam0, dp_frame_dp_ref, dp_ref_dp_cam0, 3,3);
+                if(!invert_33(dp_cam0_dp_frame, dp_frame_dp_cam0))
+                {
+                    MSG("Singular transformation when stabilizing point %d", ipt);
+                    goto done;
+                }
+                mul_N3_3M(dp_drtrf, dp_cam0_dp_frame, dp_frame_drtrf, 3,6);
+
+                const int istate = ctx->istate_frames + iframe*6;
+                for(int i=0; i<3; i++)
+                    for(int j=0; j<6; j++)
+                        dp_dstate[i*Nstate + istate + j] = dp_drtrf[i*6 + j] / (double)ctx->Nframes;
+            }
+        }
+    }
+
+    ctx->result = true;
+
+ done:
+    free(dq_dintrinsics[0]);
+    return NULL;
+}
+
+bool mrcal_triangulate_with_uncertainty( // output
+                                        mrcal_point3_t* p,
+                                        double*         Var_p_observation,
+                                        double*         dp_dstate,
+
+                                        // input
+                                        const mrcal_point2_t*           q,
+                                        int                             N,
+                                        mrcal_triangulation_function_t* triangulate,
+                                        const mrcal_lensmodel_t*        lensmodel0,
+                                        const double*                   intrinsics0,
+                                        const double*                   rt_0ref,
+                                        const mrcal_lensmodel_t*        lensmodel1,
+                                        const double*                   intrinsics1,
+                                        const double*                   rt_1ref,
+                                        const double*                   Var_q,
+
+                                        int Nstate,
+                                        int istate_intrinsics0, int istate_intrinsics1,
+                                        int icol0_intrinsics,   int Nintrinsics_state,
+                                        int istate_extrinsics0, int istate_extrinsics1,
+                                        bool stabilize,
+                                        const double* rt_ref_frame,
+                                        int Nframes, int istate_frames,
+
+                                        int Nthreads)
+{
+    if(Var_p_observation != NULL && Var_q == NULL)
+    {
+        MSG("Var_p_observation requested, but Var_q not given");
+        return false;
+    }
+
+    // The geometry of the camera pair
+    pair_geometry_t geometry;
+    double rt_ref1[6];
+    double dt_ref1_dr_1ref[3*3], dt_ref1_dt_1ref[3*3];
+    double dr01_dr_ref1[3*3], dt01_dt_ref1[3*3];
+    mrcal_invert_rt(rt_ref1, dt_ref1_dr_1ref, dt_ref1_dt_1ref, rt_1ref);
+    mrcal_compose_rt(geometry.rt01,
+                     geometry.dr01_dr_0ref, dr01_dr_ref1,
+                     geometry.dt01_dr_0ref, dt01_dt_ref1,
+                     rt_0ref, rt_ref1);
+    // dr_ref1/dr_1ref = -I and dr_ref1/dt_1ref = 0. And dr01/dt_ref1 = 0 and
+    // dt01/dr_ref1 = 0
+    for(int i=0; i<9; i++)
+        geometry.dr01_dr_1ref[i] = -dr01_dr_ref1[i];
+    mul_N3_3M(geometry.dt01_dr_1ref, dt01_dt_ref1, dt_ref1_dr_1ref, 3,3);
+    mul_N3_3M(geometry.dt01_dt_1ref, dt01_dt_ref1, dt_ref1_dt_1ref, 3,3);
+
+    mrcal_projector_t* projectors[2] =
+        { mrcal_projector_new(lensmodel0, intrinsics0),
+          mrcal_projector_new(lensmodel1, intrinsics1) };
+    bool result = false;
+    if(projectors[0] == NULL || projectors[1] == NULL)
+        goto done;
+
+    {
+        Nthreads = _mrcal_get_Nthreads(Nthreads,
+                                       (N + TRIANGULATION_UNCERTAINTY_TILE_NPOINTS-1) / TRIANGULATION_UNCERTAINTY_TILE_NPOINTS);
+
+        triangulation_uncertainty_context_t ctx[Nthreads];
+        for(int i=0; i<Nthreads; i++)
+            ctx[i] = (triangulation_uncertainty_context_t)
+                { .p                  = p,
+                  .Var_p_observation  = Var_p_observation,
+                  .dp_dstate          = dp_dstate,
+                  .q                  = q,
+                  .N                  = N,
+                  .triangulate        = triangulate,
+                  .projectors         = {projectors[0], projectors[1]},
+                  .rt_0ref            = rt_0ref,
+                  .Var_q              = Var_q,
+                  .geometry           = &geometry,
+                  .Nstate             = Nstate,
+                  .istate_intrinsics  = {istate_intrinsics0, istate_intrinsics1},
+                  .icol0_intrinsics   = icol0_intrinsics,
+                  .Nintrinsics_state  = Nintrinsics_state,
+                  .istate_extrinsics  = {istate_extrinsics0, istate_extrinsics1},
+                  .stabilize          = stabilize,
+                  .rt_ref_frame       = rt_ref_frame,
+                  .Nframes            = rt_ref_frame != NULL ? Nframes : 0,
+                  .istate_frames      = istate_frames,
+                  .ithread            = i,
+                  .Nthreads           = Nthreads };
+
+        result = _mrcal_run_threads(&triangulation_uncertainty_thread,
+                                    ctx, sizeof(ctx[0]), Nthreads);
+        for(int i=0; i<Nthreads; i++)
+            result = result && ctx[i].result;
+    }
+
+ done:
+    mrcal_projector_free(&projectors[0]);
+    mrcal_projector_free(&projectors[1]);
+    return result;
+}
@@ -454,14 +454,22 @@ mrcal_triangulate_leecivera_l1(// outputs
     if(dot_v0t.x*dot_v0t.x * dot_v1v1.x > dot_v1t.x*dot_v1t.x * dot_v0v0.x )
     {
         // Equation (12)
-        vec_withgrad_t<9,3> n1 = cross<9>(v1, t01);
-        v0 -= n1 * v0.dot(n1)/n1.norm2();
+        vec_withgrad_t<9,3> n1       = cross<9>(v1, t01);
+        val_withgrad_t<9>   n1_norm2 = n1.norm2();
+        // v1 is parallel to t01: there's no epipolar plane
+        if(n1_norm2.x <= 0.0)
+            return (mrcal_point3_t){0};
+        v0 -= n1 * v0.dot(n1)/n1_norm2;
     }
     else
     {
         // Equation (13)
-        vec_withgrad_t<9,3> n0 = cross<9>(v0, t01);
-        v1 -= n0 * v1.dot(n0)/n0.norm2();
+        vec_withgrad_t<9,3> n0       = cross<9>(v0, t01);
+        val_withgrad_t<9>   n0_norm2 = n0.norm2();
+        // v0 is parallel to t01: there's no epipolar plane
+        if(n0_norm2.x <= 0.0)
+            return (mrcal_point3_t){0};
+        v1 -= n0 * v1.dot(n0)/n0_norm2;
     }
 
     // My two 3D rays now intersect exactly, and I use compute the intersection
@@ -525,8 +533,12 @@ mrcal_triangulate_leecivera_linf(// outputs
         ( na.norm2().x > nb.norm2().x ) ?
         na : nb;
 
-    v0 -= n * v0.dot(n)/n.norm2();
-    v1 -= n * v1.dot(n)/n.norm2();
+    val_withgrad_t<9> n_norm2 = n.norm2();
+    // v0 and v1 are both parallel to t01: there's no epipolar plane
+    if(n_norm2.x <= 0.0)
+        return (mrcal_point3_t){0};
+    v0 -= n * v0.dot(n)/n_norm2;
+    v1 -= n * v1.dot(n)/n_norm2;
 
     // My two 3D rays now intersect exactly, and I use compute the intersection
     // with that assumption
@@ -619,7 +631,11 @@ mrcal_triangulate_leecivera_mid2(// outputs
     vec_withgrad_t<9,3> v1 (_v1 ->xyz, 3);
     vec_withgrad_t<9,3> t01(_t01->xyz, 6);
 
-    val_withgrad_t<9> p_norm2_recip = val_withgrad_t<9>(1.0) / cross_norm2<9>(v0, v1);
+    val_withgrad_t<9> p_norm2 = cross_norm2<9>(v0, v1);
+    // Parallel rays
+    if(p_norm2.x <= 0.0)
+        return (mrcal_point3_t){0};
+    val_withgrad_t<9> p_norm2_recip = val_withgrad_t<9>(1.0) / p_norm2;
 
     val_withgrad_t<9> l0 = (cross_norm2<9>(v1, t01) * p_norm2_recip).sqrt();
     val_withgrad_t<9> l1 = (cross_norm2<9>(v0, t01) * p_norm2_recip).sqrt();
@@ -676,7 +692,11 @@ mrcal_triangulate_leecivera_wmid2(// outputs
     v0 /= v0.mag();
     v1 /= v1.mag();
 
-    val_withgrad_t<9> p_mag_recip = val_withgrad_t<9>(1.0) / cross_mag<9>(v0, v1);
+    val_withgrad_t<9> p_mag = cross_mag<9>(v0, v1);
+    // Parallel rays
+    if(p_mag.x <= 0.0)
+        return (mrcal_point3_t){0};
+    val_withgrad_t<9> p_mag_recip = val_withgrad_t<9>(1.0) / p_mag;
 
     val_withgrad_t<9> l0 = cross_mag<9>(v1, t01) * p_mag_recip;
     val_withgrad_t<9> l1 = cross_mag<9>(v0, t01) * p_mag_recip;
@@ -704,3 +724,746 @@ mrcal_triangulate_leecivera_wmid2(// outputs
 
     return _m;
 }
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// N-view triangulation
+////////////////////////////////////////////////////////////////////////////////
+
+// Solves A x = b for a symmetric 3x3 A, given by its upper triangle a00, a01,
+// a02, a11, a12, a22. Returns false if A is (nearly) singular
+template <int NGRAD>
+static
+bool
+solve_sym33( // output
+             vec_withgrad_t<NGRAD,3>& x,
+
+             // inputs
+             const val_withgrad_t<NGRAD>* a,
+             const vec_withgrad_t<NGRAD,3>& b)
+{
+    // The adjugate
+    val_withgrad_t<NGRAD> adj[6] =
+        { a[3]*a[5] - a[4]*a[4],
+          a[2]*a[4] - a[1]*a[5],
+          a[1]*a[4] - a[2]*a[3],
+          a[0]*a[5] - a[2]*a[2],
+          a[1]*a[2] - a[0]*a[4],
+          a[0]*a[3] - a[1]*a[1] };
+
+    val_withgrad_t<NGRAD> det = a[0]*adj[0] + a[1]*adj[1] + a[2]*adj[2];
+
+    // The threshold is relative to the scale of A, so that the result doesn't
+    // depend on the weighting of the terms that make up A
+    const double trace_3 = (a[0].x + a[3].x + a[5].x) / 3.;
+    if(fabs(det.x) <= 1e-10 * trace_3*trace_3*trace_3)
+        return false;
+
+    x.v[0] = (adj[0]*b.v[0] + adj[1]*b.v[1] + adj[2]*b.v[2]) / det;
+    x.v[1] = (adj[1]*b.v[0] + adj[3]*b.v[1] + adj[4]*b.v[2]) / det;
+    x.v[2] = (adj[2]*b.v[0] + adj[4]*b.v[1] + adj[5]*b.v[2]) / det;
+    return true;
+}
+
+// Reads view i. If i == igrad, v[i] and t[i] are gradient variables 0,1,2 and
+// 3,4,5 respectively. u is the normalized v[i]
+template <int NGRAD>
+static void
+get_nview_view( // outputs
+                vec_withgrad_t<NGRAD,3>& u,
+                vec_withgrad_t<NGRAD,3>& ti,
+
+                // inputs
+                const mrcal_point3_t* v,
+                const mrcal_point3_t* t,
+                int i,
+                int igrad)
+{
+    if(i == igrad)
+    {
+        u  = vec_withgrad_t<NGRAD,3>(v[i].xyz, 0);
+        ti = vec_withgrad_t<NGRAD,3>(t[i].xyz, 3);
+    }
+    else
+    {
+        u  = vec_withgrad_t<NGRAD,3>(v[i].xyz);
+        ti = vec_withgrad_t<NGRAD,3>(t[i].xyz);
+    }
+    u /= u.mag();
+}
+
+// The point must be in front of each camera
+static bool
+nview_chirality(const double* m,
+                const mrcal_point3_t* v,
+                const mrcal_point3_t* t,
+                int N)
+{
+    for(int i=0; i<N; i++)
+    {
+        double d = 0.0;
+        for(int j=0; j<3; j++)
+            d += (m[j] - t[i].xyz[j]) * v[i].xyz[j];
+        if(d <= 0.0)
+            return false;
+    }
+    return true;
+}
+
+// The "midpoint" N-view triangulation. If igrad >= 0, we propagate the
+// gradients in respect to the observation of view igrad: gradient variables
+// 0,1,2 are v[igrad] and 3,4,5 are t[igrad]. I call this N times to get the
+// gradients in respect to all the views. This is inefficient, but N is small,
+// and it keeps the number of gradients fixed at compile time
+//
+// Each observation is a ray in 3D, passing through t[i] in the direction of
+// v[i]. The point nearest to ray i is p = t[i] + k u[i], where u[i] is the
+// normalized v[i]. The squared distance from p to the ray is
+//
+//   E[i] = norm2( P[i] (p - t[i]) )
+//
+// where P[i] = I - u[i] u[i]t projects onto the plane orthogonal to u[i]. I
+// find the point that minimizes sum(E[i]). This is linear:
+//
+//   sum(P[i]) p = sum(P[i] t[i])
+//
+// For N = 2 this produces the same result as mrcal_triangulate_geometric().
+// The distance from p to each ray is weighted equally, so faraway cameras have
+// a disproportionate effect. The chirality isn't checked here
+template <int NGRAD>
+static bool
+triangulate_nview_midpoint( // output
+                            vec_withgrad_t<NGRAD,3>& m,
+
+                            // inputs
+                            const mrcal_point3_t* v,
+                            const mrcal_point3_t* t,
+                            int N,
+                            int igrad)
+{
+    if(N < 2)
+        return false;
+
+    // upper triangle of sum(P[i]) and sum(P[i] t[i])
+    val_withgrad_t<NGRAD>   A[6];
+    vec_withgrad_t<NGRAD,3> b;
+
+    for(int i=0; i<N; i++)
+    {
+        vec_withgrad_t<NGRAD,3> u, ti;
+        get_nview_view(u, ti, v, t, i, igrad);
+
+        // P t = t - u (u.t)
+        vec_withgrad_t<NGRAD,3> Pt = ti - u*u.dot(ti);
+
+        A[0] = A[0] + 1.0 - u.v[0]*u.v[0];
+        A[1] = A[1]       - u.v[0]*u.v[1];
+        A[2] = A[2]       - u.v[0]*u.v[2];
+        A[3] = A[3] + 1.0 - u.v[1]*u.v[1];
+        A[4] = A[4]       - u.v[1]*u.v[2];
+        A[5] = A[5] + 1.0 - u.v[2]*u.v[2];
+        b   += Pt;
+    }
+
+    return solve_sym33(m, A, b);
+}
+
+// The angular N-view triangulation minimizes
+//
+//   E = sum( sin(th[i])^2 )
+//
+// where th[i] is the angle between u[i] and d[i] = p - t[i]. Each term is the
+// squared norm of the residual
+//
+//   r[i] = P[i] d[i] / mag(d[i])
+//
+// and the gradient of E/2 in respect to p is
+//
+//   F = sum( J[i]t r[i] ) = sum( (P[i] d[i] - d[i] sin(th[i])^2) / norm2(d[i]) )
+//
+// This function evaluates F. The gradient variables in p, u, ti are whatever
+// the caller set up
+template <int NGRAD>
+static vec_withgrad_t<NGRAD,3>
+nview_angular_cost_gradient(const vec_withgrad_t<NGRAD,3>& p,
+                            const mrcal_point3_t* v,
+                            const mrcal_point3_t* t,
+                            int N,
+                            int igrad)
+{
+    vec_withgrad_t<NGRAD,3> F;
+    for(int i=0; i<N; i++)
+    {
+        vec_withgrad_t<NGRAD,3> u, ti;
+        get_nview_view(u, ti, v, t, i, igrad);
+
+        vec_withgrad_t<NGRAD,3> d  = p - ti;
+        val_withgrad_t<NGRAD>   d2 = d.norm2();
+        vec_withgrad_t<NGRAD,3> Pd = d - u*u.dot(d);
+
+        F += (Pd - d*(Pd.norm2() / d2)) / d2;
+    }
+    return F;
+}
+
+// Minimizes the angular cost described above with Gauss-Newton steps, seeded
+// from the midpoint solution. The gradients (if igrad >= 0) are those of the
+// minimizer: at the optimum F(p,x) = 0, so by the implicit function theorem
+//
+//   dp/dx = -inv(dF/dp) dF/dx
+//
+// where x are the observations of view igrad, and dF/dp is the full Hessian
+// of E/2. I compute this by taking one more Newton step from the converged p,
+// propagating the gradients of x only. That step doesn't move p (F = 0
+// there), but it produces exactly the gradients above
+template <int NGRAD>
+static bool
+triangulate_nview_angular( // output
+                           vec_withgrad_t<NGRAD,3>& m,
+
+                           // inputs
+                           const mrcal_point3_t* v,
+                           const mrcal_point3_t* t,
+                           int N,
+                           int igrad)
+{
+    vec_withgrad_t<0,3> m0;
+    if(!triangulate_nview_midpoint<0>(m0, v, t, N, -1))
+        return false;
+
+    double p[3];
+    m0.extract_value(p);
+
+    const int Niterations_max = 20;
+    for(int iteration = 0; iteration < Niterations_max; iteration++)
+    {
+        // J[i] = dr[i]/dp comes from the gradients of r[i] in respect to p
+        vec_withgrad_t<3,3> pg(p, 0);
+
+        // upper triangle of sum(J[i]t J[i]) and sum(J[i]t r[i])
+        val_withgrad_t<0>   JtJ[6];
+        vec_withgrad_t<0,3> Jtr;
+        for(int i=0; i<N; i++)
+        {
+            vec_withgrad_t<3,3> u, ti;
+            get_nview_view(u, ti, v, t, i, -1);
+
+            vec_withgrad_t<3,3> d = pg - ti;
+            vec_withgrad_t<3,3> r = (d - u*u.dot(d)) / d.mag();
+
+            int k = 0;
+            for(int j0=0; j0<3; j0++)
+            {
+                for(int j1=j0; j1<3; j1++, k++)
+                    for(int l=0; l<3; l++)
+                        JtJ[k].x += r.v[l].j[j0] * r.v[l].j[j1];
+                for(int l=0; l<3; l++)
+                    Jtr.v[j0].x += r.v[l].j[j0] * r.v[l].x;
+            }
+        }
+
+        vec_withgrad_t<0,3> delta;
+        if(!solve_sym33(delta, JtJ, Jtr))
+            return false;
+
+        double step2 = 0.0, p2 = 0.0;
+        for(int j=0; j<3; j++)
+        {
+            p[j] -= delta.v[j].x;
+            step2 += delta.v[j].x * delta.v[j].x;
+            p2    += p[j]*p[j];
+        }
+        if(step2 <= 1e-24 * p2)
+            break;
+    }
+
+    m = vec_withgrad_t<NGRAD,3>(p);
+    if(NGRAD > 0)
+    {
+        // The Hessian dF/dp at the optimum. It's symmetric; I use the upper
+        // triangle
+        vec_withgrad_t<3,3> F_dp =
+            nview_angular_cost_gradient(vec_withgrad_t<3,3>(p, 0), v, t, N, -1);
+        val_withgrad_t<NGRAD> H[6] =
+            { F_dp.v[0].j[0], F_dp.v[0].j[1], F_dp.v[0].j[2],
+                              F_dp.v[1].j[1], F_dp.v[1].j[2],
+                                              F_dp.v[2].j[2] };
+
+        vec_withgrad_t<NGRAD,3> F =
+            nview_angular_cost_gradient(m, v, t, N, igrad);
+        vec_withgrad_t<NGRAD,3> delta;
+        if(!solve_sym33(delta, H, F))
+            return false;
+        m -= delta;
+    }
+    return true;
+}
+
+// Triangulates a point observed from N>=2 views, checking the chirality. The
+// gradients are as described for triangulate_nview_midpoint()
+template <int NGRAD>
+static bool
+triangulate_nview( // output
+                   vec_withgrad_t<NGRAD,3>& m,
+
+                   // inputs
+                   const mrcal_point3_t* v,
+                   const mrcal_point3_t* t,
+                   int N,
+                   int igrad,
+                   bool angular)
+{
+    if(angular)
+    {
+        if(!triangulate_nview_angular(m, v, t, N, igrad))
+            return false;
+    }
+    else
+    {
+        if(!triangulate_nview_midpoint(m, v, t, N, igrad))
+            return false;
+    }
+
+    double _m[3];
+    m.extract_value(_m);
+    return nview_chirality(_m, v, t, N);
+}
+
+static
+mrcal_point3_t
+triangulate_nview_withgrad(// outputs
+                           // These may be NULL
+                           double* dm_dv,
+                           double* dm_dt,
+
+                           // inputs
+                           const mrcal_point3_t* v,
+                           const mrcal_point3_t* t,
+                           int N,
+                           bool angular)
+{
+    mrcal_point3_t _m;
+
+    if(dm_dv == NULL && dm_dt == NULL)
+    {
+        vec_withgrad_t<0,3> m;
+        if(!triangulate_nview<0>(m, v, t, N, -1, angular))
+            return (mrcal_point3_t){0};
+        m.extract_value(_m.xyz);
+        return _m;
+    }
+
+    for(int i=0; i<N; i++)
+    {
+        vec_withgrad_t<6,3> m;
+        if(!triangulate_nview<6>(m, v, t, N, i, angular))
+        {
+            // No valid solution. I report zero gradients
+            if(dm_dv != NULL) memset(dm_dv, 0, N*9*sizeof(double));
+            if(dm_dt != NULL) memset(dm_dt, 0, N*9*sizeof(double));
+            return (mrcal_point3_t){0};
+        }
+        if(i == 0)
+            m.extract_value(_m.xyz);
+        if(dm_dv != NULL)
+            m.extract_grad (&dm_dv[9*i], 0,3, 0,
+                            3*sizeof(double), sizeof(double),
+                            3);
+        if(dm_dt != NULL)
+            m.extract_grad (&dm_dt[9*i], 3,3, 0,
+                            3*sizeof(double), sizeof(double),
+                            3);
+    }
+    return _m;
+}
+
+// Minimize the sum of squared distances to the N rays. Closed form
+extern "C"
+mrcal_point3_t
+mrcal_triangulate_nview_geometric(// outputs
+                                  // These may be NULL
+                                  double* dm_dv,
+                                  double* dm_dt,
+
+                                  // inputs
+                                  const mrcal_point3_t* v,
+                                  const mrcal_point3_t* t,
+                                  int N)
+{
+    return triangulate_nview_withgrad(dm_dv, dm_dt, v, t, N, false);
+}
+
+// Minimize the sum of squared sin(angular errors). Gauss-Newton, starting at the
+// mrcal_triangulate_nview_geometric() solution
+extern "C"
+mrcal_point3_t
+mrcal_triangulate_nview_angular(// outputs
+                                // These may be NULL
+                                double* dm_dv,
+                                double* dm_dt,
+
+                                // inputs
+                                const mrcal_point3_t* v,
+                                const mrcal_point3_t* t,
+                                int N)
+{
+    return triangulate_nview_withgrad(dm_dv, dm_dt, v, t, N, true);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Batched triangulation routines. No gradients
+////////////////////////////////////////////////////////////////////////////////
+//
+// These compute the same thing as the routines above, with no gradients, for
+// many points at a time. The data is stored in SoA layout: all the x, then all
+// the y, then all the z. The per-point kernels below are plain-double,
+// branch-free and inlined into the loops over the points, so the compiler can
+// vectorize those loops, triangulating several points at once in the SIMD
+// lanes: each decision the above routines make with an if() is made here by
+// selecting between the two candidate values, and the validity checks are
+// combined with & instead of &&. Invalid points get (0,0,0), as before
+
+#define BATCH_KERNEL static inline __attribute__((always_inline))
+
+BATCH_KERNEL double dot3(const double* a, const double* b)
+{
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+BATCH_KERNEL void cross3(double* c, const double* a, const double* b)
+{
+    c[0] = a[1]*b[2] - a[2]*b[1];
+    c[1] = a[2]*b[0] - a[0]*b[2];
+    c[2] = a[0]*b[1] - a[1]*b[0];
+}
+BATCH_KERNEL double cross3_norm2(const double* a, const double* b)
+{
+    double c[3];
+    cross3(c, a,b);
+    return dot3(c,c);
+}
+BATCH_KERNEL void normalize3(double* a)
+{
+    const double s = 1.0 / sqrt(dot3(a,a));
+    a[0] *= s;
+    a[1] *= s;
+    a[2] *= s;
+}
+
+// Same as triangulate_assume_intersect() above
+BATCH_KERNEL bool
+triangulate_assume_intersect_nograd(// output
+                                    double* m,
+
+                                    // inputs. camera-0 coordinates
+                                    const double* v0,
+                                    const double* v1,
+                                    const double* t01)
+{
+    const double det_xz = v1[0]*v0[2] - v0[0]*v1[2];
+    const double det_yz = v1[1]*v0[2] - v0[1]*v1[2];
+
+    // Use xz or yz: whichever has the bigger abs(det)
+    const bool   use_xz = fabs(det_xz) > fabs(det_yz);
+    const double det    = use_xz ? det_xz : det_yz;
+    const double v0a    = use_xz ? v0 [0] : v0 [1];
+    const double v1a    = use_xz ? v1 [0] : v1 [1];
+    const double ta     = use_xz ? t01[0] : t01[1];
+
+    bool valid = fabs(det) > 1e-10;
+
+    const double k0 = (t01[2]*v1a - ta*v1[2]) / (valid ? det : 1.0);
+    const bool k1_negative = (t01[2]*v0a > ta*v0[2]) ^ (det > 0);
+    valid = valid & (k0 > 0.0) & !k1_negative;
+
+    m[0] = v0[0]*k0;
+    m[1] = v0[1]*k0;
+    m[2] = v0[2]*k0;
+    return valid;
+}
+
+// Same as chirality() above
+BATCH_KERNEL bool
+chirality_nograd(double l0, const double* v0,
+                 double l1, const double* v1,
+                 const double* t01)
+{
+    double len2_nominal = 0.0;
+    double len2_pp      = 0.0;
+    double len2_mp      = 0.0;
+    double len2_mm      = 0.0;
+    for(int i=0; i<3; i++)
+    {
+        const double x_nominal = ( l1*v1[i] + t01[i]) - l0*v0[i];
+        const double x_pp      = ( l1*v1[i] + t01[i]) + l0*v0[i];
+        const double x_mp      = (-l1*v1[i] + t01[i]) + l0*v0[i];
+        const double x_mm      = (-l1*v1[i] + t01[i]) - l0*v0[i];
+        len2_nominal += x_nominal*x_nominal;
+        len2_pp      += x_pp*x_pp;
+        len2_mp      += x_mp*x_mp;
+        len2_mm      += x_mm*x_mm;
+    }
+    return
+        !(len2_pp < len2_nominal) &
+        !(len2_mp < len2_nominal) &
+        !(len2_mm < len2_nominal);
+}
+
+BATCH_KERNEL bool
+triangulate_geometric_nograd(double* m,
+                             const double* v0, const double* v1, const double* t01)
+{
+    // Same math as mrcal_triangulate_geometric()
+    const double dot_v0v0 = dot3(v0,v0);
+    const double dot_v1v1 = dot3(v1,v1);
+    const double dot_v0v1 = dot3(v0,v1);
+    const double dot_v0t  = dot3(v0,t01);
+    const double dot_v1t  = dot3(v1,t01);
+
+    const double denom = dot_v0v0*dot_v1v1 - dot_v0v1*dot_v0v1;
+    bool valid = !(-1e-10 <= denom && denom <= 1e-10);
+
+    const double denom_recip = 1.0 / (valid ? denom : 1.0);
+    const double k0 = denom_recip * (dot_v1v1*dot_v0t - dot_v0v1*dot_v1t);
+    const double k1 = denom_recip * (dot_v0v1*dot_v0t - dot_v0v0*dot_v1t);
+    valid = valid & (k0 > 0.0) & (k1 > 0.0);
+
+    for(int i=0; i<3; i++)
+        m[i] = (v0[i]*k0 + v1[i]*k1 + t01[i]) * 0.5;
+    return valid;
+}
+
+BATCH_KERNEL bool
+triangulate_leecivera_l1_nograd(double* m,
+                                const double* _v0, const double* _v1, const double* t01)
+{
+    // Same math as mrcal_triangulate_leecivera_l1()
+    const double dot_v0v0 = dot3(_v0,_v0);
+    const double dot_v1v1 = dot3(_v1,_v1);
+    const double dot_v0t  = dot3(_v0,t01);
+    const double dot_v1t  = dot3(_v1,t01);
+
+    // If true, I use equation (12): I adjust v0. Otherwise, I use equation (13):
+    // I adjust v1
+    const bool adjust_v0 = dot_v0t*dot_v0t * dot_v1v1 > dot_v1t*dot_v1t * dot_v0v0;
+
+    double a[3], b[3];
+    for(int i=0; i<3; i++)
+    {
+        a[i] = adjust_v0 ? _v1[i] : _v0[i];
+        b[i] = adjust_v0 ? _v0[i] : _v1[i];
+    }
+
+    double n[3];
+    cross3(n, a, t01);
+    const double n_norm2 = dot3(n,n);
+    bool valid = n_norm2 > 0.0;
+    const double s = dot3(b,n) / (valid ? n_norm2 : 1.0);
+    for(int i=0; i<3; i++)
+        b[i] -= n[i]*s;
+
+    double v0[3], v1[3];
+    for(int i=0; i<3; i++)
+    {
+        v0[i] = adjust_v0 ? b[i]   : _v0[i];
+        v1[i] = adjust_v0 ? _v1[i] : b[i];
+    }
+
+    return triangulate_assume_intersect_nograd(m, v0, v1, t01) & valid;
+}
+
+BATCH_KERNEL bool
+triangulate_leecivera_linf_nograd(double* m,
+                                  const double* _v0, const double* _v1, const double* t01)
+{
+    // Same math as mrcal_triangulate_leecivera_linf()
+    double v0[3] = {_v0[0], _v0[1], _v0[2]};
+    double v1[3] = {_v1[0], _v1[1], _v1[2]};
+    normalize3(v0);
+    normalize3(v1);
+
+    double sum[3], diff[3];
+    for(int i=0; i<3; i++)
+    {
+        sum [i] = v0[i] + v1[i];
+        diff[i] = v0[i] - v1[i];
+    }
+    double na[3], nb[3];
+    cross3(na, sum,  t01);
+    cross3(nb, diff, t01);
+
+    const double na_norm2 = dot3(na,na);
+    const double nb_norm2 = dot3(nb,nb);
+    const bool   use_na   = na_norm2 > nb_norm2;
+    double n[3];
+    for(int i=0; i<3; i++)
+        n[i] = use_na ? na[i] : nb[i];
+    const double n_norm2 = use_na ? na_norm2 : nb_norm2;
+
+    bool valid = n_norm2 > 0.0;
+    const double n_norm2_recip = 1.0 / (valid ? n_norm2 : 1.0);
+    const double s0 = dot3(v0,n) * n_norm2_recip;
+    const double s1 = dot3(v1,n) * n_norm2_recip;
+    for(int i=0; i<3; i++)
+    {
+        v0[i] -= n[i]*s0;
+        v1[i] -= n[i]*s1;
+    }
+
+    return triangulate_assume_intersect_nograd(m, v0, v1, t01) & valid;
+}
+
+BATCH_KERNEL bool
+triangulate_leecivera_mid2_nograd(double* m,
+                                  const double* v0, const double* v1, const double* t01)
+{
+    // Same math as mrcal_triangulate_leecivera_mid2()
+    const double p_norm2 = cross3_norm2(v0, v1);
+    bool valid = p_norm2 > 0.0;
+    const double p_norm2_recip = 1.0 / (valid ? p_norm2 : 1.0);
+
+    const double l0 = sqrt(cross3_norm2(v1, t01) * p_norm2_recip);
+    const double l1 = sqrt(cross3_norm2(v0, t01) * p_norm2_recip);
+
+    valid = valid & chirality_nograd(l0, v0, l1, v1, t01);
+
+    for(int i=0; i<3; i++)
+        m[i] = (v0[i]*l0 + t01[i] + v1[i]*l1) / 2.0;
+    return valid;
+}
+
+BATCH_KERNEL bool
+triangulate_leecivera_wmid2_nograd(double* m,
+                                   const double* _v0, const double* _v1, const double* t01)
+{
+    // Same math as mrcal_triangulate_leecivera_wmid2()
+    double v0[3] = {_v0[0], _v0[1], _v0[2]};
+    double v1[3] = {_v1[0], _v1[1], _v1[2]};
+    normalize3(v0);
+    normalize3(v1);
+
+    const double p_mag = sqrt(cross3_norm2(v0, v1));
+    bool valid = p_mag > 0.0;
+    const double p_mag_recip = 1.0 / (valid ? p_mag : 1.0);
+
+    const double l0 = sqrt(cross3_norm2(v1, t01)) * p_mag_recip;
+    const double l1 = sqrt(cross3_norm2(v0, t01)) * p_mag_recip;
+
+    valid = valid & chirality_nograd(l0, v0, l1, v1, t01);
+
+    const double l01_recip = 1.0 / (valid ? (l0 + l1) : 1.0);
+    for(int i=0; i<3; i++)
+        m[i] = (v0[i]*l0*l1 + t01[i]*l0 + v1[i]*l0*l1) * l01_recip;
+    return valid;
+}
+
+BATCH_KERNEL bool
+triangulate_lindstrom_nograd(double* m,
+                             const double* v0_local, const double* v1_local,
+                             const double* Rt01)
+{
+    // Same math as mrcal_triangulate_lindstrom(). See the comments there
+    const double* R01 = &Rt01[0];
+    const double* t01 = &Rt01[9];
+
+    const double E[9] = { R01[6]*t01[1] - R01[3]*t01[2],
+                          R01[7]*t01[1] - R01[4]*t01[2],
+                          R01[8]*t01[1] - R01[5]*t01[2],
+
+                          R01[0]*t01[2] - R01[6]*t01[0],
+                          R01[1]*t01[2] - R01[7]*t01[0],
+                          R01[2]*t01[2] - R01[8]*t01[0],
+
+                          R01[3]*t01[0] - R01[0]*t01[1],
+                          R01[4]*t01[0] - R01[1]*t01[1],
+                          R01[5]*t01[0] - R01[2]*t01[1] };
+
+    const double x0[2] = { v0_local[0]/v0_local[2], v0_local[1]/v0_local[2] };
+    const double x1[2] = { v1_local[0]/v1_local[2], v1_local[1]/v1_local[2] };
+
+    double n[2] = { E[0]*x1[0] + E[1]*x1[1] + E[2],
+                    E[3]*x1[0] + E[4]*x1[1] + E[5] };
+    double nn[2] = { E[0]*x0[0] + E[3]*x0[1] + E[6],
+                     E[1]*x0[0] + E[4]*x0[1] + E[7] };
+
+    const double a =
+        n[0]*E[0]*nn[0] +
+        n[0]*E[1]*nn[1] +
+        n[1]*E[3]*nn[0] +
+        n[1]*E[4]*nn[1];
+    const double b = (n [0]*n [0] + n [1]*n [1] +
+                      nn[0]*nn[0] + nn[1]*nn[1]) * 0.5;
+    const double n_2 =
+        E[6]*x1[0] +
+        E[7]*x1[1] +
+        E[8];
+    const double c =
+        n[0]*x0[0] +
+        n[1]*x0[1] +
+        n_2;
+    const double d = sqrt(b*b - a*c);
+    double l = c / (b + d);
+
+    double dx [2] = { l * n [0], l * n [1] };
+    double dxx[2] = { l * nn[0], l * nn[1] };
+
+    n[0] = n[0] - E[0]*dxx[0] - E[1]*dxx[1];
+    n[1] = n[1] - E[3]*dxx[0] - E[4]*dxx[1];
+
+    nn[0] = nn[0] - E[0]*dx[0] - E[3]*dx[1];
+    nn[1] = nn[1] - E[1]*dx[0] - E[4]*dx[1];
+
+    const double bb = (n [0]*n [0] + n [1]*n [1] +
+                       nn[0]*nn[0] + nn[1]*nn[1]) * 0.5;
+    l = l/d * bb;
+
+    dx [0] = l * n [0];
+    dx [1] = l * n [1];
+    dxx[0] = l * nn[0];
+    dxx[1] = l * nn[1];
+
+    const double v0[3] = { x0[0] - dx [0], x0[1] - dx [1], 1.0 };
+    const double v1[3] = { x1[0] - dxx[0], x1[1] - dxx[1], 1.0 };
+
+    const double Rv1[3] = { R01[0]*v1[0] + R01[1]*v1[1] + R01[2]*v1[2],
+                            R01[3]*v1[0] + R01[4]*v1[1] + R01[5]*v1[2],
+                            R01[6]*v1[0] + R01[7]*v1[1] + R01[8]*v1[2] };
+
+    return triangulate_assume_intersect_nograd(m, v0, Rv1, t01);
+}
+
+// The loop over the points. Each input is an (Nvars,N) array: its N-long rows
+// are gathered into a per-point Nvars-long vector, and the kernel is evaluated
+// for that point
+#define DEFINE_TRIANGULATE_BATCH(name, arg0, arg1, arg2, Nvars2)        \
+extern "C"                                                              \
+void                                                                    \
+mrcal_triangulate_ ## name ## _batch(double*       __restrict__ m,      \
+                                     const double* __restrict__ arg0,   \
+                                     const double* __restrict__ arg1,   \
+                                     const double* __restrict__ arg2,   \
+                                     int N)                             \
+{                                                                       \
+    _Pragma("GCC ivdep")                                                \
+    for(int i=0; i<N; i++)                                              \
+    {                                                                   \
+        const double a0[3] = { arg0[i], arg0[N+i], arg0[2*N+i] };       \
+        const double a1[3] = { arg1[i], arg1[N+i], arg1[2*N+i] };       \
+        double a2[Nvars2];                                              \
+        for(int j=0; j<Nvars2; j++)                                     \
+            a2[j] = arg2[j*N + i];                                      \
+                                                                        \
+        double _m[3];                                                   \
+        const bool valid =                                              \
+            triangulate_ ## name ## _nograd(_m, a0, a1, a2);            \
+        m[i]     = valid ? _m[0] : 0.0;                                 \
+        m[N+i]   = valid ? _m[1] : 0.0;                                 \
+        m[2*N+i] = valid ? _m[2] : 0.0;                                 \
+    }                                                                   \
+}
+
+#define DEFINE_TRIANGULATE_BATCH_CAMERA0(name) \
+    DEFINE_TRIANGULATE_BATCH(name, v0, v1, t01, 3)
+MRCAL_TRIANGULATION_METHOD_LIST(DEFINE_TRIANGULATE_BATCH_CAMERA0)
+DEFINE_TRIANGULATE_BATCH(lindstrom, v0_local, v1_local, Rt01, 12)
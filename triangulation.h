@@ -121,3 +121,119 @@ mrcal_triangulate_leecivera_wmid2(// outputs
 // I don't implement triangulate_leecivera_l2() yet because it requires
 // computing an SVD, which is far slower than what the rest of these functions
 // do
+
+// All the above routines that take their inputs in the camera-0 coordinate
+// system have the same prototype: everything except
+// mrcal_triangulate_lindstrom(). This is the type of these functions, to
+// select the triangulation method in the routines that call them many times
+typedef mrcal_point3_t
+(mrcal_triangulation_function_t)(// outputs
+                                 // These all may be NULL
+                                 mrcal_point3_t* dm_dv0,
+                                 mrcal_point3_t* dm_dv1,
+                                 mrcal_point3_t* dm_dt01,
+
+                                 // inputs
+                                 const mrcal_point3_t* v0,
+                                 const mrcal_point3_t* v1,
+                                 const mrcal_point3_t* t01);
+
+// The names of the functions with this prototype, as an "X macro":
+// https://en.wikipedia.org/wiki/X_Macro
+// mrcal_triangulate_NAME() for each NAME in the list
+#define MRCAL_TRIANGULATION_METHOD_LIST(_) \
+    _(geometric)                            \
+    _(leecivera_l1)                         \
+    _(leecivera_linf)                       \
+    _(leecivera_mid2)                       \
+    _(leecivera_wmid2)
+
+
+// Batched versions of the above routines, without gradients. These
+// triangulate N points per call, and are much faster than calling the
+// per-point routines in a loop: several points are computed at a time in SIMD
+// lanes. The results are the same, up to floating-point round-off; invalid
+// points are reported as (0,0,0)
+//
+// All the arrays are stored in the SoA layout: each is an (Nvars,N) array,
+// with contiguous rows. So m[N*0 + i], m[N*1 + i], m[N*2 + i] are the x,y,z
+// of point i. The v0, v1, t01 arrays are (3,N). Each point has its own t01:
+// if all the points come from the same camera pair, the t01 array has
+// identical columns
+//
+// mrcal_triangulate_NAME_batch() for each NAME in
+// MRCAL_TRIANGULATION_METHOD_LIST has this prototype
+typedef void
+(mrcal_triangulation_batch_function_t)(// output. (3,N) array
+                                       double* m,
+
+                                       // inputs. (3,N) arrays
+
+                                       // not-necessarily normalized vectors in
+                                       // the camera-0 coord system
+                                       const double* v0,
+                                       const double* v1,
+                                       const double* t01,
+                                       int N);
+
+#define MRCAL_DECLARE_TRIANGULATE_BATCH(name) \
+    mrcal_triangulation_batch_function_t mrcal_triangulate_ ## name ## _batch;
+MRCAL_TRIANGULATION_METHOD_LIST(MRCAL_DECLARE_TRIANGULATE_BATCH)
+#undef MRCAL_DECLARE_TRIANGULATE_BATCH
+
+// Batched mrcal_triangulate_lindstrom(). The v0_local, v1_local arrays are
+// (3,N). Rt01 is (12,N): each column is a flattened (4,3) Rt01 transformation
+void
+mrcal_triangulate_lindstrom_batch(// output. (3,N) array
+                                  double* m,
+
+                                  // inputs
+
+                                  // not-necessarily normalized vectors in the
+                                  // LOCAL coordinate system
+                                  const double* v0_local,
+                                  const double* v1_local,
+                                  const double* Rt01,
+                                  int N);
+
+
+// N-view triangulation. These triangulate a point observed by N >= 2 cameras.
+// v[i] is the observation vector from camera i and t[i] is the position of
+// camera i. Both are given in the same (reference) coordinate system, and the
+// v[i] don't need to be normalized. The triangulated point is returned in that
+// coordinate system. As with the 2-view routines, we return (0,0,0) if there's
+// no valid solution: the rays are parallel, or the point is behind any of the
+// cameras. The gradients are then reported as 0
+//
+// If dm_dv or dm_dt are not NULL, they are (N,3,3) arrays, and we report the
+// gradients in them: dm_dv[i] = dm/dv[i] and dm_dt[i] = dm/dt[i]
+
+// Minimizes the sum of squared distances from the point to each ray. This is a
+// closed form. For N == 2 this produces the same result as
+// mrcal_triangulate_geometric()
+mrcal_point3_t
+mrcal_triangulate_nview_geometric(// outputs
+                                  // These may be NULL
+                                  double* dm_dv,
+                                  double* dm_dt,
+
+                                  // inputs
+                                  const mrcal_point3_t* v,
+                                  const mrcal_point3_t* t,
+                                  int N);
+
+// Minimizes the sum of squared sines of the angular errors: the angles between
+// each v[i] and the vector from t[i] to the point. This is solved with
+// Gauss-Newton steps, starting from the mrcal_triangulate_nview_geometric()
+// solution. Unlike that method, this one isn't biased towards the cameras
+// closest to the point
+mrcal_point3_t
+mrcal_triangulate_nview_angular(// outputs
+                                // These may be NULL
+                                double* dm_dv,
+                                double* dm_dt,
+
+                                // inputs
+                                const mrcal_point3_t* v,
+                                const mrcal_point3_t* t,
+                                int N);